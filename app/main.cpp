@@ -1,15 +1,15 @@
 #include <iostream>
 #include <vector>
 #include <cstring>
-#include <thread>
-#include <chrono>
 
 // Core utilities
 #include "utils/logger.h"
+#include "video/ContentAnalyzer.h"
 
 // Rust FFI bindings
 #include "audio_ffi.h"
 #include "video_ffi.h"
+#include "encoder_hints.h"
 
 void demonstrate_audio_mixing() {
     std::cout << "\n=== Audio Mixing Demo ===" << std::endl;
@@ -77,32 +77,46 @@ void demonstrate_video_encoding() {
 
     std::cout << "Encoder started successfully" << std::endl;
 
-    // Submit some test frames
-    const size_t frame_size = 1920 * 1080 * 3;  // RGB24
-    std::vector<uint8_t> frame_data(frame_size, 128);  // Gray frame
-
+    // Submit some test frames: five gray, then a cut to white. The
+    // analyzer flags the first white frame so the encoder starts an IDR there.
+    ContentAnalyzer analyzer;
     for (int i = 0; i < 10; ++i) {
-        bool success = encoder_submit_frame(
+        VideoFrame frame(1920, 1080);  // RGBA
+        std::memset(frame.plane(0), i < 5 ? 128 : 255, (size_t)frame.stride(0) * frame.height);
+        frame.timestamp = i * 33333;  // ~30fps timestamp in microseconds
+        analyzer.process(frame);
+
+        CFrameHints hints = encoderHintsFor(frame);
+        bool success = encoder_submit_frame_with_hints(
             encoder,
-            frame_data.data(),
-            frame_size,
-            i * 33333  // ~30fps timestamp in microseconds
+            frame.plane(0),
+            (size_t)frame.stride(0) * frame.height,
+            (int64_t)frame.timestamp,
+            &hints
         );
 
         if (success) {
-            std::cout << "Submitted frame " << i << std::endl;
+            std::cout << "Submitted frame " << i << (hints.force_keyframe ? " (keyframe)" : "") << std::endl;
         } else {
             std::cerr << "Failed to submit frame " << i << std::endl;
             break;
         }
     }
 
-    // Wait a bit for encoding to complete
-    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    // Wait for encoding to complete, then pull the packets
+    encoder_flush(encoder);
+    CEncodedPacket packet;
+    while (encoder_receive_packet(encoder, &packet)) {
+        std::cout << "Packet " << packet.sequence << ": " << packet.size << " bytes, pts " << packet.pts
+                  << (packet.scene_cut ? " (scene cut)" : "") << std::endl;
+        encoder_release_packet(encoder, &packet);
+    }
 
     // Get statistics
-    uint64_t encoded = encoder_get_encoded_frames(encoder);
-    std::cout << "Encoded frames: " << encoded << std::endl;
+    CEncoderStats stats;
+    encoder_get_stats(encoder, &stats);
+    std::cout << "Encoded frames: " << stats.encoded << ", avg latency " << stats.avg_latency_ms
+              << " ms, peak in flight " << stats.peak_in_flight << "/" << stats.max_in_flight << std::endl;
 
     // Stop and clean up
     encoder_stop(encoder);
@@ -1,17 +1,27 @@
 #include "audio_ffi.h"
 #include "../../core/audio/MicrophoneSource.h"
+#include "../../core/audio/SpeakerSink.h"
+#include "utils/ready_signal.h"
 #include <memory>
 #include <string>
 #include <algorithm>
+#include <cstring>
+#include <mutex>
 
 struct AudioContext {
     std::unique_ptr<MicrophoneSource> source;
+    // Reused by every audio_get_frame() call instead of allocating one each time
+    std::mutex frameMutex;
+    AudioFrame frame;
+    core::utils::ReadySignal ready;
+    int listenerId = 0;
 };
 
 AudioContext* audio_create(int device_index) {
     try {
         auto ctx = new AudioContext();
         ctx->source = std::make_unique<MicrophoneSource>(std::to_string(device_index));
+        ctx->listenerId = ctx->source->addDataListener([ctx]() { ctx->ready.notify(); });
         return ctx;
     } catch (...) {
         return nullptr;
@@ -19,7 +29,10 @@ AudioContext* audio_create(int device_index) {
 }
 
 void audio_destroy(AudioContext* ctx) {
-    if (ctx) delete ctx;
+    if (!ctx) return;
+    // The capture callback must be done with the signal before it goes
+    ctx->source->removeDataListener(ctx->listenerId);
+    delete ctx;
 }
 
 bool audio_start(AudioContext* ctx) {
@@ -34,10 +47,12 @@ void audio_stop(AudioContext* ctx) {
 int audio_get_frame(AudioContext* ctx, float* buffer, int buffer_len, int* channels, int* sample_rate, uint64_t* timestamp) {
     if (!ctx || !ctx->source) return 0;
 
-    AudioFrame frame;
+    std::lock_guard<std::mutex> lock(ctx->frameMutex);
+    ctx->ready.clear();
+    AudioFrame& frame = ctx->frame;
     if (ctx->source->getFrame(frame)) {
         if (buffer) {
-            int copy_count = std::min((int)frame.data.size(), buffer_len);
+            int copy_count = std::min((int)frame.data.size(), std::max(buffer_len, 0));
             std::memcpy(buffer, frame.data.data(), copy_count * sizeof(float));
             
             if (channels) *channels = frame.channels;
@@ -50,6 +65,79 @@ int audio_get_frame(AudioContext* ctx, float* buffer, int buffer_len, int* chann
     return 0;
 }
 
+int audio_get_ready_fd(AudioContext* ctx) {
+    if (!ctx) return -1;
+    return ctx->ready.fd();
+}
+
+int audio_read_samples(AudioContext* ctx, float* buffer, int buffer_len, int* channels, int* sample_rate, uint64_t* timestamp) {
+    if (!ctx || !ctx->source || !buffer || buffer_len <= 0) return 0;
+
+    ctx->ready.clear();
+    size_t count = ctx->source->readSamples(buffer, (size_t)buffer_len, timestamp);
+    int frameSamples = std::max(ctx->source->getChannels(), 1);
+    // Stopped short of everything queued: come back for the rest
+    if (count + frameSamples > (size_t)buffer_len) ctx->ready.notify();
+    if (channels) *channels = ctx->source->getChannels();
+    if (sample_rate) *sample_rate = ctx->source->getSampleRate();
+    return (int)count;
+}
+
+// --- Speaker Implementation ---
+struct SpeakerContext {
+    std::unique_ptr<SpeakerSink> sink;
+    // Shared with the drain listener, which runs on the audio thread
+    std::shared_ptr<core::utils::ReadySignal> ready;
+    size_t lowWater = 0;
+};
+
+SpeakerContext* speaker_create(int low_water_samples) {
+    try {
+        auto ctx = new SpeakerContext();
+        ctx->sink = std::make_unique<SpeakerSink>();
+        ctx->ready = std::make_shared<core::utils::ReadySignal>();
+        ctx->lowWater = low_water_samples > 0 ? (size_t)low_water_samples : 44100 * 2 / 4;
+        std::shared_ptr<core::utils::ReadySignal> ready = ctx->ready;
+        ctx->sink->setDrainListener([ready]() { ready->notify(); }, ctx->lowWater);
+        // Nothing queued yet
+        ctx->ready->notify();
+        return ctx;
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void speaker_destroy(SpeakerContext* ctx) {
+    if (ctx) delete ctx;
+}
+
+bool speaker_start(SpeakerContext* ctx) {
+    if (!ctx || !ctx->sink) return false;
+    return ctx->sink->start();
+}
+
+void speaker_stop(SpeakerContext* ctx) {
+    if (ctx && ctx->sink) ctx->sink->stop();
+}
+
+bool speaker_push_samples(SpeakerContext* ctx, const float* samples, int count) {
+    if (!ctx || !ctx->sink || !samples || count < 0) return false;
+    ctx->ready->clear();
+    ctx->sink->pushSamples(samples, (size_t)count);
+    if (ctx->sink->getQueuedSamples() <= ctx->lowWater) ctx->ready->notify();
+    return true;
+}
+
+int speaker_get_queued_samples(SpeakerContext* ctx) {
+    if (!ctx || !ctx->sink) return 0;
+    return (int)ctx->sink->getQueuedSamples();
+}
+
+int speaker_get_ready_fd(SpeakerContext* ctx) {
+    if (!ctx || !ctx->ready) return -1;
+    return ctx->ready->fd();
+}
+
 // --- Audio Mixer Implementation (Dummy/Mock) ---
 struct AudioMixer {
     int channels;
@@ -45,6 +45,55 @@ void audio_stop(AudioContext* ctx);
  */
 int audio_get_frame(AudioContext* ctx, float* buffer, int buffer_len, int* channels, int* sample_rate, uint64_t* timestamp);
 
+/**
+ * Readable while captured samples may be waiting, for epoll or Tokio's
+ * AsyncFd. Register it for reading but never read it; audio_get_frame()
+ * and audio_read_samples() clear it.
+ * @return A file descriptor owned by the context, or -1.
+ */
+int audio_get_ready_fd(AudioContext* ctx);
+
+/**
+ * Drain every captured sample, up to buffer_len, in one call.
+ * @param buffer Interleaved float output.
+ * @param buffer_len Size of the buffer in floats. Only whole sample frames
+ *        (one sample per channel) are copied; if more remain, the fd stays readable.
+ * @param channels Output: number of channels.
+ * @param sample_rate Output: sample rate.
+ * @param timestamp Output: capture clock at the read (microseconds).
+ * @return Number of floats copied, 0 if none were waiting.
+ */
+int audio_read_samples(AudioContext* ctx, float* buffer, int buffer_len, int* channels, int* sample_rate, uint64_t* timestamp);
+
+// --- Speaker API ---
+typedef struct SpeakerContext SpeakerContext;
+
+/**
+ * Create a playback sink on the default output device (44.1 kHz stereo float).
+ * @param low_water_samples The ready fd turns readable once no more than
+ *        this many samples are queued; 0 means a quarter second.
+ * @return Pointer to SpeakerContext or NULL.
+ */
+SpeakerContext* speaker_create(int low_water_samples);
+void speaker_destroy(SpeakerContext* ctx);
+bool speaker_start(SpeakerContext* ctx);
+void speaker_stop(SpeakerContext* ctx);
+
+/**
+ * Queue interleaved samples for playback, any number per call.
+ * @return false on a bad argument.
+ */
+bool speaker_push_samples(SpeakerContext* ctx, const float* samples, int count);
+
+int speaker_get_queued_samples(SpeakerContext* ctx);
+
+/**
+ * Readable when playback has drained the queue to the low-water mark, so
+ * a producer can sleep until more audio is wanted. speaker_push_samples()
+ * clears it.
+ */
+int speaker_get_ready_fd(SpeakerContext* ctx);
+
 // --- Audio Mixer API (Restored) ---
 typedef struct AudioMixer AudioMixer;
 
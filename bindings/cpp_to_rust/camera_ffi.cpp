@@ -1,20 +1,26 @@
 #include "camera_ffi.h"
+#include "frame_lending.h"
 #include "../../core/video/CameraSource.h"
+#include "../../core/video/SourceManager.h"
 #include <memory>
 #include <string>
 
 struct CameraContext {
-    std::unique_ptr<CameraSource> source;
+    std::shared_ptr<CameraSource> source;
     // Cache last frame dimensions to avoid checking every time if needed
     int width = 0;
     int height = 0;
+    // Readiness fd and the frame camera_copy_frame() had no room for
+    std::unique_ptr<FrameLender> lender;
+    bool registered = false;
 };
 
 CameraContext* camera_create(int device_index) {
     try {
         auto ctx = new CameraContext();
         // Convert integer index to string ID expected by CameraSource
-        ctx->source = std::make_unique<CameraSource>(std::to_string(device_index));
+        ctx->source = std::make_shared<CameraSource>(std::to_string(device_index));
+        ctx->lender = std::make_unique<FrameLender>(ctx->source);
         return ctx;
     } catch (...) {
         return nullptr;
@@ -23,6 +29,10 @@ CameraContext* camera_create(int device_index) {
 
 void camera_destroy(CameraContext* ctx) {
     if (ctx) {
+        auto& manager = SourceManager::getInstance();
+        if (ctx->registered && manager.getSource(ctx->source->getName()) == ctx->source) {
+            manager.removeSource(ctx->source->getName());
+        }
         delete ctx;
     }
 }
@@ -42,11 +52,11 @@ bool camera_get_frame(CameraContext* ctx, uint8_t* buffer, int* width, int* heig
     if (!ctx || !ctx->source) return false;
 
     VideoFrame frame;
-    if (ctx->source->getFrame(frame)) {
+    if (ctx->lender->take(frame)) {
         if (buffer) {
             // Safety check: caller must ensure buffer is large enough.
-            // In a production FFI, we should pass buffer size to verify.
-            std::memcpy(buffer, frame.data.data(), frame.data.size());
+            // camera_copy_frame() is the checked variant.
+            frame.copyTo(buffer, frame.packedSize());
         }
         
         if (width) *width = frame.width;
@@ -57,3 +67,30 @@ bool camera_get_frame(CameraContext* ctx, uint8_t* buffer, int* width, int* heig
     }
     return false;
 }
+
+bool camera_borrow_frame(CameraContext* ctx, CCameraFrame* frame) {
+    if (!ctx || !ctx->source) return false;
+    return ctx->lender->borrow(frame);
+}
+
+void camera_release_frame(CameraContext*, CCameraFrame* frame) {
+    returnLentFrame(frame);
+}
+
+bool camera_copy_frame(CameraContext* ctx, uint8_t* buffer, size_t buffer_size, size_t* frame_size, int* width,
+                       int* height, uint64_t* timestamp) {
+    if (!ctx || !ctx->source) return false;
+    return ctx->lender->copy(buffer, buffer_size, frame_size, width, height, timestamp);
+}
+
+int camera_get_ready_fd(CameraContext* ctx) {
+    if (!ctx || !ctx->lender) return -1;
+    return ctx->lender->readyFd();
+}
+
+bool camera_register_source(CameraContext* ctx) {
+    if (!ctx || !ctx->source) return false;
+    SourceManager::getInstance().addSource(ctx->source);
+    ctx->registered = true;
+    return true;
+}
@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -11,6 +12,27 @@ extern "C" {
 // Opaque handle for the camera source
 typedef struct CameraContext CameraContext;
 
+typedef enum {
+    CAMERA_FORMAT_RGBA = 0,
+    CAMERA_FORMAT_I420 = 1,  // Planes Y, U, V
+    CAMERA_FORMAT_NV12 = 2   // Planes Y, UV
+} CCameraFormat;
+
+// A captured frame lent to the caller. The pixels are the camera's own
+// pooled buffer, not a copy: read-only, valid until camera_release_frame().
+// The camera keeps capturing into other buffers meanwhile.
+typedef struct {
+    const uint8_t* planes[3];
+    int strides[3];     // Bytes between rows; rows start 64-byte aligned
+    int plane_count;
+    int width;
+    int height;
+    CCameraFormat format;
+    uint64_t timestamp; // Microseconds
+    bool unchanged;     // Same pixels as the previous frame
+    void* handle;       // Owned by the camera; do not touch
+} CCameraFrame;
+
 /**
  * Create a new camera source instance.
  * @param device_index The index of the camera (e.g., 0 for default).
@@ -39,6 +61,7 @@ void camera_stop(CameraContext* ctx);
 
 /**
  * Retrieve the latest video frame.
+ * Unchecked: prefer camera_borrow_frame(), or camera_copy_frame() when a copy is needed.
  * @param ctx The camera context.
  * @param buffer Pointer to the destination buffer (must be large enough: w * h * 4 for RGBA).
  * @param width Output pointer for frame width.
@@ -48,6 +71,57 @@ void camera_stop(CameraContext* ctx);
  */
 bool camera_get_frame(CameraContext* ctx, uint8_t* buffer, int* width, int* height, uint64_t* timestamp);
 
+/**
+ * Borrow the latest video frame without copying it.
+ * @param ctx The camera context.
+ * @param frame Filled in on success; hand it back with camera_release_frame().
+ * @return true if a new frame was lent, false if no new frame is available.
+ */
+bool camera_borrow_frame(CameraContext* ctx, CCameraFrame* frame);
+
+/**
+ * Return a borrowed frame's buffer to the camera's pool. Frames may be
+ * released in any order, from any thread, and after camera_destroy().
+ * @param ctx The camera context, or NULL.
+ * @param frame A frame from camera_borrow_frame(); cleared on return.
+ */
+void camera_release_frame(CameraContext* ctx, CCameraFrame* frame);
+
+/**
+ * Copy the latest video frame with rows tightly packed, plane after plane.
+ * @param ctx The camera context.
+ * @param buffer Destination buffer.
+ * @param buffer_size Size of buffer in bytes.
+ * @param frame_size Output: bytes the frame needs. If buffer_size is too
+ *        small nothing is copied and the frame is offered again by the
+ *        next call, unless a newer one has arrived.
+ * @param width Output pointer for frame width.
+ * @param height Output pointer for frame height.
+ * @param timestamp Output pointer for timestamp (microseconds).
+ * @return true if a frame was copied.
+ */
+bool camera_copy_frame(CameraContext* ctx, uint8_t* buffer, size_t buffer_size, size_t* frame_size, int* width,
+                       int* height, uint64_t* timestamp);
+
+/**
+ * Readiness for event loops (epoll, Tokio's AsyncFd): the descriptor is
+ * readable while a new frame may be waiting, so there is no need to poll.
+ * Register it for reading but never read it; any frame call clears it.
+ * @param ctx The camera context.
+ * @return A file descriptor owned by the context, or -1.
+ */
+int camera_get_ready_fd(CameraContext* ctx);
+
+/**
+ * Add the camera to the SourceManager, so source_manager_borrow_frames()
+ * collects its frames along with every other source's. The manager only
+ * looks at the newest frame without taking it, so camera_borrow_frame()
+ * and the other frame calls still see every frame as well.
+ * @param ctx The camera context.
+ * @return true on success.
+ */
+bool camera_register_source(CameraContext* ctx);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,23 @@
+#ifndef ENCODER_HINTS_H
+#define ENCODER_HINTS_H
+
+#include "video_ffi.h"
+#include "../../core/video/VideoFrame.h"
+
+// Encoder hints for a frame's ContentAnalyzer result. The motion map
+// points into frame.analysis, so keep the frame alive until the submit
+// call returns. Frames without analysis get neutral hints.
+inline CFrameHints encoderHintsFor(const VideoFrame& frame) {
+    CFrameHints hints = {};
+    const FrameAnalysis* analysis = frame.analysis.get();
+    if (!analysis) return hints;
+    hints.force_keyframe = analysis->sceneCut;
+    hints.scene_change_score = (float)analysis->sceneChangeScore;
+    hints.motion_activity = (float)analysis->motionActivity;
+    hints.motion_cols = analysis->motionCols;
+    hints.motion_rows = analysis->motionRows;
+    hints.motion_map = analysis->motion.empty() ? nullptr : analysis->motion.data();
+    return hints;
+}
+
+#endif // ENCODER_HINTS_H
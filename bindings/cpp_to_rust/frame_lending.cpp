@@ -0,0 +1,74 @@
+#include "frame_lending.h"
+#include <memory>
+
+void lendFrame(const VideoFrame& frame, CCameraFrame* out) {
+    auto held = std::make_unique<VideoFrame>(frame);
+    *out = CCameraFrame{};
+    for (int i = 0; i < held->planeCount; ++i) {
+        out->planes[i] = held->plane(i);
+        out->strides[i] = held->stride(i);
+    }
+    out->plane_count = held->planeCount;
+    out->width = held->width;
+    out->height = held->height;
+    out->format = (CCameraFormat)held->format;
+    out->timestamp = held->timestamp;
+    out->unchanged = held->unchanged;
+    out->handle = held.release();
+}
+
+void returnLentFrame(CCameraFrame* frame) {
+    if (!frame || !frame->handle) return;
+    delete static_cast<VideoFrame*>(frame->handle);
+    *frame = CCameraFrame{};
+}
+
+bool copyFramePacked(const VideoFrame& frame, uint8_t* buffer, size_t size, size_t* frameSize) {
+    size_t needed = frame.packedSize();
+    if (frameSize) *frameSize = needed;
+    if (!buffer || size < needed) return false;
+    return frame.copyTo(buffer, size);
+}
+
+FrameLender::FrameLender(std::shared_ptr<VideoSource> source) : source_(std::move(source)) {
+    listenerId_ = source_->addFrameListener([this]() { ready_.notify(); });
+}
+
+FrameLender::~FrameLender() {
+    source_->removeFrameListener(listenerId_);
+}
+
+bool FrameLender::take(VideoFrame& frame) {
+    ready_.clear();
+    VideoFrame newer;
+    bool fresh = source_->getFrame(newer);
+    std::lock_guard<std::mutex> lock(pendingMutex_);
+    frame = fresh ? std::move(newer) : std::move(pending_);
+    pending_ = VideoFrame();
+    return !frame.empty();
+}
+
+bool FrameLender::borrow(CCameraFrame* frame) {
+    VideoFrame captured;
+    if (!frame || !take(captured)) return false;
+    try {
+        lendFrame(captured, frame);
+    } catch (...) {
+        return false;
+    }
+    return true;
+}
+
+bool FrameLender::copy(uint8_t* buffer, size_t size, size_t* frameSize, int* width, int* height,
+                       uint64_t* timestamp) {
+    VideoFrame frame;
+    if (!take(frame)) return false;
+    if (width) *width = frame.width;
+    if (height) *height = frame.height;
+    if (timestamp) *timestamp = frame.timestamp;
+    if (copyFramePacked(frame, buffer, size, frameSize)) return true;
+    // Kept for a retry with a larger buffer; a newer frame still comes first
+    std::lock_guard<std::mutex> lock(pendingMutex_);
+    if (pending_.empty()) pending_ = std::move(frame);
+    return false;
+}
@@ -0,0 +1,43 @@
+#ifndef BINDINGS_FRAME_LENDING_H
+#define BINDINGS_FRAME_LENDING_H
+
+#include "camera_ffi.h"
+#include "../../core/video/VideoSource.h"
+#include "utils/ready_signal.h"
+#include <memory>
+#include <mutex>
+
+// How camera_ffi lends VideoFrames across the C API: the handle is a heap
+// VideoFrame sharing the pixel buffer, so the source's pool cannot hand the
+// buffer out again until the caller releases it.
+void lendFrame(const VideoFrame& frame, CCameraFrame* out);
+void returnLentFrame(CCameraFrame* frame);
+
+// Packed copy that never writes past size. Sets *frameSize to what the
+// frame needs either way; false if size is too small.
+bool copyFramePacked(const VideoFrame& frame, uint8_t* buffer, size_t size, size_t* frameSize);
+
+// What a camera or screen context keeps besides its source: the readiness
+// fd, raised whenever the source publishes, and a frame a copy had no room for.
+class FrameLender {
+public:
+    explicit FrameLender(std::shared_ptr<VideoSource> source);
+    ~FrameLender();
+    FrameLender(const FrameLender&) = delete;
+    FrameLender& operator=(const FrameLender&) = delete;
+
+    int readyFd() const { return ready_.fd(); }
+    // The newest frame, or the one a copy left behind. Clears the fd first.
+    bool take(VideoFrame& frame);
+    bool borrow(CCameraFrame* frame);
+    bool copy(uint8_t* buffer, size_t size, size_t* frameSize, int* width, int* height, uint64_t* timestamp);
+
+private:
+    std::shared_ptr<VideoSource> source_;
+    core::utils::ReadySignal ready_;
+    int listenerId_;
+    std::mutex pendingMutex_;
+    VideoFrame pending_;
+};
+
+#endif // BINDINGS_FRAME_LENDING_H
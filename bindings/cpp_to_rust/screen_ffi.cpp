@@ -0,0 +1,73 @@
+#include "screen_ffi.h"
+#include "frame_lending.h"
+#include "../../core/video/ScreenSource.h"
+#include "../../core/video/SourceManager.h"
+#include <memory>
+
+struct ScreenContext {
+    std::shared_ptr<ScreenSource> source;
+    std::unique_ptr<FrameLender> lender;
+    bool registered = false;
+};
+
+ScreenContext* screen_create(int screen_index) {
+    try {
+        auto ctx = new ScreenContext();
+        ctx->source = std::make_shared<ScreenSource>(screen_index);
+        ctx->lender = std::make_unique<FrameLender>(ctx->source);
+        return ctx;
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void screen_destroy(ScreenContext* ctx) {
+    if (!ctx) return;
+    auto& manager = SourceManager::getInstance();
+    if (ctx->registered && manager.getSource(ctx->source->getName()) == ctx->source) {
+        manager.removeSource(ctx->source->getName());
+    }
+    delete ctx;
+}
+
+bool screen_set_frame_rate(ScreenContext* ctx, int num, int den) {
+    if (!ctx || num <= 0 || den <= 0) return false;
+    ctx->source->setFrameRate(FrameRate{num, den});
+    return true;
+}
+
+bool screen_start(ScreenContext* ctx) {
+    if (!ctx) return false;
+    return ctx->source->start();
+}
+
+void screen_stop(ScreenContext* ctx) {
+    if (ctx) ctx->source->stop();
+}
+
+bool screen_borrow_frame(ScreenContext* ctx, CCameraFrame* frame) {
+    if (!ctx) return false;
+    return ctx->lender->borrow(frame);
+}
+
+void screen_release_frame(ScreenContext*, CCameraFrame* frame) {
+    returnLentFrame(frame);
+}
+
+bool screen_copy_frame(ScreenContext* ctx, uint8_t* buffer, size_t buffer_size, size_t* frame_size, int* width,
+                       int* height, uint64_t* timestamp) {
+    if (!ctx) return false;
+    return ctx->lender->copy(buffer, buffer_size, frame_size, width, height, timestamp);
+}
+
+int screen_get_ready_fd(ScreenContext* ctx) {
+    if (!ctx) return -1;
+    return ctx->lender->readyFd();
+}
+
+bool screen_register_source(ScreenContext* ctx) {
+    if (!ctx) return false;
+    SourceManager::getInstance().addSource(ctx->source);
+    ctx->registered = true;
+    return true;
+}
@@ -0,0 +1,68 @@
+#ifndef SCREEN_FFI_H
+#define SCREEN_FFI_H
+
+#include "camera_ffi.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Opaque handle for a screen capture source. Frames are lent and copied
+// exactly as camera frames are.
+typedef struct ScreenContext ScreenContext;
+
+/**
+ * Create a screen capture source. Without an X display it generates frames.
+ * @param screen_index The X screen to capture.
+ * @return Pointer to ScreenContext, or NULL on failure.
+ */
+ScreenContext* screen_create(int screen_index);
+
+/**
+ * Destroy the screen source and free resources.
+ */
+void screen_destroy(ScreenContext* ctx);
+
+/**
+ * Capture rate as a fraction, e.g. 30000/1001. Takes effect on screen_start().
+ * @return false if the rate is not positive.
+ */
+bool screen_set_frame_rate(ScreenContext* ctx, int num, int den);
+
+bool screen_start(ScreenContext* ctx);
+void screen_stop(ScreenContext* ctx);
+
+/**
+ * Borrow the latest frame without copying it; see camera_borrow_frame().
+ */
+bool screen_borrow_frame(ScreenContext* ctx, CCameraFrame* frame);
+
+/**
+ * Return a borrowed frame; see camera_release_frame().
+ */
+void screen_release_frame(ScreenContext* ctx, CCameraFrame* frame);
+
+/**
+ * Size-checked packed copy of the latest frame; see camera_copy_frame().
+ */
+bool screen_copy_frame(ScreenContext* ctx, uint8_t* buffer, size_t buffer_size, size_t* frame_size, int* width,
+                       int* height, uint64_t* timestamp);
+
+/**
+ * Readable while a new frame may be waiting; see camera_get_ready_fd().
+ */
+int screen_get_ready_fd(ScreenContext* ctx);
+
+/**
+ * Add the screen to the SourceManager; see camera_register_source().
+ */
+bool screen_register_source(ScreenContext* ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SCREEN_FFI_H
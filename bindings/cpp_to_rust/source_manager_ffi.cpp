@@ -0,0 +1,54 @@
+#include "source_manager_ffi.h"
+#include "frame_lending.h"
+#include "../../core/video/SourceManager.h"
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+int source_manager_get_ready_fd(void) {
+    return SourceManager::getInstance().getReadyFd();
+}
+
+int source_manager_borrow_frames(CSourceFrame* frames, int max_frames) {
+    if (!frames || max_frames <= 0) return 0;
+    std::vector<std::pair<std::string, VideoFrame>> collected;
+    int lent = 0;
+    try {
+        SourceManager::getInstance().collectFrames(collected, (size_t)max_frames);
+        for (; lent < (int)collected.size(); ++lent) {
+            CSourceFrame& out = frames[lent];
+            std::memset(out.name, 0, sizeof(out.name));
+            std::strncpy(out.name, collected[lent].first.c_str(), sizeof(out.name) - 1);
+            lendFrame(collected[lent].second, &out.frame);
+        }
+    } catch (...) {
+        source_manager_release_frames(frames, lent);
+        return 0;
+    }
+    return lent;
+}
+
+void source_manager_release_frames(CSourceFrame* frames, int count) {
+    if (!frames) return;
+    for (int i = 0; i < count; ++i) returnLentFrame(&frames[i].frame);
+}
+
+int source_manager_get_source_count(void) {
+    return (int)SourceManager::getInstance().getSourceNames().size();
+}
+
+bool source_manager_get_source_name(int index, char* name, size_t name_len) {
+    std::vector<std::string> names = SourceManager::getInstance().getSourceNames();
+    if (!name || index < 0 || index >= (int)names.size() || names[index].size() >= name_len) return false;
+    std::memcpy(name, names[index].c_str(), names[index].size() + 1);
+    return true;
+}
+
+bool source_manager_remove_source(const char* name) {
+    if (!name) return false;
+    auto& manager = SourceManager::getInstance();
+    if (!manager.getSource(name)) return false;
+    manager.removeSource(name);
+    return true;
+}
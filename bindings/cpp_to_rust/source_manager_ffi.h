@@ -0,0 +1,58 @@
+#ifndef SOURCE_MANAGER_FFI_H
+#define SOURCE_MANAGER_FFI_H
+
+#include "camera_ffi.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// One source's new frame from source_manager_borrow_frames()
+typedef struct {
+    char name[64];          // Source name, truncated and NUL-terminated
+    CCameraFrame frame;     // Lent as by camera_borrow_frame()
+} CSourceFrame;
+
+/**
+ * Readable while a registered source may have a new frame, so one
+ * descriptor covers every source. Register it for reading but never read
+ * it; source_manager_borrow_frames() clears it.
+ * @return A file descriptor owned by the manager, or -1.
+ */
+int source_manager_get_ready_fd(void);
+
+/**
+ * Borrow the new frame of every registered source in one call.
+ * @param frames Array to fill.
+ * @param max_frames Its length. Sources left over keep the fd readable.
+ * @return Number of frames lent; release each with source_manager_release_frames().
+ */
+int source_manager_borrow_frames(CSourceFrame* frames, int max_frames);
+
+/**
+ * Return frames lent by source_manager_borrow_frames().
+ */
+void source_manager_release_frames(CSourceFrame* frames, int count);
+
+int source_manager_get_source_count(void);
+
+/**
+ * Name of the source at index, in name order.
+ * @return false if index is out of range or name_len is too small.
+ */
+bool source_manager_get_source_name(int index, char* name, size_t name_len);
+
+/**
+ * Unregister and stop a source.
+ * @return false if no source has that name.
+ */
+bool source_manager_remove_source(const char* name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SOURCE_MANAGER_FFI_H
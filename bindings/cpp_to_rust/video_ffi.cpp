@@ -0,0 +1,174 @@
+#include "video_ffi.h"
+#include "../../core/video/VideoEncoder.h"
+#include <memory>
+
+// In-tree implementation of the encoder API, used when the Rust modules
+// are not built (USE_RUST_MODULES=OFF)
+struct EncoderPipeline {
+    std::unique_ptr<VideoEncoder> encoder;
+    VideoEncoderConfig config;
+    CEncodedPacketCallback callback = nullptr;
+    void* userData = nullptr;
+};
+
+static void fillPacket(const EncodedPacket& source, CEncodedPacket* packet, void* handle) {
+    packet->data = source.data.data();
+    packet->size = source.data.size();
+    packet->pts = source.timestamp;
+    packet->dts = source.timestamp;
+    packet->sequence = source.sequence;
+    packet->keyframe = source.keyframe;
+    packet->scene_cut = source.sceneCut;
+    packet->handle = handle;
+}
+
+static void applyCallback(EncoderPipeline* pipeline) {
+    if (!pipeline->callback) {
+        pipeline->encoder->setPacketCallback(nullptr);
+        return;
+    }
+    CEncodedPacketCallback callback = pipeline->callback;
+    void* userData = pipeline->userData;
+    pipeline->encoder->setPacketCallback([callback, userData](const EncodedPacket& source) {
+        CEncodedPacket packet;
+        fillPacket(source, &packet, nullptr);
+        callback(&packet, userData);
+    });
+}
+
+EncoderPipeline* encoder_create(CEncoderConfig config) {
+    if (config.width <= 0 || config.height <= 0) return nullptr;
+    try {
+        auto pipeline = new EncoderPipeline();
+        pipeline->config.width = config.width;
+        pipeline->config.height = config.height;
+        pipeline->config.fps = config.fps;
+        pipeline->config.bitrate = config.bitrate;
+        pipeline->encoder = std::make_unique<VideoEncoder>(pipeline->config);
+        return pipeline;
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void encoder_destroy(EncoderPipeline* encoder) {
+    if (encoder) {
+        delete encoder;
+    }
+}
+
+bool encoder_submit_frame(EncoderPipeline* encoder, const void* frame_data, size_t frame_size, int64_t timestamp) {
+    return encoder_submit_frame_with_hints(encoder, frame_data, frame_size, timestamp, nullptr);
+}
+
+bool encoder_submit_frame_with_hints(EncoderPipeline* encoder, const void* frame_data, size_t frame_size,
+                                     int64_t timestamp, const CFrameHints* hints) {
+    if (!encoder || !encoder->encoder || !frame_data) return false;
+    // Every frame is intra-coded; a cut is only recorded on the packet
+    bool sceneCut = hints && hints->force_keyframe;
+    try {
+        return encoder->encoder->submitPacked(static_cast<const uint8_t*>(frame_data), frame_size, timestamp,
+                                              sceneCut);
+    } catch (...) {
+        return false;
+    }
+}
+
+bool encoder_start(EncoderPipeline* encoder) {
+    if (!encoder || !encoder->encoder) return false;
+    try {
+        return encoder->encoder->start();
+    } catch (...) {
+        return false;
+    }
+}
+
+bool encoder_stop(EncoderPipeline* encoder) {
+    if (!encoder || !encoder->encoder) return false;
+    encoder->encoder->stop();
+    return true;
+}
+
+uint64_t encoder_get_encoded_frames(const EncoderPipeline* encoder) {
+    if (!encoder || !encoder->encoder) return 0;
+    return encoder->encoder->getEncodedFrames();
+}
+
+bool encoder_set_max_in_flight(EncoderPipeline* encoder, int max_frames) {
+    if (!encoder || !encoder->encoder || max_frames <= 0) return false;
+    if (encoder->encoder->isRunning()) return false;
+    try {
+        encoder->config.maxInFlight = max_frames;
+        encoder->encoder = std::make_unique<VideoEncoder>(encoder->config);
+        applyCallback(encoder);
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
+
+CEncoderSubmitResult encoder_try_submit_frame(EncoderPipeline* encoder, const void* frame_data, size_t frame_size,
+                                              int64_t timestamp, const CFrameHints* hints) {
+    if (!encoder || !encoder->encoder || !frame_data) return ENCODER_SUBMIT_REJECTED;
+    bool sceneCut = hints && hints->force_keyframe;
+    try {
+        switch (encoder->encoder->trySubmitPacked(static_cast<const uint8_t*>(frame_data), frame_size, timestamp,
+                                                  sceneCut)) {
+            case SubmitResult::Accepted: return ENCODER_SUBMIT_OK;
+            case SubmitResult::WouldBlock: return ENCODER_SUBMIT_WOULD_BLOCK;
+            default: return ENCODER_SUBMIT_REJECTED;
+        }
+    } catch (...) {
+        return ENCODER_SUBMIT_REJECTED;
+    }
+}
+
+bool encoder_set_packet_callback(EncoderPipeline* encoder, CEncodedPacketCallback callback, void* user_data) {
+    if (!encoder || !encoder->encoder) return false;
+    encoder->callback = callback;
+    encoder->userData = user_data;
+    applyCallback(encoder);
+    return true;
+}
+
+bool encoder_receive_packet(EncoderPipeline* encoder, CEncodedPacket* packet) {
+    if (!encoder || !encoder->encoder || !packet) return false;
+    auto held = std::make_unique<EncodedPacket>();
+    if (!encoder->encoder->getPacket(*held)) return false;
+    fillPacket(*held, packet, held.get());
+    held.release();
+    return true;
+}
+
+void encoder_release_packet(EncoderPipeline* encoder, CEncodedPacket* packet) {
+    if (!packet || !packet->handle) return;
+    std::unique_ptr<EncodedPacket> held(static_cast<EncodedPacket*>(packet->handle));
+    if (encoder && encoder->encoder) {
+        encoder->encoder->recyclePacket(std::move(*held));
+    }
+    *packet = CEncodedPacket{};
+}
+
+bool encoder_flush(EncoderPipeline* encoder) {
+    if (!encoder || !encoder->encoder) return false;
+    encoder->encoder->flush();
+    return true;
+}
+
+bool encoder_get_stats(const EncoderPipeline* encoder, CEncoderStats* stats) {
+    if (!encoder || !encoder->encoder || !stats) return false;
+    VideoEncoderStats source = encoder->encoder->getStats();
+    stats->submitted = source.submitted;
+    stats->encoded = source.encoded;
+    stats->rejected = source.rejected;
+    stats->would_block = source.wouldBlock;
+    stats->blocked_submits = source.blockedSubmits;
+    stats->dropped_packets = source.droppedPackets;
+    stats->in_flight = source.inFlight;
+    stats->peak_in_flight = source.peakInFlight;
+    stats->max_in_flight = encoder->config.maxInFlight;
+    stats->queued_packets = source.queuedPackets;
+    stats->avg_encode_ms = source.avgEncodeMs;
+    stats->avg_latency_ms = source.avgLatencyMs;
+    return true;
+}
@@ -9,7 +9,7 @@
 extern "C" {
 #endif
 
-// Opaque pointer to Rust EncoderPipeline
+// Opaque encoder handle, backed by the in-tree C++ VideoEncoder
 typedef struct EncoderPipeline EncoderPipeline;
 
 // Encoder configuration
@@ -20,6 +20,55 @@ typedef struct {
     int bitrate;
 } CEncoderConfig;
 
+// Per-frame content hints (filled from the engine's ContentAnalyzer)
+typedef struct {
+    bool force_keyframe;        // Scene cut: encode this frame as an IDR frame
+    float scene_change_score;   // 0..1
+    float motion_activity;      // Share of motion cells that moved, 0..1
+    int motion_cols;            // Motion grid covering the whole frame
+    int motion_rows;
+    const uint8_t* motion_map;  // motion_cols * motion_rows mean luma differences, row-major; valid during the call only
+} CFrameHints;
+
+// Outcome of a non-blocking submit
+typedef enum {
+    ENCODER_SUBMIT_OK = 0,
+    ENCODER_SUBMIT_WOULD_BLOCK = 1,  // max_in_flight frames pending; retry after receiving a packet
+    ENCODER_SUBMIT_REJECTED = 2      // Not running, or the buffer matches no supported layout
+} CEncoderSubmitResult;
+
+// One encoded frame. `data` is a pooled buffer borrowed from the encoder:
+// packets from encoder_receive_packet() stay valid until
+// encoder_release_packet(); packets passed to the callback only during the call.
+typedef struct {
+    const uint8_t* data;
+    size_t size;
+    int64_t pts;        // Submission timestamp
+    int64_t dts;        // Equal to pts: every frame is intra-coded
+    uint64_t sequence;  // Submission order, starting at 0
+    bool keyframe;
+    bool scene_cut;     // Submitted with force_keyframe
+    void* handle;       // Owned by the encoder; do not touch
+} CEncodedPacket;
+
+typedef void (*CEncodedPacketCallback)(const CEncodedPacket* packet, void* user_data);
+
+// End-to-end counters, see encoder_get_stats()
+typedef struct {
+    uint64_t submitted;
+    uint64_t encoded;
+    uint64_t rejected;
+    uint64_t would_block;       // Non-blocking submits turned away
+    uint64_t blocked_submits;   // Blocking submits that had to wait
+    uint64_t dropped_packets;   // Packets discarded because nobody received them
+    int in_flight;              // Submitted, not yet delivered
+    int peak_in_flight;
+    int max_in_flight;
+    int queued_packets;         // Delivered, waiting for encoder_receive_packet()
+    double avg_encode_ms;
+    double avg_latency_ms;      // Submit to delivery
+} CEncoderStats;
+
 // Create a new encoder pipeline
 EncoderPipeline* encoder_create(CEncoderConfig config);
 
@@ -34,6 +83,16 @@ bool encoder_submit_frame(
     int64_t timestamp
 );
 
+// Submit a frame with content hints so the encoder can place keyframes at
+// cuts and spend bits where the motion is. `hints` may be NULL.
+bool encoder_submit_frame_with_hints(
+    EncoderPipeline* encoder,
+    const void* frame_data,
+    size_t frame_size,
+    int64_t timestamp,
+    const CFrameHints* hints
+);
+
 // Start the encoding pipeline
 bool encoder_start(EncoderPipeline* encoder);
 
@@ -43,6 +102,36 @@ bool encoder_stop(EncoderPipeline* encoder);
 // Get number of encoded frames
 uint64_t encoder_get_encoded_frames(const EncoderPipeline* encoder);
 
+// Frames that may be submitted but not yet delivered (default 8). Only
+// before encoder_start().
+bool encoder_set_max_in_flight(EncoderPipeline* encoder, int max_frames);
+
+// Like encoder_submit_frame_with_hints(), but never waits for a free slot
+CEncoderSubmitResult encoder_try_submit_frame(
+    EncoderPipeline* encoder,
+    const void* frame_data,
+    size_t frame_size,
+    int64_t timestamp,
+    const CFrameHints* hints
+);
+
+// Delivers packets in submission order on an encoder thread instead of
+// queueing them for encoder_receive_packet(). NULL restores queueing.
+// The callback must not call encoder_flush() or encoder_stop().
+bool encoder_set_packet_callback(EncoderPipeline* encoder, CEncodedPacketCallback callback, void* user_data);
+
+// Borrows the oldest queued packet. False when none is ready.
+bool encoder_receive_packet(EncoderPipeline* encoder, CEncodedPacket* packet);
+
+// Returns a received packet's buffer to the encoder
+void encoder_release_packet(EncoderPipeline* encoder, CEncodedPacket* packet);
+
+// Waits until every frame submitted so far has been delivered; the
+// pipeline keeps running. encoder_stop() drains the same way before stopping.
+bool encoder_flush(EncoderPipeline* encoder);
+
+bool encoder_get_stats(const EncoderPipeline* encoder, CEncoderStats* stats);
+
 #ifdef __cplusplus
 }
 #endif
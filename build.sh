@@ -3,19 +3,25 @@ set -e
 
 echo "=== Building Hybrid Media Engine ==="
 
-# Build Rust modules
+# Build Rust modules when they are present; otherwise the in-tree encoder is used
+CMAKE_ARGS=""
 echo ""
-echo "Step 1: Building Rust modules..."
-cd rust-modules
-cargo build --release
-cd ..
+if [ -d rust-modules ]; then
+    echo "Step 1: Building Rust modules..."
+    cd rust-modules
+    cargo build --release
+    cd ..
+    CMAKE_ARGS="-DUSE_RUST_MODULES=ON"
+else
+    echo "Step 1: No rust-modules directory, using the in-tree encoder"
+fi
 
 # Build C++ project
 echo ""
 echo "Step 2: Building C++ project..."
 mkdir -p build
 cd build
-cmake ..
+cmake .. $CMAKE_ARGS
 cmake --build .
 cd ..
 
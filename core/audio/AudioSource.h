@@ -2,6 +2,9 @@
 #define AUDIO_SOURCE_H
 
 #include "AudioFrame.h"
+#include <functional>
+#include <map>
+#include <mutex>
 #include <string>
 
 class AudioSource {
@@ -16,6 +19,30 @@ public:
     virtual bool getFrame(AudioFrame& frame) = 0;
     
     virtual std::string getName() const = 0;
+
+    // Calls listener on the capturing thread whenever samples arrive. Same
+    // rules as VideoSource::addFrameListener().
+    int addDataListener(std::function<void()> listener) {
+        std::lock_guard<std::mutex> lock(listenerMutex_);
+        dataListeners_[++lastListenerId_] = std::move(listener);
+        return lastListenerId_;
+    }
+
+    void removeDataListener(int id) {
+        std::lock_guard<std::mutex> lock(listenerMutex_);
+        dataListeners_.erase(id);
+    }
+
+protected:
+    void notifyData() {
+        std::lock_guard<std::mutex> lock(listenerMutex_);
+        for (auto& entry : dataListeners_) entry.second();
+    }
+
+private:
+    std::mutex listenerMutex_;
+    std::map<int, std::function<void()>> dataListeners_;
+    int lastListenerId_ = 0;
 };
 
 #endif // AUDIO_SOURCE_H
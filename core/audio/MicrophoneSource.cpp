@@ -1,9 +1,10 @@
 #include "MicrophoneSource.h"
+#include <algorithm>
 #include <iostream>
 #include <chrono>
 
 MicrophoneSource::MicrophoneSource(const std::string& deviceId) 
-    : deviceId_(deviceId), running_(false), captureDeviceId_(0) {
+    : deviceId_(deviceId), running_(false), captureDeviceId_(0), channels_(2), sampleRate_(44100) {
     if (SDL_Init(SDL_INIT_AUDIO) < 0) {
         std::cerr << "SDL Audio Init Failed: " << SDL_GetError() << std::endl;
     }
@@ -40,6 +41,8 @@ bool MicrophoneSource::start() {
     }
 
     std::cout << "Microphone opened: " << have.freq << "Hz " << (int)have.channels << "ch" << std::endl;
+    channels_ = have.channels;
+    sampleRate_ = have.freq;
 
     running_ = true;
     SDL_PauseAudioDevice(captureDeviceId_, 0); // Start recording
@@ -77,6 +80,22 @@ bool MicrophoneSource::getFrame(AudioFrame& frame) {
     return true;
 }
 
+size_t MicrophoneSource::readSamples(float* out, size_t maxSamples, uint64_t* timestamp) {
+    std::lock_guard<std::mutex> lock(queueMutex_);
+    size_t channels = (size_t)std::max(channels_, 1);
+    size_t count = std::min(captureQueue_.size(), maxSamples) / channels * channels;
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = captureQueue_.front();
+        captureQueue_.pop_front();
+    }
+    if (timestamp) {
+        *timestamp = std::chrono::duration_cast<std::chrono::microseconds>(
+                         std::chrono::system_clock::now().time_since_epoch())
+                         .count();
+    }
+    return count;
+}
+
 std::string MicrophoneSource::getName() const {
     return "Mic-" + deviceId_;
 }
@@ -92,18 +111,21 @@ void MicrophoneSource::processCapturedAudio(Uint8* stream, int len) {
     int sampleCount = len / sizeof(float);
     float* in = (float*)stream;
     
-    std::lock_guard<std::mutex> lock(queueMutex_);
-    for (int i = 0; i < sampleCount; ++i) {
-        captureQueue_.push_back(in[i]);
-    }
-    
-    // Prevent unlimited growth if not consumed
-    size_t maxSize = 44100 * 2 * 2; // 2 seconds buffer
-    if (captureQueue_.size() > maxSize) {
-        // Drop oldest
-        size_t toDrop = captureQueue_.size() - maxSize;
-        auto it = captureQueue_.begin();
-        std::advance(it, toDrop);
-        captureQueue_.erase(captureQueue_.begin(), it);
+    {
+        std::lock_guard<std::mutex> lock(queueMutex_);
+        for (int i = 0; i < sampleCount; ++i) {
+            captureQueue_.push_back(in[i]);
+        }
+
+        // Prevent unlimited growth if not consumed
+        size_t maxSize = 44100 * 2 * 2; // 2 seconds buffer
+        if (captureQueue_.size() > maxSize) {
+            // Drop oldest
+            size_t toDrop = captureQueue_.size() - maxSize;
+            auto it = captureQueue_.begin();
+            std::advance(it, toDrop);
+            captureQueue_.erase(captureQueue_.begin(), it);
+        }
     }
+    notifyData();
 }
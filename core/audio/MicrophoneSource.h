@@ -19,6 +19,14 @@ public:
     bool getFrame(AudioFrame& frame) override;
     std::string getName() const override;
 
+    // Everything captured so far, up to maxSamples, in whole interleaved
+    // sample frames; one call instead of one getFrame() per block.
+    // Returns the samples copied.
+    size_t readSamples(float* out, size_t maxSamples, uint64_t* timestamp);
+    // What the device delivers; known once started
+    int getChannels() const { return channels_; }
+    int getSampleRate() const { return sampleRate_; }
+
 private:
     static void AudioCallback(void* userdata, Uint8* stream, int len);
     void processCapturedAudio(Uint8* stream, int len);
@@ -27,6 +35,8 @@ private:
     std::atomic<bool> running_;
     
     SDL_AudioDeviceID captureDeviceId_;
+    int channels_;
+    int sampleRate_;
     
     std::mutex queueMutex_;
     std::list<float> captureQueue_;
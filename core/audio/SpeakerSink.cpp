@@ -49,6 +49,10 @@ void SpeakerSink::stop() {
 }
 
 void SpeakerSink::pushFrame(const AudioFrame& frame) {
+    pushSamples(frame.data.data(), frame.data.size());
+}
+
+void SpeakerSink::pushSamples(const float* samples, size_t count) {
     std::lock_guard<std::mutex> lock(queueMutex_);
     // Limit queue size to avoid latency buildup (e.g., keep max 0.5 sec)
     if (audioQueue_.size() > 44100 * 2 * 0.5) { 
@@ -57,9 +61,12 @@ void SpeakerSink::pushFrame(const AudioFrame& frame) {
         audioQueue_.clear(); 
     }
     
-    for (float sample : frame.data) {
-        audioQueue_.push_back(sample);
-    }
+    audioQueue_.insert(audioQueue_.end(), samples, samples + count);
+}
+
+size_t SpeakerSink::getQueuedSamples() {
+    std::lock_guard<std::mutex> lock(queueMutex_);
+    return audioQueue_.size();
 }
 
 void SpeakerSink::AudioCallback(void* userdata, Uint8* stream, int len) {
@@ -71,14 +78,19 @@ void SpeakerSink::processAudio(Uint8* stream, int len) {
     int sampleCount = len / sizeof(float);
     float* out = (float*)stream;
     
-    std::lock_guard<std::mutex> lock(queueMutex_);
-    
-    for (int i = 0; i < sampleCount; ++i) {
-        if (audioQueue_.empty()) {
-            out[i] = 0.0f; // Silence
-        } else {
-            out[i] = audioQueue_.front();
-            audioQueue_.pop_front();
+    size_t queued;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex_);
+
+        for (int i = 0; i < sampleCount; ++i) {
+            if (audioQueue_.empty()) {
+                out[i] = 0.0f; // Silence
+            } else {
+                out[i] = audioQueue_.front();
+                audioQueue_.pop_front();
+            }
         }
+        queued = audioQueue_.size();
     }
+    if (drainListener_ && queued <= lowWaterSamples_) drainListener_();
 }
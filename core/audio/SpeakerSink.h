@@ -3,6 +3,7 @@
 
 #include "AudioFrame.h"
 #include <SDL.h>
+#include <functional>
 #include <vector>
 #include <mutex>
 #include <list>
@@ -18,6 +19,17 @@ public:
     
     // Queue audio for playback
     void pushFrame(const AudioFrame& frame);
+    // Interleaved samples straight from a caller's buffer
+    void pushSamples(const float* samples, size_t count);
+    size_t getQueuedSamples();
+
+    // Calls listener on the audio thread each time playback leaves no more
+    // than lowWaterSamples queued, so a producer can sleep until it should
+    // push again. Set before start(); same rules as a source's listener.
+    void setDrainListener(std::function<void()> listener, size_t lowWaterSamples) {
+        drainListener_ = std::move(listener);
+        lowWaterSamples_ = lowWaterSamples;
+    }
 
 private:
     static void AudioCallback(void* userdata, Uint8* stream, int len);
@@ -28,6 +40,8 @@ private:
     
     std::mutex queueMutex_;
     std::list<float> audioQueue_; // Simple FIFO for float samples
+    std::function<void()> drainListener_;
+    size_t lowWaterSamples_ = 0;
 };
 
 #endif // SPEAKER_SINK_H
@@ -0,0 +1,397 @@
+#include "SharedFrameRing.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr uint32_t kMagic = 0x464D5246; // "FRMF"
+constexpr uint32_t kVersion = 1;
+constexpr size_t kPage = 4096;
+constexpr int kMaxSlots = 1024;
+
+enum SlotState : uint32_t { kFree = 0, kWriting = 1, kReady = 2, kReading = 3 };
+
+uint64_t pack(uint32_t generation, uint32_t state) {
+    return (uint64_t)generation << 32 | state;
+}
+
+uint32_t stateOf(uint64_t control) {
+    return (uint32_t)control;
+}
+
+uint32_t generationOf(uint64_t control) {
+    return (uint32_t)(control >> 32);
+}
+
+size_t alignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+} // namespace
+
+struct SharedFrameRing::Slot {
+    std::atomic<uint64_t> control;   // Generation and state
+    std::atomic<uint64_t> sequence;  // Of the latest publication
+    SharedFrameInfo info;
+};
+
+struct SharedFrameRing::Header {
+    struct Layout {
+        uint32_t slots;
+        uint64_t slotBytes;
+        uint64_t slotsOffset;       // Slot array
+        uint64_t payloadOffset;     // First payload; page aligned
+    };
+
+    uint32_t magic;
+    uint32_t version;
+    uint64_t size;
+    int32_t producerPid;
+    std::atomic<int32_t> consumerPid;
+    std::atomic<uint32_t> closed;
+    std::atomic<uint32_t> published;   // The futex word
+    std::atomic<uint32_t> waiters;
+    std::atomic<uint64_t> nextSequence;
+    std::atomic<uint64_t> reclaimed;
+    std::atomic<uint64_t> skipped;
+    Layout channels[2];
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+              "Slot states are shared between processes");
+
+std::shared_ptr<SharedFrameRing> SharedFrameRing::create(const SharedFrameRingConfig& config) {
+    if (config.videoSlots < 1 || config.videoSlots > kMaxSlots || config.audioSlots < 1 ||
+        config.audioSlots > kMaxSlots) {
+        std::cerr << "SharedFrameRing: 1 to " << kMaxSlots << " slots per channel" << std::endl;
+        return nullptr;
+    }
+    size_t videoBytes = config.videoSlotBytes ? config.videoSlotBytes
+                                              : VideoFrame::allocationSize(3840, 2160, VideoFrame::Format::RGBA);
+    Header::Layout layouts[2];
+    layouts[0].slots = (uint32_t)config.videoSlots;
+    layouts[0].slotBytes = alignUp(videoBytes, kPage);
+    layouts[1].slots = (uint32_t)config.audioSlots;
+    layouts[1].slotBytes = alignUp(std::max<size_t>(config.audioSlotBytes, 1), kPage);
+    size_t size = alignUp(sizeof(Header), 64);
+    for (Header::Layout& layout : layouts) {
+        layout.slotsOffset = size;
+        size += layout.slots * alignUp(sizeof(Slot), 64);
+    }
+    size = alignUp(size, kPage);
+    for (Header::Layout& layout : layouts) {
+        layout.payloadOffset = size;
+        size += layout.slots * layout.slotBytes;
+    }
+
+    int fd = memfd_create("frame-ring", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd < 0) {
+        std::cerr << "SharedFrameRing: memfd_create failed: " << std::strerror(errno) << std::endl;
+        return nullptr;
+    }
+    // Sealed at this size, so the consumer cannot be made to fault on a shrunk file
+    if (ftruncate(fd, (off_t)size) != 0 ||
+        fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) != 0) {
+        std::cerr << "SharedFrameRing: sizing failed: " << std::strerror(errno) << std::endl;
+        ::close(fd);
+        return nullptr;
+    }
+    void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        std::cerr << "SharedFrameRing: mmap failed: " << std::strerror(errno) << std::endl;
+        ::close(fd);
+        return nullptr;
+    }
+
+    Header* header = new (base) Header();
+    header->magic = kMagic;
+    header->version = kVersion;
+    header->size = size;
+    header->producerPid = (int32_t)getpid();
+    for (int c = 0; c < 2; ++c) {
+        header->channels[c] = layouts[c];
+        for (uint32_t i = 0; i < layouts[c].slots; ++i) {
+            new ((uint8_t*)base + layouts[c].slotsOffset + i * alignUp(sizeof(Slot), 64)) Slot();
+        }
+    }
+    return std::shared_ptr<SharedFrameRing>(new SharedFrameRing(fd, (uint8_t*)base, size));
+}
+
+std::shared_ptr<SharedFrameRing> SharedFrameRing::attach(int fd) {
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(Header)) {
+        std::cerr << "SharedFrameRing: not a frame ring" << std::endl;
+        if (fd >= 0) ::close(fd);
+        return nullptr;
+    }
+    int seals = fcntl(fd, F_GET_SEALS);
+    if (seals < 0 || !(seals & F_SEAL_SHRINK)) {
+        std::cerr << "SharedFrameRing: ring is not sealed" << std::endl;
+        ::close(fd);
+        return nullptr;
+    }
+    size_t size = (size_t)st.st_size;
+    void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        std::cerr << "SharedFrameRing: mmap failed: " << std::strerror(errno) << std::endl;
+        ::close(fd);
+        return nullptr;
+    }
+    std::shared_ptr<SharedFrameRing> ring(new SharedFrameRing(fd, (uint8_t*)base, size));
+
+    // Only the layout is trusted, and only after checking it fits
+    const Header* header = ring->header_;
+    bool valid = header->magic == kMagic && header->version == kVersion && header->size == size;
+    for (int c = 0; valid && c < 2; ++c) {
+        const Header::Layout& layout = header->channels[c];
+        valid = layout.slots >= 1 && layout.slots <= (uint32_t)kMaxSlots && layout.slotBytes % kPage == 0 &&
+                layout.slotsOffset + layout.slots * alignUp(sizeof(Slot), 64) <= size &&
+                layout.payloadOffset % kPage == 0 && layout.slotBytes <= size &&
+                layout.payloadOffset + layout.slots * layout.slotBytes <= size;
+    }
+    if (!valid) {
+        std::cerr << "SharedFrameRing: bad ring layout" << std::endl;
+        return nullptr;
+    }
+
+    ring->header_->consumerPid.store((int32_t)getpid());
+    for (Channel channel : {Channel::Video, Channel::Audio}) {
+        for (int i = 0; i < ring->slotCount(channel); ++i) {
+            std::atomic<uint64_t>& control = ring->slot(channel, i).control;
+            uint64_t current = control.load();
+            if (stateOf(current) == kReading) {
+                control.compare_exchange_strong(current, pack(generationOf(current), kFree));
+            }
+        }
+    }
+    return ring;
+}
+
+SharedFrameRing::SharedFrameRing(int fd, uint8_t* base, size_t size)
+    : fd_(fd), base_(base), size_(size), header_(reinterpret_cast<Header*>(base)), cursor_{0, 0} {
+}
+
+SharedFrameRing::~SharedFrameRing() {
+    munmap(base_, size_);
+    ::close(fd_);
+}
+
+bool SharedFrameRing::sendFd(int socket, int fd) {
+    char byte = 0;
+    iovec iov = {&byte, 1};
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+    msghdr message = {};
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+    cmsghdr* cmsg = CMSG_FIRSTHDR(&message);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    std::memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+    ssize_t n;
+    do {
+        n = sendmsg(socket, &message, MSG_NOSIGNAL);
+    } while (n < 0 && errno == EINTR);
+    return n == 1;
+}
+
+int SharedFrameRing::receiveFd(int socket) {
+    char byte;
+    iovec iov = {&byte, 1};
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+    msghdr message = {};
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+    ssize_t n;
+    do {
+        n = recvmsg(socket, &message, MSG_CMSG_CLOEXEC);
+    } while (n < 0 && errno == EINTR);
+    if (n != 1) return -1;
+    cmsghdr* cmsg = CMSG_FIRSTHDR(&message);
+    if (!cmsg || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) return -1;
+    int fd;
+    std::memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+    return fd;
+}
+
+int SharedFrameRing::slotCount(Channel channel) const {
+    return (int)header_->channels[(int)channel].slots;
+}
+
+size_t SharedFrameRing::slotBytes(Channel channel) const {
+    return header_->channels[(int)channel].slotBytes;
+}
+
+uint8_t* SharedFrameRing::payload(Channel channel, int index) const {
+    const Header::Layout& layout = header_->channels[(int)channel];
+    return base_ + layout.payloadOffset + (size_t)index * layout.slotBytes;
+}
+
+SharedFrameInfo& SharedFrameRing::info(Channel channel, int index) const {
+    return slot(channel, index).info;
+}
+
+SharedFrameRing::Slot& SharedFrameRing::slot(Channel channel, int index) const {
+    const Header::Layout& layout = header_->channels[(int)channel];
+    return *reinterpret_cast<Slot*>(base_ + layout.slotsOffset + (size_t)index * alignUp(sizeof(Slot), 64));
+}
+
+int SharedFrameRing::acquire(Channel channel, uint32_t& generation) {
+    int count = slotCount(channel);
+    int& cursor = cursor_[(int)channel];
+    for (int k = 0; k < count; ++k) {
+        int i = (cursor + k) % count;
+        std::atomic<uint64_t>& control = slot(channel, i).control;
+        uint64_t current = control.load(std::memory_order_acquire);
+        if (stateOf(current) != kFree) continue;
+        uint32_t next = generationOf(current) + 1;
+        if (control.compare_exchange_strong(current, pack(next, kWriting), std::memory_order_acq_rel)) {
+            cursor = (i + 1) % count;
+            generation = next;
+            return i;
+        }
+    }
+    // Take back the oldest frame the consumer has not started on; it may
+    // take it first, so look again if so
+    for (int attempt = 0; attempt < count; ++attempt) {
+        int oldest = -1;
+        uint64_t oldestSequence = 0;
+        uint64_t oldestControl = 0;
+        for (int i = 0; i < count; ++i) {
+            uint64_t current = slot(channel, i).control.load(std::memory_order_acquire);
+            uint64_t sequence = slot(channel, i).sequence.load(std::memory_order_relaxed);
+            if (stateOf(current) == kReady && (oldest < 0 || sequence < oldestSequence)) {
+                oldest = i;
+                oldestSequence = sequence;
+                oldestControl = current;
+            }
+        }
+        if (oldest < 0) return -1;
+        uint32_t next = generationOf(oldestControl) + 1;
+        if (slot(channel, oldest).control.compare_exchange_strong(oldestControl, pack(next, kWriting),
+                                                                  std::memory_order_acq_rel)) {
+            header_->reclaimed.fetch_add(1, std::memory_order_relaxed);
+            generation = next;
+            return oldest;
+        }
+    }
+    return -1;
+}
+
+bool SharedFrameRing::publish(Channel channel, int index) {
+    Slot& s = slot(channel, index);
+    uint64_t current = s.control.load(std::memory_order_relaxed);
+    if (stateOf(current) != kWriting) return false;
+    uint64_t sequence = header_->nextSequence.fetch_add(1, std::memory_order_relaxed) + 1;
+    s.info.sequence = sequence;
+    s.sequence.store(sequence, std::memory_order_relaxed);
+    // Releases the payload and info written before it
+    s.control.store(pack(generationOf(current), kReady), std::memory_order_release);
+    header_->published.fetch_add(1, std::memory_order_release);
+    if (header_->waiters.load(std::memory_order_seq_cst) > 0) {
+        syscall(SYS_futex, &header_->published, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+    }
+    return true;
+}
+
+void SharedFrameRing::abandon(Channel channel, int index, uint32_t generation) {
+    uint64_t expected = pack(generation, kWriting);
+    slot(channel, index).control.compare_exchange_strong(expected, pack(generation, kFree));
+}
+
+void SharedFrameRing::close() {
+    header_->closed.store(1);
+    header_->published.fetch_add(1);
+    syscall(SYS_futex, &header_->published, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+int SharedFrameRing::take(Channel channel, bool newest, uint32_t& generation) {
+    int count = slotCount(channel);
+    int chosen = -1;
+    uint64_t chosenSequence = 0;
+    for (;;) {
+        uint64_t chosenControl = 0;
+        chosen = -1;
+        for (int i = 0; i < count; ++i) {
+            uint64_t current = slot(channel, i).control.load(std::memory_order_acquire);
+            uint64_t sequence = slot(channel, i).sequence.load(std::memory_order_relaxed);
+            if (stateOf(current) != kReady) continue;
+            if (chosen < 0 || (newest ? sequence > chosenSequence : sequence < chosenSequence)) {
+                chosen = i;
+                chosenSequence = sequence;
+                chosenControl = current;
+            }
+        }
+        if (chosen < 0) return -1;
+        // Fails if the producer took the slot back meanwhile
+        if (slot(channel, chosen).control.compare_exchange_strong(
+                chosenControl, pack(generationOf(chosenControl), kReading), std::memory_order_acq_rel)) {
+            generation = generationOf(chosenControl);
+            break;
+        }
+    }
+    if (newest) {
+        for (int i = 0; i < count; ++i) {
+            std::atomic<uint64_t>& control = slot(channel, i).control;
+            uint64_t current = control.load(std::memory_order_acquire);
+            if (stateOf(current) != kReady || slot(channel, i).sequence.load() >= chosenSequence) continue;
+            if (control.compare_exchange_strong(current, pack(generationOf(current), kFree))) {
+                header_->skipped.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+    return chosen;
+}
+
+void SharedFrameRing::release(Channel channel, int index, uint32_t generation) {
+    uint64_t expected = pack(generation, kReading);
+    slot(channel, index).control.compare_exchange_strong(expected, pack(generation, kFree),
+                                                         std::memory_order_release);
+}
+
+uint32_t SharedFrameRing::publishedCount() const {
+    return header_->published.load(std::memory_order_acquire);
+}
+
+bool SharedFrameRing::wait(uint32_t seen, int timeoutMs) const {
+    timespec timeout;
+    timeout.tv_sec = timeoutMs / 1000;
+    timeout.tv_nsec = (long)(timeoutMs % 1000) * 1000000;
+    header_->waiters.fetch_add(1, std::memory_order_seq_cst);
+    // Not the private futex: the word is shared with another process
+    if (header_->published.load(std::memory_order_seq_cst) == seen) {
+        syscall(SYS_futex, &header_->published, FUTEX_WAIT, seen, &timeout, nullptr, 0);
+    }
+    header_->waiters.fetch_sub(1, std::memory_order_seq_cst);
+    return header_->published.load(std::memory_order_acquire) != seen;
+}
+
+bool SharedFrameRing::producerAlive() const {
+    if (header_->closed.load()) return false;
+    return kill(header_->producerPid, 0) == 0 || errno == EPERM;
+}
+
+SharedFrameRingStats SharedFrameRing::getStats() const {
+    SharedFrameRingStats stats;
+    stats.published = header_->nextSequence.load();
+    stats.reclaimed = header_->reclaimed.load();
+    stats.skipped = header_->skipped.load();
+    return stats;
+}
@@ -0,0 +1,114 @@
+#ifndef SHARED_FRAME_RING_H
+#define SHARED_FRAME_RING_H
+
+#include "VideoFrame.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+struct SharedFrameRingConfig {
+    int videoSlots = 4;
+    size_t videoSlotBytes = 0;      // 0: room for a 3840x2160 RGBA frame
+    int audioSlots = 32;
+    size_t audioSlotBytes = 64 * 1024;
+};
+
+constexpr int kSharedMaxDirtyRects = 16;
+
+// Description of the payload in a slot, written by the producer before
+// the slot is published
+struct SharedFrameInfo {
+    uint64_t sequence;
+    uint64_t timestamp;        // Microseconds, the frame's own
+    uint64_t publishedNs;      // CLOCK_MONOTONIC, which both processes share
+    uint64_t payloadBytes;
+    // Video; strides and offsets as in VideoFrame, offsets from the slot start
+    int32_t width;
+    int32_t height;
+    int32_t format;
+    int32_t planeCount;
+    int32_t strides[kMaxPlanes];
+    uint64_t offsets[kMaxPlanes];
+    int32_t unchanged;
+    int32_t dirtyCount;        // -1: too many to carry, treat the whole frame as changed
+    VideoRect dirty[kSharedMaxDirtyRects];
+    // Audio: interleaved float samples
+    int32_t channels;
+    int32_t sampleRate;
+    int32_t samplesPerChannel;
+};
+
+struct SharedFrameRingStats {
+    uint64_t published = 0;
+    uint64_t reclaimed = 0;    // Published, then overwritten before the consumer took them
+    uint64_t skipped = 0;      // Passed over by a consumer that wanted the newest
+};
+
+// Fixed slots for video and audio frames in one sealed memfd, shared by a
+// producer process (capture) and a consumer process (the engine). Payloads
+// are written and read in place. Each slot has an atomic state word, free,
+// writing, ready or reading, tagged with a generation, so either side can
+// crash without the other acting on a slot it no longer owns. The
+// producer never waits: without a free slot it takes back the oldest one
+// the consumer has not started reading. The consumer sleeps on a futex in
+// the mapping, so no other descriptor has to be passed.
+class SharedFrameRing {
+public:
+    enum class Channel { Video = 0, Audio = 1 };
+
+    // Producer side: a new, zeroed ring. nullptr on failure.
+    static std::shared_ptr<SharedFrameRing> create(const SharedFrameRingConfig& config = SharedFrameRingConfig());
+    // Consumer side: maps a ring received from the producer and takes the
+    // descriptor over. Slots a previous consumer left in use are freed.
+    static std::shared_ptr<SharedFrameRing> attach(int fd);
+    ~SharedFrameRing();
+    SharedFrameRing(const SharedFrameRing&) = delete;
+    SharedFrameRing& operator=(const SharedFrameRing&) = delete;
+
+    // Passing the ring to another process: SCM_RIGHTS over a Unix socket
+    int fd() const { return fd_; }
+    static bool sendFd(int socket, int fd);
+    static int receiveFd(int socket);
+
+    int slotCount(Channel channel) const;
+    size_t slotBytes(Channel channel) const;
+    uint8_t* payload(Channel channel, int slot) const;
+    SharedFrameInfo& info(Channel channel, int slot) const;
+
+    // Producer. A slot to write into, or -1 if the consumer holds them all.
+    int acquire(Channel channel, uint32_t& generation);
+    // False unless the slot is still being written
+    bool publish(Channel channel, int slot);
+    // Returns a slot acquired and not published; a stale generation is ignored
+    void abandon(Channel channel, int slot, uint32_t generation);
+    // No more frames; the consumer sees the producer gone
+    void close();
+
+    // Consumer. The oldest published slot, or with newest the latest one
+    // (the older ones are freed); -1 if none.
+    int take(Channel channel, bool newest, uint32_t& generation);
+    void release(Channel channel, int slot, uint32_t generation);
+    // Counts publications on both channels
+    uint32_t publishedCount() const;
+    // Sleeps until publishedCount() moves on from seen, up to timeoutMs
+    bool wait(uint32_t seen, int timeoutMs) const;
+    // False once the producer closed the ring or its process is gone
+    bool producerAlive() const;
+
+    SharedFrameRingStats getStats() const;
+
+private:
+    struct Header;
+    struct Slot;
+
+    SharedFrameRing(int fd, uint8_t* base, size_t size);
+    Slot& slot(Channel channel, int index) const;
+
+    int fd_;
+    uint8_t* base_;
+    size_t size_;
+    Header* header_;
+    int cursor_[2];  // Producer: where the next search for a free slot starts
+};
+
+#endif // SHARED_FRAME_RING_H
@@ -0,0 +1,187 @@
+#include "SharedMemoryPublisher.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+using Channel = SharedFrameRing::Channel;
+
+uint64_t monotonicNs() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+SharedMemoryPublisher::SharedMemoryPublisher(const SharedFrameRingConfig& config) : config_(config) {
+}
+
+SharedMemoryPublisher::~SharedMemoryPublisher() {
+    stop();
+}
+
+bool SharedMemoryPublisher::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (ring_) return true;
+    ring_ = SharedFrameRing::create(config_);
+    if (!ring_) return false;
+    acquired_.assign(ring_->slotCount(Channel::Video), nullptr);
+    return true;
+}
+
+void SharedMemoryPublisher::stop() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Frames still out keep the mapping alive through their buffers
+    if (ring_) ring_->close();
+    ring_.reset();
+    acquired_.clear();
+}
+
+VideoFrame SharedMemoryPublisher::acquireVideoFrame(int width, int height, VideoFrame::Format format) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!ring_) return VideoFrame();
+    int strides[kMaxPlanes];
+    size_t offsets[kMaxPlanes];
+    size_t size = VideoFrame::layout(width, height, format, strides, offsets);
+    if (size > ring_->slotBytes(Channel::Video)) {
+        stats_.droppedFrames++;
+        return VideoFrame();
+    }
+    uint32_t generation;
+    int slot = ring_->acquire(Channel::Video, generation);
+    if (slot < 0) {
+        stats_.droppedFrames++;
+        return VideoFrame();
+    }
+    std::shared_ptr<SharedFrameRing> ring = ring_;
+    auto buffer = FrameBuffer::wrap(ring->payload(Channel::Video, slot), size, [ring, slot, generation]() {
+        ring->abandon(Channel::Video, slot, generation);
+    });
+    acquired_[slot] = buffer.get();
+    return VideoFrame::fromBuffer(width, height, format, std::move(buffer), strides, offsets);
+}
+
+bool SharedMemoryPublisher::publish(const VideoFrame& frame) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!ring_ || frame.empty()) return false;
+
+    // In place when the frame is one of ours still being written
+    for (int slot = 0; slot < (int)acquired_.size(); ++slot) {
+        if (acquired_[slot] != frame.buffer.get()) continue;
+        acquired_[slot] = nullptr;
+        if (!describe(frame, slot) || !ring_->publish(Channel::Video, slot)) return false;
+        stats_.videoFrames++;
+        return true;
+    }
+
+    int strides[kMaxPlanes];
+    size_t offsets[kMaxPlanes];
+    size_t size = VideoFrame::layout(frame.width, frame.height, frame.format, strides, offsets);
+    if (size > ring_->slotBytes(Channel::Video)) {
+        std::cerr << "SharedMemoryPublisher: " << frame.width << "x" << frame.height
+                  << " frame does not fit a slot" << std::endl;
+        stats_.droppedFrames++;
+        return false;
+    }
+    uint32_t generation;
+    int slot = ring_->acquire(Channel::Video, generation);
+    if (slot < 0) {
+        stats_.droppedFrames++;
+        return false;
+    }
+    acquired_[slot] = nullptr;
+    uint8_t* base = ring_->payload(Channel::Video, slot);
+    auto buffer = FrameBuffer::wrap(base, size, nullptr);
+    VideoFrame copy = VideoFrame::fromBuffer(frame.width, frame.height, frame.format, buffer, strides, offsets);
+    for (int p = 0; p < frame.planeCount; ++p) {
+        int rowBytes = frame.planeRowBytes(p);
+        for (int y = 0; y < frame.planeHeight(p); ++y) {
+            std::memcpy(copy.plane(p) + (size_t)y * copy.stride(p), frame.plane(p) + (size_t)y * frame.stride(p),
+                        rowBytes);
+        }
+    }
+    copy.timestamp = frame.timestamp;
+    copy.unchanged = frame.unchanged;
+    copy.dirtyRects = frame.dirtyRects;
+    if (!describe(copy, slot) || !ring_->publish(Channel::Video, slot)) {
+        ring_->abandon(Channel::Video, slot, generation);
+        return false;
+    }
+    stats_.videoFrames++;
+    stats_.copiedFrames++;
+    return true;
+}
+
+bool SharedMemoryPublisher::describe(const VideoFrame& frame, int slot) {
+    const uint8_t* base = ring_->payload(Channel::Video, slot);
+    size_t slotBytes = ring_->slotBytes(Channel::Video);
+    SharedFrameInfo& info = ring_->info(Channel::Video, slot);
+    info.timestamp = frame.timestamp;
+    info.width = frame.width;
+    info.height = frame.height;
+    info.format = (int32_t)frame.format;
+    info.planeCount = frame.planeCount;
+    size_t end = 0;
+    for (int p = 0; p < kMaxPlanes; ++p) {
+        info.strides[p] = p < frame.planeCount ? frame.stride(p) : 0;
+        info.offsets[p] = p < frame.planeCount ? (uint64_t)(frame.plane(p) - base) : 0;
+        if (p < frame.planeCount) {
+            size_t planeEnd = info.offsets[p] + (size_t)frame.stride(p) * (frame.planeHeight(p) - 1) +
+                              frame.planeRowBytes(p);
+            end = std::max(end, planeEnd);
+        }
+    }
+    // A view cropped outside its slot cannot be described
+    if (end > slotBytes) return false;
+    info.payloadBytes = end;
+    info.unchanged = frame.unchanged ? 1 : 0;
+    if (frame.dirtyRects.size() > (size_t)kSharedMaxDirtyRects) {
+        info.dirtyCount = -1;
+    } else {
+        info.dirtyCount = (int32_t)frame.dirtyRects.size();
+        std::copy(frame.dirtyRects.begin(), frame.dirtyRects.end(), info.dirty);
+    }
+    info.channels = 0;
+    info.sampleRate = 0;
+    info.samplesPerChannel = 0;
+    info.publishedNs = monotonicNs();
+    return true;
+}
+
+bool SharedMemoryPublisher::publish(const AudioFrame& frame) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!ring_) return false;
+    size_t bytes = frame.data.size() * sizeof(float);
+    if (bytes > ring_->slotBytes(Channel::Audio)) {
+        std::cerr << "SharedMemoryPublisher: audio frame does not fit a slot" << std::endl;
+        stats_.droppedFrames++;
+        return false;
+    }
+    uint32_t generation;
+    int slot = ring_->acquire(Channel::Audio, generation);
+    if (slot < 0) {
+        stats_.droppedFrames++;
+        return false;
+    }
+    std::memcpy(ring_->payload(Channel::Audio, slot), frame.data.data(), bytes);
+    SharedFrameInfo& info = ring_->info(Channel::Audio, slot);
+    info = SharedFrameInfo{};
+    info.timestamp = frame.timestamp;
+    info.payloadBytes = bytes;
+    info.channels = frame.channels;
+    info.sampleRate = frame.sampleRate;
+    info.samplesPerChannel = frame.samplesPerChannel;
+    info.publishedNs = monotonicNs();
+    ring_->publish(Channel::Audio, slot);
+    stats_.audioFrames++;
+    return true;
+}
+
+SharedMemoryPublisherStats SharedMemoryPublisher::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    SharedMemoryPublisherStats stats = stats_;
+    if (ring_) stats.reclaimed = ring_->getStats().reclaimed;
+    return stats;
+}
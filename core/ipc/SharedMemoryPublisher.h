@@ -0,0 +1,57 @@
+#ifndef SHARED_MEMORY_PUBLISHER_H
+#define SHARED_MEMORY_PUBLISHER_H
+
+#include "SharedFrameRing.h"
+#include "AudioFrame.h"
+#include "VideoFrame.h"
+#include <memory>
+#include <mutex>
+#include <vector>
+
+struct SharedMemoryPublisherStats {
+    uint64_t videoFrames = 0;
+    uint64_t audioFrames = 0;
+    uint64_t copiedFrames = 0;   // Video published from a buffer outside the ring
+    uint64_t droppedFrames = 0;  // No free slot, or too large for one
+    uint64_t reclaimed = 0;      // Overwritten before the consumer took them
+};
+
+// Producer end of a SharedFrameRing, for a capture process feeding the
+// engine in another process. Frames from acquireVideoFrame() live in a
+// slot, so publishing them copies nothing; any other frame is copied into
+// a slot once. Never blocks on the consumer.
+class SharedMemoryPublisher {
+public:
+    explicit SharedMemoryPublisher(const SharedFrameRingConfig& config = SharedFrameRingConfig());
+    ~SharedMemoryPublisher();
+
+    // Creates the ring; pass fd() to the consumer, e.g. with SharedFrameRing::sendFd
+    bool start();
+    // Tells the consumer no more frames are coming
+    void stop();
+    int fd() const { return ring_ ? ring_->fd() : -1; }
+    std::shared_ptr<SharedFrameRing> ring() const { return ring_; }
+
+    // A writable frame laid out as the engine allocates it, backed by a
+    // free slot; empty if none is free or it does not fit. Dropping it
+    // unpublished returns the slot. Do not write to it once published.
+    VideoFrame acquireVideoFrame(int width, int height, VideoFrame::Format format);
+    // Publishes with the frame's timestamp and change hints
+    bool publish(const VideoFrame& frame);
+    bool publish(const AudioFrame& frame);
+
+    SharedMemoryPublisherStats getStats() const;
+
+private:
+    bool describe(const VideoFrame& frame, int slot);
+
+    SharedFrameRingConfig config_;
+    std::shared_ptr<SharedFrameRing> ring_;
+    mutable std::mutex mutex_;
+    // Per video slot, the buffer acquireVideoFrame() handed out and that
+    // is not published yet
+    std::vector<const FrameBuffer*> acquired_;
+    SharedMemoryPublisherStats stats_;
+};
+
+#endif // SHARED_MEMORY_PUBLISHER_H
@@ -0,0 +1,196 @@
+#include "SharedMemorySource.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace {
+
+using Channel = SharedFrameRing::Channel;
+
+constexpr int kMaxDimension = 16384;
+constexpr int kMaxChannels = 32;
+
+uint64_t monotonicNs() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Every plane row inside the slot
+bool validVideo(const SharedFrameInfo& info, size_t slotBytes) {
+    if (info.width <= 0 || info.height <= 0 || info.width > kMaxDimension || info.height > kMaxDimension ||
+        info.format < (int32_t)VideoFrame::Format::RGBA || info.format > (int32_t)VideoFrame::Format::NV12) {
+        return false;
+    }
+    VideoFrame probe(0, 0, (VideoFrame::Format)info.format);
+    probe.width = info.width;
+    probe.height = info.height;
+    if (info.planeCount != probe.planeCount) return false;
+    for (int p = 0; p < probe.planeCount; ++p) {
+        uint64_t rowBytes = (uint64_t)probe.planeRowBytes(p);
+        if (info.strides[p] < (int64_t)rowBytes || info.offsets[p] > slotBytes) return false;
+        uint64_t end = info.offsets[p] + (uint64_t)info.strides[p] * (probe.planeHeight(p) - 1) + rowBytes;
+        if (end > slotBytes) return false;
+    }
+    if (info.dirtyCount > kSharedMaxDirtyRects) return false;
+    return true;
+}
+
+} // namespace
+
+SharedMemoryVideoSource::SharedMemoryVideoSource(std::shared_ptr<SharedFrameRing> ring, std::string name)
+    : ring_(std::move(ring)), name_(std::move(name)), running_(false), frames_(0), rejected_(0),
+      lastLatencyUs_(0), maxLatencyUs_(0) {
+}
+
+bool SharedMemoryVideoSource::start() {
+    if (!ring_) return false;
+    running_ = true;
+    return true;
+}
+
+void SharedMemoryVideoSource::stop() {
+    running_ = false;
+    std::lock_guard<std::mutex> lock(frameMutex_);
+    pending_ = VideoFrame();
+    returnedBuffer_.reset();
+}
+
+bool SharedMemoryVideoSource::getFrame(VideoFrame& frame) {
+    std::lock_guard<std::mutex> lock(frameMutex_);
+    if (!running_) return false;
+    VideoFrame newest;
+    if (takeNewest(newest)) pending_ = std::move(newest);
+    if (pending_.empty()) return false;
+
+    frame = std::move(pending_);
+    pending_ = VideoFrame();
+    returned_ = frame;
+    returned_.buffer.reset();
+    returnedBuffer_ = frame.buffer;
+    return true;
+}
+
+bool SharedMemoryVideoSource::getLatestFrame(VideoFrame& frame) {
+    std::lock_guard<std::mutex> lock(frameMutex_);
+    if (!running_) return false;
+    VideoFrame newest;
+    if (takeNewest(newest)) pending_ = std::move(newest);
+    if (!pending_.empty()) {
+        frame = pending_;
+        return true;
+    }
+    // Plane pointers stay valid while the buffer, and so the slot, lives
+    std::shared_ptr<FrameBuffer> buffer = returnedBuffer_.lock();
+    if (!buffer) return false;
+    frame = returned_;
+    frame.buffer = std::move(buffer);
+    return true;
+}
+
+bool SharedMemoryVideoSource::takeNewest(VideoFrame& frame) {
+    for (;;) {
+        uint32_t generation;
+        int slot = ring_->take(Channel::Video, true, generation);
+        if (slot < 0) return false;
+        // The producer may still scribble on its copy; only this one is checked and used
+        SharedFrameInfo info = ring_->info(Channel::Video, slot);
+        size_t slotBytes = ring_->slotBytes(Channel::Video);
+        if (!validVideo(info, slotBytes)) {
+            ring_->release(Channel::Video, slot, generation);
+            rejected_++;
+            continue;
+        }
+
+        std::shared_ptr<SharedFrameRing> ring = ring_;
+        auto buffer = FrameBuffer::wrap(ring->payload(Channel::Video, slot), slotBytes,
+                                        [ring, slot, generation]() {
+                                            ring->release(Channel::Video, slot, generation);
+                                        });
+        size_t offsets[kMaxPlanes];
+        for (int p = 0; p < kMaxPlanes; ++p) offsets[p] = (size_t)info.offsets[p];
+        frame = VideoFrame::fromBuffer(info.width, info.height, (VideoFrame::Format)info.format, std::move(buffer),
+                                       info.strides, offsets);
+        frame.timestamp = info.timestamp;
+        frame.unchanged = info.unchanged != 0;
+        frame.dirtyRects.clear();
+        for (int i = 0; i < info.dirtyCount; ++i) {
+            const VideoRect& rect = info.dirty[i];
+            if (rect.x < 0 || rect.y < 0 || rect.width <= 0 || rect.height <= 0 ||
+                rect.x + rect.width > info.width || rect.y + rect.height > info.height) {
+                // Unknown beats wrong: the whole frame counts as changed
+                frame.dirtyRects.clear();
+                break;
+            }
+            frame.dirtyRects.push_back(rect);
+        }
+
+        uint64_t now = monotonicNs();
+        uint64_t latencyUs = now > info.publishedNs ? (now - info.publishedNs) / 1000 : 0;
+        lastLatencyUs_ = latencyUs;
+        if (latencyUs > maxLatencyUs_) maxLatencyUs_ = latencyUs;
+        frames_++;
+        return true;
+    }
+}
+
+bool SharedMemoryVideoSource::waitFrame(VideoFrame& frame, int timeoutMs) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    for (;;) {
+        // Read the count first, so a publish between it and getFrame() ends the wait
+        uint32_t seen = ring_ ? ring_->publishedCount() : 0;
+        if (getFrame(frame)) return true;
+        if (!running_ || !ring_->producerAlive()) return false;
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline -
+                                                                               std::chrono::steady_clock::now());
+        if (remaining.count() <= 0) return false;
+        // Bounded, so a producer killed mid-wait is noticed
+        ring_->wait(seen, (int)std::min<long long>(remaining.count(), 100));
+    }
+}
+
+SharedMemorySourceStats SharedMemoryVideoSource::getStats() const {
+    SharedMemorySourceStats stats;
+    stats.frames = frames_;
+    stats.skipped = ring_ ? ring_->getStats().skipped : 0;
+    stats.rejected = rejected_;
+    stats.lastLatencyUs = lastLatencyUs_;
+    stats.maxLatencyUs = maxLatencyUs_;
+    return stats;
+}
+
+SharedMemoryAudioSource::SharedMemoryAudioSource(std::shared_ptr<SharedFrameRing> ring, std::string name)
+    : ring_(std::move(ring)), name_(std::move(name)), running_(false) {
+}
+
+bool SharedMemoryAudioSource::start() {
+    if (!ring_) return false;
+    running_ = true;
+    return true;
+}
+
+void SharedMemoryAudioSource::stop() {
+    running_ = false;
+}
+
+bool SharedMemoryAudioSource::getFrame(AudioFrame& frame) {
+    if (!running_) return false;
+    for (;;) {
+        uint32_t generation;
+        int slot = ring_->take(Channel::Audio, false, generation);
+        if (slot < 0) return false;
+        SharedFrameInfo info = ring_->info(Channel::Audio, slot);
+        uint64_t bytes = (uint64_t)info.channels * (uint64_t)info.samplesPerChannel * sizeof(float);
+        bool valid = info.channels > 0 && info.channels <= kMaxChannels && info.samplesPerChannel > 0 &&
+                     info.sampleRate > 0 && bytes <= ring_->slotBytes(Channel::Audio);
+        if (valid) {
+            frame.channels = info.channels;
+            frame.sampleRate = info.sampleRate;
+            frame.samplesPerChannel = info.samplesPerChannel;
+            frame.timestamp = info.timestamp;
+            frame.data.resize(bytes / sizeof(float));
+            std::memcpy(frame.data.data(), ring_->payload(Channel::Audio, slot), bytes);
+        }
+        ring_->release(Channel::Audio, slot, generation);
+        if (valid) return true;
+    }
+}
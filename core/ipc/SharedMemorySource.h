@@ -0,0 +1,84 @@
+#ifndef SHARED_MEMORY_SOURCE_H
+#define SHARED_MEMORY_SOURCE_H
+
+#include "SharedFrameRing.h"
+#include "AudioSource.h"
+#include "VideoSource.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+
+struct SharedMemorySourceStats {
+    uint64_t frames = 0;
+    uint64_t skipped = 0;        // Published, then passed over for a newer one
+    uint64_t rejected = 0;       // Slot description out of bounds
+    uint64_t lastLatencyUs = 0;  // Publish to getFrame()
+    uint64_t maxLatencyUs = 0;
+};
+
+// Video from a producer process through a SharedFrameRing. Frames wrap
+// their slot, which goes back to the producer when the last copy is
+// dropped, so holding many frames starves the producer of slots. Always
+// the newest frame; older ones are skipped. Slot descriptions are checked
+// against the mapping, so a faulty producer cannot cause reads outside it.
+// getLatestFrame() looks without taking: a frame it pulls from the ring is
+// held for the next getFrame(), pinning that one slot until then.
+class SharedMemoryVideoSource : public VideoSource {
+public:
+    explicit SharedMemoryVideoSource(std::shared_ptr<SharedFrameRing> ring, std::string name = "Shared memory");
+
+    bool start() override;
+    void stop() override;
+    bool getFrame(VideoFrame& frame) override;
+    // The newest frame, whether or not getFrame() returned it. A frame
+    // already returned is only available while a consumer still holds it,
+    // since its slot may have gone back to the producer.
+    bool getLatestFrame(VideoFrame& frame) override;
+    std::string getName() const override { return name_; }
+
+    // getFrame(), sleeping up to timeoutMs for a frame to be published.
+    // Returns early once the producer is gone.
+    bool waitFrame(VideoFrame& frame, int timeoutMs);
+    bool isProducerAlive() const { return ring_ && ring_->producerAlive(); }
+
+    SharedMemorySourceStats getStats() const;
+
+private:
+    // Takes the newest valid frame off the ring, if one was published
+    bool takeNewest(VideoFrame& frame);
+
+    std::shared_ptr<SharedFrameRing> ring_;
+    std::string name_;
+    std::atomic<bool> running_;
+    std::mutex frameMutex_;
+    // Taken off the ring, not yet returned by getFrame()
+    VideoFrame pending_;
+    // The last frame getFrame() returned, kept without its buffer so the
+    // slot is never pinned; returnedBuffer_ finds it while a copy lives
+    VideoFrame returned_;
+    std::weak_ptr<FrameBuffer> returnedBuffer_;
+    std::atomic<uint64_t> frames_;
+    std::atomic<uint64_t> rejected_;
+    std::atomic<uint64_t> lastLatencyUs_;
+    std::atomic<uint64_t> maxLatencyUs_;
+};
+
+// Audio from the same ring, oldest first so nothing is skipped while the
+// slots last. Samples are copied out, since AudioFrame owns its storage.
+class SharedMemoryAudioSource : public AudioSource {
+public:
+    explicit SharedMemoryAudioSource(std::shared_ptr<SharedFrameRing> ring, std::string name = "Shared memory");
+
+    bool start() override;
+    void stop() override;
+    bool getFrame(AudioFrame& frame) override;
+    std::string getName() const override { return name_; }
+
+private:
+    std::shared_ptr<SharedFrameRing> ring_;
+    std::string name_;
+    std::atomic<bool> running_;
+};
+
+#endif // SHARED_MEMORY_SOURCE_H
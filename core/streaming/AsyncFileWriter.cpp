@@ -0,0 +1,535 @@
+#include "AsyncFileWriter.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifdef HAVE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+namespace {
+
+constexpr size_t kAlignment = 4096;
+
+bool writeFully(int fd, const uint8_t* data, size_t size, uint64_t offset) {
+    size_t done = 0;
+    while (done < size) {
+        ssize_t n = ::pwrite(fd, data + done, size - done, (off_t)(offset + done));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        done += (size_t)n;
+    }
+    return true;
+}
+
+} // namespace
+
+#ifdef HAVE_IO_URING
+
+// The rings mapped from the kernel, driven with raw system calls so there
+// is no liburing dependency
+struct AsyncFileWriter::IoRing {
+    static constexpr uint64_t kPreallocateTag = UINT64_MAX;
+    static constexpr uint64_t kSyncTag = UINT64_MAX - 1;
+
+    int fd = -1;
+    void* sqMap = MAP_FAILED;
+    size_t sqMapSize = 0;
+    void* cqMap = MAP_FAILED;
+    size_t cqMapSize = 0;
+    io_uring_sqe* sqes = (io_uring_sqe*)MAP_FAILED;
+    size_t sqesSize = 0;
+    unsigned* sqHead = nullptr;
+    unsigned* sqTail = nullptr;
+    unsigned* sqArray = nullptr;
+    unsigned sqMask = 0;
+    unsigned* cqHead = nullptr;
+    unsigned* cqTail = nullptr;
+    unsigned cqMask = 0;
+    io_uring_cqe* cqes = nullptr;
+    unsigned entries = 0;
+    unsigned outstanding = 0;          // Operations submitted, not completed
+    std::vector<Chunk> slots;          // Writes in flight, by user_data
+    std::vector<size_t> freeSlots;
+
+    ~IoRing() {
+        if (sqes != MAP_FAILED) munmap(sqes, sqesSize);
+        if (cqMap != MAP_FAILED) munmap(cqMap, cqMapSize);
+        if (sqMap != MAP_FAILED) munmap(sqMap, sqMapSize);
+        if (fd >= 0) ::close(fd);
+    }
+
+    // Queues one operation and submits it at once
+    io_uring_sqe* next() {
+        unsigned tail = *sqTail;
+        unsigned index = tail & sqMask;
+        io_uring_sqe* sqe = &sqes[index];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqArray[index] = index;
+        return sqe;
+    }
+
+    bool submit() {
+        __atomic_store_n(sqTail, *sqTail + 1, __ATOMIC_RELEASE);
+        for (;;) {
+            long n = syscall(__NR_io_uring_enter, fd, 1, 0, 0, nullptr, 0);
+            if (n == 1) break;
+            if (n < 0 && (errno == EINTR || errno == EAGAIN)) continue;
+            return false;
+        }
+        outstanding++;
+        return true;
+    }
+
+    void wait(int timeoutMs) {
+        __kernel_timespec ts;
+        ts.tv_sec = timeoutMs / 1000;
+        ts.tv_nsec = (long long)(timeoutMs % 1000) * 1000000;
+        io_uring_getevents_arg arg;
+        std::memset(&arg, 0, sizeof(arg));
+        arg.ts = (uint64_t)(uintptr_t)&ts;
+        // ETIME and EINTR just end the wait
+        syscall(__NR_io_uring_enter, fd, 0, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+    }
+};
+
+#else
+
+struct AsyncFileWriter::IoRing {};
+
+#endif
+
+AsyncFileWriter::AsyncFileWriter(const AsyncFileWriterConfig& config)
+    : config_(config)
+    , fd_(-1)
+    , size_(0)
+    , preallocatedEnd_(0)
+    , inFlight_(0)
+    , queuedBytes_(0)
+    , stopping_(false) {
+    config_.chunkBytes = std::max(kAlignment, config_.chunkBytes / kAlignment * kAlignment);
+    config_.ringEntries = std::max(config_.ringEntries, 4u);
+}
+
+AsyncFileWriter::~AsyncFileWriter() {
+    close();
+    for (uint8_t* buffer : freeBuffers_) std::free(buffer);
+    std::free(current_.data);
+}
+
+bool AsyncFileWriter::open(const std::string& path) {
+    if (fd_ >= 0) {
+        std::cerr << "AsyncFileWriter: already open" << std::endl;
+        return false;
+    }
+    fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        std::cerr << "Failed to open " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    size_ = 0;
+    preallocatedEnd_ = 0;
+    lastSync_ = Clock::now();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_ = AsyncFileWriterStats();
+        queuedBytes_ = 0;
+        inFlight_ = 0;
+        stopping_ = false;
+    }
+    maybePreallocate(0, false);
+
+    if (config_.useIoUring && !config_.beforeWrite && !setupRing()) {
+        std::cerr << "io_uring is not available; writing " << path << " from a thread." << std::endl;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.ioUring = ring_ != nullptr;
+    if (!ring_) writer_ = std::thread(&AsyncFileWriter::writerLoop, this);
+    return true;
+}
+
+bool AsyncFileWriter::append(const uint8_t* data, size_t size) {
+    if (fd_ < 0) return false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stats_.failed) return false;
+        queuedBytes_ += size;
+    }
+    while (size > 0) {
+        if (!current_.data) {
+            current_.data = takeBuffer();
+            current_.offset = size_;
+            current_.size = 0;
+        }
+        size_t n = std::min(size, config_.chunkBytes - current_.size);
+        std::memcpy(current_.data + current_.size, data, n);
+        current_.size += n;
+        size_ += n;
+        data += n;
+        size -= n;
+        if (current_.size == config_.chunkBytes) {
+            submit(current_);
+            current_ = Chunk();
+        }
+    }
+#ifdef HAVE_IO_URING
+    if (ring_) {
+        pumpRing();
+        if (ring_->outstanding < ring_->entries && syncDue()) {
+            io_uring_sqe* sqe = ring_->next();
+            sqe->opcode = IORING_OP_FSYNC;
+            sqe->fd = fd_;
+            sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+            sqe->user_data = IoRing::kSyncTag;
+            if (!ring_->submit()) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stats_.failed = true;
+            }
+        }
+    }
+#endif
+    return true;
+}
+
+bool AsyncFileWriter::waitForRoom(size_t maxQueued, int timeoutMs) {
+    Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(timeoutMs);
+    if (ring_) {
+        for (;;) {
+            pumpRing();
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                // Nothing in flight means only the chunk being filled is queued
+                if (queuedBytes_ <= maxQueued || inFlight_ == 0 || stats_.failed) {
+                    return queuedBytes_ <= maxQueued;
+                }
+            }
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+            if (left <= 0) return false;
+            reapRing(true, (int)left);
+        }
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    jobDone_.wait_until(lock, deadline, [&]() {
+        return queuedBytes_ <= maxQueued || inFlight_ == 0 || stats_.failed;
+    });
+    return queuedBytes_ <= maxQueued;
+}
+
+size_t AsyncFileWriter::queuedBytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return queuedBytes_;
+}
+
+bool AsyncFileWriter::flush() {
+    if (fd_ < 0) return false;
+    if (current_.size > 0) {
+        submit(current_);
+        current_ = Chunk();
+    }
+#ifdef HAVE_IO_URING
+    if (ring_) {
+        while (ring_->outstanding > 0 || !ringBacklog_.empty()) {
+            reapRing(true, 100);
+            pumpRing();
+        }
+    }
+#endif
+    std::unique_lock<std::mutex> lock(mutex_);
+    jobDone_.wait(lock, [&]() { return inFlight_ == 0; });
+    return !stats_.failed;
+}
+
+bool AsyncFileWriter::writeAt(uint64_t offset, const uint8_t* data, size_t size) {
+    if (fd_ < 0) return false;
+    if (!writeFully(fd_, data, size, offset)) {
+        std::cerr << "AsyncFileWriter: write failed: " << std::strerror(errno) << std::endl;
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.failed = true;
+        return false;
+    }
+    return true;
+}
+
+bool AsyncFileWriter::close() {
+    if (fd_ < 0) return true;
+    bool ok = flush();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    jobReady_.notify_all();
+    if (writer_.joinable()) writer_.join();
+    ring_.reset();
+
+    // The preallocation past the end is kept until the size is set again
+    if (ftruncate(fd_, (off_t)size_) != 0) ok = false;
+    if (fdatasync(fd_) != 0) {
+        ok = false;
+    } else {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.fsyncs++;
+    }
+    if (::close(fd_) != 0) ok = false;
+    fd_ = -1;
+    if (!ok) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.failed = true;
+    }
+    return ok;
+}
+
+AsyncFileWriterStats AsyncFileWriter::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    AsyncFileWriterStats stats = stats_;
+    stats.queuedBytes = queuedBytes_;
+    return stats;
+}
+
+uint8_t* AsyncFileWriter::takeBuffer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!freeBuffers_.empty()) {
+            uint8_t* buffer = freeBuffers_.back();
+            freeBuffers_.pop_back();
+            return buffer;
+        }
+    }
+    // Only as many as are queued at once, so bounded by the caller's limit
+    uint8_t* buffer = (uint8_t*)std::aligned_alloc(kAlignment, config_.chunkBytes);
+    if (!buffer) throw std::bad_alloc();
+    return buffer;
+}
+
+void AsyncFileWriter::submit(Chunk chunk) {
+    chunk.submitted = Clock::now();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        inFlight_++;
+        if (!ring_) jobs_.push_back(chunk);
+    }
+    if (ring_) {
+        submitRing(chunk);
+    } else {
+        jobReady_.notify_one();
+    }
+}
+
+void AsyncFileWriter::completed(const Chunk& chunk, bool ok) {
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() - chunk.submitted).count();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        inFlight_--;
+        queuedBytes_ -= chunk.size;
+        freeBuffers_.push_back(chunk.data);
+        if (ok) {
+            stats_.writes++;
+            stats_.bytesWritten += chunk.size;
+            stats_.maxWriteMs = std::max(stats_.maxWriteMs, ms);
+        } else {
+            stats_.failed = true;
+        }
+    }
+    jobDone_.notify_all();
+}
+
+void AsyncFileWriter::maybePreallocate(uint64_t end, bool async) {
+    if (config_.preallocateBytes == 0 || end + config_.preallocateBytes / 2 < preallocatedEnd_) return;
+    uint64_t from = preallocatedEnd_;
+    uint64_t length = end + config_.preallocateBytes - from;
+    preallocatedEnd_ = end + config_.preallocateBytes;
+#ifdef HAVE_IO_URING
+    if (async && ring_) {
+        io_uring_sqe* sqe = ring_->next();
+        sqe->opcode = IORING_OP_FALLOCATE;
+        sqe->fd = fd_;
+        sqe->off = from;
+        sqe->addr = length;
+        sqe->len = FALLOC_FL_KEEP_SIZE;
+        sqe->user_data = IoRing::kPreallocateTag;
+        if (ring_->submit()) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stats_.preallocatedBytes += length;
+        }
+        return;
+    }
+#endif
+    (void)async;
+    if (fallocate(fd_, FALLOC_FL_KEEP_SIZE, (off_t)from, (off_t)length) != 0) {
+        // Some filesystems cannot; the writes still work
+        std::cerr << "AsyncFileWriter: fallocate failed (" << std::strerror(errno) << "); not preallocating."
+                  << std::endl;
+        config_.preallocateBytes = 0;
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.preallocatedBytes += length;
+}
+
+bool AsyncFileWriter::syncDue() {
+    if (config_.fsyncIntervalMs <= 0) return false;
+    Clock::time_point now = Clock::now();
+    if (now - lastSync_ < std::chrono::milliseconds(config_.fsyncIntervalMs)) return false;
+    lastSync_ = now;
+    return true;
+}
+
+#ifdef HAVE_IO_URING
+
+bool AsyncFileWriter::setupRing() {
+    std::unique_ptr<IoRing> ring(new IoRing());
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    ring->fd = (int)syscall(__NR_io_uring_setup, config_.ringEntries, &params);
+    if (ring->fd < 0) return false;
+    // Waiting with a timeout needs IORING_ENTER_EXT_ARG (5.11)
+    if (!(params.features & IORING_FEAT_EXT_ARG)) return false;
+
+    ring->sqMapSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cqMapSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    ring->sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    ring->sqMap = mmap(nullptr, ring->sqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd,
+                       IORING_OFF_SQ_RING);
+    ring->cqMap = mmap(nullptr, ring->cqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd,
+                       IORING_OFF_CQ_RING);
+    ring->sqes = (io_uring_sqe*)mmap(nullptr, ring->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                     ring->fd, IORING_OFF_SQES);
+    if (ring->sqMap == MAP_FAILED || ring->cqMap == MAP_FAILED || ring->sqes == MAP_FAILED) return false;
+
+    uint8_t* sq = (uint8_t*)ring->sqMap;
+    ring->sqHead = (unsigned*)(sq + params.sq_off.head);
+    ring->sqTail = (unsigned*)(sq + params.sq_off.tail);
+    ring->sqMask = *(unsigned*)(sq + params.sq_off.ring_mask);
+    ring->sqArray = (unsigned*)(sq + params.sq_off.array);
+    uint8_t* cq = (uint8_t*)ring->cqMap;
+    ring->cqHead = (unsigned*)(cq + params.cq_off.head);
+    ring->cqTail = (unsigned*)(cq + params.cq_off.tail);
+    ring->cqMask = *(unsigned*)(cq + params.cq_off.ring_mask);
+    ring->cqes = (io_uring_cqe*)(cq + params.cq_off.cqes);
+    ring->entries = params.sq_entries;
+    // Leave room for a preallocation and a sync beside the writes
+    ring->slots.resize(ring->entries - 2);
+    for (size_t i = ring->slots.size(); i > 0; --i) ring->freeSlots.push_back(i - 1);
+    ring_ = std::move(ring);
+    return true;
+}
+
+void AsyncFileWriter::submitRing(Chunk chunk) {
+    // Waiting for a slot here would stall the caller on the disk; the
+    // chunk stays queued, as it would for the writer thread
+    ringBacklog_.push_back(chunk);
+    pumpRing();
+}
+
+void AsyncFileWriter::pumpRing() {
+    reapRing(false, 0);
+    while (!ringBacklog_.empty() && !ring_->freeSlots.empty() && ring_->outstanding + 2 <= ring_->entries) {
+        Chunk chunk = ringBacklog_.front();
+        ringBacklog_.pop_front();
+        maybePreallocate(chunk.offset + chunk.size, true);
+        size_t slot = ring_->freeSlots.back();
+        ring_->freeSlots.pop_back();
+        ring_->slots[slot] = chunk;
+
+        io_uring_sqe* sqe = ring_->next();
+        sqe->opcode = IORING_OP_WRITE;
+        sqe->fd = fd_;
+        sqe->addr = (uint64_t)(uintptr_t)chunk.data;
+        sqe->len = (uint32_t)chunk.size;
+        sqe->off = chunk.offset;
+        sqe->user_data = slot;
+        if (!ring_->submit()) {
+            std::cerr << "AsyncFileWriter: io_uring submit failed: " << std::strerror(errno) << std::endl;
+            ring_->freeSlots.push_back(slot);
+            completed(chunk, false);
+        }
+    }
+}
+
+void AsyncFileWriter::reapRing(bool wait, int timeoutMs) {
+    unsigned head = *ring_->cqHead;
+    if (wait && head == __atomic_load_n(ring_->cqTail, __ATOMIC_ACQUIRE) && ring_->outstanding > 0) {
+        ring_->wait(timeoutMs);
+    }
+    unsigned tail = __atomic_load_n(ring_->cqTail, __ATOMIC_ACQUIRE);
+    for (; head != tail; ++head) {
+        const io_uring_cqe& cqe = ring_->cqes[head & ring_->cqMask];
+        ring_->outstanding--;
+        if (cqe.user_data == IoRing::kPreallocateTag) {
+            if (cqe.res < 0) {
+                std::cerr << "AsyncFileWriter: fallocate failed (" << std::strerror(-cqe.res)
+                          << "); not preallocating." << std::endl;
+                config_.preallocateBytes = 0;
+            }
+            continue;
+        }
+        if (cqe.user_data == IoRing::kSyncTag) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (cqe.res < 0) {
+                stats_.failed = true;
+            } else {
+                stats_.fsyncs++;
+            }
+            continue;
+        }
+        size_t slot = (size_t)cqe.user_data;
+        Chunk& chunk = ring_->slots[slot];
+        if (cqe.res < 0) std::cerr << "AsyncFileWriter: write failed: " << std::strerror(-cqe.res) << std::endl;
+        if (cqe.res > 0) chunk.written += (size_t)cqe.res;
+        if (cqe.res > 0 && chunk.written < chunk.size) {
+            // Short write: send the rest from the same slot
+            io_uring_sqe* sqe = ring_->next();
+            sqe->opcode = IORING_OP_WRITE;
+            sqe->fd = fd_;
+            sqe->addr = (uint64_t)(uintptr_t)(chunk.data + chunk.written);
+            sqe->len = (uint32_t)(chunk.size - chunk.written);
+            sqe->off = chunk.offset + chunk.written;
+            sqe->user_data = slot;
+            if (ring_->submit()) continue;
+        }
+        ring_->freeSlots.push_back(slot);
+        completed(chunk, chunk.written == chunk.size);
+    }
+    __atomic_store_n(ring_->cqHead, head, __ATOMIC_RELEASE);
+}
+
+#else
+
+bool AsyncFileWriter::setupRing() {
+    return false;
+}
+
+void AsyncFileWriter::submitRing(Chunk) {}
+
+void AsyncFileWriter::pumpRing() {}
+
+void AsyncFileWriter::reapRing(bool, int) {}
+
+#endif
+
+void AsyncFileWriter::writerLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        jobReady_.wait(lock, [this]() { return stopping_ || !jobs_.empty(); });
+        if (jobs_.empty()) break;
+        Chunk chunk = jobs_.front();
+        jobs_.pop_front();
+        lock.unlock();
+
+        maybePreallocate(chunk.offset + chunk.size, false);
+        if (config_.beforeWrite) config_.beforeWrite(chunk.size);
+        bool ok = writeFully(fd_, chunk.data, chunk.size, chunk.offset);
+        if (!ok) std::cerr << "AsyncFileWriter: write failed: " << std::strerror(errno) << std::endl;
+        bool synced = ok && syncDue() && fdatasync(fd_) == 0;
+        completed(chunk, ok);
+
+        lock.lock();
+        if (synced) stats_.fsyncs++;
+    }
+}
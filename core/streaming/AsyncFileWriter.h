@@ -0,0 +1,121 @@
+#ifndef ASYNC_FILE_WRITER_H
+#define ASYNC_FILE_WRITER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct AsyncFileWriterConfig {
+    size_t chunkBytes = 1024 * 1024;           // Write size and alignment; a multiple of 4096
+    size_t preallocateBytes = 64 * 1024 * 1024; // Reserved ahead with fallocate; 0 turns it off
+    int fsyncIntervalMs = 1000;                // 0 turns periodic fdatasync off
+    bool useIoUring = true;                    // Else, or if the kernel refuses, a writer thread
+    unsigned ringEntries = 32;
+    // Runs on the writer thread before each write; lets tests stall the
+    // disk. Forces the writer thread.
+    std::function<void(size_t bytes)> beforeWrite;
+};
+
+struct AsyncFileWriterStats {
+    bool ioUring = false;
+    uint64_t bytesWritten = 0;   // Completed
+    uint64_t writes = 0;
+    uint64_t fsyncs = 0;
+    uint64_t preallocatedBytes = 0;
+    double maxWriteMs = 0.0;     // Submission to completion
+    size_t queuedBytes = 0;      // Appended, not yet written
+    bool failed = false;
+};
+
+// Appends to a file without blocking the caller on the disk. Bytes are
+// copied into aligned chunks and each full chunk is written whole at a
+// chunk-aligned offset, through io_uring where the kernel allows it and a
+// dedicated writer thread otherwise. Extents are reserved ahead with
+// fallocate (trimmed again on close) and data is synced periodically.
+//
+// Calls other than getStats() must come from one thread at a time.
+class AsyncFileWriter {
+public:
+    explicit AsyncFileWriter(const AsyncFileWriterConfig& config = AsyncFileWriterConfig());
+    ~AsyncFileWriter();
+
+    // Creates or truncates path
+    bool open(const std::string& path);
+    // Copies size bytes onto the end of the file; never waits for the disk.
+    // False once a write has failed.
+    bool append(const uint8_t* data, size_t size);
+    // Waits up to timeoutMs for queuedBytes() to fall to maxQueued
+    bool waitForRoom(size_t maxQueued, int timeoutMs);
+    size_t queuedBytes() const;
+    uint64_t size() const { return size_; } // Appended so far
+    // Writes out everything appended and waits for it
+    bool flush();
+    // Overwrites bytes that have already been flushed; synchronous
+    bool writeAt(uint64_t offset, const uint8_t* data, size_t size);
+    // Flushes, gives back the unused preallocation, syncs and closes. True
+    // if every write succeeded.
+    bool close();
+
+    bool isOpen() const { return fd_ >= 0; }
+    bool usingIoUring() const { return ring_ != nullptr; }
+    AsyncFileWriterStats getStats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+    struct Chunk {
+        uint8_t* data = nullptr;
+        size_t size = 0;
+        uint64_t offset = 0;
+        size_t written = 0;      // Short writes resume from here
+        Clock::time_point submitted;
+    };
+    struct IoRing;
+
+    uint8_t* takeBuffer();
+    void submit(Chunk chunk);
+    void completed(const Chunk& chunk, bool ok);
+    void maybePreallocate(uint64_t end, bool async);
+    bool syncDue();
+
+    // io_uring: submissions and completions both happen on the caller
+    bool setupRing();
+    void submitRing(Chunk chunk);
+    // Submits waiting chunks while the ring has room; never waits
+    void pumpRing();
+    // Handles completions, waiting up to timeoutMs for one if wait is set
+    void reapRing(bool wait, int timeoutMs);
+
+    // Writer thread
+    void writerLoop();
+
+    AsyncFileWriterConfig config_;
+    int fd_;
+    uint64_t size_;
+    Chunk current_;                  // Being filled
+    uint64_t preallocatedEnd_;
+    Clock::time_point lastSync_;
+    std::unique_ptr<IoRing> ring_;
+    std::deque<Chunk> ringBacklog_;  // Full chunks the ring has no room for yet
+
+    // Shared with the writer thread
+    mutable std::mutex mutex_;
+    std::condition_variable jobReady_;
+    std::condition_variable jobDone_;
+    std::deque<Chunk> jobs_;
+    std::vector<uint8_t*> freeBuffers_;
+    size_t inFlight_;                // Chunks submitted, not completed
+    size_t queuedBytes_;
+    bool stopping_;
+    AsyncFileWriterStats stats_;
+    std::thread writer_;
+};
+
+#endif // ASYNC_FILE_WRITER_H
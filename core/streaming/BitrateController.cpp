@@ -0,0 +1,143 @@
+#include "BitrateController.h"
+#include <algorithm>
+#include <cmath>
+
+BitrateController::BitrateController(const BitrateControllerConfig& config)
+    : config_(config) {
+    if (config_.ladder.empty()) config_.ladder.push_back({0, 0, 0});
+    config_.maxKbps = std::max(config_.maxKbps, config_.minKbps);
+    config_.minFps = std::min(config_.minFps, config_.maxFps);
+    reset();
+}
+
+void BitrateController::reset() {
+    hasSample_ = false;
+    lastTimeMs_ = 0.0;
+    lastSentBytes_ = 0;
+    targetKbps_ = std::min(std::max(config_.startKbps, config_.minKbps), config_.maxKbps);
+    throughputKbps_ = targetKbps_; // Until acknowledgements say otherwise
+    minRttMs_ = -1.0;
+    minRttTimeMs_ = 0.0;
+    lastDecreaseMs_ = -1e12;
+    clearSinceMs_ = -1.0;
+    upSinceMs_ = -1.0;
+    recovering_ = false;
+    stats_ = BitrateControllerStats();
+
+    decision_ = BitrateDecision();
+    decision_.targetKbps = (int)std::lround(targetKbps_);
+    decision_.fps = config_.maxFps;
+    decision_.rung = rungFor(targetKbps_);
+    decision_.width = config_.ladder[decision_.rung].width;
+    decision_.height = config_.ladder[decision_.rung].height;
+}
+
+bool BitrateController::update(const NetworkSample& sample) {
+    stats_.updates++;
+    double now = sample.timeMs;
+    if (!hasSample_ || sample.sentBytes < lastSentBytes_) {
+        hasSample_ = true;
+        lastTimeMs_ = now;
+        lastSentBytes_ = sample.sentBytes;
+        return false;
+    }
+    double dt = now - lastTimeMs_;
+    if (dt <= 0.0) return false;
+
+    // Bytes per millisecond times 8 is kbit/s
+    double instantKbps = (double)(sample.sentBytes - lastSentBytes_) * 8.0 / dt;
+    lastTimeMs_ = now;
+    lastSentBytes_ = sample.sentBytes;
+    // Averaged over about half a second: ACKs arrive in bursts under jitter
+    double weight = dt / (dt + 500.0);
+    throughputKbps_ += (instantKbps - throughputKbps_) * weight;
+
+    double rttRiseMs = 0.0;
+    if (sample.rttMs >= 0.0) {
+        // Path minimum over a 10 s window, so a longer route is picked up
+        if (minRttMs_ < 0.0 || sample.rttMs <= minRttMs_ || now - minRttTimeMs_ > 10000.0) {
+            minRttMs_ = sample.rttMs;
+            minRttTimeMs_ = now;
+        }
+        rttRiseMs = sample.rttMs - minRttMs_;
+    }
+    // Unacknowledged bytes include one round trip in flight, which is not queueing
+    double queueDelayMs = (double)sample.queuedBytes * 8.0 / std::max(throughputKbps_, (double)config_.minKbps);
+    queueDelayMs = std::max(0.0, queueDelayMs - std::max(minRttMs_, 0.0));
+    bool congested = queueDelayMs > config_.congestedDelayMs || rttRiseMs > config_.rttRiseMs;
+    bool clear = queueDelayMs < config_.clearDelayMs && rttRiseMs < config_.rttRiseMs * 0.5;
+
+    if (!recovering_ && queueDelayMs > config_.recoverDelayMs) {
+        recovering_ = true;
+        clearSinceMs_ = -1.0;
+        stats_.recoveries++;
+    }
+    if (recovering_) {
+        if (!clear) {
+            clearSinceMs_ = -1.0;
+        } else if (clearSinceMs_ < 0.0) {
+            clearSinceMs_ = now;
+        } else if (now - clearSinceMs_ >= config_.recoverHoldMs) {
+            recovering_ = false;
+        }
+    }
+
+    // While a queue drains the link runs at capacity, so measured
+    // throughput is the reference; cutting the target again before one
+    // RTT has shown the effect would compound.
+    double holdMs = std::max(300.0, sample.rttMs);
+    if (congested && now - lastDecreaseMs_ >= holdMs) {
+        double cut = std::min(targetKbps_, throughputKbps_ * config_.decreaseFactor);
+        if (cut < targetKbps_) {
+            targetKbps_ = cut;
+            lastDecreaseMs_ = now;
+            stats_.decreases++;
+        }
+    } else if (clear && !recovering_ && now - lastDecreaseMs_ >= config_.increaseHoldMs) {
+        targetKbps_ *= 1.0 + config_.increasePerSecond * dt / 1000.0;
+    }
+    targetKbps_ = std::min(std::max(targetKbps_, (double)config_.minKbps), (double)config_.maxKbps);
+
+    stats_.throughputKbps = throughputKbps_;
+    stats_.queueDelayMs = queueDelayMs;
+    stats_.minRttMs = std::max(minRttMs_, 0.0);
+
+    BitrateDecision previous = decision_;
+    applyTarget(now);
+    decision_.dropNonReference = recovering_ || queueDelayMs > config_.dropDelayMs;
+    return decision_ != previous;
+}
+
+int BitrateController::rungFor(double targetKbps) const {
+    for (size_t i = 0; i < config_.ladder.size(); ++i) {
+        if (targetKbps >= config_.ladder[i].minKbps) return (int)i;
+    }
+    return (int)config_.ladder.size() - 1;
+}
+
+void BitrateController::applyTarget(double nowMs) {
+    decision_.targetKbps = (int)std::lround(targetKbps_);
+    decision_.recovering = recovering_;
+    decision_.fps = recovering_ ? config_.minFps : config_.maxFps;
+
+    // Down the ladder at once; up one rung at a time, with margin and hold
+    int desired = rungFor(targetKbps_);
+    int rung = decision_.rung;
+    if (desired > rung) {
+        rung = desired;
+        upSinceMs_ = -1.0;
+    } else if (desired < rung && targetKbps_ >= config_.ladder[rung - 1].minKbps * 1.1) {
+        if (upSinceMs_ < 0.0) {
+            upSinceMs_ = nowMs;
+        } else if (nowMs - upSinceMs_ >= config_.ladderUpHoldMs) {
+            rung--;
+            upSinceMs_ = -1.0;
+        }
+    } else {
+        upSinceMs_ = -1.0;
+    }
+    if (rung != decision_.rung) stats_.rungChanges++;
+    decision_.rung = rung;
+    decision_.width = config_.ladder[rung].width;
+    decision_.height = config_.ladder[rung].height;
+}
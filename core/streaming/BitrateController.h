@@ -0,0 +1,108 @@
+#ifndef BITRATE_CONTROLLER_H
+#define BITRATE_CONTROLLER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct BitrateRung {
+    int width;
+    int height;
+    int minKbps; // Lowest target this resolution is used at
+};
+
+struct BitrateControllerConfig {
+    int minKbps = 300;
+    int maxKbps = 6000;
+    int startKbps = 2500;
+    int maxFps = 30;
+    int minFps = 15;
+    // Highest resolution first
+    std::vector<BitrateRung> ladder = {{1920, 1080, 4500}, {1280, 720, 2500}, {854, 480, 1200}, {640, 360, 0}};
+
+    // Thresholds on queueing delay: unsent bytes over measured throughput
+    double dropDelayMs = 150.0;      // Non-reference frames are dropped above this
+    double congestedDelayMs = 250.0; // The target is cut above this
+    double recoverDelayMs = 1000.0;  // RECOVERING is entered above this
+    double clearDelayMs = 60.0;      // The queue counts as drained below this
+    double recoverHoldMs = 2000.0;   // ...for this long before RECOVERING ends
+    double rttRiseMs = 80.0;         // RTT above the path minimum that counts as congestion
+
+    double decreaseFactor = 0.85;    // Applied to measured throughput on congestion
+    double increasePerSecond = 0.08; // Multiplicative probe while the path is clear
+    double increaseHoldMs = 1000.0;  // No probing this soon after a cut
+    double ladderUpHoldMs = 3000.0;  // Target must clear the next rung up this long
+};
+
+struct NetworkSample {
+    double timeMs = 0.0;     // Monotonic
+    size_t queuedBytes = 0;  // Accepted for sending, not yet acknowledged
+    uint64_t sentBytes = 0;  // Cumulative, acknowledged by the peer
+    double rttMs = -1.0;     // Negative when unknown
+};
+
+struct BitrateDecision {
+    int targetKbps = 0;
+    int fps = 0;
+    int rung = 0;
+    int width = 0;
+    int height = 0;
+    bool dropNonReference = false;
+    bool recovering = false;
+
+    bool operator==(const BitrateDecision& other) const {
+        return targetKbps == other.targetKbps && fps == other.fps && rung == other.rung &&
+               dropNonReference == other.dropNonReference && recovering == other.recovering;
+    }
+    bool operator!=(const BitrateDecision& other) const { return !(*this == other); }
+};
+
+struct BitrateControllerStats {
+    uint64_t updates = 0;
+    uint64_t decreases = 0;
+    uint64_t rungChanges = 0;
+    uint64_t recoveries = 0;
+    double throughputKbps = 0.0;
+    double queueDelayMs = 0.0;
+    double minRttMs = 0.0;
+};
+
+// Congestion controller for the live stream. Each update() takes the
+// sender's queue occupancy, acknowledged byte count and RTT, and moves the
+// encoder target: cut to a fraction of measured throughput when queueing
+// delay or RTT rises, probe upwards multiplicatively while the path is
+// clear. Frame rate and resolution rung follow the target (the rung only
+// moves up after a hold), and non-reference frames are dropped while a
+// queue is forming. A deep queue enters RECOVERING until it has drained.
+class BitrateController {
+public:
+    explicit BitrateController(const BitrateControllerConfig& config = BitrateControllerConfig());
+
+    void reset();
+    // True when the decision changed
+    bool update(const NetworkSample& sample);
+    const BitrateDecision& decision() const { return decision_; }
+    BitrateControllerStats getStats() const { return stats_; }
+
+private:
+    int rungFor(double targetKbps) const;
+    void applyTarget(double nowMs);
+
+    BitrateControllerConfig config_;
+    BitrateDecision decision_;
+    BitrateControllerStats stats_;
+
+    bool hasSample_;
+    double lastTimeMs_;
+    uint64_t lastSentBytes_;
+    double targetKbps_;
+    double throughputKbps_;
+    double minRttMs_;
+    double minRttTimeMs_;
+    double lastDecreaseMs_;
+    double clearSinceMs_;
+    double upSinceMs_;
+    bool recovering_;
+};
+
+#endif // BITRATE_CONTROLLER_H
@@ -0,0 +1,55 @@
+#include "GopCache.h"
+
+void GopCache::setMaxBytes(size_t maxBytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    maxBytes_ = maxBytes;
+    if (stats_.bytes > maxBytes_) {
+        gop_.clear();
+        stats_.packets = 0;
+        stats_.bytes = 0;
+        overflowed_ = true;
+    }
+}
+
+void GopCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    videoHeader_ = GopPacket();
+    audioHeader_ = GopPacket();
+    gop_.clear();
+    overflowed_ = false;
+    stats_ = GopCacheStats();
+}
+
+GopCacheStats GopCache::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void GopCache::store(const GopPacket& packet) {
+    if (packet.sequenceHeader) {
+        (packet.video ? videoHeader_ : audioHeader_) = packet;
+        return;
+    }
+    if (!packet.payload || maxBytes_ == 0) return;
+    if (packet.video && packet.keyframe) {
+        gop_.clear();
+        stats_.packets = 0;
+        stats_.bytes = 0;
+        overflowed_ = false;
+    }
+    // Nothing before the first keyframe is worth replaying
+    if (overflowed_ || (gop_.empty() && !(packet.video && packet.keyframe))) return;
+
+    if (stats_.bytes + packet.payload->size() > maxBytes_) {
+        // A GOP without its keyframe is useless: drop it all until the next one
+        gop_.clear();
+        stats_.packets = 0;
+        stats_.bytes = 0;
+        stats_.overflows++;
+        overflowed_ = true;
+        return;
+    }
+    gop_.push_back(packet);
+    stats_.packets++;
+    stats_.bytes += packet.payload->size();
+}
@@ -0,0 +1,72 @@
+#ifndef GOP_CACHE_H
+#define GOP_CACHE_H
+
+#include "RtmpPublisher.h"
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// One packet as StreamController hands it to its outputs
+struct GopPacket {
+    bool video = true;
+    uint32_t timestampMs = 0;
+    bool keyframe = false;
+    RtmpPublisher::Payload payload;
+    uint8_t format = RtmpPublisher::kFlvVideoAvc; // FLV codec id, or sound format for audio
+    bool sequenceHeader = false;
+    int32_t compositionMs = 0;
+};
+
+struct GopCacheStats {
+    size_t packets = 0;    // Since the last keyframe, audio included
+    size_t bytes = 0;
+    uint64_t overflows = 0; // GOPs that outgrew maxBytes and were not kept
+};
+
+// The latest sequence headers and every packet since the last keyframe,
+// as references to the shared payloads. A new connection replays this and
+// starts decoding at once, instead of waiting up to a GOP for the next
+// keyframe or asking the encoder for one.
+//
+// add() and replay() run their callbacks under the cache lock, so each
+// packet reaches a joining output exactly once: either in its replay or
+// through the delivery that follows.
+class GopCache {
+public:
+    // 0 keeps only the sequence headers
+    explicit GopCache(size_t maxBytes = 0) : maxBytes_(maxBytes), overflowed_(false) {}
+
+    void setMaxBytes(size_t maxBytes);
+    void clear();
+    GopCacheStats getStats() const;
+
+    template <typename Deliver>
+    void add(const GopPacket& packet, Deliver deliver) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        store(packet);
+        deliver(packet);
+    }
+
+    // replay(headers, gop); gop is empty or starts with a keyframe
+    template <typename Replay>
+    void replay(Replay replay) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<const GopPacket*> headers;
+        if (videoHeader_.payload) headers.push_back(&videoHeader_);
+        if (audioHeader_.payload) headers.push_back(&audioHeader_);
+        replay(headers, gop_);
+    }
+
+private:
+    void store(const GopPacket& packet);
+
+    mutable std::mutex mutex_;
+    size_t maxBytes_;
+    GopPacket videoHeader_;
+    GopPacket audioHeader_;
+    std::vector<GopPacket> gop_;
+    bool overflowed_; // Until the next keyframe
+    GopCacheStats stats_;
+};
+
+#endif // GOP_CACHE_H
@@ -0,0 +1,87 @@
+#include "LinkEmulator.h"
+#include <algorithm>
+
+LinkEmulator::LinkEmulator(const LinkEmulatorConfig& config)
+    : config_(config)
+    , rng_(config.seed)
+    , uniform_(0.0, 1.0)
+    , sendQueueBytes_(0)
+    , queuedBytes_(0)
+    , nowMs_(0.0)
+    , wireClockMs_(0.0)
+    , lastAckMs_(0.0)
+    , ackedBytes_(0)
+    , rttMs_(2.0 * config.delayMs)
+    , lostPackets_(0) {
+    config_.packetBytes = std::max<size_t>(config_.packetBytes, 1);
+}
+
+void LinkEmulator::setConfig(const LinkEmulatorConfig& config) {
+    size_t packetBytes = std::max<size_t>(config.packetBytes, 1);
+    config_ = config;
+    config_.packetBytes = packetBytes;
+}
+
+void LinkEmulator::write(size_t bytes) {
+    queuedBytes_ += bytes;
+    sendQueueBytes_ += bytes;
+    while (bytes > 0) {
+        size_t packet = std::min(bytes, config_.packetBytes);
+        sendQueue_.push_back(packet);
+        bytes -= packet;
+    }
+}
+
+void LinkEmulator::advance(double nowMs) {
+    if (nowMs <= nowMs_) return;
+
+    // Lost packets due for resending go to the head of the line
+    while (!resends_.empty() && resends_.front().dueMs <= nowMs) {
+        sendQueue_.push_front(resends_.front().bytes);
+        sendQueueBytes_ += resends_.front().bytes;
+        resends_.pop_front();
+    }
+
+    // The wire serializes packets at the bandwidth cap
+    double clock = wireClockMs_;
+    double msPerByte = 8.0 / std::max(config_.bandwidthKbps, 1e-3);
+    while (!sendQueue_.empty()) {
+        size_t bytes = sendQueue_.front();
+        double sentAt = clock + bytes * msPerByte;
+        if (sentAt > nowMs) break;
+        clock = sentAt;
+        sendQueue_.pop_front();
+        sendQueueBytes_ -= bytes;
+
+        if (config_.lossRate > 0.0 && uniform_(rng_) < config_.lossRate) {
+            lostPackets_++;
+            resends_.push_back({bytes, sentAt + 2.0 * config_.delayMs + config_.jitterMs});
+            continue;
+        }
+        // Queueing in the router buffer shows up in RTT; the rest waits in the sender
+        double queueingMs = std::min(sendQueueBytes_, config_.bottleneckBytes) * msPerByte;
+        double rtt = 2.0 * config_.delayMs + uniform_(rng_) * config_.jitterMs + queueingMs;
+        double ackAt = std::max(sentAt + rtt, lastAckMs_); // Acknowledged in order
+        lastAckMs_ = ackAt;
+        inFlight_.push_back({bytes, ackAt, rtt});
+    }
+    // An idle wire does not bank time for a later burst
+    wireClockMs_ = sendQueue_.empty() ? std::max(clock, nowMs) : clock;
+
+    while (!inFlight_.empty() && inFlight_.front().ackAtMs <= nowMs) {
+        ackedBytes_ += inFlight_.front().bytes;
+        queuedBytes_ -= inFlight_.front().bytes;
+        rttMs_ = inFlight_.front().rttMs;
+        inFlight_.pop_front();
+    }
+    nowMs_ = nowMs;
+}
+
+NetworkSample LinkEmulator::sample(double nowMs) const {
+    NetworkSample sample;
+    sample.timeMs = nowMs;
+    sample.queuedBytes = queuedBytes_;
+    sample.sentBytes = ackedBytes_;
+    sample.rttMs = rttMs_;
+    return sample;
+}
@@ -0,0 +1,72 @@
+#ifndef LINK_EMULATOR_H
+#define LINK_EMULATOR_H
+
+#include "BitrateController.h"
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <random>
+
+struct LinkEmulatorConfig {
+    double bandwidthKbps = 5000.0;
+    double delayMs = 20.0;               // One way
+    double jitterMs = 0.0;               // Extra one-way delay, uniform in [0, jitterMs]
+    double lossRate = 0.0;               // Per packet; a lost packet is resent after one RTT
+    size_t bottleneckBytes = 64 * 1024;  // Router buffer: what of the queue shows up in RTT
+    size_t packetBytes = 1400;
+    unsigned seed = 1;
+};
+
+// In-process stand-in for a TCP path, in simulated time: a sender queue
+// drained at the bandwidth cap, propagation delay with jitter, random loss
+// with retransmission, and in-order acknowledgements. It reports the same
+// signals StreamController gets from a real socket, so BitrateController
+// can be exercised with step changes and no network.
+class LinkEmulator {
+public:
+    explicit LinkEmulator(const LinkEmulatorConfig& config = LinkEmulatorConfig());
+
+    // Takes effect for data sent from now on; queued data stays queued
+    void setConfig(const LinkEmulatorConfig& config);
+    const LinkEmulatorConfig& config() const { return config_; }
+
+    void write(size_t bytes);
+    // Moves simulated time forward; call with non-decreasing times
+    void advance(double nowMs);
+
+    size_t queuedBytes() const { return queuedBytes_; } // Written, not yet acknowledged
+    uint64_t ackedBytes() const { return ackedBytes_; }
+    double rttMs() const { return rttMs_; }             // Latest acknowledged packet
+    uint64_t lostPackets() const { return lostPackets_; }
+    NetworkSample sample(double nowMs) const;
+
+private:
+    struct InFlight {
+        size_t bytes;
+        double ackAtMs;
+        double rttMs;
+    };
+    struct Resend {
+        size_t bytes;
+        double dueMs;
+    };
+
+    LinkEmulatorConfig config_;
+    std::mt19937 rng_;
+    std::uniform_real_distribution<double> uniform_;
+
+    std::deque<size_t> sendQueue_; // Packet sizes, not yet on the wire
+    size_t sendQueueBytes_;
+    std::deque<InFlight> inFlight_;
+    std::deque<Resend> resends_;
+    size_t queuedBytes_;
+
+    double nowMs_;
+    double wireClockMs_; // When the wire is free again
+    double lastAckMs_;
+    uint64_t ackedBytes_;
+    double rttMs_;
+    uint64_t lostPackets_;
+};
+
+#endif // LINK_EMULATOR_H
@@ -0,0 +1,112 @@
+#include "Matroska.h"
+#include <cassert>
+#include <cstring>
+
+namespace {
+
+constexpr int kMasterSizeBytes = 8;
+
+int minimalSizeBytes(uint64_t size) {
+    int bytes = 1;
+    // All ones is reserved for "unknown"
+    while (bytes < 8 && size >= (1ULL << (7 * bytes)) - 1) bytes++;
+    return bytes;
+}
+
+} // namespace
+
+EbmlWriter& EbmlWriter::uint(uint32_t id, uint64_t value) {
+    int bytes = 1;
+    while (bytes < 8 && value >> (8 * bytes)) bytes++;
+    putId(id);
+    putSize(bytes, 1);
+    for (int i = bytes - 1; i >= 0; --i) data_.push_back((uint8_t)(value >> (8 * i)));
+    return *this;
+}
+
+EbmlWriter& EbmlWriter::floating(uint32_t id, double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    putId(id);
+    putSize(8, 1);
+    for (int i = 7; i >= 0; --i) data_.push_back((uint8_t)(bits >> (8 * i)));
+    return *this;
+}
+
+EbmlWriter& EbmlWriter::string(uint32_t id, const std::string& value) {
+    return binary(id, (const uint8_t*)value.data(), value.size());
+}
+
+EbmlWriter& EbmlWriter::binary(uint32_t id, const uint8_t* data, size_t size) {
+    header(id, size);
+    return append(data, size);
+}
+
+EbmlWriter& EbmlWriter::header(uint32_t id, uint64_t size) {
+    putId(id);
+    putSize(size, minimalSizeBytes(size));
+    return *this;
+}
+
+EbmlWriter& EbmlWriter::append(const uint8_t* data, size_t size) {
+    data_.insert(data_.end(), data, data + size);
+    return *this;
+}
+
+EbmlWriter& EbmlWriter::begin(uint32_t id) {
+    putId(id);
+    open_.push_back(data_.size());
+    putSize(0, kMasterSizeBytes);
+    return *this;
+}
+
+EbmlWriter& EbmlWriter::end() {
+    assert(!open_.empty());
+    size_t sizeAt = open_.back();
+    open_.pop_back();
+    uint64_t size = data_.size() - sizeAt - kMasterSizeBytes;
+    data_[sizeAt] = 0x01;
+    for (int i = 1; i < kMasterSizeBytes; ++i) {
+        data_[sizeAt + i] = (uint8_t)(size >> (8 * (kMasterSizeBytes - 1 - i)));
+    }
+    return *this;
+}
+
+EbmlWriter& EbmlWriter::beginUnknownSize(uint32_t id) {
+    putId(id);
+    data_.push_back(0x01);
+    data_.insert(data_.end(), 7, 0xFF);
+    return *this;
+}
+
+EbmlWriter& EbmlWriter::padding(size_t totalBytes) {
+    assert(totalBytes >= 2);
+    // One id byte, then a one-byte size while the payload fits it
+    size_t payload = totalBytes - 2;
+    int sizeBytes = 1;
+    if (payload >= 127) {
+        assert(totalBytes >= 1 + kMasterSizeBytes);
+        payload = totalBytes - 1 - kMasterSizeBytes;
+        sizeBytes = kMasterSizeBytes;
+    }
+    putId(kMkvVoid);
+    putSize(payload, sizeBytes);
+    data_.insert(data_.end(), payload, 0);
+    return *this;
+}
+
+void EbmlWriter::clear() {
+    data_.clear();
+    open_.clear();
+}
+
+void EbmlWriter::putId(uint32_t id) {
+    // Ids carry their own length marker, so just drop the leading zero bytes
+    int bytes = id > 0xFFFFFF ? 4 : id > 0xFFFF ? 3 : id > 0xFF ? 2 : 1;
+    for (int i = bytes - 1; i >= 0; --i) data_.push_back((uint8_t)(id >> (8 * i)));
+}
+
+void EbmlWriter::putSize(uint64_t size, int bytes) {
+    uint64_t marked = size | (1ULL << (7 * bytes));
+    for (int i = bytes - 1; i >= 0; --i) data_.push_back((uint8_t)(marked >> (8 * i)));
+}
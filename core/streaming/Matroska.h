@@ -0,0 +1,97 @@
+#ifndef MATROSKA_H
+#define MATROSKA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// EBML/Matroska pieces for RecordingSink and anything that reads its
+// output: the element ids it writes and a writer for EBML elements.
+
+constexpr uint32_t kMkvEbml = 0x1A45DFA3;
+constexpr uint32_t kMkvEbmlVersion = 0x4286;
+constexpr uint32_t kMkvEbmlReadVersion = 0x42F7;
+constexpr uint32_t kMkvEbmlMaxIdLength = 0x42F2;
+constexpr uint32_t kMkvEbmlMaxSizeLength = 0x42F3;
+constexpr uint32_t kMkvDocType = 0x4282;
+constexpr uint32_t kMkvDocTypeVersion = 0x4287;
+constexpr uint32_t kMkvDocTypeReadVersion = 0x4285;
+constexpr uint32_t kMkvVoid = 0xEC;
+
+constexpr uint32_t kMkvSegment = 0x18538067;
+constexpr uint32_t kMkvSeekHead = 0x114D9B74;
+constexpr uint32_t kMkvSeek = 0x4DBB;
+constexpr uint32_t kMkvSeekId = 0x53AB;
+constexpr uint32_t kMkvSeekPosition = 0x53AC;
+
+constexpr uint32_t kMkvInfo = 0x1549A966;
+constexpr uint32_t kMkvTimestampScale = 0x2AD7B1;
+constexpr uint32_t kMkvDuration = 0x4489;
+constexpr uint32_t kMkvMuxingApp = 0x4D80;
+constexpr uint32_t kMkvWritingApp = 0x5741;
+
+constexpr uint32_t kMkvTracks = 0x1654AE6B;
+constexpr uint32_t kMkvTrackEntry = 0xAE;
+constexpr uint32_t kMkvTrackNumber = 0xD7;
+constexpr uint32_t kMkvTrackUid = 0x73C5;
+constexpr uint32_t kMkvTrackType = 0x83;
+constexpr uint32_t kMkvFlagLacing = 0x9C;
+constexpr uint32_t kMkvCodecId = 0x86;
+constexpr uint32_t kMkvCodecPrivate = 0x63A2;
+constexpr uint32_t kMkvVideo = 0xE0;
+constexpr uint32_t kMkvPixelWidth = 0xB0;
+constexpr uint32_t kMkvPixelHeight = 0xBA;
+constexpr uint32_t kMkvAudio = 0xE1;
+constexpr uint32_t kMkvSamplingFrequency = 0xB5;
+constexpr uint32_t kMkvChannels = 0x9F;
+
+constexpr uint32_t kMkvCluster = 0x1F43B675;
+constexpr uint32_t kMkvClusterTimestamp = 0xE7;
+constexpr uint32_t kMkvSimpleBlock = 0xA3;
+
+constexpr uint32_t kMkvCues = 0x1C53BB6B;
+constexpr uint32_t kMkvCuePoint = 0xBB;
+constexpr uint32_t kMkvCueTime = 0xB3;
+constexpr uint32_t kMkvCueTrackPositions = 0xB7;
+constexpr uint32_t kMkvCueTrack = 0xF7;
+constexpr uint32_t kMkvCueClusterPosition = 0xF1;
+
+constexpr uint8_t kMkvTrackTypeVideo = 1;
+constexpr uint8_t kMkvTrackTypeAudio = 2;
+constexpr uint8_t kMkvBlockKeyframe = 0x80;
+// SimpleBlock header for track numbers below 127: track, timestamp, flags
+constexpr size_t kMkvSimpleBlockHeader = 4;
+
+// Appends EBML elements to a buffer. Master elements get an 8-byte size
+// that end() fills in, so they can be written in one pass.
+class EbmlWriter {
+public:
+    EbmlWriter& uint(uint32_t id, uint64_t value);
+    EbmlWriter& floating(uint32_t id, double value);
+    EbmlWriter& string(uint32_t id, const std::string& value);
+    EbmlWriter& binary(uint32_t id, const uint8_t* data, size_t size);
+    // Id and size only; the caller appends the payload
+    EbmlWriter& header(uint32_t id, uint64_t size);
+    EbmlWriter& append(const uint8_t* data, size_t size);
+    EbmlWriter& begin(uint32_t id);
+    EbmlWriter& end();
+    // A master element left open for good, as a Segment written live
+    EbmlWriter& beginUnknownSize(uint32_t id);
+    // A Void element of exactly totalBytes (at least 2), to be overwritten
+    EbmlWriter& padding(size_t totalBytes);
+
+    size_t size() const { return data_.size(); }
+    bool empty() const { return data_.empty(); }
+    const std::vector<uint8_t>& data() const { return data_; }
+    void clear();
+
+private:
+    void putId(uint32_t id);
+    void putSize(uint64_t size, int bytes);
+
+    std::vector<uint8_t> data_;
+    std::vector<size_t> open_; // Offsets of the size fields end() fills in
+};
+
+#endif // MATROSKA_H
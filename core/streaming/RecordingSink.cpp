@@ -0,0 +1,331 @@
+#include "RecordingSink.h"
+#include "RtmpPublisher.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <iostream>
+
+namespace {
+
+constexpr size_t kSeekHeadSpace = 160;
+// Duration: 2-byte id, 1-byte size, 8-byte float
+constexpr size_t kDurationSpace = 11;
+// SimpleBlock times are signed 16-bit offsets from the cluster's
+constexpr int64_t kMaxBlockOffsetMs = 32767;
+constexpr uint8_t kVideoTrack = 1;
+constexpr uint8_t kAudioTrack = 2;
+constexpr const char* kAppName = "HybridMediaEngine";
+
+const char* videoCodecName(uint8_t codecId) {
+    switch (codecId) {
+        case RtmpPublisher::kFlvVideoAvc: return "V_MPEG4/ISO/AVC";
+        case RtmpPublisher::kFlvVideoHevc: return "V_MPEGH/ISO/HEVC";
+        default: return nullptr;
+    }
+}
+
+// Sample rate and channels from an AAC AudioSpecificConfig
+bool parseAacConfig(const std::vector<uint8_t>& config, double& sampleRate, int& channels) {
+    static const int kRates[] = {96000, 88200, 64000, 48000, 44100, 32000, 24000, 22050, 16000, 12000, 11025, 8000,
+                                 7350};
+    if (config.size() < 2) return false;
+    int rateIndex = (config[0] & 0x07) << 1 | config[1] >> 7;
+    if (rateIndex >= (int)(sizeof(kRates) / sizeof(kRates[0]))) return false;
+    sampleRate = kRates[rateIndex];
+    channels = (config[1] >> 3) & 0x0F;
+    if (channels == 0) channels = 2; // Given in a program config element instead
+    return true;
+}
+
+void appendId(EbmlWriter& out, uint32_t seekId, uint32_t id) {
+    uint8_t bytes[4] = {(uint8_t)(id >> 24), (uint8_t)(id >> 16), (uint8_t)(id >> 8), (uint8_t)id};
+    out.binary(seekId, bytes, sizeof(bytes));
+}
+
+} // namespace
+
+RecordingSink::RecordingSink(const RecordingSinkConfig& config)
+    : config_(config)
+    , writer_(config.writer)
+    , recording_(false)
+    , headerWritten_(false)
+    , hasAudioTrack_(false)
+    , waitKeyframe_(true)
+    , baseMs_(0)
+    , segmentStart_(0)
+    , seekHeadAt_(0)
+    , durationAt_(0)
+    , infoAt_(0)
+    , tracksAt_(0)
+    , clusterTimeMs_(0)
+    , lastTimeMs_(0) {
+}
+
+RecordingSink::~RecordingSink() {
+    stop();
+}
+
+bool RecordingSink::start(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (recording_) {
+        std::cerr << "RecordingSink: already recording" << std::endl;
+        return false;
+    }
+    if (!writer_.open(path)) return false;
+    recording_ = true;
+    headerWritten_ = false;
+    hasAudioTrack_ = false;
+    waitKeyframe_ = true;
+    cluster_.clear();
+    cues_.clear();
+    lastTimeMs_ = 0;
+    stats_ = RecordingSinkStats();
+    stats_.recording = true;
+    std::cout << "Recording to " << path << (writer_.usingIoUring() ? " (io_uring)" : "") << std::endl;
+    return true;
+}
+
+bool RecordingSink::stop() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!recording_) return false;
+    finish();
+    bool ok = writer_.close();
+    recording_ = false;
+    stats_.recording = false;
+    if (!ok) std::cerr << "Recording was not completed cleanly." << std::endl;
+    return ok;
+}
+
+bool RecordingSink::isRecording() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return recording_;
+}
+
+bool RecordingSink::addVideo(uint32_t timestampMs, bool keyframe, const uint8_t* data, size_t size,
+                             uint8_t codecId, bool sequenceHeader, int32_t compositionMs) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Kept while idle too, so a recording can start mid-stream
+    if (sequenceHeader) {
+        videoHeader_.bytes.assign(data, data + size);
+        videoHeader_.format = codecId;
+        videoHeader_.present = true;
+        return recording_;
+    }
+    if (!recording_) return false;
+    if (!videoCodecName(codecId) || !videoHeader_.present || videoHeader_.format != codecId) {
+        stats_.skippedPackets++;
+        return false;
+    }
+    if (!headerWritten_) {
+        if (!keyframe) {
+            stats_.skippedPackets++;
+            return false;
+        }
+        baseMs_ = timestampMs;
+        writeHeader();
+    }
+    return add(true, (int64_t)timestampMs + compositionMs - baseMs_, keyframe, data, size);
+}
+
+bool RecordingSink::addAudio(uint32_t timestampMs, const uint8_t* data, size_t size, uint8_t soundFormat,
+                             bool sequenceHeader) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (sequenceHeader) {
+        audioHeader_.bytes.assign(data, data + size);
+        audioHeader_.format = soundFormat;
+        audioHeader_.present = true;
+        return recording_;
+    }
+    if (!recording_) return false;
+    if (!hasAudioTrack_ || soundFormat != audioHeader_.format) {
+        stats_.skippedPackets++;
+        return false;
+    }
+    return add(false, (int64_t)timestampMs - baseMs_, false, data, size);
+}
+
+RecordingSinkStats RecordingSink::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    RecordingSinkStats stats = stats_;
+    stats.fileBytes = writer_.size();
+    stats.durationMs = (double)lastTimeMs_;
+    stats.writer = writer_.getStats();
+    return stats;
+}
+
+bool RecordingSink::add(bool video, int64_t timeMs, bool keyframe, const uint8_t* data, size_t size) {
+    if (timeMs < 0) {
+        stats_.skippedPackets++;
+        return false;
+    }
+    if (video && waitKeyframe_ && !keyframe) {
+        stats_.droppedPackets++;
+        return false;
+    }
+    size_t blockBytes = kMkvSimpleBlockHeader + size;
+    int64_t offsetMs = timeMs - clusterTimeMs_;
+    if ((video && keyframe) || cluster_.size() + blockBytes > config_.maxClusterBytes ||
+        offsetMs > kMaxBlockOffsetMs || offsetMs < -kMaxBlockOffsetMs) {
+        closeCluster();
+    }
+    // Room for the block's own id and size too
+    if (!makeRoom(blockBytes + 16)) {
+        stats_.droppedPackets++;
+        // Inter frames after a dropped frame cannot be decoded
+        if (video) waitKeyframe_ = true;
+        return false;
+    }
+
+    if (cluster_.empty()) {
+        // Closed clusters are appended at once, so this one starts at the end
+        uint64_t position = writer_.size() - segmentStart_;
+        cluster_.begin(kMkvCluster).uint(kMkvClusterTimestamp, (uint64_t)timeMs);
+        clusterTimeMs_ = timeMs;
+        if (video && keyframe) cues_.emplace_back(timeMs, position);
+        stats_.clusters++;
+    }
+    int16_t offset = (int16_t)(timeMs - clusterTimeMs_);
+    uint8_t block[kMkvSimpleBlockHeader] = {
+        (uint8_t)(0x80 | (video ? kVideoTrack : kAudioTrack)), (uint8_t)((uint16_t)offset >> 8),
+        (uint8_t)offset, (uint8_t)(video && !keyframe ? 0 : kMkvBlockKeyframe)};
+    cluster_.header(kMkvSimpleBlock, blockBytes).append(block, sizeof(block)).append(data, size);
+
+    if (video && keyframe) waitKeyframe_ = false;
+    stats_.packets++;
+    lastTimeMs_ = std::max(lastTimeMs_, timeMs);
+    return true;
+}
+
+void RecordingSink::writeHeader() {
+    EbmlWriter out;
+    out.begin(kMkvEbml)
+        .uint(kMkvEbmlVersion, 1)
+        .uint(kMkvEbmlReadVersion, 1)
+        .uint(kMkvEbmlMaxIdLength, 4)
+        .uint(kMkvEbmlMaxSizeLength, 8)
+        .string(kMkvDocType, "matroska")
+        .uint(kMkvDocTypeVersion, 4)
+        .uint(kMkvDocTypeReadVersion, 2)
+        .end();
+    out.beginUnknownSize(kMkvSegment);
+    segmentStart_ = out.size();
+    seekHeadAt_ = out.size();
+    out.padding(kSeekHeadSpace);
+
+    infoAt_ = out.size() - segmentStart_;
+    out.begin(kMkvInfo)
+        .uint(kMkvTimestampScale, 1000000) // Milliseconds
+        .string(kMkvMuxingApp, kAppName)
+        .string(kMkvWritingApp, kAppName);
+    durationAt_ = out.size();
+    out.padding(kDurationSpace).end();
+
+    tracksAt_ = out.size() - segmentStart_;
+    out.begin(kMkvTracks);
+    out.begin(kMkvTrackEntry)
+        .uint(kMkvTrackNumber, kVideoTrack)
+        .uint(kMkvTrackUid, kVideoTrack)
+        .uint(kMkvTrackType, kMkvTrackTypeVideo)
+        .uint(kMkvFlagLacing, 0)
+        .string(kMkvCodecId, videoCodecName(videoHeader_.format))
+        .binary(kMkvCodecPrivate, videoHeader_.bytes.data(), videoHeader_.bytes.size())
+        .begin(kMkvVideo)
+        .uint(kMkvPixelWidth, (uint64_t)std::max(config_.width, 1))
+        .uint(kMkvPixelHeight, (uint64_t)std::max(config_.height, 1))
+        .end()
+        .end();
+
+    double sampleRate = 0.0;
+    int channels = 0;
+    hasAudioTrack_ = audioHeader_.present && audioHeader_.format == RtmpPublisher::kFlvAudioAac &&
+                     parseAacConfig(audioHeader_.bytes, sampleRate, channels);
+    if (hasAudioTrack_) {
+        out.begin(kMkvTrackEntry)
+            .uint(kMkvTrackNumber, kAudioTrack)
+            .uint(kMkvTrackUid, kAudioTrack)
+            .uint(kMkvTrackType, kMkvTrackTypeAudio)
+            .uint(kMkvFlagLacing, 0)
+            .string(kMkvCodecId, "A_AAC")
+            .binary(kMkvCodecPrivate, audioHeader_.bytes.data(), audioHeader_.bytes.size())
+            .begin(kMkvAudio)
+            .floating(kMkvSamplingFrequency, sampleRate)
+            .uint(kMkvChannels, (uint64_t)channels)
+            .end()
+            .end();
+    } else if (audioHeader_.present) {
+        std::cerr << "RecordingSink: recording without audio (sound format "
+                  << (int)audioHeader_.format << " is not supported)." << std::endl;
+    }
+    out.end();
+
+    writer_.append(out.data().data(), out.size());
+    headerWritten_ = true;
+}
+
+bool RecordingSink::makeRoom(size_t bytes) {
+    size_t need = cluster_.size() + bytes;
+    if (need > config_.maxQueuedBytes) return false;
+    size_t maxQueued = config_.maxQueuedBytes - need;
+    if (writer_.queuedBytes() <= maxQueued) return true;
+    if (config_.dropPolicy != RecordingDropPolicy::Block) return false;
+
+    auto started = std::chrono::steady_clock::now();
+    bool room = writer_.waitForRoom(maxQueued, config_.maxBlockMs);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+    stats_.maxBlockedMs = std::max(stats_.maxBlockedMs, ms);
+    return room;
+}
+
+void RecordingSink::closeCluster() {
+    if (cluster_.empty()) return;
+    cluster_.end();
+    writer_.append(cluster_.data().data(), cluster_.size());
+    cluster_.clear();
+}
+
+void RecordingSink::finish() {
+    closeCluster();
+    if (!headerWritten_) return;
+
+    uint64_t cuesAt = writer_.size() - segmentStart_;
+    if (!cues_.empty()) {
+        EbmlWriter cues;
+        cues.begin(kMkvCues);
+        for (const auto& cue : cues_) {
+            cues.begin(kMkvCuePoint)
+                .uint(kMkvCueTime, (uint64_t)cue.first)
+                .begin(kMkvCueTrackPositions)
+                .uint(kMkvCueTrack, kVideoTrack)
+                .uint(kMkvCueClusterPosition, cue.second)
+                .end()
+                .end();
+        }
+        cues.end();
+        writer_.append(cues.data().data(), cues.size());
+    }
+    if (!writer_.flush()) return;
+
+    // Now that the sizes are known, fill in what was left open
+    uint64_t segmentSize = writer_.size() - segmentStart_;
+    uint8_t size[8] = {0x01};
+    for (int i = 1; i < 8; ++i) size[i] = (uint8_t)(segmentSize >> (8 * (7 - i)));
+    writer_.writeAt(segmentStart_ - sizeof(size), size, sizeof(size));
+
+    EbmlWriter duration;
+    duration.floating(kMkvDuration, (double)lastTimeMs_);
+    assert(duration.size() == kDurationSpace);
+    writer_.writeAt(durationAt_, duration.data().data(), duration.size());
+
+    EbmlWriter seekHead;
+    seekHead.begin(kMkvSeekHead);
+    std::pair<uint32_t, uint64_t> entries[] = {{kMkvInfo, infoAt_}, {kMkvTracks, tracksAt_}, {kMkvCues, cuesAt}};
+    for (const auto& entry : entries) {
+        if (entry.first == kMkvCues && cues_.empty()) continue;
+        seekHead.begin(kMkvSeek);
+        appendId(seekHead, kMkvSeekId, entry.first);
+        seekHead.uint(kMkvSeekPosition, entry.second).end();
+    }
+    seekHead.end();
+    seekHead.padding(kSeekHeadSpace - seekHead.size());
+    writer_.writeAt(seekHeadAt_, seekHead.data().data(), seekHead.size());
+}
@@ -0,0 +1,102 @@
+#ifndef RECORDING_SINK_H
+#define RECORDING_SINK_H
+
+#include "AsyncFileWriter.h"
+#include "Matroska.h"
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+enum class RecordingDropPolicy {
+    DropToKeyframe, // Never waits: what does not fit is dropped, video until the next keyframe
+    Block           // Waits up to maxBlockMs for the disk, then drops as DropToKeyframe
+};
+
+struct RecordingSinkConfig {
+    int width = 1280;                 // Written as the video track's pixel size
+    int height = 720;
+    size_t maxQueuedBytes = 32 * 1024 * 1024; // Muxed but not yet on disk
+    RecordingDropPolicy dropPolicy = RecordingDropPolicy::DropToKeyframe;
+    int maxBlockMs = 100;
+    size_t maxClusterBytes = 4 * 1024 * 1024; // A cluster also ends at each keyframe
+    AsyncFileWriterConfig writer;
+};
+
+struct RecordingSinkStats {
+    bool recording = false;
+    uint64_t packets = 0;          // Written
+    uint64_t droppedPackets = 0;   // For want of room, or waiting for a keyframe after that
+    uint64_t skippedPackets = 0;   // Before the first keyframe, or in a format Matroska is not given
+    uint64_t clusters = 0;
+    uint64_t fileBytes = 0;
+    double durationMs = 0.0;
+    double maxBlockedMs = 0.0;     // Longest wait for the disk under RecordingDropPolicy::Block
+    AsyncFileWriterStats writer;
+};
+
+// Records encoded A/V to a Matroska (.mkv) file without stalling the
+// caller on the disk. Packets are muxed into a cluster in memory (one per
+// GOP), and each finished cluster goes to an AsyncFileWriter. The file
+// starts at the first video keyframe after the video sequence header, with
+// the audio track if its header has arrived by then. Until stop() the
+// Segment has no size and there are no cues, so a recording cut short by a
+// crash still plays; stop() adds the cues, duration and seek index.
+//
+// Codec ids and sound formats are FLV's, as RtmpPublisher takes them:
+// AVC, HEVC and AAC, which Matroska carries as they are.
+class RecordingSink {
+public:
+    explicit RecordingSink(const RecordingSinkConfig& config = RecordingSinkConfig());
+    ~RecordingSink();
+
+    bool start(const std::string& path);
+    // Waits for the disk; true if the file was completed and every write succeeded
+    bool stop();
+    bool isRecording() const;
+
+    // False if the packet was not recorded
+    bool addVideo(uint32_t timestampMs, bool keyframe, const uint8_t* data, size_t size, uint8_t codecId = 7,
+                  bool sequenceHeader = false, int32_t compositionMs = 0);
+    bool addAudio(uint32_t timestampMs, const uint8_t* data, size_t size, uint8_t soundFormat = 10,
+                  bool sequenceHeader = false);
+
+    RecordingSinkStats getStats() const;
+
+private:
+    struct Header {
+        std::vector<uint8_t> bytes;
+        uint8_t format = 0;
+        bool present = false;
+    };
+
+    bool add(bool video, int64_t timeMs, bool keyframe, const uint8_t* data, size_t size);
+    void writeHeader();
+    bool makeRoom(size_t bytes);
+    void closeCluster();
+    void finish();
+
+    RecordingSinkConfig config_;
+    mutable std::mutex mutex_;
+    AsyncFileWriter writer_;
+    bool recording_;
+    bool headerWritten_;
+    bool hasAudioTrack_;
+    bool waitKeyframe_;
+    Header videoHeader_;
+    Header audioHeader_;
+    uint32_t baseMs_;              // First keyframe, time 0 in the file
+    uint64_t segmentStart_;        // File offset of the Segment's payload
+    uint64_t seekHeadAt_;          // Space left for the seek index
+    uint64_t durationAt_;          // Space left in Info for the duration
+    uint64_t infoAt_;
+    uint64_t tracksAt_;
+    EbmlWriter cluster_;
+    int64_t clusterTimeMs_;
+    std::vector<std::pair<int64_t, uint64_t>> cues_; // Keyframe time, cluster offset in the Segment
+    int64_t lastTimeMs_;
+    RecordingSinkStats stats_;
+};
+
+#endif // RECORDING_SINK_H
@@ -0,0 +1,339 @@
+#include "ReplayBuffer.h"
+#include "RtmpProtocol.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr size_t kNoSpace = SIZE_MAX;
+// Packets copied out per lock hold while writing a clip
+constexpr size_t kClipBatchBytes = 256 * 1024;
+constexpr size_t kFlvTagHeader = 11;
+
+void appendBigEndian(std::vector<uint8_t>& out, uint32_t value, int bytes) {
+    for (int i = bytes - 1; i >= 0; --i) out.push_back((uint8_t)(value >> (8 * i)));
+}
+
+void appendFlvTag(std::vector<uint8_t>& out, bool video, uint32_t timestampMs, const uint8_t* prefix,
+                  size_t prefixSize, const uint8_t* data, size_t size) {
+    uint32_t dataSize = (uint32_t)(prefixSize + size);
+    out.push_back(video ? 9 : 8);
+    appendBigEndian(out, dataSize, 3);
+    appendBigEndian(out, timestampMs & 0xFFFFFF, 3);
+    out.push_back((uint8_t)(timestampMs >> 24));
+    appendBigEndian(out, 0, 3); // Stream id
+    out.insert(out.end(), prefix, prefix + prefixSize);
+    out.insert(out.end(), data, data + size);
+    appendBigEndian(out, (uint32_t)kFlvTagHeader + dataSize, 4);
+}
+
+bool writeAll(int fd, const std::vector<uint8_t>& bytes) {
+    size_t done = 0;
+    while (done < bytes.size()) {
+        ssize_t n = ::write(fd, bytes.data() + done, bytes.size() - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        done += (size_t)n;
+    }
+    return true;
+}
+
+} // namespace
+
+ReplayBuffer::ReplayBuffer(const ReplayBufferConfig& config)
+    : config_(config)
+    , tail_(0)
+    , bytes_(0)
+    , head_(0)
+    , count_(0)
+    , firstSequence_(0)
+    , keyframeHead_(0)
+    , keyframeCount_(0)
+    , waitKeyframe_(true)
+    , writing_(false)
+    , stopping_(false) {
+    config_.maxPackets = std::max<size_t>(config_.maxPackets, 2);
+    ring_.reset(new uint8_t[config_.maxBytes]);
+    entries_.resize(config_.maxPackets);
+    keyframes_.resize(config_.maxPackets);
+}
+
+ReplayBuffer::~ReplayBuffer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    jobReady_.notify_all();
+    if (writer_.joinable()) writer_.join();
+}
+
+void ReplayBuffer::addVideo(uint32_t timestampMs, bool keyframe, const uint8_t* data, size_t size, uint8_t codecId,
+                            bool sequenceHeader, int32_t compositionMs) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (sequenceHeader) {
+        videoHeader_.bytes.assign(data, data + size);
+        videoHeader_.format = codecId;
+        videoHeader_.present = true;
+        return;
+    }
+    Entry entry;
+    entry.size = (uint32_t)size;
+    entry.timestampMs = timestampMs;
+    entry.compositionMs = compositionMs;
+    entry.format = codecId;
+    entry.video = true;
+    entry.keyframe = keyframe;
+    add(entry, data);
+}
+
+void ReplayBuffer::addAudio(uint32_t timestampMs, const uint8_t* data, size_t size, uint8_t soundFormat,
+                            bool sequenceHeader) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (sequenceHeader) {
+        audioHeader_.bytes.assign(data, data + size);
+        audioHeader_.format = soundFormat;
+        audioHeader_.present = true;
+        return;
+    }
+    Entry entry;
+    entry.size = (uint32_t)size;
+    entry.timestampMs = timestampMs;
+    entry.format = soundFormat;
+    add(entry, data);
+}
+
+void ReplayBuffer::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    reset();
+    waitKeyframe_ = true;
+    videoHeader_.present = false;
+    audioHeader_.present = false;
+}
+
+void ReplayBuffer::add(const Entry& entry, const uint8_t* data) {
+    bool keyframe = entry.video && entry.keyframe;
+    if (entry.size == 0) return;
+    if ((waitKeyframe_ && !keyframe) || entry.size >= config_.maxBytes) {
+        stats_.skippedPackets++;
+        return;
+    }
+
+    size_t offset;
+    for (;;) {
+        offset = count_ < config_.maxPackets ? findSpace(entry.size) : kNoSpace;
+        if (offset != kNoSpace) break;
+        if (keyframeCount_ >= 2) {
+            evictOldestGop();
+            continue;
+        }
+        // The current GOP alone outgrew the ring; it cannot be kept whole
+        reset();
+        if (!keyframe) {
+            waitKeyframe_ = true;
+            stats_.skippedPackets++;
+            return;
+        }
+    }
+
+    std::memcpy(ring_.get() + offset, data, entry.size);
+    tail_ = offset + entry.size;
+    Entry& stored = entries_[(head_ + count_) % config_.maxPackets];
+    stored = entry;
+    stored.offset = offset;
+    count_++;
+    bytes_ += entry.size;
+    if (keyframe) {
+        keyframes_[(keyframeHead_ + keyframeCount_) % config_.maxPackets] = firstSequence_ + count_ - 1;
+        keyframeCount_++;
+    }
+    waitKeyframe_ = false;
+
+    // Drop the oldest GOP once the ones after it still cover the duration
+    while (keyframeCount_ >= 2 &&
+           (uint32_t)(entry.timestampMs - entryAt(keyframeAt(1)).timestampMs) >= config_.durationMs) {
+        evictOldestGop();
+    }
+}
+
+size_t ReplayBuffer::findSpace(size_t size) const {
+    if (count_ == 0) return 0;
+    size_t start = entries_[head_].offset;
+    if (tail_ > start) {
+        if (config_.maxBytes - tail_ >= size) return tail_;
+        // Wrap; strictly less, so the tail never catches up with the head
+        if (start > size) return 0;
+        return kNoSpace;
+    }
+    return start - tail_ > size ? tail_ : kNoSpace;
+}
+
+void ReplayBuffer::evictOldestGop() {
+    uint64_t next = keyframeAt(1);
+    while (firstSequence_ < next) {
+        bytes_ -= entries_[head_].size;
+        head_ = (head_ + 1) % config_.maxPackets;
+        count_--;
+        firstSequence_++;
+    }
+    keyframeHead_ = (keyframeHead_ + 1) % config_.maxPackets;
+    keyframeCount_--;
+    stats_.evictedGops++;
+}
+
+void ReplayBuffer::reset() {
+    stats_.evictedGops += keyframeCount_;
+    firstSequence_ += count_;
+    head_ = count_ = 0;
+    keyframeHead_ = keyframeCount_ = 0;
+    tail_ = bytes_ = 0;
+}
+
+const ReplayBuffer::Entry& ReplayBuffer::entryAt(uint64_t sequence) const {
+    return entries_[(head_ + (sequence - firstSequence_)) % config_.maxPackets];
+}
+
+uint64_t ReplayBuffer::keyframeAt(size_t index) const {
+    return keyframes_[(keyframeHead_ + index) % config_.maxPackets];
+}
+
+bool ReplayBuffer::saveClip(const std::string& path, double lastMs, std::function<void(const ReplayClip&)> done) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (keyframeCount_ == 0 || stopping_) return false;
+
+    // The newest keyframe at least lastMs back, else the oldest kept
+    uint32_t newest = entryAt(firstSequence_ + count_ - 1).timestampMs;
+    size_t start = 0;
+    if (lastMs > 0.0) {
+        for (size_t i = keyframeCount_; i-- > 0;) {
+            if ((uint32_t)(newest - entryAt(keyframeAt(i)).timestampMs) >= lastMs) {
+                start = i;
+                break;
+            }
+        }
+    }
+    ClipJob job;
+    job.path = path;
+    job.first = keyframeAt(start);
+    job.end = firstSequence_ + count_;
+    job.video = videoHeader_;
+    job.audio = audioHeader_;
+    job.done = std::move(done);
+    jobs_.push_back(std::move(job));
+    if (!writer_.joinable()) writer_ = std::thread(&ReplayBuffer::writerLoop, this);
+    jobReady_.notify_one();
+    return true;
+}
+
+void ReplayBuffer::flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    jobsDone_.wait(lock, [this]() { return jobs_.empty() && !writing_; });
+}
+
+ReplayBufferStats ReplayBuffer::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ReplayBufferStats stats = stats_;
+    stats.packets = count_;
+    stats.bytes = bytes_;
+    if (count_ > 0) {
+        stats.windowMs = (uint32_t)(entryAt(firstSequence_ + count_ - 1).timestampMs - entries_[head_].timestampMs);
+    }
+    return stats;
+}
+
+void ReplayBuffer::writerLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        jobReady_.wait(lock, [this]() { return stopping_ || !jobs_.empty(); });
+        if (jobs_.empty()) break;
+        ClipJob job = std::move(jobs_.front());
+        jobs_.pop_front();
+        writing_ = true;
+        lock.unlock();
+
+        ReplayClip clip = writeClip(job);
+        if (job.done) job.done(clip);
+
+        lock.lock();
+        (clip.ok ? stats_.clipsWritten : stats_.clipsFailed)++;
+        writing_ = false;
+        jobsDone_.notify_all();
+    }
+}
+
+ReplayClip ReplayBuffer::writeClip(const ClipJob& job) {
+    ReplayClip clip;
+    clip.path = job.path;
+    // Written aside and renamed, so a clip on disk is always whole
+    std::string partial = job.path + ".part";
+    int fd = ::open(partial.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        std::cerr << "ReplayBuffer: cannot create " << partial << ": " << std::strerror(errno) << std::endl;
+        return clip;
+    }
+
+    std::vector<uint8_t> batch;
+    batch.reserve(kClipBatchBytes + 64 * 1024);
+    const uint8_t fileHeader[] = {'F', 'L', 'V', 1, 0x05, 0, 0, 0, 9, 0, 0, 0, 0}; // Audio and video
+    batch.insert(batch.end(), fileHeader, fileHeader + sizeof(fileHeader));
+    uint8_t prefix[kFlvMaxPrefix];
+    if (job.video.present) {
+        size_t prefixSize = writeFlvVideoPrefix(prefix, true, job.video.format, true, 0);
+        appendFlvTag(batch, true, 0, prefix, prefixSize, job.video.bytes.data(), job.video.bytes.size());
+    }
+    if (job.audio.present) {
+        size_t prefixSize = writeFlvAudioPrefix(prefix, job.audio.format, true);
+        appendFlvTag(batch, false, 0, prefix, prefixSize, job.audio.bytes.data(), job.audio.bytes.size());
+    }
+
+    bool ok = true;
+    uint32_t base = 0;
+    int32_t last = 0;
+    for (uint64_t sequence = job.first; ok && sequence < job.end;) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            // Only if writing fell a whole window behind the live stream
+            if (sequence < firstSequence_) {
+                std::cerr << "ReplayBuffer: " << job.path << " was overwritten before it was saved" << std::endl;
+                ok = false;
+                break;
+            }
+            if (sequence == job.first) base = entryAt(sequence).timestampMs;
+            for (; sequence < job.end && batch.size() < kClipBatchBytes; ++sequence) {
+                const Entry& entry = entryAt(sequence);
+                // Audio stamped just before the first keyframe starts at zero too
+                int32_t relative = std::max<int32_t>(0, (int32_t)(entry.timestampMs - base));
+                size_t prefixSize = entry.video
+                    ? writeFlvVideoPrefix(prefix, entry.keyframe, entry.format, false, entry.compositionMs)
+                    : writeFlvAudioPrefix(prefix, entry.format, false);
+                appendFlvTag(batch, entry.video, (uint32_t)relative, prefix, prefixSize, ring_.get() + entry.offset,
+                             entry.size);
+                last = std::max(last, relative);
+                clip.packets++;
+            }
+        }
+        ok = writeAll(fd, batch);
+        clip.fileBytes += batch.size();
+        batch.clear();
+    }
+    if (ok && !batch.empty()) {
+        ok = writeAll(fd, batch); // Headers only
+        clip.fileBytes += batch.size();
+    }
+    ok = ::close(fd) == 0 && ok;
+    if (ok && std::rename(partial.c_str(), job.path.c_str()) != 0) {
+        std::cerr << "ReplayBuffer: cannot rename to " << job.path << ": " << std::strerror(errno) << std::endl;
+        ok = false;
+    }
+    if (!ok) {
+        ::unlink(partial.c_str());
+        return clip;
+    }
+    clip.ok = true;
+    clip.durationMs = last;
+    return clip;
+}
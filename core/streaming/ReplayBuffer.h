@@ -0,0 +1,129 @@
+#ifndef REPLAY_BUFFER_H
+#define REPLAY_BUFFER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct ReplayBufferConfig {
+    double durationMs = 30000.0; // Kept at least this long, rounded out to whole GOPs
+    size_t maxBytes = 64 * 1024 * 1024; // Payload ring, allocated up front
+    size_t maxPackets = 16384;          // Index ring, allocated up front
+};
+
+struct ReplayBufferStats {
+    size_t packets = 0;
+    size_t bytes = 0;
+    double windowMs = 0.0;          // First keyframe to newest packet
+    uint64_t evictedGops = 0;
+    uint64_t skippedPackets = 0;    // Before the first keyframe, or in a GOP too big for the ring
+    uint64_t clipsWritten = 0;
+    uint64_t clipsFailed = 0;
+};
+
+struct ReplayClip {
+    std::string path;
+    bool ok = false;
+    size_t packets = 0;
+    size_t fileBytes = 0;
+    double durationMs = 0.0;
+};
+
+// "Save the last N seconds": encoded audio and video copied into a fixed
+// byte ring with a fixed index beside it, so memory stays flat however
+// long the session runs. Space is reclaimed a whole GOP at a time, so the
+// window always starts on a keyframe. Clips are written as FLV by one
+// background thread that copies packets out in short batches under the
+// lock, so add*() never waits for the disk.
+class ReplayBuffer {
+public:
+    explicit ReplayBuffer(const ReplayBufferConfig& config = ReplayBufferConfig());
+    // Finishes the clips already requested
+    ~ReplayBuffer();
+
+    // Codec ids and sound formats are FLV's, as RtmpPublisher takes them.
+    // Sequence headers are kept aside and lead every clip.
+    void addVideo(uint32_t timestampMs, bool keyframe, const uint8_t* data, size_t size, uint8_t codecId = 7,
+                  bool sequenceHeader = false, int32_t compositionMs = 0);
+    void addAudio(uint32_t timestampMs, const uint8_t* data, size_t size, uint8_t soundFormat = 10,
+                  bool sequenceHeader = false);
+    void clear();
+
+    // Queues the last lastMs of media (0: everything kept), from the keyframe
+    // at or before that point, to be written to path. done runs on the
+    // writer thread. False if there is nothing to save.
+    bool saveClip(const std::string& path, double lastMs = 0.0,
+                  std::function<void(const ReplayClip&)> done = nullptr);
+    // Waits until every requested clip is written
+    void flush();
+
+    ReplayBufferStats getStats() const;
+
+private:
+    struct Entry {
+        size_t offset = 0;
+        uint32_t size = 0;
+        uint32_t timestampMs = 0;
+        int32_t compositionMs = 0;
+        uint8_t format = 0;
+        bool video = false;
+        bool keyframe = false;
+    };
+    struct Header {
+        std::vector<uint8_t> bytes;
+        uint8_t format = 0;
+        bool present = false;
+    };
+    struct ClipJob {
+        std::string path;
+        uint64_t first; // Packet sequence numbers
+        uint64_t end;
+        Header video;
+        Header audio;
+        std::function<void(const ReplayClip&)> done;
+    };
+
+    void add(const Entry& entry, const uint8_t* data);
+    // Start of a free run of size bytes, or SIZE_MAX
+    size_t findSpace(size_t size) const;
+    void evictOldestGop();
+    void reset();
+    const Entry& entryAt(uint64_t sequence) const;
+    uint64_t keyframeAt(size_t index) const; // index 0 is the oldest
+    void writerLoop();
+    ReplayClip writeClip(const ClipJob& job);
+
+    ReplayBufferConfig config_;
+
+    mutable std::mutex mutex_;
+    std::unique_ptr<uint8_t[]> ring_;
+    size_t tail_;                  // Next write offset
+    size_t bytes_;
+    std::vector<Entry> entries_;   // Ring of config_.maxPackets
+    size_t head_;
+    size_t count_;
+    uint64_t firstSequence_;       // Of entries_[head_]
+    std::vector<uint64_t> keyframes_; // Ring of sequence numbers, oldest at keyframeHead_
+    size_t keyframeHead_;
+    size_t keyframeCount_;
+    bool waitKeyframe_;
+    Header videoHeader_;
+    Header audioHeader_;
+    ReplayBufferStats stats_;
+
+    // Writer thread, started with the first clip
+    std::thread writer_;
+    std::condition_variable jobReady_;
+    std::condition_variable jobsDone_;
+    std::deque<ClipJob> jobs_;
+    bool writing_;
+    bool stopping_;
+};
+
+#endif // REPLAY_BUFFER_H
@@ -0,0 +1,356 @@
+#include "RtmpProtocol.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+constexpr uint8_t kAmfNumber = 0x00;
+constexpr uint8_t kAmfBoolean = 0x01;
+constexpr uint8_t kAmfString = 0x02;
+constexpr uint8_t kAmfObject = 0x03;
+constexpr uint8_t kAmfNull = 0x05;
+constexpr uint8_t kAmfUndefined = 0x06;
+constexpr uint8_t kAmfEcmaArray = 0x08;
+constexpr uint8_t kAmfObjectEnd = 0x09;
+constexpr uint8_t kAmfLongString = 0x0C;
+
+constexpr int kMaxAmfDepth = 16;
+constexpr uint32_t kMaxMessageLength = 16 * 1024 * 1024;
+
+uint32_t readBe16(const uint8_t* p) { return (uint32_t)p[0] << 8 | p[1]; }
+uint32_t readBe24(const uint8_t* p) { return (uint32_t)p[0] << 16 | (uint32_t)p[1] << 8 | p[2]; }
+uint32_t readBe32(const uint8_t* p) { return (uint32_t)p[0] << 24 | readBe24(p + 1); }
+uint32_t readLe32(const uint8_t* p) { return p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24; }
+
+void writeBe24(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 16);
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)v;
+}
+
+void writeBe32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    writeBe24(p + 1, v);
+}
+
+size_t writeBasicHeader(uint8_t* out, int fmt, uint32_t chunkStreamId) {
+    if (chunkStreamId < 64) {
+        out[0] = (uint8_t)(fmt << 6 | chunkStreamId);
+        return 1;
+    }
+    if (chunkStreamId < 320) {
+        out[0] = (uint8_t)(fmt << 6);
+        out[1] = (uint8_t)(chunkStreamId - 64);
+        return 2;
+    }
+    out[0] = (uint8_t)(fmt << 6 | 1);
+    out[1] = (uint8_t)((chunkStreamId - 64) & 0xFF);
+    out[2] = (uint8_t)((chunkStreamId - 64) >> 8);
+    return 3;
+}
+
+bool readString(const uint8_t*& p, const uint8_t* end, size_t lengthBytes, std::string& out) {
+    if ((size_t)(end - p) < lengthBytes) return false;
+    size_t length = lengthBytes == 2 ? readBe16(p) : readBe32(p);
+    p += lengthBytes;
+    if ((size_t)(end - p) < length) return false;
+    out.assign(reinterpret_cast<const char*>(p), length);
+    p += length;
+    return true;
+}
+
+bool readValue(const uint8_t*& p, const uint8_t* end, AmfValue& value, int depth);
+
+bool readProperties(const uint8_t*& p, const uint8_t* end, AmfValue& value, int depth) {
+    value.type = AmfValue::Type::Object;
+    for (;;) {
+        std::string name;
+        if (!readString(p, end, 2, name)) return false;
+        if (name.empty() && p < end && *p == kAmfObjectEnd) {
+            ++p;
+            return true;
+        }
+        AmfValue property;
+        if (!readValue(p, end, property, depth + 1)) return false;
+        value.properties.emplace_back(std::move(name), std::move(property));
+    }
+}
+
+bool readValue(const uint8_t*& p, const uint8_t* end, AmfValue& value, int depth) {
+    if (p >= end || depth > kMaxAmfDepth) return false;
+    uint8_t marker = *p++;
+    switch (marker) {
+        case kAmfNumber: {
+            if (end - p < 8) return false;
+            uint64_t bits = 0;
+            for (int i = 0; i < 8; ++i) bits = bits << 8 | p[i];
+            std::memcpy(&value.number, &bits, sizeof(bits));
+            value.type = AmfValue::Type::Number;
+            p += 8;
+            return true;
+        }
+        case kAmfBoolean:
+            if (p >= end) return false;
+            value.type = AmfValue::Type::Boolean;
+            value.boolean = *p++ != 0;
+            return true;
+        case kAmfString:
+        case kAmfLongString:
+            value.type = AmfValue::Type::String;
+            return readString(p, end, marker == kAmfString ? 2 : 4, value.string);
+        case kAmfObject:
+            return readProperties(p, end, value, depth);
+        case kAmfEcmaArray:
+            if (end - p < 4) return false;
+            p += 4; // The count is advisory; the end marker terminates
+            return readProperties(p, end, value, depth);
+        case kAmfNull:
+            value.type = AmfValue::Type::Null;
+            return true;
+        case kAmfUndefined:
+            value.type = AmfValue::Type::Undefined;
+            return true;
+        default:
+            return false;
+    }
+}
+
+} // namespace
+
+const AmfValue* AmfValue::find(const std::string& key) const {
+    for (const auto& property : properties) {
+        if (property.first == key) return &property.second;
+    }
+    return nullptr;
+}
+
+Amf0Writer& Amf0Writer::number(double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    data_.push_back(kAmfNumber);
+    for (int i = 7; i >= 0; --i) data_.push_back((uint8_t)(bits >> (8 * i)));
+    return *this;
+}
+
+Amf0Writer& Amf0Writer::boolean(bool value) {
+    data_.push_back(kAmfBoolean);
+    data_.push_back(value ? 1 : 0);
+    return *this;
+}
+
+Amf0Writer& Amf0Writer::string(const std::string& value) {
+    if (value.size() > 0xFFFF) {
+        data_.push_back(kAmfLongString);
+        uint8_t length[4];
+        writeBe32(length, (uint32_t)value.size());
+        data_.insert(data_.end(), length, length + 4);
+    } else {
+        data_.push_back(kAmfString);
+        data_.push_back((uint8_t)(value.size() >> 8));
+        data_.push_back((uint8_t)value.size());
+    }
+    data_.insert(data_.end(), value.begin(), value.end());
+    return *this;
+}
+
+Amf0Writer& Amf0Writer::null() {
+    data_.push_back(kAmfNull);
+    return *this;
+}
+
+Amf0Writer& Amf0Writer::beginObject() {
+    data_.push_back(kAmfObject);
+    return *this;
+}
+
+Amf0Writer& Amf0Writer::beginEcmaArray(uint32_t count) {
+    data_.push_back(kAmfEcmaArray);
+    uint8_t bytes[4];
+    writeBe32(bytes, count);
+    data_.insert(data_.end(), bytes, bytes + 4);
+    return *this;
+}
+
+Amf0Writer& Amf0Writer::key(const std::string& name) {
+    putName(name);
+    return *this;
+}
+
+Amf0Writer& Amf0Writer::endObject() {
+    putName("");
+    data_.push_back(kAmfObjectEnd);
+    return *this;
+}
+
+void Amf0Writer::putName(const std::string& name) {
+    size_t length = std::min<size_t>(name.size(), 0xFFFF);
+    data_.push_back((uint8_t)(length >> 8));
+    data_.push_back((uint8_t)length);
+    data_.insert(data_.end(), name.begin(), name.begin() + length);
+}
+
+bool decodeAmf0(const uint8_t* data, size_t size, std::vector<AmfValue>& values) {
+    const uint8_t* p = data;
+    const uint8_t* end = data + size;
+    while (p < end) {
+        AmfValue value;
+        if (!readValue(p, end, value, 0)) return false;
+        values.push_back(std::move(value));
+    }
+    return true;
+}
+
+size_t writeRtmpChunkHeader(uint8_t* out, uint32_t chunkStreamId, uint32_t timestamp, uint32_t length,
+                            uint8_t typeId, uint32_t streamId) {
+    size_t n = writeBasicHeader(out, 0, chunkStreamId);
+    bool extended = timestamp >= 0xFFFFFF;
+    writeBe24(out + n, extended ? 0xFFFFFF : timestamp);
+    writeBe24(out + n + 3, length);
+    out[n + 6] = typeId;
+    // The message stream id is the one little-endian field
+    out[n + 7] = (uint8_t)streamId;
+    out[n + 8] = (uint8_t)(streamId >> 8);
+    out[n + 9] = (uint8_t)(streamId >> 16);
+    out[n + 10] = (uint8_t)(streamId >> 24);
+    n += 11;
+    if (extended) {
+        writeBe32(out + n, timestamp);
+        n += 4;
+    }
+    return n;
+}
+
+size_t writeRtmpContinuationHeader(uint8_t* out, uint32_t chunkStreamId, uint32_t timestamp) {
+    size_t n = writeBasicHeader(out, 3, chunkStreamId);
+    if (timestamp >= 0xFFFFFF) {
+        writeBe32(out + n, timestamp);
+        n += 4;
+    }
+    return n;
+}
+
+void appendRtmpMessage(std::vector<uint8_t>& out, const RtmpMessage& message, uint32_t chunkSize) {
+    uint8_t header[kRtmpMaxChunkHeader];
+    size_t length = message.payload.size();
+    size_t n = writeRtmpChunkHeader(header, message.chunkStreamId, message.timestamp, (uint32_t)length,
+                                    message.typeId, message.streamId);
+    size_t offset = 0;
+    do {
+        out.insert(out.end(), header, header + n);
+        size_t take = std::min<size_t>(chunkSize, length - offset);
+        out.insert(out.end(), message.payload.begin() + offset, message.payload.begin() + offset + take);
+        offset += take;
+        n = writeRtmpContinuationHeader(header, message.chunkStreamId, message.timestamp);
+    } while (offset < length);
+}
+
+size_t writeFlvVideoPrefix(uint8_t* out, bool keyframe, uint8_t codecId, bool sequenceHeader, int32_t compositionMs) {
+    out[0] = (uint8_t)((keyframe ? 1 : 2) << 4 | (codecId & 0x0F));
+    if (codecId != 7 && codecId != 12) return 1; // AVC, HEVC
+    out[1] = sequenceHeader ? 0 : 1;
+    out[2] = (uint8_t)(compositionMs >> 16);
+    out[3] = (uint8_t)(compositionMs >> 8);
+    out[4] = (uint8_t)compositionMs;
+    return 5;
+}
+
+size_t writeFlvAudioPrefix(uint8_t* out, uint8_t soundFormat, bool sequenceHeader) {
+    // FLV requires AAC to be flagged 44 kHz, 16-bit stereo whatever it carries
+    out[0] = (uint8_t)(soundFormat << 4 | 3 << 2 | 1 << 1 | 1);
+    if (soundFormat != 10) return 1; // AAC
+    out[1] = sequenceHeader ? 0 : 1;
+    return 2;
+}
+
+bool RtmpChunkReader::feed(const uint8_t* data, size_t size, std::vector<RtmpMessage>& messages) {
+    if (failed_) return false;
+    pending_.insert(pending_.end(), data, data + size);
+
+    static const size_t kMessageHeaderSize[4] = {11, 7, 3, 0};
+    size_t pos = 0;
+    for (;;) {
+        const uint8_t* p = pending_.data() + pos;
+        size_t available = pending_.size() - pos;
+        if (available < 1) break;
+
+        int fmt = p[0] >> 6;
+        uint32_t chunkStreamId = p[0] & 0x3F;
+        size_t headerSize = 1;
+        if (chunkStreamId == 0) {
+            if (available < 2) break;
+            chunkStreamId = 64 + p[1];
+            headerSize = 2;
+        } else if (chunkStreamId == 1) {
+            if (available < 3) break;
+            chunkStreamId = 64 + p[1] + ((uint32_t)p[2] << 8);
+            headerSize = 3;
+        }
+        if (available < headerSize + kMessageHeaderSize[fmt]) break;
+
+        ChunkStream& stream = streams_[chunkStreamId];
+        bool midMessage = !stream.payload.empty();
+        if ((fmt != 0 && !stream.started) || (midMessage && fmt < 2)) {
+            failed_ = true;
+            return false;
+        }
+
+        const uint8_t* header = p + headerSize;
+        uint32_t field = fmt <= 2 ? readBe24(header) : 0;
+        uint32_t length = fmt <= 1 ? readBe24(header + 3) : stream.length;
+        bool extended = fmt <= 2 ? field == 0xFFFFFF : stream.extended;
+        headerSize += kMessageHeaderSize[fmt];
+        if (extended) {
+            if (available < headerSize + 4) break;
+            if (fmt <= 2) field = readBe32(p + headerSize);
+            headerSize += 4;
+        }
+        if (length > kMaxMessageLength) {
+            failed_ = true;
+            return false;
+        }
+        size_t take = std::min<size_t>(chunkSize_, length - (midMessage ? stream.payload.size() : 0));
+        if (available < headerSize + take) break;
+
+        // The whole chunk is here: commit the header
+        if (fmt <= 1) {
+            stream.length = length;
+            stream.typeId = header[6];
+        }
+        if (fmt == 0) stream.streamId = readLe32(header + 7);
+        stream.extended = extended;
+        if (!midMessage) {
+            if (fmt == 0) {
+                stream.timestamp = field;
+                stream.delta = 0;
+            } else {
+                if (fmt <= 2) stream.delta = field;
+                stream.timestamp += stream.delta;
+            }
+            stream.payload.reserve(stream.length);
+        }
+        stream.started = true;
+        stream.payload.insert(stream.payload.end(), p + headerSize, p + headerSize + take);
+        pos += headerSize + take;
+
+        if (stream.payload.size() == stream.length) {
+            RtmpMessage message;
+            message.chunkStreamId = chunkStreamId;
+            message.timestamp = stream.timestamp;
+            message.typeId = stream.typeId;
+            message.streamId = stream.streamId;
+            message.payload = std::move(stream.payload);
+            stream.payload.clear();
+            if (message.typeId == (uint8_t)RtmpMessageType::SetChunkSize && message.payload.size() >= 4) {
+                uint32_t chunkSize = readBe32(message.payload.data()) & 0x7FFFFFFF;
+                if (chunkSize == 0 || chunkSize > kMaxMessageLength) {
+                    failed_ = true;
+                    return false;
+                }
+                chunkSize_ = chunkSize;
+            }
+            messages.push_back(std::move(message));
+        }
+    }
+    pending_.erase(pending_.begin(), pending_.begin() + pos);
+    return true;
+}
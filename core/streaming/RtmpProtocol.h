@@ -0,0 +1,121 @@
+#ifndef RTMP_PROTOCOL_H
+#define RTMP_PROTOCOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Wire-level RTMP pieces shared by the publisher and anything that reads
+// its output: AMF0 values, chunk headers and a chunk stream reassembler.
+
+enum class RtmpMessageType : uint8_t {
+    SetChunkSize = 1,
+    Abort = 2,
+    Acknowledgement = 3,
+    UserControl = 4,
+    WindowAckSize = 5,
+    SetPeerBandwidth = 6,
+    Audio = 8,
+    Video = 9,
+    DataAmf0 = 18,
+    CommandAmf0 = 20
+};
+
+struct RtmpMessage {
+    uint32_t chunkStreamId = 0;
+    uint32_t timestamp = 0;  // Milliseconds
+    uint8_t typeId = 0;
+    uint32_t streamId = 0;
+    std::vector<uint8_t> payload;
+};
+
+constexpr size_t kRtmpHandshakeSize = 1536;
+constexpr uint32_t kRtmpDefaultChunkSize = 128;
+// Basic header (3) + type-0 message header (11) + extended timestamp (4)
+constexpr size_t kRtmpMaxChunkHeader = 18;
+
+struct AmfValue {
+    enum class Type { Number, Boolean, String, Object, Null, Undefined };
+
+    Type type = Type::Undefined;
+    double number = 0.0;
+    bool boolean = false;
+    std::string string;
+    std::vector<std::pair<std::string, AmfValue>> properties; // Objects and ECMA arrays
+
+    const AmfValue* find(const std::string& key) const;
+};
+
+class Amf0Writer {
+public:
+    Amf0Writer& number(double value);
+    Amf0Writer& boolean(bool value);
+    Amf0Writer& string(const std::string& value);
+    Amf0Writer& null();
+    Amf0Writer& beginObject();
+    Amf0Writer& beginEcmaArray(uint32_t count);
+    // Property name inside an object or ECMA array; the value follows
+    Amf0Writer& key(const std::string& name);
+    // Ends objects and ECMA arrays alike
+    Amf0Writer& endObject();
+
+    const std::vector<uint8_t>& data() const { return data_; }
+    std::vector<uint8_t> take() { return std::move(data_); }
+
+private:
+    void putName(const std::string& name);
+
+    std::vector<uint8_t> data_;
+};
+
+// Decodes a sequence of top-level AMF0 values. False on malformed or
+// unsupported input.
+bool decodeAmf0(const uint8_t* data, size_t size, std::vector<AmfValue>& values);
+
+// Writes a type-0 chunk header and returns its length (at most kRtmpMaxChunkHeader)
+size_t writeRtmpChunkHeader(uint8_t* out, uint32_t chunkStreamId, uint32_t timestamp, uint32_t length,
+                            uint8_t typeId, uint32_t streamId);
+// Type-3 header for the following chunks of the same message
+size_t writeRtmpContinuationHeader(uint8_t* out, uint32_t chunkStreamId, uint32_t timestamp);
+
+// Chunks a whole message into `out` by copying; meant for small control
+// and command messages.
+void appendRtmpMessage(std::vector<uint8_t>& out, const RtmpMessage& message, uint32_t chunkSize);
+
+// FLV tag body prefixes, as RTMP media messages and .flv files carry them.
+// AVC/HEVC video gets the packet type and composition time (5 bytes), AAC
+// audio the packet type (2 bytes); other codecs just the flags byte.
+size_t writeFlvVideoPrefix(uint8_t* out, bool keyframe, uint8_t codecId, bool sequenceHeader, int32_t compositionMs);
+size_t writeFlvAudioPrefix(uint8_t* out, uint8_t soundFormat, bool sequenceHeader);
+constexpr size_t kFlvMaxPrefix = 5;
+
+// Reassembles messages from an incoming chunk stream, following Set Chunk
+// Size messages as they arrive.
+class RtmpChunkReader {
+public:
+    // Appends every message completed by `data`. False once the stream is malformed.
+    bool feed(const uint8_t* data, size_t size, std::vector<RtmpMessage>& messages);
+    uint32_t chunkSize() const { return chunkSize_; }
+
+private:
+    struct ChunkStream {
+        uint32_t timestamp = 0;
+        uint32_t delta = 0;
+        uint32_t length = 0;
+        uint8_t typeId = 0;
+        uint32_t streamId = 0;
+        bool extended = false;
+        bool started = false;
+        std::vector<uint8_t> payload;
+    };
+
+    std::vector<uint8_t> pending_;
+    std::map<uint32_t, ChunkStream> streams_;
+    uint32_t chunkSize_ = kRtmpDefaultChunkSize;
+    bool failed_ = false;
+};
+
+#endif // RTMP_PROTOCOL_H
@@ -0,0 +1,703 @@
+#include "RtmpPublisher.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <fcntl.h>
+#include <netdb.h>
+#include <linux/sockios.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+
+namespace {
+
+constexpr uint32_t kChunkStreamControl = 2;
+constexpr uint32_t kChunkStreamCommand = 3;
+constexpr uint32_t kChunkStreamAudio = 4;
+constexpr uint32_t kChunkStreamData = 5;
+constexpr uint32_t kChunkStreamVideo = 6;
+
+constexpr double kConnectTransaction = 1;
+constexpr double kCreateStreamTransaction = 2;
+
+// One sendmsg() covers at most this many header/payload slices
+constexpr size_t kMaxGather = 256;
+
+std::vector<uint8_t> be32Payload(uint32_t value) {
+    return {(uint8_t)(value >> 24), (uint8_t)(value >> 16), (uint8_t)(value >> 8), (uint8_t)value};
+}
+
+double msSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+RtmpPublisher::RtmpPublisher(const RtmpPublisherConfig& config)
+    : config_(config)
+    , state_(State::Idle)
+    , stopRequested_(false)
+    , socket_(-1)
+    , epoll_(-1)
+    , wakeFd_(-1)
+    , writeInterest_(false)
+    , nextAddress_(0)
+    , handshakeDone_(false)
+    , bytesReceived_(0)
+    , lastAcknowledged_(0)
+    , windowAckSize_(0)
+    , streamId_(0)
+    , waitKeyframe_(false)
+    , queuedBytes_(0)
+    , totalLatencyMs_(0.0)
+    , latencySamples_(0) {
+    config_.chunkSize = std::min<uint32_t>(std::max<uint32_t>(config_.chunkSize, 128), 65536);
+}
+
+RtmpPublisher::~RtmpPublisher() {
+    stop();
+}
+
+bool RtmpPublisher::parseUrl(const std::string& url, RtmpUrl& out) {
+    const std::string scheme = "rtmp://";
+    if (url.compare(0, scheme.size(), scheme) != 0) return false;
+    std::string rest = url.substr(scheme.size());
+    size_t slash = rest.find('/');
+    if (slash == std::string::npos || slash == 0) return false;
+    std::string hostPort = rest.substr(0, slash);
+    std::string path = rest.substr(slash + 1);
+
+    RtmpUrl parsed;
+    size_t colon = hostPort.rfind(':');
+    if (colon != std::string::npos) {
+        std::string port = hostPort.substr(colon + 1);
+        if (port.empty() || port.size() > 5 || port.find_first_not_of("0123456789") != std::string::npos) return false;
+        parsed.port = std::stoi(port);
+        if (parsed.port <= 0 || parsed.port > 65535) return false;
+        parsed.host = hostPort.substr(0, colon);
+    } else {
+        parsed.host = hostPort;
+    }
+
+    size_t last = path.rfind('/');
+    if (parsed.host.empty() || last == std::string::npos || last == 0 || last + 1 == path.size()) return false;
+    parsed.app = path.substr(0, last);
+    parsed.streamKey = path.substr(last + 1);
+    parsed.tcUrl = scheme + hostPort + "/" + parsed.app;
+    out = parsed;
+    return true;
+}
+
+bool RtmpPublisher::start(const std::string& url) {
+    if (thread_.joinable()) {
+        std::cerr << "RtmpPublisher: already started" << std::endl;
+        return false;
+    }
+    if (!parseUrl(url, url_)) {
+        std::cerr << "RtmpPublisher: invalid URL " << url << std::endl;
+        state_ = State::Error;
+        return false;
+    }
+
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* addresses = nullptr;
+    if (getaddrinfo(url_.host.c_str(), std::to_string(url_.port).c_str(), &hints, &addresses) != 0 || !addresses) {
+        std::cerr << "RtmpPublisher: cannot resolve " << url_.host << std::endl;
+        state_ = State::Error;
+        return false;
+    }
+    addresses_.clear();
+    for (addrinfo* entry = addresses; entry; entry = entry->ai_next) {
+        Address address{};
+        std::memcpy(&address.storage, entry->ai_addr, entry->ai_addrlen);
+        address.length = entry->ai_addrlen;
+        address.family = entry->ai_family;
+        addresses_.push_back(address);
+    }
+    freeaddrinfo(addresses);
+    nextAddress_ = 0;
+    int connectError = 0;
+    int socket = connectNext(connectError);
+    if (socket < 0) {
+        std::cerr << "RtmpPublisher: connect to " << url_.host << ":" << url_.port
+                  << " failed: " << std::strerror(connectError) << std::endl;
+        state_ = State::Error;
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(queueMutex_);
+        socket_ = socket;
+        epoll_ = epoll_create1(EPOLL_CLOEXEC);
+        wakeFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    }
+    epoll_event socketEvent{};
+    socketEvent.events = EPOLLIN | EPOLLOUT;
+    socketEvent.data.fd = socket_;
+    epoll_event wakeEvent{};
+    wakeEvent.events = EPOLLIN;
+    wakeEvent.data.fd = wakeFd_;
+    if (epoll_ < 0 || wakeFd_ < 0 || epoll_ctl(epoll_, EPOLL_CTL_ADD, socket_, &socketEvent) < 0 ||
+        epoll_ctl(epoll_, EPOLL_CTL_ADD, wakeFd_, &wakeEvent) < 0) {
+        std::cerr << "RtmpPublisher: epoll setup failed: " << std::strerror(errno) << std::endl;
+        closeSockets();
+        state_ = State::Error;
+        return false;
+    }
+    writeInterest_ = true;
+
+    handshake_.clear();
+    handshakeDone_ = false;
+    reader_ = RtmpChunkReader();
+    streamId_ = 0;
+    bytesReceived_ = 0;
+    lastAcknowledged_ = 0;
+    windowAckSize_ = 0;
+    outgoing_.clear();
+    {
+        std::lock_guard<std::mutex> lock(queueMutex_);
+        pending_.clear();
+        waitKeyframe_ = false;
+        queuedBytes_ = 0;
+    }
+    {
+        std::lock_guard<std::mutex> lock(statsMutex_);
+        stats_ = RtmpPublisherStats();
+        totalLatencyMs_ = 0.0;
+        latencySamples_ = 0;
+    }
+
+    // C0 + C1: version 3, zero time and version fields, random filler
+    std::vector<uint8_t> c0c1(1 + kRtmpHandshakeSize, 0);
+    c0c1[0] = 3;
+    std::minstd_rand rng((unsigned)std::chrono::steady_clock::now().time_since_epoch().count());
+    for (size_t i = 9; i < c0c1.size(); ++i) c0c1[i] = (uint8_t)rng();
+    queueRaw(std::move(c0c1));
+
+    state_ = State::Connecting;
+    stopRequested_ = false;
+    thread_ = std::thread(&RtmpPublisher::eventLoop, this);
+
+    {
+        std::unique_lock<std::mutex> lock(startMutex_);
+        startCv_.wait_for(lock, std::chrono::milliseconds(config_.connectTimeoutMs), [this]() {
+            return state_ == State::Publishing || state_ == State::Error;
+        });
+    }
+    if (state_ != State::Publishing) {
+        if (state_ != State::Error) fail("timed out publishing to " + url_.tcUrl);
+        stop();
+        return false;
+    }
+    std::cout << "RTMP publishing to " << url_.tcUrl << " (stream id " << streamId_ << ")" << std::endl;
+    return true;
+}
+
+void RtmpPublisher::stop() {
+    if (!thread_.joinable()) {
+        closeSockets();
+        return;
+    }
+    if (state_ == State::Publishing) {
+        Amf0Writer command;
+        command.string("deleteStream").number(0).null().number(streamId_);
+        queueControl(kChunkStreamCommand, RtmpMessageType::CommandAmf0, 0, command.take());
+    }
+    stopRequested_ = true;
+    wake();
+    thread_.join();
+    closeSockets();
+    outgoing_.clear();
+    {
+        std::lock_guard<std::mutex> lock(queueMutex_);
+        pending_.clear();
+        queuedBytes_ = 0;
+    }
+    if (state_ != State::Error) state_ = State::Idle;
+}
+
+bool RtmpPublisher::sendVideo(uint32_t timestampMs, bool keyframe, Payload payload, uint8_t codecId,
+                              bool sequenceHeader, int32_t compositionMs) {
+    uint8_t header[kFlvMaxPrefix];
+    size_t headerSize = writeFlvVideoPrefix(header, keyframe, codecId, sequenceHeader, compositionMs);
+    return queueMedia(RtmpMessageType::Video, kChunkStreamVideo, timestampMs, keyframe || sequenceHeader, header,
+                      headerSize, std::move(payload));
+}
+
+bool RtmpPublisher::sendAudio(uint32_t timestampMs, Payload payload, uint8_t soundFormat, bool sequenceHeader) {
+    uint8_t header[kFlvMaxPrefix];
+    size_t headerSize = writeFlvAudioPrefix(header, soundFormat, sequenceHeader);
+    return queueMedia(RtmpMessageType::Audio, kChunkStreamAudio, timestampMs, true, header, headerSize,
+                      std::move(payload));
+}
+
+RtmpPublisherStats RtmpPublisher::getStats() const {
+    std::lock_guard<std::mutex> lock(queueMutex_);
+    std::lock_guard<std::mutex> statsLock(statsMutex_);
+    RtmpPublisherStats stats = stats_;
+    stats.queuedBytes = queuedBytes_;
+    if (latencySamples_ > 0) stats.avgSendLatencyMs = totalLatencyMs_ / latencySamples_;
+
+    // What the kernel still holds and how long ACKs take, for congestion control
+    if (socket_ >= 0 && state_ == State::Publishing) {
+        int unacked = 0;
+        if (ioctl(socket_, SIOCOUTQ, &unacked) == 0 && unacked > 0) stats.socketQueuedBytes = (size_t)unacked;
+        tcp_info info{};
+        socklen_t length = sizeof(info);
+        if (getsockopt(socket_, IPPROTO_TCP, TCP_INFO, &info, &length) == 0 && info.tcpi_rtt > 0) {
+            stats.rttMs = info.tcpi_rtt / 1000.0;
+        }
+    }
+    return stats;
+}
+
+bool RtmpPublisher::queueMedia(RtmpMessageType type, uint32_t chunkStreamId, uint32_t timestamp, bool keyframe,
+                               const uint8_t* tagHeader, size_t tagHeaderSize, Payload payload) {
+    if (state_ != State::Publishing || stopRequested_ || !payload) return false;
+    bool video = type == RtmpMessageType::Video;
+    Outgoing message =
+        chunkMessage(chunkStreamId, timestamp, (uint8_t)type, streamId_, tagHeader, tagHeaderSize, payload);
+    message.media = true;
+
+    size_t queued = 0;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex_);
+        bool full = queuedBytes_ + message.size > config_.maxQueuedBytes;
+        if (full || (video && waitKeyframe_ && !keyframe)) {
+            if (video) waitKeyframe_ = true;
+            std::lock_guard<std::mutex> statsLock(statsMutex_);
+            (video ? stats_.droppedVideo : stats_.droppedAudio)++;
+            return false;
+        }
+        if (video && keyframe) waitKeyframe_ = false;
+        queued = queuedBytes_ += message.size;
+        pending_.push_back(std::move(message));
+        if (wakeFd_ >= 0) {
+            uint64_t one = 1;
+            ssize_t ignored = ::write(wakeFd_, &one, sizeof(one));
+            (void)ignored;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    (video ? stats_.videoMessages : stats_.audioMessages)++;
+    stats_.peakQueuedBytes = std::max(stats_.peakQueuedBytes, queued);
+    return true;
+}
+
+RtmpPublisher::Outgoing RtmpPublisher::chunkMessage(uint32_t chunkStreamId, uint32_t timestamp, uint8_t typeId,
+                                                    uint32_t streamId, const uint8_t* prefix, size_t prefixSize,
+                                                    const Payload& payload) const {
+    struct Slice {
+        bool fromPayload;
+        size_t offset;
+        size_t length;
+    };
+
+    Outgoing message;
+    message.payload = payload;
+    message.queued = std::chrono::steady_clock::now();
+    size_t payloadSize = payload ? payload->size() : 0;
+    size_t length = prefixSize + payloadSize;
+    size_t chunkSize = config_.chunkSize;
+    size_t chunks = std::max<size_t>(1, (length + chunkSize - 1) / chunkSize);
+
+    // All headers go into one buffer; the payload is only referenced.
+    // The prefix (FLV tag header) always fits in the first chunk.
+    message.bytes.resize(kRtmpMaxChunkHeader + prefixSize + (chunks - 1) * 7);
+    uint8_t* bytes = message.bytes.data();
+    std::vector<Slice> slices;
+    slices.reserve(chunks * 2);
+
+    size_t used = writeRtmpChunkHeader(bytes, chunkStreamId, timestamp, (uint32_t)length, typeId, streamId);
+    if (prefixSize > 0) std::memcpy(bytes + used, prefix, prefixSize);
+    used += prefixSize;
+    slices.push_back({false, 0, used});
+    size_t offset = std::min(chunkSize - prefixSize, payloadSize);
+    if (offset > 0) slices.push_back({true, 0, offset});
+    while (offset < payloadSize) {
+        size_t headerSize = writeRtmpContinuationHeader(bytes + used, chunkStreamId, timestamp);
+        slices.push_back({false, used, headerSize});
+        used += headerSize;
+        size_t take = std::min(chunkSize, payloadSize - offset);
+        slices.push_back({true, offset, take});
+        offset += take;
+    }
+    message.bytes.resize(used); // Shrinking keeps the buffer in place
+
+    message.iov.reserve(slices.size());
+    for (const Slice& slice : slices) {
+        const uint8_t* base = slice.fromPayload ? payload->data() + slice.offset : message.bytes.data() + slice.offset;
+        message.iov.push_back(iovec{const_cast<uint8_t*>(base), slice.length});
+    }
+    message.size = used + payloadSize;
+    return message;
+}
+
+void RtmpPublisher::queueRaw(std::vector<uint8_t> bytes) {
+    Outgoing message;
+    message.bytes = std::move(bytes);
+    message.size = message.bytes.size();
+    message.iov.push_back(iovec{message.bytes.data(), message.bytes.size()});
+    message.queued = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(queueMutex_);
+    queuedBytes_ += message.size;
+    pending_.push_back(std::move(message));
+}
+
+void RtmpPublisher::queueControl(uint32_t chunkStreamId, RtmpMessageType type, uint32_t streamId,
+                                 std::vector<uint8_t> payload) {
+    RtmpMessage message;
+    message.chunkStreamId = chunkStreamId;
+    message.typeId = (uint8_t)type;
+    message.streamId = streamId;
+    message.payload = std::move(payload);
+    // Set Chunk Size goes out before the peer knows the new size
+    uint32_t chunkSize = type == RtmpMessageType::SetChunkSize ? kRtmpDefaultChunkSize : config_.chunkSize;
+    std::vector<uint8_t> bytes;
+    appendRtmpMessage(bytes, message, chunkSize);
+    queueRaw(std::move(bytes));
+}
+
+void RtmpPublisher::queueMetadata() {
+    std::vector<std::pair<std::string, double>> fields;
+    if (config_.width > 0) fields.emplace_back("width", config_.width);
+    if (config_.height > 0) fields.emplace_back("height", config_.height);
+    if (config_.frameRate > 0.0) fields.emplace_back("framerate", config_.frameRate);
+    if (config_.videoBitrateKbps > 0) fields.emplace_back("videodatarate", config_.videoBitrateKbps);
+    fields.emplace_back("videocodecid", config_.videoCodecId);
+    fields.emplace_back("audiocodecid", config_.audioCodecId);
+
+    Amf0Writer data;
+    data.string("@setDataFrame").string("onMetaData").beginEcmaArray((uint32_t)fields.size());
+    for (const auto& field : fields) data.key(field.first).number(field.second);
+    data.endObject();
+    queueControl(kChunkStreamData, RtmpMessageType::DataAmf0, streamId_, data.take());
+}
+
+void RtmpPublisher::wake() {
+    std::lock_guard<std::mutex> lock(queueMutex_);
+    if (wakeFd_ >= 0) {
+        uint64_t one = 1;
+        ssize_t ignored = ::write(wakeFd_, &one, sizeof(one));
+        (void)ignored;
+    }
+}
+
+void RtmpPublisher::eventLoop() {
+    epoll_event events[4];
+    auto drainDeadline = std::chrono::steady_clock::time_point::max();
+    for (;;) {
+        {
+            std::lock_guard<std::mutex> lock(queueMutex_);
+            while (!pending_.empty()) {
+                outgoing_.push_back(std::move(pending_.front()));
+                pending_.pop_front();
+            }
+        }
+        if (state_ != State::Connecting && state_ != State::Error && !flushWrites()) break;
+        if (state_ == State::Error) break;
+        updateWriteInterest();
+
+        if (stopRequested_) {
+            if (drainDeadline == std::chrono::steady_clock::time_point::max()) {
+                drainDeadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+            }
+            if (state_ != State::Publishing || outgoing_.empty() || std::chrono::steady_clock::now() >= drainDeadline) {
+                break;
+            }
+        }
+
+        int count = epoll_wait(epoll_, events, 4, stopRequested_ ? 50 : -1);
+        if (count < 0) {
+            if (errno == EINTR) continue;
+            fail(std::string("epoll_wait failed: ") + std::strerror(errno));
+            break;
+        }
+        for (int i = 0; i < count; ++i) {
+            if (events[i].data.fd == wakeFd_) {
+                uint64_t value;
+                ssize_t ignored = ::read(wakeFd_, &value, sizeof(value));
+                (void)ignored;
+                continue;
+            }
+            uint32_t flags = events[i].events;
+            if (state_ == State::Connecting && (flags & (EPOLLOUT | EPOLLERR | EPOLLHUP))) {
+                int error = 0;
+                socklen_t length = sizeof(error);
+                getsockopt(socket_, SOL_SOCKET, SO_ERROR, &error, &length);
+                if (error != 0) {
+                    // Refused or unreachable: move on to the host's next address
+                    int next = connectNext(error);
+                    epoll_event event{};
+                    event.events = EPOLLIN | EPOLLOUT;
+                    event.data.fd = next;
+                    if (next < 0 || epoll_ctl(epoll_, EPOLL_CTL_ADD, next, &event) < 0) {
+                        if (next >= 0) ::close(next);
+                        fail(std::string("connect failed: ") + std::strerror(error));
+                        break;
+                    }
+                    std::lock_guard<std::mutex> lock(queueMutex_);
+                    ::close(socket_); // Also leaves the epoll set
+                    socket_ = next;
+                    writeInterest_ = true;
+                    break;
+                }
+                state_ = State::Handshaking;
+            }
+            if ((flags & EPOLLIN) && !handleReadable()) break;
+            if ((flags & (EPOLLERR | EPOLLHUP)) && !(flags & EPOLLIN) && state_ != State::Error) {
+                fail("connection lost");
+                break;
+            }
+        }
+    }
+    startCv_.notify_all();
+}
+
+bool RtmpPublisher::handleReadable() {
+    uint8_t buffer[64 * 1024];
+    for (;;) {
+        ssize_t n = ::read(socket_, buffer, sizeof(buffer));
+        if (n > 0) {
+            bytesReceived_ += (uint64_t)n;
+            bool ok = handshakeDone_ ? processChunks(buffer, (size_t)n) : handleHandshake(buffer, (size_t)n);
+            if (!ok) return false;
+            continue;
+        }
+        if (n == 0) {
+            fail("server closed the connection");
+            return false;
+        }
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+        fail(std::string("read failed: ") + std::strerror(errno));
+        return false;
+    }
+
+    if (windowAckSize_ > 0 && bytesReceived_ - lastAcknowledged_ >= windowAckSize_) {
+        queueControl(kChunkStreamControl, RtmpMessageType::Acknowledgement, 0, be32Payload((uint32_t)bytesReceived_));
+        lastAcknowledged_ = bytesReceived_;
+    }
+    return true;
+}
+
+bool RtmpPublisher::handleHandshake(const uint8_t* data, size_t size) {
+    // S0 + S1 + S2
+    const size_t total = 1 + 2 * kRtmpHandshakeSize;
+    size_t before = handshake_.size();
+    size_t take = std::min(size, total - before);
+    handshake_.insert(handshake_.end(), data, data + take);
+
+    if (before < 1 + kRtmpHandshakeSize && handshake_.size() >= 1 + kRtmpHandshakeSize) {
+        if (handshake_[0] != 3) {
+            fail("unsupported RTMP version " + std::to_string(handshake_[0]));
+            return false;
+        }
+        // C2 echoes S1
+        queueRaw(std::vector<uint8_t>(handshake_.begin() + 1, handshake_.begin() + 1 + kRtmpHandshakeSize));
+    }
+    if (handshake_.size() < total) return true;
+
+    handshakeDone_ = true;
+    state_ = State::Negotiating;
+    queueControl(kChunkStreamControl, RtmpMessageType::SetChunkSize, 0, be32Payload(config_.chunkSize));
+    Amf0Writer connect;
+    connect.string("connect").number(kConnectTransaction).beginObject()
+        .key("app").string(url_.app)
+        .key("type").string("nonprivate")
+        .key("flashVer").string("FMLE/3.0 (compatible; HybridMediaEngine)")
+        .key("tcUrl").string(url_.tcUrl)
+        .endObject();
+    queueControl(kChunkStreamCommand, RtmpMessageType::CommandAmf0, 0, connect.take());
+    return take < size ? processChunks(data + take, size - take) : true;
+}
+
+bool RtmpPublisher::processChunks(const uint8_t* data, size_t size) {
+    std::vector<RtmpMessage> messages;
+    if (!reader_.feed(data, size, messages)) {
+        fail("malformed chunk stream from server");
+        return false;
+    }
+    for (const RtmpMessage& message : messages) {
+        if (!handleMessage(message)) return false;
+    }
+    return true;
+}
+
+bool RtmpPublisher::handleMessage(const RtmpMessage& message) {
+    const std::vector<uint8_t>& payload = message.payload;
+    switch ((RtmpMessageType)message.typeId) {
+        case RtmpMessageType::WindowAckSize:
+            if (payload.size() >= 4) {
+                windowAckSize_ = (uint32_t)payload[0] << 24 | (uint32_t)payload[1] << 16 | (uint32_t)payload[2] << 8 |
+                                 payload[3];
+            }
+            return true;
+        case RtmpMessageType::UserControl:
+            // Ping request (6) wants a ping response (7) with the same time
+            if (payload.size() >= 6 && payload[0] == 0 && payload[1] == 6) {
+                std::vector<uint8_t> response(payload.begin(), payload.begin() + 6);
+                response[1] = 7;
+                queueControl(kChunkStreamControl, RtmpMessageType::UserControl, 0, std::move(response));
+            }
+            return true;
+        case RtmpMessageType::CommandAmf0:
+            return handleCommand(message);
+        default:
+            return true; // Chunk size is tracked by the reader; the rest needs no answer
+    }
+}
+
+bool RtmpPublisher::handleCommand(const RtmpMessage& message) {
+    std::vector<AmfValue> values;
+    if (!decodeAmf0(message.payload.data(), message.payload.size(), values) || values.size() < 2 ||
+        values[0].type != AmfValue::Type::String) {
+        fail("malformed command from server");
+        return false;
+    }
+    const std::string& name = values[0].string;
+    double transaction = values[1].number;
+
+    if (name == "_result" && transaction == kConnectTransaction) {
+        Amf0Writer command;
+        command.string("createStream").number(kCreateStreamTransaction).null();
+        queueControl(kChunkStreamCommand, RtmpMessageType::CommandAmf0, 0, command.take());
+    } else if (name == "_result" && transaction == kCreateStreamTransaction) {
+        if (values.size() < 4 || values[3].type != AmfValue::Type::Number) {
+            fail("createStream returned no stream id");
+            return false;
+        }
+        streamId_ = (uint32_t)values[3].number;
+        Amf0Writer command;
+        command.string("publish").number(0).null().string(url_.streamKey).string("live");
+        queueControl(kChunkStreamCommand, RtmpMessageType::CommandAmf0, streamId_, command.take());
+    } else if (name == "_error") {
+        const AmfValue* description = values.size() >= 4 ? values[3].find("description") : nullptr;
+        fail("server refused the request" + (description ? ": " + description->string : std::string()));
+        return false;
+    } else if (name == "onStatus") {
+        const AmfValue* code = values.size() >= 4 ? values[3].find("code") : nullptr;
+        const AmfValue* level = values.size() >= 4 ? values[3].find("level") : nullptr;
+        if (code && code->string == "NetStream.Publish.Start") {
+            if (state_ == State::Negotiating) {
+                queueMetadata();
+                {
+                    std::lock_guard<std::mutex> lock(startMutex_);
+                    state_ = State::Publishing;
+                }
+                startCv_.notify_all();
+            }
+        } else if (level && level->string == "error") {
+            fail("publish failed: " + (code ? code->string : std::string("unknown")));
+            return false;
+        }
+    }
+    return true;
+}
+
+bool RtmpPublisher::flushWrites() {
+    while (!outgoing_.empty()) {
+        iovec gather[kMaxGather];
+        size_t count = 0;
+        for (auto it = outgoing_.begin(); it != outgoing_.end() && count < kMaxGather; ++it) {
+            for (size_t i = it->next; i < it->iov.size() && count < kMaxGather; ++i) gather[count++] = it->iov[i];
+        }
+        msghdr header{};
+        header.msg_iov = gather;
+        header.msg_iovlen = count;
+        // sendmsg() is writev() with flags: no SIGPIPE on a dropped connection
+        ssize_t written = ::sendmsg(socket_, &header, MSG_NOSIGNAL);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return true;
+            fail(std::string("send failed: ") + std::strerror(errno));
+            return false;
+        }
+
+        size_t remaining = (size_t)written;
+        double latencyMs = 0.0;
+        int completedMedia = 0;
+        while (remaining > 0) {
+            Outgoing& message = outgoing_.front();
+            iovec& slice = message.iov[message.next];
+            if (remaining < slice.iov_len) {
+                slice.iov_base = static_cast<uint8_t*>(slice.iov_base) + remaining;
+                slice.iov_len -= remaining;
+                break;
+            }
+            remaining -= slice.iov_len;
+            if (++message.next == message.iov.size()) {
+                if (message.media) {
+                    double ms = msSince(message.queued);
+                    latencyMs = std::max(latencyMs, ms);
+                    std::lock_guard<std::mutex> lock(statsMutex_);
+                    totalLatencyMs_ += ms;
+                    latencySamples_++;
+                    completedMedia++;
+                }
+                queuedBytes_ -= message.size;
+                outgoing_.pop_front();
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(statsMutex_);
+        stats_.bytesSent += (uint64_t)written;
+        stats_.gatherWrites++;
+        if (completedMedia > 0) stats_.maxSendLatencyMs = std::max(stats_.maxSendLatencyMs, latencyMs);
+    }
+    return true;
+}
+
+void RtmpPublisher::updateWriteInterest() {
+    bool wanted = state_ == State::Connecting || !outgoing_.empty();
+    if (wanted == writeInterest_) return;
+    epoll_event event{};
+    event.events = (uint32_t)EPOLLIN | (wanted ? (uint32_t)EPOLLOUT : 0u);
+    event.data.fd = socket_;
+    if (epoll_ctl(epoll_, EPOLL_CTL_MOD, socket_, &event) == 0) writeInterest_ = wanted;
+}
+
+void RtmpPublisher::fail(const std::string& reason) {
+    std::cerr << "RtmpPublisher: " << reason << std::endl;
+    {
+        std::lock_guard<std::mutex> lock(startMutex_);
+        state_ = State::Error;
+    }
+    startCv_.notify_all();
+}
+
+int RtmpPublisher::connectNext(int& error) {
+    while (nextAddress_ < addresses_.size()) {
+        const Address& address = addresses_[nextAddress_++];
+        int socket = ::socket(address.family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (socket < 0) {
+            error = errno;
+            continue;
+        }
+        if (::connect(socket, (const sockaddr*)&address.storage, address.length) == 0 || errno == EINPROGRESS) {
+            int one = 1;
+            setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            return socket;
+        }
+        error = errno;
+        ::close(socket);
+    }
+    return -1;
+}
+
+void RtmpPublisher::closeSockets() {
+    std::lock_guard<std::mutex> lock(queueMutex_);
+    if (socket_ >= 0) ::close(socket_);
+    if (epoll_ >= 0) ::close(epoll_);
+    if (wakeFd_ >= 0) ::close(wakeFd_);
+    socket_ = epoll_ = wakeFd_ = -1;
+    writeInterest_ = false;
+}
@@ -0,0 +1,181 @@
+#ifndef RTMP_PUBLISHER_H
+#define RTMP_PUBLISHER_H
+
+#include "RtmpProtocol.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+struct RtmpUrl {
+    std::string host;
+    int port = 1935;
+    std::string app;
+    std::string streamKey;
+    std::string tcUrl; // rtmp://host[:port]/app
+};
+
+struct RtmpPublisherConfig {
+    int connectTimeoutMs = 5000;
+    uint32_t chunkSize = 4096;
+    size_t maxQueuedBytes = 4 * 1024 * 1024; // Accepted but not yet written to the socket
+    // onMetaData; zero fields are left out
+    int width = 0;
+    int height = 0;
+    double frameRate = 0.0;
+    int videoBitrateKbps = 0;
+    int videoCodecId = 7;  // FLV ids: 7 = AVC
+    int audioCodecId = 10; // 10 = AAC
+};
+
+struct RtmpPublisherStats {
+    uint64_t videoMessages = 0;
+    uint64_t audioMessages = 0;
+    uint64_t droppedVideo = 0;   // Queue full, or waiting for a keyframe after a drop
+    uint64_t droppedAudio = 0;
+    uint64_t bytesSent = 0;
+    uint64_t gatherWrites = 0;   // sendmsg() calls, each covering many chunks
+    size_t queuedBytes = 0;
+    size_t peakQueuedBytes = 0;
+    double avgSendLatencyMs = 0.0; // send*() until the last byte went to the socket
+    double maxSendLatencyMs = 0.0;
+    size_t socketQueuedBytes = 0;  // In the kernel send buffer, not yet acknowledged
+    double rttMs = -1.0;           // Smoothed TCP RTT; negative when unknown
+};
+
+// RTMP publisher: handshake, connect/createStream/publish, then FLV-tagged
+// audio and video messages. One thread drives a non-blocking socket from
+// an epoll loop; send*() only queues. Payloads are shared with the queue
+// and gathered in place between the chunk headers by writev-style
+// sendmsg() calls, never copied. The queue is bounded by maxQueuedBytes:
+// when it is full the packet is dropped, and video then waits for the
+// next keyframe.
+class RtmpPublisher {
+public:
+    enum class State {
+        Idle,
+        Connecting,
+        Handshaking,
+        Negotiating,
+        Publishing,
+        Error
+    };
+
+    static constexpr uint8_t kFlvVideoAvc = 7;
+    static constexpr uint8_t kFlvVideoHevc = 12;
+    static constexpr uint8_t kFlvAudioAac = 10;
+
+    using Payload = std::shared_ptr<const std::vector<uint8_t>>;
+
+    explicit RtmpPublisher(const RtmpPublisherConfig& config = RtmpPublisherConfig());
+    ~RtmpPublisher();
+
+    // rtmp://host[:port]/app[/more]/streamKey
+    static bool parseUrl(const std::string& url, RtmpUrl& out);
+
+    // Connects and publishes; returns once the server accepted the stream,
+    // refused it, or connectTimeoutMs passed
+    bool start(const std::string& url);
+    // Gives queued data up to a second to go out, then closes
+    void stop();
+    State getState() const { return state_; }
+
+    // AVC/HEVC payloads get the packet type and composition time fields
+    bool sendVideo(uint32_t timestampMs, bool keyframe, Payload payload, uint8_t codecId = kFlvVideoAvc,
+                   bool sequenceHeader = false, int32_t compositionMs = 0);
+    // AAC payloads get the packet type field; the sound header byte is
+    // written as 44 kHz, 16-bit stereo, as FLV requires for AAC
+    bool sendAudio(uint32_t timestampMs, Payload payload, uint8_t soundFormat = kFlvAudioAac,
+                   bool sequenceHeader = false);
+
+    RtmpPublisherStats getStats() const;
+
+private:
+    struct Outgoing {
+        std::vector<uint8_t> bytes;  // Chunk headers, FLV tag header, or a whole control message
+        Payload payload;
+        std::vector<iovec> iov;
+        size_t next = 0;             // First iov entry not fully written
+        size_t size = 0;
+        bool media = false;
+        std::chrono::steady_clock::time_point queued;
+    };
+
+    bool queueMedia(RtmpMessageType type, uint32_t chunkStreamId, uint32_t timestamp, bool keyframe,
+                    const uint8_t* tagHeader, size_t tagHeaderSize, Payload payload);
+    Outgoing chunkMessage(uint32_t chunkStreamId, uint32_t timestamp, uint8_t typeId, uint32_t streamId,
+                          const uint8_t* prefix, size_t prefixSize, const Payload& payload) const;
+    void queueRaw(std::vector<uint8_t> bytes);
+    void queueControl(uint32_t chunkStreamId, RtmpMessageType type, uint32_t streamId, std::vector<uint8_t> payload);
+    void queueMetadata();
+    void wake();
+
+    void eventLoop();
+    bool handleReadable();
+    bool handleHandshake(const uint8_t* data, size_t size);
+    bool processChunks(const uint8_t* data, size_t size);
+    bool handleMessage(const RtmpMessage& message);
+    bool handleCommand(const RtmpMessage& message);
+    bool flushWrites();
+    void updateWriteInterest();
+    void fail(const std::string& reason);
+    // Starts a non-blocking connect to the next resolved address that
+    // accepts one. Returns the socket, or -1 with errno-style `error`.
+    int connectNext(int& error);
+    void closeSockets();
+
+    RtmpPublisherConfig config_;
+    RtmpUrl url_;
+    std::atomic<State> state_;
+    std::thread thread_;
+    std::atomic<bool> stopRequested_;
+
+    // Changed under queueMutex_, which getStats() and stop() also take
+    int socket_;
+    int epoll_;
+    int wakeFd_;
+    bool writeInterest_;
+
+    // Every address the host resolved to, tried in order until one connects
+    struct Address {
+        sockaddr_storage storage;
+        socklen_t length;
+        int family;
+    };
+    std::vector<Address> addresses_;
+    size_t nextAddress_;
+
+    // Loop thread only
+    std::vector<uint8_t> handshake_;
+    bool handshakeDone_;
+    RtmpChunkReader reader_;
+    uint64_t bytesReceived_;
+    uint64_t lastAcknowledged_;
+    uint32_t windowAckSize_;
+    std::deque<Outgoing> outgoing_;
+    std::atomic<uint32_t> streamId_; // Set before Publishing
+
+    // Everything to be sent reaches the loop through here; the wake fd is
+    // only written under this lock so stop() can close it safely
+    mutable std::mutex queueMutex_;
+    std::deque<Outgoing> pending_;
+    bool waitKeyframe_;
+    std::atomic<size_t> queuedBytes_;
+
+    std::mutex startMutex_;
+    std::condition_variable startCv_;
+
+    mutable std::mutex statsMutex_;
+    RtmpPublisherStats stats_;
+    double totalLatencyMs_;
+    uint64_t latencySamples_;
+};
+
+#endif // RTMP_PUBLISHER_H
@@ -0,0 +1,414 @@
+#include "RtpProtocol.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+constexpr uint8_t kNalFuA = 28;
+constexpr uint8_t kNalStapA = 24;
+// Fragment offsets beyond this are treated as corrupt
+constexpr size_t kMaxFrameBytes = 64 * 1024 * 1024;
+const uint8_t kStartCode[4] = {0, 0, 0, 1};
+
+void putBe16(uint8_t* out, uint16_t value) {
+    out[0] = (uint8_t)(value >> 8);
+    out[1] = (uint8_t)value;
+}
+
+void putBe32(uint8_t* out, uint32_t value) {
+    out[0] = (uint8_t)(value >> 24);
+    out[1] = (uint8_t)(value >> 16);
+    out[2] = (uint8_t)(value >> 8);
+    out[3] = (uint8_t)value;
+}
+
+uint16_t be16(const uint8_t* data) {
+    return (uint16_t)(data[0] << 8 | data[1]);
+}
+
+uint32_t be32(const uint8_t* data) {
+    return (uint32_t)data[0] << 24 | (uint32_t)data[1] << 16 | (uint32_t)data[2] << 8 | data[3];
+}
+
+// Eight bytes at a time; parity is computed for every media packet
+void xorBytes(uint8_t* dst, const uint8_t* src, size_t size) {
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t a, b;
+        std::memcpy(&a, dst + i, 8);
+        std::memcpy(&b, src + i, 8);
+        a ^= b;
+        std::memcpy(dst + i, &a, 8);
+    }
+    for (; i < size; ++i) dst[i] ^= src[i];
+}
+
+// Start of the next 00 00 01 at or after from, or size
+size_t findStartCode(const uint8_t* data, size_t size, size_t from) {
+    for (size_t i = from; i + 3 <= size; ++i) {
+        if (data[i + 2] > 1) {
+            i += 2;
+        } else if (data[i] == 0 && data[i + 1] == 0 && data[i + 2] == 1) {
+            return i;
+        }
+    }
+    return size;
+}
+
+} // namespace
+
+void writeRtpHeader(uint8_t* out, const RtpHeader& header) {
+    out[0] = 0x80;
+    out[1] = (uint8_t)((header.marker ? 0x80 : 0) | (header.payloadType & 0x7F));
+    putBe16(out + 2, header.sequence);
+    putBe32(out + 4, header.timestamp);
+    putBe32(out + 8, header.ssrc);
+}
+
+bool parseRtpHeader(const uint8_t* data, size_t size, RtpHeader& header, size_t& payloadOffset,
+                    size_t& payloadSize) {
+    if (size < kRtpHeaderSize || (data[0] >> 6) != 2) return false;
+    size_t offset = kRtpHeaderSize + 4 * (size_t)(data[0] & 0x0F);
+    if (data[0] & 0x10) {
+        if (offset + 4 > size) return false;
+        offset += 4 + 4 * (size_t)be16(data + offset + 2);
+    }
+    if (offset > size) return false;
+    size_t end = size;
+    if (data[0] & 0x20) {
+        uint8_t padding = data[size - 1];
+        if (padding == 0 || padding > end - offset) return false;
+        end -= padding;
+    }
+    header.marker = (data[1] & 0x80) != 0;
+    header.payloadType = data[1] & 0x7F;
+    header.sequence = be16(data + 2);
+    header.timestamp = be32(data + 4);
+    header.ssrc = be32(data + 8);
+    payloadOffset = offset;
+    payloadSize = end - offset;
+    return true;
+}
+
+std::vector<uint8_t> buildRtcpNack(uint32_t senderSsrc, uint32_t mediaSsrc, const std::vector<uint16_t>& lost) {
+    std::vector<uint8_t> packet(12);
+    // Each FCI entry names one PID and flags up to 16 following numbers
+    for (size_t i = 0; i < lost.size();) {
+        uint16_t pid = lost[i++];
+        uint16_t mask = 0;
+        while (i < lost.size()) {
+            uint16_t distance = (uint16_t)(lost[i] - pid);
+            if (distance < 1 || distance > 16) break;
+            mask |= (uint16_t)(1 << (distance - 1));
+            i++;
+        }
+        uint8_t entry[4];
+        putBe16(entry, pid);
+        putBe16(entry + 2, mask);
+        packet.insert(packet.end(), entry, entry + 4);
+    }
+    packet[0] = 0x80 | 1; // Version 2, FMT 1: generic NACK
+    packet[1] = kRtcpTransportFeedback;
+    putBe16(&packet[2], (uint16_t)(packet.size() / 4 - 1));
+    putBe32(&packet[4], senderSsrc);
+    putBe32(&packet[8], mediaSsrc);
+    return packet;
+}
+
+bool parseRtcpNack(const uint8_t* data, size_t size, uint32_t& mediaSsrc, std::vector<uint16_t>& lost) {
+    if (size < 12 || (data[0] >> 6) != 2 || (data[0] & 0x1F) != 1 || data[1] != kRtcpTransportFeedback) {
+        return false;
+    }
+    size_t total = ((size_t)be16(data + 2) + 1) * 4;
+    if (total > size || total < 12) return false;
+    mediaSsrc = be32(data + 8);
+    for (size_t offset = 12; offset + 4 <= total; offset += 4) {
+        uint16_t pid = be16(data + offset);
+        uint16_t mask = be16(data + offset + 2);
+        lost.push_back(pid);
+        for (int bit = 0; bit < 16; ++bit) {
+            if (mask & (1 << bit)) lost.push_back((uint16_t)(pid + bit + 1));
+        }
+    }
+    return true;
+}
+
+RtpPacketizer::RtpPacketizer(RtpPayloadFormat format, uint8_t payloadType, uint32_t ssrc, size_t mtu)
+    : format_(format)
+    , payloadType_(payloadType)
+    , ssrc_(ssrc)
+    , maxPayload_(std::min(std::max(mtu, kRtpHeaderSize + 16), kRtpMaxDatagram) - kRtpHeaderSize)
+    , sequence_(0) {
+}
+
+uint8_t* RtpPacketizer::addPacket(std::vector<RtpPacketBuffer>& out, size_t& count, size_t payloadSize,
+                                  uint32_t timestamp) {
+    if (out.size() <= count) out.emplace_back();
+    RtpPacketBuffer& packet = out[count++];
+    packet.resize(kRtpHeaderSize + payloadSize);
+    RtpHeader header;
+    header.payloadType = payloadType_;
+    header.sequence = sequence_++;
+    header.timestamp = timestamp;
+    header.ssrc = ssrc_;
+    writeRtpHeader(packet.data(), header);
+    return packet.data() + kRtpHeaderSize;
+}
+
+void RtpPacketizer::packetizeNal(const uint8_t* nal, size_t size, uint32_t timestamp,
+                                 std::vector<RtpPacketBuffer>& out, size_t& count) {
+    if (size == 0) return;
+    if (size <= maxPayload_) {
+        std::memcpy(addPacket(out, count, size, timestamp), nal, size);
+        return;
+    }
+    // FU-A: the NAL header is split into an indicator and a fragment header
+    uint8_t indicator = (uint8_t)((nal[0] & 0xE0) | kNalFuA);
+    uint8_t type = nal[0] & 0x1F;
+    size_t chunk = maxPayload_ - 2;
+    for (size_t offset = 1; offset < size; offset += chunk) {
+        size_t take = std::min(chunk, size - offset);
+        uint8_t* payload = addPacket(out, count, take + 2, timestamp);
+        payload[0] = indicator;
+        payload[1] = (uint8_t)(type | (offset == 1 ? 0x80 : 0) | (offset + take == size ? 0x40 : 0));
+        std::memcpy(payload + 2, nal + offset, take);
+    }
+}
+
+size_t RtpPacketizer::packetize(const uint8_t* data, size_t size, uint32_t timestamp,
+                                std::vector<RtpPacketBuffer>& out) {
+    size_t count = 0;
+    switch (format_) {
+        case RtpPayloadFormat::Audio:
+            if (size > maxPayload_) return 0;
+            std::memcpy(addPacket(out, count, size, timestamp), data, size);
+            break;
+        case RtpPayloadFormat::Fragmented: {
+            size_t chunk = maxPayload_ - 4;
+            size_t offset = 0;
+            do {
+                size_t take = std::min(chunk, size - offset);
+                uint8_t* payload = addPacket(out, count, take + 4, timestamp);
+                putBe32(payload, (uint32_t)offset);
+                std::memcpy(payload + 4, data + offset, take);
+                offset += take;
+            } while (offset < size);
+            break;
+        }
+        case RtpPayloadFormat::H264: {
+            size_t start = findStartCode(data, size, 0);
+            if (start == size) {
+                packetizeNal(data, size, timestamp, out, count); // A bare NAL unit
+                break;
+            }
+            while (start < size) {
+                size_t nal = start + 3;
+                size_t next = findStartCode(data, size, nal);
+                size_t end = next;
+                while (end > nal && data[end - 1] == 0) end--; // Zero byte of a 4-byte start code
+                packetizeNal(data + nal, end - nal, timestamp, out, count);
+                start = next;
+            }
+            break;
+        }
+    }
+    if (count > 0) out[count - 1][1] |= 0x80;
+    return count;
+}
+
+RtpDepacketizer::RtpDepacketizer(RtpPayloadFormat format)
+    : format_(format)
+    , active_(false)
+    , damaged_(false)
+    , lossPending_(false)
+    , inFragment_(false) {
+}
+
+void RtpDepacketizer::push(const RtpHeader& header, const uint8_t* payload, size_t size,
+                           std::vector<RtpFrame>& frames) {
+    if (active_ && header.timestamp != current_.timestamp) {
+        damaged_ = true; // The marker packet of the frame in progress was lost
+        finish(frames);
+    }
+    if (!active_) {
+        active_ = true;
+        current_.ssrc = header.ssrc;
+        current_.timestamp = header.timestamp;
+        current_.data.clear();
+        damaged_ = lossPending_;
+        lossPending_ = false;
+        inFragment_ = false;
+    }
+    std::vector<uint8_t>& data = current_.data;
+
+    switch (format_) {
+        case RtpPayloadFormat::Audio:
+            data.assign(payload, payload + size);
+            break;
+        case RtpPayloadFormat::Fragmented: {
+            if (size < 4) {
+                damaged_ = true;
+                break;
+            }
+            size_t offset = be32(payload);
+            if (offset != data.size()) damaged_ = true;
+            if (offset + size > kMaxFrameBytes) break;
+            if (offset + size - 4 > data.size()) data.resize(offset + size - 4);
+            std::memcpy(data.data() + offset, payload + 4, size - 4);
+            break;
+        }
+        case RtpPayloadFormat::H264: {
+            if (size < 1) {
+                damaged_ = true;
+                break;
+            }
+            uint8_t type = payload[0] & 0x1F;
+            if (type >= 1 && type <= 23) {
+                if (inFragment_) damaged_ = true;
+                inFragment_ = false;
+                data.insert(data.end(), kStartCode, kStartCode + 4);
+                data.insert(data.end(), payload, payload + size);
+            } else if (type == kNalFuA && size >= 2) {
+                bool first = (payload[1] & 0x80) != 0;
+                bool last = (payload[1] & 0x40) != 0;
+                if (first) {
+                    if (inFragment_) damaged_ = true;
+                    data.insert(data.end(), kStartCode, kStartCode + 4);
+                    data.push_back((uint8_t)((payload[0] & 0xE0) | (payload[1] & 0x1F)));
+                    inFragment_ = true;
+                }
+                if (!inFragment_) {
+                    damaged_ = true; // Its start was lost
+                    break;
+                }
+                data.insert(data.end(), payload + 2, payload + size);
+                if (last) inFragment_ = false;
+            } else if (type == kNalStapA) {
+                // Aggregates from other senders: 16-bit size before each NAL unit
+                size_t offset = 1;
+                while (offset + 2 <= size) {
+                    size_t length = be16(payload + offset);
+                    offset += 2;
+                    if (length == 0 || offset + length > size) {
+                        damaged_ = true;
+                        break;
+                    }
+                    data.insert(data.end(), kStartCode, kStartCode + 4);
+                    data.insert(data.end(), payload + offset, payload + offset + length);
+                    offset += length;
+                }
+            } else {
+                damaged_ = true;
+            }
+            break;
+        }
+    }
+    if (header.marker || format_ == RtpPayloadFormat::Audio) finish(frames);
+}
+
+void RtpDepacketizer::markLoss() {
+    // A lost audio packet is a lost frame and damages no other
+    if (format_ == RtpPayloadFormat::Audio) return;
+    if (active_) {
+        damaged_ = true;
+    } else {
+        lossPending_ = true;
+    }
+}
+
+void RtpDepacketizer::finish(std::vector<RtpFrame>& frames) {
+    current_.complete = !damaged_ && !inFragment_;
+    frames.push_back(std::move(current_));
+    current_ = RtpFrame();
+    active_ = false;
+    inFragment_ = false;
+}
+
+bool parseRtpFecHeader(const uint8_t* data, size_t size, RtpFecHeader& header) {
+    if (size < kRtpFecHeaderSize) return false;
+    header.baseSequence = be16(data);
+    header.stride = data[2];
+    header.count = data[3];
+    header.lengthXor = be16(data + 4);
+    header.mediaSsrc = be32(data + 8);
+    return header.stride > 0 && header.count > 0;
+}
+
+RtpFecEncoder::RtpFecEncoder(const RtpFecConfig& config, uint8_t payloadType, uint32_t ssrc, uint32_t mediaSsrc)
+    : config_(config)
+    , payloadType_(payloadType)
+    , ssrc_(ssrc)
+    , mediaSsrc_(mediaSsrc)
+    , sequence_(0)
+    , position_(0) {
+    // Counts and strides travel in one byte
+    config_.columns = std::min(std::max(config_.columns, 0), 255);
+    config_.rows = config_.columns > 0 ? std::min(std::max(config_.rows, 0), 255) : 0;
+    columns_.resize(config_.rows > 0 ? config_.columns : 0);
+}
+
+void RtpFecEncoder::add(Parity& parity, const RtpPacketBuffer& packet, uint16_t sequence) {
+    if (parity.count == 0) parity.baseSequence = sequence;
+    if (parity.bits.size() < packet.size()) parity.bits.resize(packet.size(), 0);
+    xorBytes(parity.bits.data(), packet.data(), packet.size());
+    parity.length = std::max(parity.length, packet.size());
+    parity.lengthXor ^= (uint16_t)packet.size();
+    parity.count++;
+}
+
+void RtpFecEncoder::emit(Parity& parity, uint8_t stride, uint32_t timestamp, std::vector<RtpPacketBuffer>& out,
+                         size_t& count) {
+    if (out.size() <= count) out.emplace_back();
+    RtpPacketBuffer& packet = out[count++];
+    packet.resize(kRtpHeaderSize + kRtpFecHeaderSize + parity.length);
+    RtpHeader header;
+    header.payloadType = payloadType_;
+    header.sequence = sequence_++;
+    header.timestamp = timestamp;
+    header.ssrc = ssrc_;
+    writeRtpHeader(packet.data(), header);
+
+    uint8_t* fec = packet.data() + kRtpHeaderSize;
+    putBe16(fec, parity.baseSequence);
+    fec[2] = stride;
+    fec[3] = (uint8_t)parity.count;
+    putBe16(fec + 4, parity.lengthXor);
+    putBe16(fec + 6, 0);
+    putBe32(fec + 8, mediaSsrc_);
+    std::memcpy(fec + kRtpFecHeaderSize, parity.bits.data(), parity.length);
+
+    std::fill(parity.bits.begin(), parity.bits.begin() + parity.length, 0);
+    parity.length = 0;
+    parity.lengthXor = 0;
+    parity.count = 0;
+}
+
+size_t RtpFecEncoder::protect(const RtpPacketBuffer& packet, uint16_t sequence, uint32_t timestamp,
+                              std::vector<RtpPacketBuffer>& out) {
+    size_t count = 0;
+    if (!enabled()) return 0;
+    add(row_, packet, sequence);
+    if (config_.rows > 0) add(columns_[position_ % config_.columns], packet, sequence);
+    position_++;
+    if (row_.count == config_.columns) emit(row_, 1, timestamp, out, count);
+    if (config_.rows > 0 && position_ == config_.columns * config_.rows) {
+        for (Parity& column : columns_) emit(column, (uint8_t)config_.columns, timestamp, out, count);
+    }
+    if (position_ == config_.columns * std::max(config_.rows, 1)) position_ = 0;
+    return count;
+}
+
+bool recoverRtpFecPacket(const RtpFecHeader& header, const uint8_t* parity, size_t paritySize,
+                         const std::vector<std::pair<const uint8_t*, size_t>>& others, RtpPacketBuffer& out) {
+    if (others.size() + 1 != header.count) return false;
+    size_t length = header.lengthXor;
+    for (const auto& other : others) {
+        if (other.second > paritySize) return false;
+        length ^= other.second;
+    }
+    if (length > paritySize || length < kRtpHeaderSize) return false;
+    out.assign(parity, parity + paritySize);
+    for (const auto& other : others) xorBytes(out.data(), other.first, other.second);
+    out.resize(length);
+    return true;
+}
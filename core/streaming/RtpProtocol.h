@@ -0,0 +1,162 @@
+#ifndef RTP_PROTOCOL_H
+#define RTP_PROTOCOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Wire-level RTP pieces shared by RtpSender and RtpReceiver: the fixed
+// header, RTCP generic NACK, payload (de)packetization and XOR parity FEC.
+
+constexpr size_t kRtpHeaderSize = 12;
+// Whole UDP payload; leaves room for tunnels under a 1500-byte MTU
+constexpr size_t kRtpDefaultMtu = 1200;
+constexpr size_t kRtpMaxDatagram = 2048;
+
+using RtpPacketBuffer = std::vector<uint8_t>;
+
+struct RtpHeader {
+    bool marker = false;
+    uint8_t payloadType = 0;
+    uint16_t sequence = 0;
+    uint32_t timestamp = 0;
+    uint32_t ssrc = 0;
+};
+
+// Writes the 12-byte fixed header (version 2, no CSRCs or extension)
+void writeRtpHeader(uint8_t* out, const RtpHeader& header);
+// Skips CSRCs and a header extension and strips padding. False if the
+// packet is not RTP version 2 or is truncated.
+bool parseRtpHeader(const uint8_t* data, size_t size, RtpHeader& header, size_t& payloadOffset,
+                    size_t& payloadSize);
+
+// RTCP transport feedback, generic NACK (RFC 4585): the sequence numbers a
+// receiver is missing from one media SSRC, as PID + bitmask pairs
+constexpr uint8_t kRtcpTransportFeedback = 205;
+std::vector<uint8_t> buildRtcpNack(uint32_t senderSsrc, uint32_t mediaSsrc, const std::vector<uint16_t>& lost);
+bool parseRtcpNack(const uint8_t* data, size_t size, uint32_t& mediaSsrc, std::vector<uint16_t>& lost);
+
+enum class RtpPayloadFormat {
+    H264,       // RFC 6184 single NAL units and FU-A fragments, from an Annex B stream
+    Fragmented, // Opaque frames such as the in-tree codec: a 4-byte offset per packet, like RFC 2435
+    Audio       // One frame per packet, as Opus (RFC 7587)
+};
+
+class RtpPacketizer {
+public:
+    RtpPacketizer(RtpPayloadFormat format, uint8_t payloadType, uint32_t ssrc, size_t mtu = kRtpDefaultMtu);
+
+    // Writes one frame as packets into out[0, count), reusing the storage
+    // of existing elements (out never shrinks); the last packet carries the
+    // marker bit. Returns count, or 0 if the frame cannot be carried (audio
+    // over the MTU, an empty H.264 frame).
+    size_t packetize(const uint8_t* data, size_t size, uint32_t timestamp, std::vector<RtpPacketBuffer>& out);
+
+    uint16_t nextSequence() const { return sequence_; }
+    uint32_t ssrc() const { return ssrc_; }
+    size_t maxPayload() const { return maxPayload_; }
+
+private:
+    uint8_t* addPacket(std::vector<RtpPacketBuffer>& out, size_t& count, size_t payloadSize, uint32_t timestamp);
+    void packetizeNal(const uint8_t* nal, size_t size, uint32_t timestamp, std::vector<RtpPacketBuffer>& out,
+                      size_t& count);
+
+    RtpPayloadFormat format_;
+    uint8_t payloadType_;
+    uint32_t ssrc_;
+    size_t maxPayload_;
+    uint16_t sequence_;
+};
+
+struct RtpFrame {
+    uint32_t ssrc = 0;
+    uint32_t timestamp = 0;
+    bool complete = true; // False when packets inside the frame were lost
+    std::vector<uint8_t> data; // H.264 comes back as Annex B with 4-byte start codes
+};
+
+// Reassembles frames from payloads handed over in sequence order. A frame
+// ends at its marker bit, or when the timestamp changes because the marker
+// packet was lost.
+class RtpDepacketizer {
+public:
+    explicit RtpDepacketizer(RtpPayloadFormat format);
+
+    // Appends finished frames to frames
+    void push(const RtpHeader& header, const uint8_t* payload, size_t size, std::vector<RtpFrame>& frames);
+    // A sequence number was given up on
+    void markLoss();
+
+private:
+    void finish(std::vector<RtpFrame>& frames);
+
+    RtpPayloadFormat format_;
+    RtpFrame current_;
+    bool active_;
+    bool damaged_;
+    bool lossPending_; // A loss between frames damages the next one
+    bool inFragment_;  // Inside an H.264 FU-A run
+};
+
+// XOR parity in the SMPTE 2022-1 layout: media packets fill a matrix of
+// `columns` x `rows` row by row. A row parity packet covers `columns`
+// consecutive packets; a column parity packet covers every columns-th
+// packet over `rows` rows. Each repairs one loss in its group, so together
+// they repair a burst as long as a row.
+struct RtpFecConfig {
+    int columns = 0; // 0 turns FEC off
+    int rows = 0;    // 0: row parity only
+};
+
+// Parity packets carry this after their RTP header, then the XOR of the
+// protected packets (whole RTP packets, zero-padded to the longest)
+struct RtpFecHeader {
+    uint16_t baseSequence = 0;
+    uint8_t stride = 1;
+    uint8_t count = 0;
+    uint16_t lengthXor = 0;
+    uint32_t mediaSsrc = 0;
+};
+constexpr size_t kRtpFecHeaderSize = 12;
+
+bool parseRtpFecHeader(const uint8_t* data, size_t size, RtpFecHeader& header);
+
+class RtpFecEncoder {
+public:
+    RtpFecEncoder(const RtpFecConfig& config, uint8_t payloadType, uint32_t ssrc, uint32_t mediaSsrc);
+
+    bool enabled() const { return config_.columns > 0; }
+    // Adds the next media packet (consecutive sequence numbers) and writes
+    // the parity packets it completes into out[0, count), as packetize().
+    size_t protect(const RtpPacketBuffer& packet, uint16_t sequence, uint32_t timestamp,
+                   std::vector<RtpPacketBuffer>& out);
+
+private:
+    struct Parity {
+        std::vector<uint8_t> bits;
+        size_t length = 0;
+        uint16_t lengthXor = 0;
+        uint16_t baseSequence = 0;
+        int count = 0;
+    };
+
+    void add(Parity& parity, const RtpPacketBuffer& packet, uint16_t sequence);
+    void emit(Parity& parity, uint8_t stride, uint32_t timestamp, std::vector<RtpPacketBuffer>& out, size_t& count);
+
+    RtpFecConfig config_;
+    uint8_t payloadType_;
+    uint32_t ssrc_;
+    uint32_t mediaSsrc_;
+    uint16_t sequence_;
+    Parity row_;
+    std::vector<Parity> columns_;
+    int position_; // Within the matrix
+};
+
+// Rebuilds the one missing member of a parity group from the parity
+// payload (after the FEC header) and the other members
+bool recoverRtpFecPacket(const RtpFecHeader& header, const uint8_t* parity, size_t paritySize,
+                         const std::vector<std::pair<const uint8_t*, size_t>>& others, RtpPacketBuffer& out);
+
+#endif // RTP_PROTOCOL_H
@@ -0,0 +1,446 @@
+#include "RtpReceiver.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <netdb.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+
+namespace {
+
+// Reorder ring per stream; a gap wider than this is skipped at once
+constexpr uint64_t kRingPackets = 4096;
+constexpr size_t kMaxBatch = 256;
+constexpr size_t kMaxStreams = 16;
+constexpr size_t kMaxPendingFec = 512;
+// Extended sequence numbers start here so early reordering cannot underflow
+constexpr uint64_t kFirstIndex = 1ull << 32;
+constexpr uint32_t kReceiverSsrc = 1;
+
+} // namespace
+
+RtpReceiver::RtpReceiver(const RtpReceiverConfig& config)
+    : config_(config)
+    , socket_(-1)
+    , epoll_(-1)
+    , wakeFd_(-1)
+    , port_(0)
+    , stopRequested_(false)
+    , peerLength_(0)
+    , hasPeer_(false)
+    , rng_(config.seed)
+    , uniform_(0.0, 1.0) {
+    config_.batchPackets = std::min(std::max<size_t>(config_.batchPackets, 1), kMaxBatch);
+    config_.maxFrames = std::max<size_t>(config_.maxFrames, 1);
+}
+
+RtpReceiver::~RtpReceiver() {
+    stop();
+}
+
+bool RtpReceiver::start() {
+    if (thread_.joinable()) {
+        std::cerr << "RtpReceiver: already started" << std::endl;
+        return false;
+    }
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    hints.ai_flags = AI_PASSIVE;
+    addrinfo* addresses = nullptr;
+    if (getaddrinfo(config_.host.empty() ? nullptr : config_.host.c_str(), std::to_string(config_.port).c_str(),
+                    &hints, &addresses) != 0 || !addresses) {
+        std::cerr << "RtpReceiver: cannot resolve " << config_.host << std::endl;
+        return false;
+    }
+    socket_ = ::socket(addresses->ai_family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (socket_ >= 0) {
+        setsockopt(socket_, SOL_SOCKET, SO_RCVBUF, &config_.receiveBufferBytes, sizeof(config_.receiveBufferBytes));
+    }
+    int bound = socket_ >= 0 ? ::bind(socket_, addresses->ai_addr, addresses->ai_addrlen) : -1;
+    int bindError = errno;
+    freeaddrinfo(addresses);
+    if (bound < 0) {
+        std::cerr << "RtpReceiver: cannot bind " << config_.host << ":" << config_.port << ": "
+                  << std::strerror(bindError) << std::endl;
+        closeSockets();
+        return false;
+    }
+    sockaddr_storage local{};
+    socklen_t length = sizeof(local);
+    getsockname(socket_, reinterpret_cast<sockaddr*>(&local), &length);
+    port_ = ntohs(local.ss_family == AF_INET6 ? reinterpret_cast<sockaddr_in6*>(&local)->sin6_port
+                                              : reinterpret_cast<sockaddr_in*>(&local)->sin_port);
+
+    epoll_ = epoll_create1(EPOLL_CLOEXEC);
+    wakeFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    epoll_event socketEvent{};
+    socketEvent.events = EPOLLIN;
+    socketEvent.data.fd = socket_;
+    epoll_event wakeEvent{};
+    wakeEvent.events = EPOLLIN;
+    wakeEvent.data.fd = wakeFd_;
+    if (epoll_ < 0 || wakeFd_ < 0 || epoll_ctl(epoll_, EPOLL_CTL_ADD, socket_, &socketEvent) < 0 ||
+        epoll_ctl(epoll_, EPOLL_CTL_ADD, wakeFd_, &wakeEvent) < 0) {
+        std::cerr << "RtpReceiver: epoll setup failed: " << std::strerror(errno) << std::endl;
+        closeSockets();
+        return false;
+    }
+
+    streams_.clear();
+    fec_.clear();
+    buffers_.assign(config_.batchPackets, RtpPacketBuffer(kRtpMaxDatagram));
+    finished_.clear();
+    loopStats_ = RtpReceiverStats();
+    hasPeer_ = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        frames_.clear();
+        stats_ = RtpReceiverStats();
+    }
+    stopRequested_ = false;
+    thread_ = std::thread(&RtpReceiver::eventLoop, this);
+    return true;
+}
+
+void RtpReceiver::stop() {
+    if (thread_.joinable()) {
+        stopRequested_ = true;
+        wake();
+        thread_.join();
+    }
+    closeSockets();
+}
+
+bool RtpReceiver::getFrame(RtpFrame& frame, int timeoutMs) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (timeoutMs > 0) {
+        frameReady_.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this]() { return !frames_.empty(); });
+    }
+    if (frames_.empty()) return false;
+    frame = std::move(frames_.front());
+    frames_.pop_front();
+    return true;
+}
+
+RtpReceiverStats RtpReceiver::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void RtpReceiver::eventLoop() {
+    epoll_event events[4];
+    while (!stopRequested_) {
+        handleTimers(nowMs());
+        publish();
+
+        // Gaps need attention every millisecond: NACKs, parity and deadlines
+        int count = epoll_wait(epoll_, events, 4, anyMissing() ? 1 : -1);
+        if (count < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "RtpReceiver: epoll_wait failed: " << std::strerror(errno) << std::endl;
+            break;
+        }
+        for (int i = 0; i < count; ++i) {
+            if (events[i].data.fd == wakeFd_) {
+                uint64_t value;
+                ssize_t ignored = ::read(wakeFd_, &value, sizeof(value));
+                (void)ignored;
+            } else {
+                receiveBatch();
+            }
+        }
+    }
+    publish();
+}
+
+void RtpReceiver::receiveBatch() {
+    mmsghdr messages[kMaxBatch];
+    iovec slices[kMaxBatch];
+    sockaddr_storage sources[kMaxBatch];
+    const size_t batch = config_.batchPackets;
+
+    // Bounded, so timers still run under a flood
+    for (int round = 0; round < 16; ++round) {
+        for (size_t i = 0; i < batch; ++i) {
+            buffers_[i].resize(kRtpMaxDatagram);
+            slices[i].iov_base = buffers_[i].data();
+            slices[i].iov_len = buffers_[i].size();
+            messages[i] = mmsghdr{};
+            messages[i].msg_hdr.msg_iov = &slices[i];
+            messages[i].msg_hdr.msg_iovlen = 1;
+            messages[i].msg_hdr.msg_name = &sources[i];
+            messages[i].msg_hdr.msg_namelen = sizeof(sources[i]);
+        }
+        int received = recvmmsg(socket_, messages, (unsigned)batch, 0, nullptr);
+        loopStats_.receiveCalls++;
+        if (received <= 0) break;
+
+        double now = nowMs();
+        for (int i = 0; i < received; ++i) {
+            if (messages[i].msg_hdr.msg_flags & MSG_TRUNC) continue;
+            if (config_.injectedLossRate > 0.0 && uniform_(rng_) < config_.injectedLossRate) {
+                loopStats_.injectedDrops++;
+                continue;
+            }
+            buffers_[i].resize(messages[i].msg_len);
+            loopStats_.packetsReceived++;
+            loopStats_.bytesReceived += messages[i].msg_len;
+            std::memcpy(&peer_, &sources[i], messages[i].msg_hdr.msg_namelen);
+            peerLength_ = messages[i].msg_hdr.msg_namelen;
+            hasPeer_ = true;
+            handlePacket(buffers_[i], now);
+        }
+        if (!fec_.empty() && anyMissing()) recoverFromFec(now);
+        if ((size_t)received < batch) break;
+    }
+}
+
+void RtpReceiver::handlePacket(RtpPacketBuffer& packet, double nowMs) {
+    RtpHeader header;
+    size_t offset = 0, size = 0;
+    if (!parseRtpHeader(packet.data(), packet.size(), header, offset, size)) return;
+
+    if (header.payloadType == config_.fecPayloadType) {
+        PendingFec fec;
+        if (!parseRtpFecHeader(packet.data() + offset, size, fec.header)) return;
+        fec.bytes.assign(packet.data() + offset + kRtpFecHeaderSize, packet.data() + offset + size);
+        fec.arrivalMs = nowMs;
+        fec_.push_back(std::move(fec));
+        if (fec_.size() > kMaxPendingFec) fec_.pop_front();
+        return;
+    }
+    Stream* stream = streamFor(header.ssrc, header.payloadType);
+    if (!stream) return;
+    if (insert(*stream, extend(*stream, header.sequence), packet, nowMs)) release(*stream);
+}
+
+RtpReceiver::Stream* RtpReceiver::streamFor(uint32_t ssrc, uint8_t payloadType) {
+    auto it = streams_.find(ssrc);
+    if (it != streams_.end()) return it->second.get();
+    if (streams_.size() >= kMaxStreams) return nullptr;
+    RtpPayloadFormat format;
+    if (payloadType == config_.videoPayloadType) {
+        format = config_.videoFormat;
+    } else if (payloadType == config_.audioPayloadType) {
+        format = RtpPayloadFormat::Audio;
+    } else {
+        return nullptr;
+    }
+    std::unique_ptr<Stream> stream(new Stream(format));
+    stream->ssrc = ssrc;
+    stream->ring.resize(kRingPackets);
+    Stream* raw = stream.get();
+    streams_[ssrc] = std::move(stream);
+    return raw;
+}
+
+uint64_t RtpReceiver::extend(const Stream& stream, uint16_t sequence) const {
+    if (!stream.started) return kFirstIndex + sequence;
+    int16_t delta = (int16_t)(uint16_t)(sequence - (uint16_t)stream.highest);
+    return stream.highest + delta;
+}
+
+bool RtpReceiver::present(const Stream& stream, uint64_t index) const {
+    const Slot& slot = stream.ring[index % kRingPackets];
+    return slot.present && slot.index == index;
+}
+
+bool RtpReceiver::insert(Stream& stream, uint64_t index, RtpPacketBuffer& packet, double nowMs, bool recovered) {
+    if (!stream.started) {
+        stream.started = true;
+        stream.next = index;
+        stream.highest = index;
+    }
+    if (index < stream.next || present(stream, index)) {
+        loopStats_.duplicates++; // Or too late to matter
+        return false;
+    }
+    // The ring cannot hold a wider gap: give up on what is in the way
+    if (index >= stream.next + kRingPackets) skipTo(stream, index - kRingPackets + 1);
+
+    Slot& slot = stream.ring[index % kRingPackets];
+    std::swap(slot.bytes, packet);
+    slot.index = index;
+    slot.present = true;
+
+    if (index > stream.highest) {
+        for (uint64_t gap = std::max(stream.highest + 1, stream.next); gap < index; ++gap) {
+            stream.missing[gap] = Missing{nowMs, -1e9, 0};
+        }
+        stream.highest = index;
+    } else {
+        auto it = stream.missing.find(index);
+        if (it != stream.missing.end()) {
+            if (recovered) {
+                loopStats_.recoveredByFec++;
+            } else if (it->second.nacks > 0) {
+                loopStats_.recoveredByNack++;
+            } else {
+                loopStats_.reordered++;
+            }
+            stream.missing.erase(it);
+        }
+    }
+    return true;
+}
+
+void RtpReceiver::depacketize(Stream& stream, const Slot& slot) {
+    RtpHeader header;
+    size_t offset = 0, size = 0;
+    if (parseRtpHeader(slot.bytes.data(), slot.bytes.size(), header, offset, size)) {
+        stream.depacketizer.push(header, slot.bytes.data() + offset, size, finished_);
+    }
+}
+
+void RtpReceiver::release(Stream& stream) {
+    while (stream.next <= stream.highest && present(stream, stream.next)) {
+        depacketize(stream, stream.ring[stream.next % kRingPackets]);
+        stream.next++;
+    }
+}
+
+void RtpReceiver::skipTo(Stream& stream, uint64_t index) {
+    for (; stream.next < index; stream.next++) {
+        if (present(stream, stream.next)) {
+            depacketize(stream, stream.ring[stream.next % kRingPackets]);
+        } else {
+            loopStats_.lostPackets++;
+            stream.depacketizer.markLoss();
+        }
+    }
+    stream.missing.erase(stream.missing.begin(), stream.missing.lower_bound(index));
+}
+
+void RtpReceiver::recoverFromFec(double nowMs) {
+    std::vector<std::pair<const uint8_t*, size_t>> others;
+    // A repaired packet can complete another group, so repeat until stuck
+    bool progress = true;
+    while (progress) {
+        progress = false;
+        for (auto it = fec_.begin(); it != fec_.end();) {
+            auto found = streams_.find(it->header.mediaSsrc);
+            if (found == streams_.end() || !found->second->started) {
+                ++it;
+                continue;
+            }
+            Stream& stream = *found->second;
+            uint64_t base = extend(stream, it->header.baseSequence);
+            size_t missingCount = 0;
+            uint64_t missingIndex = 0;
+            others.clear();
+            for (uint64_t k = 0; k < it->header.count; ++k) {
+                uint64_t index = base + k * it->header.stride;
+                if (present(stream, index)) {
+                    const RtpPacketBuffer& bytes = stream.ring[index % kRingPackets].bytes;
+                    others.emplace_back(bytes.data(), bytes.size());
+                } else {
+                    missingCount++;
+                    missingIndex = index;
+                }
+            }
+            if (missingCount > 1) {
+                ++it; // Maybe later, once a resend or another group fills in
+                continue;
+            }
+            if (missingCount == 1 && missingIndex >= stream.next && missingIndex <= stream.highest &&
+                recoverRtpFecPacket(it->header, it->bytes.data(), it->bytes.size(), others, recovered_)) {
+                RtpHeader header;
+                size_t offset = 0, size = 0;
+                if (parseRtpHeader(recovered_.data(), recovered_.size(), header, offset, size) &&
+                    header.ssrc == stream.ssrc && header.sequence == (uint16_t)missingIndex &&
+                    insert(stream, missingIndex, recovered_, nowMs, true)) {
+                    release(stream);
+                    progress = true;
+                }
+            }
+            it = fec_.erase(it); // Used, or of no further use
+        }
+    }
+}
+
+void RtpReceiver::handleTimers(double nowMs) {
+    while (!fec_.empty() && nowMs - fec_.front().arrivalMs > 2 * config_.latencyMs) fec_.pop_front();
+
+    std::vector<uint16_t> nack;
+    for (auto& entry : streams_) {
+        Stream& stream = *entry.second;
+        nack.clear();
+        for (auto it = stream.missing.begin(); it != stream.missing.end();) {
+            uint64_t index = it->first;
+            Missing& missing = it->second;
+            if (index < stream.next) {
+                it = stream.missing.erase(it);
+                continue;
+            }
+            if (nowMs - missing.detectedMs >= config_.latencyMs) {
+                // It has held up everything behind it long enough
+                skipTo(stream, index + 1);
+                release(stream);
+                it = stream.missing.lower_bound(stream.next);
+                continue;
+            }
+            if (missing.nacks < config_.maxNacks && nowMs - missing.detectedMs >= config_.nackDelayMs &&
+                nowMs - missing.lastNackMs >= config_.nackIntervalMs) {
+                nack.push_back((uint16_t)index);
+                missing.nacks++;
+                missing.lastNackMs = nowMs;
+            }
+            ++it;
+        }
+        if (!nack.empty() && hasPeer_) {
+            std::vector<uint8_t> packet = buildRtcpNack(kReceiverSsrc, stream.ssrc, nack);
+            if (::sendto(socket_, packet.data(), packet.size(), 0, reinterpret_cast<sockaddr*>(&peer_),
+                         peerLength_) >= 0) {
+                loopStats_.nacksSent++;
+            }
+        }
+    }
+}
+
+bool RtpReceiver::anyMissing() const {
+    for (const auto& entry : streams_) {
+        if (!entry.second->missing.empty()) return true;
+    }
+    return false;
+}
+
+void RtpReceiver::publish() {
+    for (const RtpFrame& frame : finished_) (frame.complete ? loopStats_.framesComplete : loopStats_.framesIncomplete)++;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (RtpFrame& frame : finished_) frames_.push_back(std::move(frame));
+        while (frames_.size() > config_.maxFrames) {
+            frames_.pop_front();
+            loopStats_.droppedFrames++;
+        }
+        stats_ = loopStats_;
+    }
+    if (!finished_.empty()) frameReady_.notify_all();
+    finished_.clear();
+}
+
+void RtpReceiver::wake() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (wakeFd_ >= 0) {
+        uint64_t one = 1;
+        ssize_t ignored = ::write(wakeFd_, &one, sizeof(one));
+        (void)ignored;
+    }
+}
+
+void RtpReceiver::closeSockets() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (socket_ >= 0) ::close(socket_);
+    if (epoll_ >= 0) ::close(epoll_);
+    if (wakeFd_ >= 0) ::close(wakeFd_);
+    socket_ = epoll_ = wakeFd_ = -1;
+}
+
+double RtpReceiver::nowMs() const {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
@@ -0,0 +1,151 @@
+#ifndef RTP_RECEIVER_H
+#define RTP_RECEIVER_H
+
+#include "RtpProtocol.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <netinet/in.h>
+
+struct RtpReceiverConfig {
+    std::string host = "127.0.0.1"; // Local address to bind
+    int port = 0;                   // 0 picks a free port
+    RtpPayloadFormat videoFormat = RtpPayloadFormat::H264;
+    uint8_t videoPayloadType = 96;
+    uint8_t audioPayloadType = 111;
+    uint8_t fecPayloadType = 127;
+
+    double latencyMs = 60.0;     // Jitter buffer: how long a missing packet holds up the ones after it
+    double nackDelayMs = 2.0;    // Reordering allowance before asking for a resend
+    double nackIntervalMs = 15.0;
+    int maxNacks = 3;            // Per missing packet
+    size_t batchPackets = 64;    // Per recvmmsg()
+    size_t maxFrames = 512;      // Undelivered frames kept; the oldest go first
+    int receiveBufferBytes = 4 * 1024 * 1024;
+
+    // Testing aid: drop this share of arriving datagrams before any processing
+    double injectedLossRate = 0.0;
+    unsigned seed = 1;
+};
+
+struct RtpReceiverStats {
+    uint64_t packetsReceived = 0;
+    uint64_t bytesReceived = 0;
+    uint64_t receiveCalls = 0;      // recvmmsg() calls
+    uint64_t injectedDrops = 0;
+    uint64_t duplicates = 0;        // Including resends that arrived after FEC
+    uint64_t reordered = 0;         // Arrived after a later sequence number
+    uint64_t recoveredByFec = 0;
+    uint64_t recoveredByNack = 0;   // Missing packets that arrived after a NACK
+    uint64_t nacksSent = 0;
+    uint64_t lostPackets = 0;       // Given up on after latencyMs
+    uint64_t framesComplete = 0;
+    uint64_t framesIncomplete = 0;
+    uint64_t droppedFrames = 0;     // Output queue overflow
+};
+
+// Local RTP receiver matching RtpSender: recvmmsg() batches feed a
+// per-SSRC reorder ring that releases packets in sequence order. A gap is
+// NACKed after a short reordering allowance, repaired from XOR parity when
+// possible, and skipped once it has held the stream up for latencyMs.
+class RtpReceiver {
+public:
+    explicit RtpReceiver(const RtpReceiverConfig& config = RtpReceiverConfig());
+    ~RtpReceiver();
+
+    bool start();
+    void stop();
+    int port() const { return port_; }
+
+    // Waits up to timeoutMs for the next frame (complete or not)
+    bool getFrame(RtpFrame& frame, int timeoutMs = 0);
+    RtpReceiverStats getStats() const;
+
+private:
+    struct Slot {
+        RtpPacketBuffer bytes;
+        uint64_t index = 0; // Extended sequence number
+        bool present = false;
+    };
+    struct Missing {
+        double detectedMs;
+        double lastNackMs;
+        int nacks;
+    };
+    struct Stream {
+        explicit Stream(RtpPayloadFormat format) : depacketizer(format) {}
+
+        uint32_t ssrc = 0;
+        bool started = false;
+        uint64_t next = 0;    // Next index to release
+        uint64_t highest = 0;
+        std::vector<Slot> ring;
+        std::map<uint64_t, Missing> missing;
+        RtpDepacketizer depacketizer;
+    };
+    struct PendingFec {
+        RtpFecHeader header;
+        RtpPacketBuffer bytes; // Parity after the FEC header
+        double arrivalMs;
+    };
+
+    void eventLoop();
+    void receiveBatch();
+    void handlePacket(RtpPacketBuffer& packet, double nowMs);
+    // Stores a media packet; false if it is a duplicate or too late
+    bool insert(Stream& stream, uint64_t index, RtpPacketBuffer& packet, double nowMs, bool recovered = false);
+    // Hands packets to the depacketizer in order, up to the first gap
+    void release(Stream& stream);
+    // Moves the release point past index, counting what never came as lost
+    void skipTo(Stream& stream, uint64_t index);
+    void depacketize(Stream& stream, const Slot& slot);
+    void recoverFromFec(double nowMs);
+    void handleTimers(double nowMs);
+    bool present(const Stream& stream, uint64_t index) const;
+    uint64_t extend(const Stream& stream, uint16_t sequence) const;
+    Stream* streamFor(uint32_t ssrc, uint8_t payloadType);
+    bool anyMissing() const;
+    // Frames and stats to the consumer side, once per loop pass
+    void publish();
+    void wake();
+    void closeSockets();
+    double nowMs() const;
+
+    RtpReceiverConfig config_;
+    int socket_;
+    int epoll_;
+    int wakeFd_;
+    std::atomic<int> port_;
+    std::atomic<bool> stopRequested_;
+    std::thread thread_;
+
+    // Loop thread only
+    std::map<uint32_t, std::unique_ptr<Stream>> streams_;
+    std::deque<PendingFec> fec_;
+    std::vector<RtpPacketBuffer> buffers_;
+    RtpPacketBuffer recovered_;
+    std::vector<RtpFrame> finished_;
+    RtpReceiverStats loopStats_;
+    sockaddr_storage peer_;
+    socklen_t peerLength_;
+    bool hasPeer_;
+    std::mt19937 rng_;
+    std::uniform_real_distribution<double> uniform_;
+
+    // Consumer side; the wake fd is only written under this lock so stop()
+    // can close it safely
+    mutable std::mutex mutex_;
+    std::condition_variable frameReady_;
+    std::deque<RtpFrame> frames_;
+    RtpReceiverStats stats_;
+};
+
+#endif // RTP_RECEIVER_H
@@ -0,0 +1,425 @@
+#include "RtpSender.h"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <netdb.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+
+namespace {
+
+// Kernel limits for one GSO send
+constexpr size_t kMaxGsoSegments = 64;
+constexpr size_t kMaxGsoBytes = 65000;
+
+uint32_t randomSsrc() {
+    std::random_device device;
+    uint32_t ssrc = 0;
+    while (ssrc == 0) ssrc = device();
+    return ssrc;
+}
+
+uint16_t sequenceOf(const RtpPacketBuffer& packet) {
+    return (uint16_t)(packet[2] << 8 | packet[3]);
+}
+
+size_t roundUpPowerOfTwo(size_t value) {
+    size_t result = 1;
+    while (result < value) result <<= 1;
+    return result;
+}
+
+} // namespace
+
+RtpSender::RtpSender(const RtpSenderConfig& config)
+    : config_(config)
+    , videoSsrc_(config.videoSsrc ? config.videoSsrc : randomSsrc())
+    , audioSsrc_(config.audioSsrc ? config.audioSsrc : randomSsrc())
+    , socket_(-1)
+    , epoll_(-1)
+    , wakeFd_(-1)
+    , gso_(false)
+    , running_(false)
+    , stopRequested_(false)
+    , videoPacketizer_(config.videoFormat, config.videoPayloadType, videoSsrc_, config.mtu)
+    , audioPacketizer_(RtpPayloadFormat::Audio, config.audioPayloadType, audioSsrc_, config.mtu)
+    , fecEncoder_(config.fec, config.fecPayloadType, videoSsrc_ ^ 0x5A5A5A5A, videoSsrc_)
+    , credit_(0.0) {
+    config_.historyPackets = roundUpPowerOfTwo(std::max<size_t>(config_.historyPackets, 64));
+    // A queued packet must still be in the history when its turn comes
+    config_.maxQueuedPackets = std::min(std::max<size_t>(config_.maxQueuedPackets, 1), config_.historyPackets / 2);
+    config_.batchPackets = std::min<size_t>(std::max<size_t>(config_.batchPackets, 1), 1024);
+    for (auto& history : history_) history.resize(config_.historyPackets);
+    messages_.resize(config_.batchPackets);
+    slices_.resize(config_.batchPackets);
+    segments_.resize(config_.batchPackets);
+    messageBytes_.resize(config_.batchPackets);
+    segmentSize_.resize(config_.batchPackets);
+    control_.resize(config_.batchPackets * CMSG_SPACE(sizeof(uint16_t)));
+}
+
+RtpSender::~RtpSender() {
+    stop();
+}
+
+bool RtpSender::start() {
+    if (thread_.joinable()) {
+        std::cerr << "RtpSender: already started" << std::endl;
+        return false;
+    }
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    addrinfo* addresses = nullptr;
+    if (config_.port <= 0 || config_.port > 65535 ||
+        getaddrinfo(config_.host.c_str(), std::to_string(config_.port).c_str(), &hints, &addresses) != 0 ||
+        !addresses) {
+        std::cerr << "RtpSender: cannot resolve " << config_.host << ":" << config_.port << std::endl;
+        return false;
+    }
+    socket_ = ::socket(addresses->ai_family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    int connected = socket_ >= 0 ? ::connect(socket_, addresses->ai_addr, addresses->ai_addrlen) : -1;
+    int connectError = errno;
+    freeaddrinfo(addresses);
+    if (connected < 0) {
+        std::cerr << "RtpSender: cannot address " << config_.host << ":" << config_.port << ": "
+                  << std::strerror(connectError) << std::endl;
+        closeSockets();
+        return false;
+    }
+    setsockopt(socket_, SOL_SOCKET, SO_SNDBUF, &config_.sendBufferBytes, sizeof(config_.sendBufferBytes));
+
+    // Probe GSO support; segment sizes are then given per message
+    gso_ = false;
+    if (config_.useGso) {
+        int segment = (int)config_.mtu;
+        gso_ = setsockopt(socket_, SOL_UDP, UDP_SEGMENT, &segment, sizeof(segment)) == 0;
+        segment = 0;
+        if (gso_) setsockopt(socket_, SOL_UDP, UDP_SEGMENT, &segment, sizeof(segment));
+    }
+
+    epoll_ = epoll_create1(EPOLL_CLOEXEC);
+    wakeFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    epoll_event socketEvent{};
+    socketEvent.events = EPOLLIN;
+    socketEvent.data.fd = socket_;
+    epoll_event wakeEvent{};
+    wakeEvent.events = EPOLLIN;
+    wakeEvent.data.fd = wakeFd_;
+    if (epoll_ < 0 || wakeFd_ < 0 || epoll_ctl(epoll_, EPOLL_CTL_ADD, socket_, &socketEvent) < 0 ||
+        epoll_ctl(epoll_, EPOLL_CTL_ADD, wakeFd_, &wakeEvent) < 0) {
+        std::cerr << "RtpSender: epoll setup failed: " << std::strerror(errno) << std::endl;
+        closeSockets();
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.clear();
+        stats_ = RtpSenderStats();
+        stats_.gsoActive = gso_;
+    }
+    credit_ = 0.0;
+    lastRefill_ = std::chrono::steady_clock::now();
+    stopRequested_ = false;
+    running_ = true;
+    thread_ = std::thread(&RtpSender::eventLoop, this);
+    std::cout << "RTP sending to " << config_.host << ":" << config_.port << " (video SSRC " << videoSsrc_
+              << (gso_ ? ", GSO" : "") << ")" << std::endl;
+    return true;
+}
+
+void RtpSender::stop() {
+    if (!thread_.joinable()) {
+        closeSockets();
+        return;
+    }
+    stopRequested_ = true;
+    wake();
+    thread_.join();
+    running_ = false;
+    closeSockets();
+    std::lock_guard<std::mutex> lock(mutex_);
+    queue_.clear();
+}
+
+bool RtpSender::sendVideo(const uint8_t* data, size_t size, uint32_t timestamp) {
+    if (!running_ || stopRequested_) return false;
+    bool queued;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queued = queueFrame(Video, videoPacketizer_, data, size, timestamp);
+    }
+    if (queued) wake();
+    return queued;
+}
+
+bool RtpSender::sendAudio(const uint8_t* data, size_t size, uint32_t timestamp) {
+    if (!running_ || stopRequested_) return false;
+    bool queued;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queued = queueFrame(Audio, audioPacketizer_, data, size, timestamp);
+    }
+    if (queued) wake();
+    return queued;
+}
+
+bool RtpSender::queueFrame(Stream stream, RtpPacketizer& packetizer, const uint8_t* data, size_t size,
+                           uint32_t timestamp) {
+    // Checked before packetizing, so a refused frame leaves no sequence gap
+    if (queue_.size() >= config_.maxQueuedPackets) {
+        stats_.droppedFrames++;
+        return false;
+    }
+    size_t count = packetizer.packetize(data, size, timestamp, scratch_);
+    if (count == 0) return false;
+    bool protect = stream == Video && fecEncoder_.enabled();
+    for (size_t i = 0; i < count; ++i) {
+        uint16_t sequence = sequenceOf(scratch_[i]);
+        size_t parity = protect ? fecEncoder_.protect(scratch_[i], sequence, timestamp, parity_) : 0;
+        storeAndQueue(stream, scratch_[i], sequence);
+        for (size_t j = 0; j < parity; ++j) storeAndQueue(Fec, parity_[j], sequenceOf(parity_[j]));
+        stats_.fecPackets += parity;
+    }
+    stats_.framesSent++;
+    return true;
+}
+
+void RtpSender::storeAndQueue(Stream stream, RtpPacketBuffer& packet, uint16_t sequence) {
+    // The old slot's buffer goes back to the caller for reuse
+    Slot& slot = history_[stream][sequence & (config_.historyPackets - 1)];
+    std::swap(slot.bytes, packet);
+    slot.sequence = sequence;
+    slot.valid = true;
+    queue_.push_back({stream, sequence});
+}
+
+int RtpSender::localPort() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sockaddr_storage address{};
+    socklen_t length = sizeof(address);
+    if (socket_ < 0 || getsockname(socket_, reinterpret_cast<sockaddr*>(&address), &length) < 0) return -1;
+    if (address.ss_family == AF_INET6) return ntohs(reinterpret_cast<sockaddr_in6*>(&address)->sin6_port);
+    return ntohs(reinterpret_cast<sockaddr_in*>(&address)->sin_port);
+}
+
+RtpSenderStats RtpSender::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    RtpSenderStats stats = stats_;
+    stats.queuedPackets = queue_.size();
+    return stats;
+}
+
+void RtpSender::wake() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (wakeFd_ >= 0) {
+        uint64_t one = 1;
+        ssize_t ignored = ::write(wakeFd_, &one, sizeof(one));
+        (void)ignored;
+    }
+}
+
+void RtpSender::eventLoop() {
+    epoll_event events[4];
+    bool writeInterest = false;
+    auto drainDeadline = std::chrono::steady_clock::time_point::max();
+    for (;;) {
+        double waitMs = -1.0;
+        bool full = !sendBatch(waitMs);
+        if (full != writeInterest) {
+            epoll_event event{};
+            event.events = (uint32_t)EPOLLIN | (full ? (uint32_t)EPOLLOUT : 0u);
+            event.data.fd = socket_;
+            if (epoll_ctl(epoll_, EPOLL_CTL_MOD, socket_, &event) == 0) writeInterest = full;
+        }
+
+        int timeout = -1;
+        if (!full && waitMs >= 0.0) timeout = (int)std::ceil(waitMs);
+        if (stopRequested_) {
+            if (drainDeadline == std::chrono::steady_clock::time_point::max()) {
+                drainDeadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+            }
+            if ((!full && waitMs < 0.0) || std::chrono::steady_clock::now() >= drainDeadline) break;
+            if (timeout < 0 || timeout > 50) timeout = 50;
+        }
+
+        int count = epoll_wait(epoll_, events, 4, timeout);
+        if (count < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "RtpSender: epoll_wait failed: " << std::strerror(errno) << std::endl;
+            break;
+        }
+        for (int i = 0; i < count; ++i) {
+            if (events[i].data.fd == wakeFd_) {
+                uint64_t value;
+                ssize_t ignored = ::read(wakeFd_, &value, sizeof(value));
+                (void)ignored;
+            } else if (events[i].events & EPOLLIN) {
+                handleFeedback();
+            }
+        }
+    }
+}
+
+bool RtpSender::sendBatch(double& waitMs) {
+    const size_t batch = config_.batchPackets;
+    const size_t controlSize = CMSG_SPACE(sizeof(uint16_t));
+    std::vector<mmsghdr>& messages = messages_;
+    std::vector<iovec>& slices = slices_;
+    std::vector<size_t>& segments = segments_;
+    std::vector<size_t>& messageBytes = messageBytes_;
+    std::vector<uint16_t>& segmentSize = segmentSize_;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    const double bytesPerMs = config_.pacingKbps / 8.0;
+    if (bytesPerMs > 0.0) {
+        auto now = std::chrono::steady_clock::now();
+        credit_ += bytesPerMs * std::chrono::duration<double, std::milli>(now - lastRefill_).count();
+        credit_ = std::min(credit_, std::max(bytesPerMs * config_.pacingBurstMs, (double)config_.mtu));
+        lastRefill_ = now;
+    }
+
+    // Consecutive packets of one size (the last may be shorter) share a
+    // message and the kernel splits them again
+    size_t messageCount = 0;
+    size_t sliceCount = 0;
+    bool groupOpen = false;
+    double credit = credit_;
+    waitMs = -1.0;
+    auto next = queue_.begin();
+    while (next != queue_.end() && sliceCount < batch) {
+        const Slot& slot = history_[next->stream][next->sequence & (config_.historyPackets - 1)];
+        if (!slot.valid || slot.sequence != next->sequence) {
+            next = queue_.erase(next); // Overwritten by a newer packet
+            continue;
+        }
+        size_t size = slot.bytes.size();
+        if (bytesPerMs > 0.0 && credit < (double)size) {
+            waitMs = std::max(((double)size - credit) / bytesPerMs, 0.5);
+            break;
+        }
+        credit -= bytesPerMs > 0.0 ? (double)size : 0.0;
+        slices[sliceCount].iov_base = const_cast<uint8_t*>(slot.bytes.data());
+        slices[sliceCount].iov_len = size;
+
+        size_t m = messageCount - 1;
+        if (gso_ && groupOpen && segments[m] < kMaxGsoSegments && messageBytes[m] + size <= kMaxGsoBytes &&
+            size <= segmentSize[m]) {
+            segments[m]++;
+            messageBytes[m] += size;
+            messages[m].msg_hdr.msg_iovlen++;
+            groupOpen = size == segmentSize[m];
+        } else {
+            m = messageCount++;
+            messages[m] = mmsghdr{};
+            messages[m].msg_hdr.msg_iov = &slices[sliceCount];
+            messages[m].msg_hdr.msg_iovlen = 1;
+            segments[m] = 1;
+            messageBytes[m] = size;
+            segmentSize[m] = (uint16_t)size;
+            groupOpen = true;
+        }
+        sliceCount++;
+        ++next;
+    }
+    if (messageCount == 0) return true;
+    if (waitMs < 0.0 && next != queue_.end()) waitMs = 0.0;
+
+    for (size_t m = 0; m < messageCount; ++m) {
+        if (segments[m] < 2) continue;
+        msghdr& header = messages[m].msg_hdr;
+        header.msg_control = &control_[m * controlSize];
+        header.msg_controllen = controlSize;
+        cmsghdr* cmsg = CMSG_FIRSTHDR(&header);
+        cmsg->cmsg_level = SOL_UDP;
+        cmsg->cmsg_type = UDP_SEGMENT;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+        std::memcpy(CMSG_DATA(cmsg), &segmentSize[m], sizeof(uint16_t));
+    }
+
+    int sent = sendmmsg(socket_, messages.data(), (unsigned)messageCount, 0);
+    stats_.sendCalls++;
+    if (sent < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) return false;
+        if (errno == EINTR) {
+            waitMs = 0.0;
+            return true;
+        }
+        if (gso_ && (errno == EIO || errno == EINVAL || errno == EOPNOTSUPP)) {
+            std::cerr << "RtpSender: GSO rejected (" << std::strerror(errno) << "), sending unsegmented"
+                      << std::endl;
+            gso_ = false;
+            stats_.gsoActive = false;
+            waitMs = 0.0;
+            return true;
+        }
+        // Nobody listening yet (ICMP port unreachable) and the like: the
+        // batch is lost, as it would be on the network
+        sent = (int)messageCount;
+    }
+
+    size_t sentSegments = 0;
+    for (int m = 0; m < sent; ++m) {
+        sentSegments += segments[m];
+        stats_.bytesSent += messageBytes[m];
+        if (segments[m] > 1) stats_.gsoMessages++;
+        if (bytesPerMs > 0.0) credit_ -= (double)messageBytes[m];
+    }
+    stats_.packetsSent += sentSegments;
+    queue_.erase(queue_.begin(), queue_.begin() + sentSegments);
+    if ((size_t)sent < messageCount) return false;
+    if (waitMs < 0.0 && !queue_.empty()) waitMs = 0.0;
+    return true;
+}
+
+void RtpSender::handleFeedback() {
+    uint8_t buffer[1500];
+    std::vector<uint16_t> lost;
+    for (;;) {
+        ssize_t n = ::recv(socket_, buffer, sizeof(buffer), 0);
+        if (n < 0) {
+            if (errno == EINTR || errno == ECONNREFUSED) continue;
+            break;
+        }
+        uint32_t mediaSsrc = 0;
+        lost.clear();
+        if (!parseRtcpNack(buffer, (size_t)n, mediaSsrc, lost)) continue;
+        Stream stream = mediaSsrc == videoSsrc_ ? Video : mediaSsrc == audioSsrc_ ? Audio : StreamCount;
+        if (stream == StreamCount) continue;
+
+        // Resends go ahead of new media, oldest first
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.nacksReceived++;
+        std::vector<Queued> resend;
+        for (uint16_t sequence : lost) {
+            const Slot& slot = history_[stream][sequence & (config_.historyPackets - 1)];
+            if (slot.valid && slot.sequence == sequence) {
+                resend.push_back({stream, sequence});
+                stats_.retransmitted++;
+            } else {
+                stats_.retransmitMisses++;
+            }
+        }
+        queue_.insert(queue_.begin(), resend.begin(), resend.end());
+    }
+}
+
+void RtpSender::closeSockets() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (socket_ >= 0) ::close(socket_);
+    if (epoll_ >= 0) ::close(epoll_);
+    if (wakeFd_ >= 0) ::close(wakeFd_);
+    socket_ = epoll_ = wakeFd_ = -1;
+}
@@ -0,0 +1,132 @@
+#ifndef RTP_SENDER_H
+#define RTP_SENDER_H
+
+#include "RtpProtocol.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+
+struct RtpSenderConfig {
+    std::string host = "127.0.0.1";
+    int port = 0;
+    size_t mtu = kRtpDefaultMtu;
+    RtpPayloadFormat videoFormat = RtpPayloadFormat::H264;
+    uint8_t videoPayloadType = 96;
+    uint8_t audioPayloadType = 111;
+    uint8_t fecPayloadType = 127;
+    uint32_t videoSsrc = 0; // 0 picks a random SSRC
+    uint32_t audioSsrc = 0;
+
+    double pacingKbps = 0.0;      // 0 sends as fast as the socket takes packets
+    double pacingBurstMs = 2.0;   // Credit a paced sender may spend at once
+    size_t batchPackets = 64;     // Packets per sendmmsg()
+    bool useGso = true;           // UDP_SEGMENT, where the kernel supports it
+    RtpFecConfig fec;             // Video only
+    size_t historyPackets = 4096; // Per stream, kept for NACKed resends; power of two
+    size_t maxQueuedPackets = 2048;
+    int sendBufferBytes = 4 * 1024 * 1024;
+};
+
+struct RtpSenderStats {
+    uint64_t framesSent = 0;
+    uint64_t packetsSent = 0;   // Media, parity and resends
+    uint64_t bytesSent = 0;
+    uint64_t sendCalls = 0;     // sendmmsg() calls
+    uint64_t gsoMessages = 0;   // Messages the kernel segmented
+    uint64_t fecPackets = 0;
+    uint64_t nacksReceived = 0;
+    uint64_t retransmitted = 0;
+    uint64_t retransmitMisses = 0; // NACKed packets no longer in the history
+    uint64_t droppedFrames = 0;    // Queue full
+    size_t queuedPackets = 0;
+    bool gsoActive = false;
+};
+
+// RTP over UDP for low-latency contribution links. send*() packetizes into
+// per-stream history rings and queues sequence numbers; one thread paces
+// the queue out in sendmmsg() batches (grouping equal-size runs with GSO),
+// adds XOR parity for video, and answers RTCP NACKs from the history.
+class RtpSender {
+public:
+    explicit RtpSender(const RtpSenderConfig& config = RtpSenderConfig());
+    ~RtpSender();
+
+    bool start();
+    // Sends what is queued, then closes the socket
+    void stop();
+    bool isRunning() const { return running_; }
+
+    // Timestamps are in RTP clock units (90 kHz video, 48 kHz audio).
+    // False when the frame cannot be packetized or the queue is full.
+    bool sendVideo(const uint8_t* data, size_t size, uint32_t timestamp);
+    bool sendAudio(const uint8_t* data, size_t size, uint32_t timestamp);
+
+    uint32_t videoSsrc() const { return videoSsrc_; }
+    uint32_t audioSsrc() const { return audioSsrc_; }
+    int localPort() const;
+    RtpSenderStats getStats() const;
+
+private:
+    enum Stream : uint8_t { Video, Audio, Fec, StreamCount };
+
+    struct Slot {
+        RtpPacketBuffer bytes;
+        uint16_t sequence = 0;
+        bool valid = false;
+    };
+    struct Queued {
+        Stream stream;
+        uint16_t sequence;
+    };
+
+    bool queueFrame(Stream stream, RtpPacketizer& packetizer, const uint8_t* data, size_t size, uint32_t timestamp);
+    void storeAndQueue(Stream stream, RtpPacketBuffer& packet, uint16_t sequence);
+    void eventLoop();
+    // Sends one batch under the pacing budget; false when the socket is full
+    bool sendBatch(double& waitMs);
+    void handleFeedback();
+    void wake();
+    void closeSockets();
+
+    RtpSenderConfig config_;
+    uint32_t videoSsrc_;
+    uint32_t audioSsrc_;
+
+    int socket_;
+    int epoll_;
+    int wakeFd_;
+    bool gso_;
+    std::atomic<bool> running_;
+    std::atomic<bool> stopRequested_;
+    std::thread thread_;
+
+    // Packetizers, history and queue; held across each sendmmsg() so ring
+    // slots cannot be reused while the kernel reads them (UDP sends do not block)
+    mutable std::mutex mutex_;
+    RtpPacketizer videoPacketizer_;
+    RtpPacketizer audioPacketizer_;
+    RtpFecEncoder fecEncoder_;
+    std::vector<RtpPacketBuffer> scratch_;
+    std::vector<RtpPacketBuffer> parity_;
+    std::vector<Slot> history_[StreamCount];
+    std::deque<Queued> queue_;
+    RtpSenderStats stats_;
+
+    // Loop thread only
+    double credit_; // Bytes the pacer may send now
+    std::chrono::steady_clock::time_point lastRefill_;
+    std::vector<mmsghdr> messages_;
+    std::vector<iovec> slices_;
+    std::vector<size_t> segments_;
+    std::vector<size_t> messageBytes_;
+    std::vector<uint16_t> segmentSize_;
+    std::vector<uint8_t> control_;
+};
+
+#endif // RTP_SENDER_H
@@ -1,7 +1,14 @@
 #include "StreamController.h"
+#include <algorithm>
+#include <chrono>
 #include <iostream>
+#include <thread>
 
-StreamController::StreamController() : currentState_(State::IDLE) {
+StreamController::StreamController()
+    : currentState_(State::IDLE)
+    , gopCache_(std::make_shared<GopCache>(8 * 1024 * 1024))
+    , dropNonReference_(false)
+    , droppedNonReference_(0) {
 }
 
 StreamController::~StreamController() {
@@ -9,31 +16,235 @@ StreamController::~StreamController() {
 }
 
 bool StreamController::startStreaming(const std::string& url) {
-    if (currentState_ == State::STREAMING) {
+    StreamOutputConfig output;
+    output.url = url;
+    output.publisher = publisherConfig_;
+    return startStreaming(std::vector<StreamOutputConfig>{output});
+}
+
+bool StreamController::startStreaming(const std::vector<StreamOutputConfig>& outputs) {
+    if (currentState_ == State::STREAMING || currentState_ == State::RECOVERING) {
         std::cout << "Already streaming." << std::endl;
         return false;
     }
+    if (outputs.empty()) {
+        std::cerr << "No stream outputs given." << std::endl;
+        return false;
+    }
 
-    std::cout << "Initializing stream to " << url << "..." << std::endl;
     currentState_ = State::INITIALIZING;
-    currentUrl_ = url;
+    gopCache_->clear();
+    std::vector<std::shared_ptr<StreamOutput>> started;
+    for (const StreamOutputConfig& config : outputs) {
+        std::cout << "Initializing stream to " << config.url << "..." << std::endl;
+        started.push_back(std::make_shared<StreamOutput>(config, gopCache_));
+    }
+    {
+        std::lock_guard<std::mutex> lock(outputsMutex_);
+        outputs_ = started;
+    }
+
+    // Connect in parallel so one slow endpoint does not hold up the rest
+    std::vector<char> connected(started.size(), 0);
+    std::vector<std::thread> starters;
+    for (size_t i = 0; i < started.size(); ++i) {
+        starters.emplace_back([&started, &connected, i]() { connected[i] = started[i]->start(); });
+    }
+    for (std::thread& starter : starters) starter.join();
 
-    // Simulate connection logic
-    // In real implementation, this would initialize WebRTC/RTMP streamers
+    size_t live = 0;
+    for (size_t i = 0; i < started.size(); ++i) {
+        if (connected[i]) {
+            live++;
+        } else {
+            std::cerr << "Failed to start streaming to " << started[i]->url() << std::endl;
+        }
+    }
+    if (live == 0) {
+        {
+            std::lock_guard<std::mutex> lock(outputsMutex_);
+            outputs_.clear();
+        }
+        for (auto& output : started) output->stop();
+        currentState_ = State::ERROR;
+        return false;
+    }
     
+    BitrateDecision decision;
+    std::function<void(const BitrateDecision&)> control;
+    {
+        std::lock_guard<std::mutex> lock(controlMutex_);
+        bitrateController_.reset();
+        decision = bitrateController_.decision();
+        control = encoderControl_;
+    }
+    dropNonReference_ = false;
+    droppedNonReference_ = 0;
+    if (control) control(decision);
+
     currentState_ = State::STREAMING;
-    std::cout << "Streaming started." << std::endl;
+    std::cout << "Streaming started to " << live << " of " << started.size() << " outputs." << std::endl;
+    return true;
+}
+
+bool StreamController::addOutput(const StreamOutputConfig& config) {
+    if (currentState_ != State::STREAMING && currentState_ != State::RECOVERING) {
+        std::cerr << "Cannot add " << config.url << ": not streaming." << std::endl;
+        return false;
+    }
+    // Listed before it connects, so every packet reaches it through either
+    // the cache replay or delivery
+    auto output = std::make_shared<StreamOutput>(config, gopCache_);
+    {
+        std::lock_guard<std::mutex> lock(outputsMutex_);
+        outputs_.push_back(output);
+    }
+    std::cout << "Adding stream output " << config.url << "..." << std::endl;
+    if (!output->start()) {
+        std::cerr << "Failed to start streaming to " << config.url << std::endl;
+        return false;
+    }
     return true;
 }
 
+void StreamController::setPublisherConfig(const RtmpPublisherConfig& config) {
+    publisherConfig_ = config;
+}
+
+void StreamController::setBitrateControllerConfig(const BitrateControllerConfig& config) {
+    std::lock_guard<std::mutex> lock(controlMutex_);
+    bitrateController_ = BitrateController(config);
+}
+
+void StreamController::setGopCacheBytes(size_t maxBytes) {
+    gopCache_->setMaxBytes(maxBytes);
+}
+
+void StreamController::setReplayBuffer(std::shared_ptr<ReplayBuffer> buffer) {
+    std::lock_guard<std::mutex> lock(outputsMutex_);
+    replayBuffer_ = std::move(buffer);
+}
+
+void StreamController::addRecording(std::shared_ptr<RecordingSink> sink) {
+    if (!sink) return;
+    // Under the cache lock, so the sink gets each packet exactly once
+    gopCache_->replay([&](const std::vector<const GopPacket*>& headers, const std::vector<GopPacket>& gop) {
+        for (const GopPacket* header : headers) record(*sink, *header);
+        for (const GopPacket& packet : gop) record(*sink, packet);
+        std::lock_guard<std::mutex> lock(outputsMutex_);
+        recordings_.push_back(std::move(sink));
+    });
+}
+
+void StreamController::removeRecording(const std::shared_ptr<RecordingSink>& sink) {
+    std::lock_guard<std::mutex> lock(outputsMutex_);
+    recordings_.erase(std::remove(recordings_.begin(), recordings_.end(), sink), recordings_.end());
+}
+
+void StreamController::setEncoderControl(std::function<void(const BitrateDecision&)> control) {
+    std::lock_guard<std::mutex> lock(controlMutex_);
+    encoderControl_ = std::move(control);
+}
+
+bool StreamController::sendVideo(uint32_t timestampMs, bool keyframe, RtmpPublisher::Payload payload,
+                                 uint8_t codecId, bool sequenceHeader, int32_t compositionMs, bool nonReference) {
+    if (currentState_ != State::STREAMING && currentState_ != State::RECOVERING) return false;
+    if (nonReference && !keyframe && !sequenceHeader && dropNonReference_) {
+        droppedNonReference_++;
+        return false;
+    }
+    GopPacket packet;
+    packet.timestampMs = timestampMs;
+    packet.keyframe = keyframe;
+    packet.payload = std::move(payload);
+    packet.format = codecId;
+    packet.sequenceHeader = sequenceHeader;
+    packet.compositionMs = compositionMs;
+    return send(packet);
+}
+
+bool StreamController::sendAudio(uint32_t timestampMs, RtmpPublisher::Payload payload, uint8_t soundFormat,
+                                 bool sequenceHeader) {
+    if (currentState_ != State::STREAMING && currentState_ != State::RECOVERING) return false;
+    GopPacket packet;
+    packet.video = false;
+    packet.timestampMs = timestampMs;
+    packet.payload = std::move(payload);
+    packet.format = soundFormat;
+    packet.sequenceHeader = sequenceHeader;
+    return send(packet);
+}
+
+bool StreamController::send(const GopPacket& packet) {
+    bool queued = false;
+    gopCache_->add(packet, [&](const GopPacket& added) {
+        std::lock_guard<std::mutex> lock(outputsMutex_);
+        for (auto& output : outputs_) queued |= output->send(added);
+        if (replayBuffer_ && added.payload) {
+            const std::vector<uint8_t>& bytes = *added.payload;
+            if (added.video) {
+                replayBuffer_->addVideo(added.timestampMs, added.keyframe, bytes.data(), bytes.size(), added.format,
+                                        added.sequenceHeader, added.compositionMs);
+            } else {
+                replayBuffer_->addAudio(added.timestampMs, bytes.data(), bytes.size(), added.format,
+                                        added.sequenceHeader);
+            }
+        }
+        for (auto& recording : recordings_) record(*recording, added);
+    });
+    return queued;
+}
+
+void StreamController::record(RecordingSink& sink, const GopPacket& packet) {
+    if (!packet.payload) return;
+    const std::vector<uint8_t>& bytes = *packet.payload;
+    if (packet.video) {
+        sink.addVideo(packet.timestampMs, packet.keyframe, bytes.data(), bytes.size(), packet.format,
+                      packet.sequenceHeader, packet.compositionMs);
+    } else {
+        sink.addAudio(packet.timestampMs, bytes.data(), bytes.size(), packet.format, packet.sequenceHeader);
+    }
+}
+
+std::shared_ptr<StreamOutput> StreamController::primaryOutput() const {
+    std::lock_guard<std::mutex> lock(outputsMutex_);
+    return outputs_.empty() ? nullptr : outputs_[0];
+}
+
+RtmpPublisherStats StreamController::getPublisherStats() const {
+    std::shared_ptr<StreamOutput> primary = primaryOutput();
+    return primary ? primary->getStatus().publisher : RtmpPublisherStats();
+}
+
+std::vector<StreamOutputStatus> StreamController::getOutputStatus() const {
+    std::lock_guard<std::mutex> lock(outputsMutex_);
+    std::vector<StreamOutputStatus> status;
+    for (const auto& output : outputs_) status.push_back(output->getStatus());
+    return status;
+}
+
+BitrateDecision StreamController::getBitrateDecision() const {
+    std::lock_guard<std::mutex> lock(controlMutex_);
+    return bitrateController_.decision();
+}
+
+BitrateControllerStats StreamController::getBitrateControllerStats() const {
+    std::lock_guard<std::mutex> lock(controlMutex_);
+    return bitrateController_.getStats();
+}
+
 void StreamController::stopStreaming() {
     if (currentState_ == State::IDLE) return;
 
     std::cout << "Stopping stream..." << std::endl;
-    // Teardown logic here
+    std::vector<std::shared_ptr<StreamOutput>> outputs;
+    {
+        std::lock_guard<std::mutex> lock(outputsMutex_);
+        outputs.swap(outputs_);
+    }
+    for (auto& output : outputs) output->stop();
     
     currentState_ = State::IDLE;
-    currentUrl_.clear();
     std::cout << "Stream stopped." << std::endl;
 }
 
@@ -42,10 +253,64 @@ StreamController::State StreamController::getState() const {
 }
 
 void StreamController::updateNetworkStats() {
-    // Logic to check bitrate, packet loss, etc.
-    // If stats are bad -> trigger State::RECOVERING or adjust bitrate
-    if (currentState_ == State::STREAMING) {
-        // Mock check
-        // std::cout << "Network stats updated." << std::endl;
+    State state = currentState_;
+    if (state != State::STREAMING && state != State::RECOVERING) return;
+    std::vector<std::shared_ptr<StreamOutput>> outputs;
+    {
+        std::lock_guard<std::mutex> lock(outputsMutex_);
+        outputs = outputs_;
+    }
+    if (outputs.empty()) return;
+    bool anyLeft = false;
+    for (const auto& output : outputs) anyLeft |= !output->hasFailed();
+    if (!anyLeft) {
+        std::cerr << "Stream connection lost." << std::endl;
+        currentState_ = State::ERROR;
+        return;
+    }
+    // Nothing to measure while the first output reconnects
+    StreamOutputStatus primary = outputs[0]->getStatus();
+    if (!primary.connected) {
+        if (state == State::STREAMING) {
+            std::cerr << "Connection to " << primary.url << " lost, reconnecting." << std::endl;
+            currentState_ = State::RECOVERING;
+        }
+        return;
+    }
+
+    // Everything handed to the publisher counts as queued until the peer
+    // has acknowledged it, whether it is still ours or in the kernel
+    const RtmpPublisherStats& stats = primary.publisher;
+    NetworkSample sample;
+    sample.timeMs = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    sample.queuedBytes = stats.queuedBytes + stats.socketQueuedBytes;
+    sample.sentBytes = stats.bytesSent - std::min<uint64_t>(stats.bytesSent, stats.socketQueuedBytes);
+    sample.rttMs = stats.rttMs;
+
+    BitrateDecision decision;
+    bool changed;
+    std::function<void(const BitrateDecision&)> control;
+    {
+        std::lock_guard<std::mutex> lock(controlMutex_);
+        changed = bitrateController_.update(sample);
+        decision = bitrateController_.decision();
+        control = encoderControl_;
+    }
+    dropNonReference_ = decision.dropNonReference;
+
+    // The state follows the decision, not only its changes: after a plain
+    // reconnect on a healthy link the decision has no reason to change
+    if (decision.recovering && state == State::STREAMING) {
+        std::cerr << "Network congested, recovering at " << decision.targetKbps << " kbps." << std::endl;
+        currentState_ = State::RECOVERING;
+    } else if (!decision.recovering && state == State::RECOVERING) {
+        if (changed) {
+            std::cout << "Network recovered, streaming at " << decision.targetKbps << " kbps." << std::endl;
+        } else {
+            std::cout << "Reconnected to " << primary.url << "." << std::endl;
+        }
+        currentState_ = State::STREAMING;
     }
+    if (changed && control) control(decision);
 }
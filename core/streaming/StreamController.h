@@ -1,8 +1,18 @@
 #ifndef STREAM_CONTROLLER_H
 #define STREAM_CONTROLLER_H
 
+#include "RtmpPublisher.h"
+#include "StreamOutput.h"
+#include "GopCache.h"
+#include "ReplayBuffer.h"
+#include "RecordingSink.h"
+#include "BitrateController.h"
 #include <string>
 #include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 class StreamController {
 public:
@@ -17,15 +27,81 @@ public:
     StreamController();
     ~StreamController();
 
+    // Applies to the next startStreaming()
+    void setPublisherConfig(const RtmpPublisherConfig& config);
+    void setBitrateControllerConfig(const BitrateControllerConfig& config);
+    // Packets since the last keyframe kept for outputs that (re)connect;
+    // 0 keeps only the sequence headers
+    void setGopCacheBytes(size_t maxBytes);
+    // Every packet sent is also copied into buffer, for instant-replay
+    // clips; nullptr stops
+    void setReplayBuffer(std::shared_ptr<ReplayBuffer> buffer);
+    // Every packet sent is also recorded by sink, starting with the cached
+    // sequence headers and GOP. The sink's drop policy decides whether a
+    // slow disk can hold up the stream.
+    void addRecording(std::shared_ptr<RecordingSink> sink);
+    void removeRecording(const std::shared_ptr<RecordingSink>& sink);
+    // Called with each new bitrate/frame rate/resolution decision, including
+    // the initial one when streaming starts
+    void setEncoderControl(std::function<void(const BitrateDecision&)> control);
+
+    // Publishes to an rtmp:// URL; blocks until the server accepts or refuses
     bool startStreaming(const std::string& url);
+    // Publishes one encode to every output at once. Succeeds if any output
+    // connected; the rest keep retrying on their own. The first output
+    // drives the bitrate controller, the others drop what they cannot keep
+    // up with.
+    bool startStreaming(const std::vector<StreamOutputConfig>& outputs);
+    // Joins an output to a running stream; it starts from the cached GOP.
+    // False if it could not connect (it keeps retrying regardless).
+    bool addOutput(const StreamOutputConfig& output);
     void stopStreaming();
+
+    // Encoded packets for the live stream; see RtmpPublisher. Each output
+    // queues a reference to the same payload, so memory is bounded by the
+    // largest maxQueuedBytes, not by the number of outputs. True if any
+    // output took the packet. Frames no other frame references are dropped
+    // here while a queue is forming.
+    bool sendVideo(uint32_t timestampMs, bool keyframe, RtmpPublisher::Payload payload,
+                   uint8_t codecId = RtmpPublisher::kFlvVideoAvc, bool sequenceHeader = false,
+                   int32_t compositionMs = 0, bool nonReference = false);
+    bool sendAudio(uint32_t timestampMs, RtmpPublisher::Payload payload,
+                   uint8_t soundFormat = RtmpPublisher::kFlvAudioAac, bool sequenceHeader = false);
     
     State getState() const;
-    void updateNetworkStats(); // Placeholder for network adaptation logic
+    // The first output's current connection
+    RtmpPublisherStats getPublisherStats() const;
+    std::vector<StreamOutputStatus> getOutputStatus() const;
+    GopCacheStats getGopCacheStats() const { return gopCache_->getStats(); }
+    BitrateDecision getBitrateDecision() const;
+    BitrateControllerStats getBitrateControllerStats() const;
+    uint64_t getDroppedNonReference() const { return droppedNonReference_; }
+
+    // Samples the first output and runs the bitrate controller; call
+    // periodically (every 100-200 ms) while streaming. RECOVERING covers
+    // both congestion and the first output reconnecting.
+    void updateNetworkStats();
 
 private:
+    bool send(const GopPacket& packet);
+    static void record(RecordingSink& sink, const GopPacket& packet);
+    std::shared_ptr<StreamOutput> primaryOutput() const;
+
     std::atomic<State> currentState_;
-    std::string currentUrl_;
+    RtmpPublisherConfig publisherConfig_;
+    std::shared_ptr<GopCache> gopCache_;
+    // Outputs, the replay buffer and recordings; taken inside the cache lock
+    // while sending
+    mutable std::mutex outputsMutex_;
+    std::vector<std::shared_ptr<StreamOutput>> outputs_;
+    std::shared_ptr<ReplayBuffer> replayBuffer_;
+    std::vector<std::shared_ptr<RecordingSink>> recordings_;
+
+    mutable std::mutex controlMutex_;
+    BitrateController bitrateController_;
+    std::function<void(const BitrateDecision&)> encoderControl_;
+    std::atomic<bool> dropNonReference_;
+    std::atomic<uint64_t> droppedNonReference_;
 };
 
 #endif // STREAM_CONTROLLER_H
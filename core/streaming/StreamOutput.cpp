@@ -0,0 +1,179 @@
+#include "StreamOutput.h"
+#include <algorithm>
+#include <iostream>
+
+StreamOutput::StreamOutput(const StreamOutputConfig& config, std::shared_ptr<const GopCache> cache)
+    : config_(config)
+    , cache_(std::move(cache))
+    , stopRequested_(false)
+    , failed_(false)
+    , waitKeyframe_(true)
+    , connects_(0)
+    , failedAttempts_(0)
+    , skippedVideo_(0)
+    , replayedPackets_(0) {
+}
+
+StreamOutput::~StreamOutput() {
+    stop();
+}
+
+bool StreamOutput::start() {
+    if (supervisor_.joinable()) {
+        std::cerr << "StreamOutput: already started" << std::endl;
+        return false;
+    }
+    stopRequested_ = false;
+    failed_ = false;
+    std::unique_ptr<RtmpPublisher> publisher = connect();
+    bool connected = publisher != nullptr;
+    if (connected) {
+        attach(std::move(publisher));
+    } else {
+        std::lock_guard<std::mutex> lock(mutex_);
+        failedAttempts_++;
+    }
+    supervisor_ = std::thread(&StreamOutput::supervise, this);
+    return connected;
+}
+
+void StreamOutput::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopRequested_ = true;
+    }
+    stopCv_.notify_all();
+    if (supervisor_.joinable()) supervisor_.join();
+
+    std::unique_ptr<RtmpPublisher> publisher;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        publisher = std::move(publisher_);
+    }
+    if (publisher) publisher->stop();
+}
+
+bool StreamOutput::send(const GopPacket& packet) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!publisher_) return false;
+    // A new connection cannot decode inter frames until it has had a keyframe
+    bool keyframe = packet.video && packet.keyframe && !packet.sequenceHeader;
+    if (packet.video && waitKeyframe_ && !keyframe && !packet.sequenceHeader) {
+        skippedVideo_++;
+        return false;
+    }
+    bool queued = queue(*publisher_, packet);
+    if (queued && keyframe) waitKeyframe_ = false;
+    return queued;
+}
+
+bool StreamOutput::isConnected() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return publisher_ && publisher_->getState() == RtmpPublisher::State::Publishing;
+}
+
+StreamOutputStatus StreamOutput::getStatus() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    StreamOutputStatus status;
+    status.url = config_.url;
+    status.connected = publisher_ && publisher_->getState() == RtmpPublisher::State::Publishing;
+    status.failed = failed_;
+    status.connects = connects_;
+    status.failedAttempts = failedAttempts_;
+    status.skippedVideo = skippedVideo_;
+    status.replayedPackets = replayedPackets_;
+    if (publisher_) status.publisher = publisher_->getStats();
+    return status;
+}
+
+std::unique_ptr<RtmpPublisher> StreamOutput::connect() {
+    std::unique_ptr<RtmpPublisher> publisher(new RtmpPublisher(config_.publisher));
+    if (!publisher->start(config_.url)) {
+        publisher->stop();
+        return nullptr;
+    }
+    return publisher;
+}
+
+void StreamOutput::attach(std::unique_ptr<RtmpPublisher> publisher) {
+    auto install = [&](const std::vector<const GopPacket*>& headers, const std::vector<GopPacket>& gop) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const GopPacket* header : headers) queue(*publisher, *header);
+        // Starting from the cached keyframe, the new connection decodes at once
+        bool replayed = !gop.empty() && queue(*publisher, gop.front());
+        if (replayed) {
+            for (size_t i = 1; i < gop.size(); ++i) queue(*publisher, gop[i]);
+            replayedPackets_ += gop.size();
+        }
+        publisher_ = std::move(publisher);
+        waitKeyframe_ = !replayed;
+        connects_++;
+    };
+    if (cache_) {
+        cache_->replay(install);
+    } else {
+        install({}, {});
+    }
+}
+
+void StreamOutput::supervise() {
+    using Clock = std::chrono::steady_clock;
+    int delayMs = config_.reconnectDelayMs;
+    int attempts = 0;
+    Clock::time_point nextAttempt = Clock::now() + std::chrono::milliseconds(delayMs);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopRequested_) {
+        if (!publisher_ && config_.maxReconnectAttempts <= 0) {
+            std::cerr << "Stream output " << config_.url << " is down." << std::endl;
+            failed_ = true;
+            break;
+        }
+        Clock::time_point wakeAt = Clock::now() + std::chrono::milliseconds(20);
+        if (!publisher_) wakeAt = std::min(wakeAt, nextAttempt);
+        stopCv_.wait_until(lock, wakeAt, [this]() { return stopRequested_.load(); });
+        if (stopRequested_) break;
+
+        if (publisher_) {
+            if (publisher_->getState() != RtmpPublisher::State::Error) continue;
+            std::unique_ptr<RtmpPublisher> lost = std::move(publisher_);
+            lock.unlock();
+            std::cerr << "Stream output " << config_.url << " lost its connection." << std::endl;
+            lost->stop();
+            lost.reset();
+            lock.lock();
+            attempts = 0;
+            delayMs = config_.reconnectDelayMs;
+            nextAttempt = Clock::now() + std::chrono::milliseconds(delayMs);
+            continue;
+        }
+        if (Clock::now() < nextAttempt) continue;
+
+        // Connecting blocks for up to connectTimeoutMs; senders carry on meanwhile
+        lock.unlock();
+        std::unique_ptr<RtmpPublisher> publisher = connect();
+        if (publisher) {
+            std::cout << "Stream output " << config_.url << " reconnected." << std::endl;
+            attach(std::move(publisher)); // Takes the cache lock, then ours
+        }
+        lock.lock();
+        if (publisher_) continue;
+        failedAttempts_++;
+        if (++attempts >= config_.maxReconnectAttempts) {
+            std::cerr << "Stream output " << config_.url << " gave up after " << attempts << " attempts."
+                      << std::endl;
+            failed_ = true;
+            break;
+        }
+        delayMs = std::min(delayMs * 2, config_.maxReconnectDelayMs);
+        nextAttempt = Clock::now() + std::chrono::milliseconds(delayMs);
+    }
+}
+
+bool StreamOutput::queue(RtmpPublisher& publisher, const GopPacket& packet) {
+    if (packet.video) {
+        return publisher.sendVideo(packet.timestampMs, packet.keyframe, packet.payload, packet.format,
+                                   packet.sequenceHeader, packet.compositionMs);
+    }
+    return publisher.sendAudio(packet.timestampMs, packet.payload, packet.format, packet.sequenceHeader);
+}
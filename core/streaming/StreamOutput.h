@@ -0,0 +1,87 @@
+#ifndef STREAM_OUTPUT_H
+#define STREAM_OUTPUT_H
+
+#include "RtmpPublisher.h"
+#include "GopCache.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+struct StreamOutputConfig {
+    std::string url;
+    // maxQueuedBytes is how far this output may fall behind before it drops
+    RtmpPublisherConfig publisher;
+    int reconnectDelayMs = 1000;     // Doubles after each failed attempt
+    int maxReconnectDelayMs = 16000;
+    int maxReconnectAttempts = 5;    // In a row; 0 turns reconnecting off
+};
+
+struct StreamOutputStatus {
+    std::string url;
+    bool connected = false;
+    bool failed = false;             // Gave up reconnecting
+    uint64_t connects = 0;           // Including the first
+    uint64_t failedAttempts = 0;
+    uint64_t skippedVideo = 0;       // Inter frames before the first keyframe of a connection
+    uint64_t replayedPackets = 0;    // From the GOP cache, over all connections
+    RtmpPublisherStats publisher;    // Current connection only
+};
+
+// One destination of a StreamController: an RtmpPublisher plus the state
+// to replace it when the connection drops. Packets are the shared payloads
+// the caller hands in, so N outputs queue references to one encode, never
+// copies; each output's own queue bound decides what it drops. A
+// supervisor thread reconnects with backoff and, on each new connection,
+// replays the cached sequence headers and GOP; without a cached GOP video
+// is held until the next keyframe.
+class StreamOutput {
+public:
+    // The cache is shared with the producer, which adds to it before sending
+    StreamOutput(const StreamOutputConfig& config, std::shared_ptr<const GopCache> cache);
+    ~StreamOutput();
+
+    // Makes the first connection attempt (blocking, as RtmpPublisher::start)
+    // and starts supervising; true if that attempt connected
+    bool start();
+    // Waits for a reconnect attempt in progress, then stops the publisher
+    void stop();
+
+    // As RtmpPublisher; false when this output is not connected or dropped the packet
+    bool send(const GopPacket& packet);
+
+    const std::string& url() const { return config_.url; }
+    bool isConnected() const;
+    bool hasFailed() const { return failed_; }
+    StreamOutputStatus getStatus() const;
+
+private:
+    std::unique_ptr<RtmpPublisher> connect();
+    // Installs a new connection and replays the cache into it
+    void attach(std::unique_ptr<RtmpPublisher> publisher);
+    void supervise();
+    static bool queue(RtmpPublisher& publisher, const GopPacket& packet);
+
+    StreamOutputConfig config_;
+    std::shared_ptr<const GopCache> cache_;
+    std::thread supervisor_;
+    std::atomic<bool> stopRequested_;
+    std::atomic<bool> failed_;
+
+    // Held only to queue into the publisher, which does not block; taken
+    // after the cache lock when both are held
+    mutable std::mutex mutex_;
+    std::condition_variable stopCv_;
+    std::unique_ptr<RtmpPublisher> publisher_;
+    bool waitKeyframe_;
+    uint64_t connects_;
+    uint64_t failedAttempts_;
+    uint64_t skippedVideo_;
+    uint64_t replayedPackets_;
+};
+
+#endif // STREAM_OUTPUT_H
@@ -0,0 +1,36 @@
+#include "ready_signal.h"
+#include <cstdint>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace core {
+namespace utils {
+
+ReadySignal::ReadySignal() : eventFd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)), ready(false) {
+}
+
+ReadySignal::~ReadySignal() {
+    if (eventFd >= 0) close(eventFd);
+}
+
+void ReadySignal::notify() {
+    if (eventFd < 0 || ready.exchange(true)) return;
+    uint64_t one = 1;
+    ssize_t written = write(eventFd, &one, sizeof(one));
+    (void)written;
+}
+
+void ReadySignal::clear() {
+    if (eventFd < 0) return;
+    // Drained before the flag is reset: a notify() in between then finds
+    // the flag still set and skips its write, which is fine since the
+    // caller collects after this. The other order could drain that write
+    // yet leave the flag set, and the fd would never be readable again.
+    uint64_t count;
+    ssize_t drained = read(eventFd, &count, sizeof(count));
+    (void)drained;
+    ready.store(false);
+}
+
+} // namespace utils
+} // namespace core
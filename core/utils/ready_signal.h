@@ -0,0 +1,35 @@
+#ifndef CORE_UTILS_READY_SIGNAL_H
+#define CORE_UTILS_READY_SIGNAL_H
+
+#include <atomic>
+
+namespace core {
+namespace utils {
+
+// An eventfd that is readable while there is something to collect, so a
+// consumer can sleep in epoll (or an async runtime) instead of polling.
+// notify() only writes on the idle-to-ready edge, so a busy producer costs
+// one syscall per consumer wakeup rather than one per item. The consumer
+// calls clear() before collecting; anything added later is signalled anew.
+class ReadySignal {
+public:
+    ReadySignal();
+    ~ReadySignal();
+
+    ReadySignal(const ReadySignal&) = delete;
+    ReadySignal& operator=(const ReadySignal&) = delete;
+
+    // Non-blocking; never read it directly. -1 if eventfd failed.
+    int fd() const { return eventFd; }
+    void notify();
+    void clear();
+
+private:
+    int eventFd;
+    std::atomic<bool> ready;
+};
+
+} // namespace utils
+} // namespace core
+
+#endif // CORE_UTILS_READY_SIGNAL_H
@@ -0,0 +1,107 @@
+#include "thread_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+namespace core {
+namespace utils {
+
+ThreadPool::ThreadPool(size_t threadCount) : stopping(false) {
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    workers.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; ++i) {
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    condition.notify_all();
+    // Workers drain the queue before exiting
+    for (auto& worker : workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+void ThreadPool::enqueue(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push_back(std::move(task));
+    }
+    condition.notify_one();
+}
+
+void ThreadPool::parallelFor(int count, const std::function<void(int, int)>& fn, int minChunk) {
+    if (count <= 0) return;
+
+    int threads = (int)workers.size() + 1;
+    int chunk = std::max(minChunk, (count + threads - 1) / threads);
+    int chunks = (count + chunk - 1) / chunk;
+    if (chunks == 1) {
+        fn(0, count);
+        return;
+    }
+
+    // Shared by the helper tasks; they may still be queued after we return
+    // if the caller finished every range itself, so keep it ref-counted.
+    struct Job {
+        std::atomic<int> next{0};
+        std::atomic<int> done{0};
+        std::mutex mutex;
+        std::condition_variable finished;
+    };
+    auto job = std::make_shared<Job>();
+
+    auto runChunks = [job, &fn, chunk, chunks, count]() {
+        int index;
+        while ((index = job->next.fetch_add(1)) < chunks) {
+            int begin = index * chunk;
+            fn(begin, std::min(count, begin + chunk));
+            if (job->done.fetch_add(1) + 1 == chunks) {
+                std::lock_guard<std::mutex> lock(job->mutex);
+                job->finished.notify_all();
+            }
+        }
+    };
+
+    int helpers = std::min(chunks - 1, (int)workers.size());
+    for (int i = 0; i < helpers; ++i) {
+        // Late helpers find no chunks left and never touch fn
+        enqueue(runChunks);
+    }
+    runChunks();
+
+    std::unique_lock<std::mutex> lock(job->mutex);
+    job->finished.wait(lock, [&job, chunks]() { return job->done.load() == chunks; });
+}
+
+size_t ThreadPool::getPendingTasks() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return tasks.size();
+}
+
+void ThreadPool::workerLoop() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+            if (tasks.empty()) {
+                return; // stopping and drained
+            }
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        task();
+    }
+}
+
+} // namespace utils
+} // namespace core
@@ -0,0 +1,48 @@
+#ifndef CORE_UTILS_THREAD_POOL_H
+#define CORE_UTILS_THREAD_POOL_H
+
+#include <cstddef>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+namespace core {
+namespace utils {
+
+class ThreadPool {
+public:
+    // threadCount == 0 uses std::thread::hardware_concurrency()
+    explicit ThreadPool(size_t threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Queue a task for asynchronous execution
+    void enqueue(std::function<void()> task);
+
+    // Split [0, count) into contiguous ranges and run fn(begin, end) on the
+    // pool. The calling thread takes ranges too and returns once all are done,
+    // so this is safe to call from inside a pool task.
+    void parallelFor(int count, const std::function<void(int, int)>& fn, int minChunk = 1);
+
+    size_t getThreadCount() const { return workers.size(); }
+    size_t getPendingTasks() const;
+
+private:
+    void workerLoop();
+
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    mutable std::mutex mutex;
+    std::condition_variable condition;
+    bool stopping;
+};
+
+} // namespace utils
+} // namespace core
+
+#endif // CORE_UTILS_THREAD_POOL_H
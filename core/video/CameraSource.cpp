@@ -1,55 +1,151 @@
 #include "CameraSource.h"
 #include <iostream>
 #include <chrono>
+#include <cmath>
+#include <cstring>
 
-CameraSource::CameraSource(const std::string& deviceId) 
-    : deviceId_(deviceId), running_(false), newFrameAvailable_(false) {
+namespace {
+
+uint64_t nowMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()
+    ).count();
+}
+
+uint64_t steadyMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()
+    ).count();
+}
+
+std::string fourccToString(int code) {
+    std::string s;
+    for (int i = 0; i < 4; ++i) {
+        char c = (char)((code >> (8 * i)) & 0xFF);
+        s.push_back(c ? c : ' ');
+    }
+    return s;
+}
+
+int stringToFourcc(const std::string& s) {
+    std::string padded = (s + "    ").substr(0, 4);
+    return cv::VideoWriter::fourcc(padded[0], padded[1], padded[2], padded[3]);
+}
+
+} // namespace
+
+CameraSource::CameraSource(const std::string& deviceId, const CameraProfile& profile)
+    : deviceId_(deviceId), playback_(false), profile_(profile), running_(false), newFrameAvailable_(false),
+      publishedSequence_(0), externallyDriven_(false), captureSequence_(0), decodesInFlight_(0),
+      compressedCapture_(false), droppedFrames_(0) {
 }
 
 CameraSource::~CameraSource() {
     stop();
 }
 
+std::shared_ptr<CameraSource> CameraSource::fromFile(const std::string& path, const CameraProfile& profile) {
+    auto source = std::make_shared<CameraSource>(path, profile);
+    source->playback_ = true;
+    return source;
+}
+
 bool CameraSource::start() {
     if (running_) return true;
-
-    // Parse device ID to integer, default to 0
-    int camIndex = 0;
-    try {
-        // Find first digit in the string
-        size_t digitPos = deviceId_.find_first_of("0123456789");
-        if (digitPos != std::string::npos) {
-            camIndex = std::stoi(deviceId_.substr(digitPos));
-        }
-    } catch (...) {
-        camIndex = 0;
+    if (externallyDriven_) {
+        // Opened and read by a MultiCameraCapture; start that instead
+        return false;
     }
 
-    // Open Camera
-    // CAP_ANY allows OpenCV to choose the best backend (V4L2, AVFoundation, DSHOW, etc.)
-    if (!capture_.open(camIndex, cv::CAP_ANY)) {
-        std::cerr << "Error: Could not open camera with index " << camIndex << std::endl;
+    if (!openDevice()) {
         return false;
     }
 
-    // Optional: Set resolution (can be parameterized later)
-    capture_.set(cv::CAP_PROP_FRAME_WIDTH, 1280);
-    capture_.set(cv::CAP_PROP_FRAME_HEIGHT, 720);
-    
     running_ = true;
     captureThread_ = std::thread(&CameraSource::captureLoop, this);
-    std::cout << "CameraSource started: " << deviceId_ << " (Index: " << camIndex << ")" << std::endl;
     return true;
 }
 
 void CameraSource::stop() {
-    if (!running_) return;
+    if (!running_ || externallyDriven_) return;
 
     running_ = false;
     if (captureThread_.joinable()) {
         captureThread_.join();
     }
-    
+    closeDevice();
+}
+
+bool CameraSource::openDevice() {
+    int camIndex = 0;
+    bool opened = false;
+    if (playback_) {
+        opened = capture_.open(deviceId_, cv::CAP_ANY);
+    } else {
+        // Parse device ID to integer, default to 0
+        try {
+            // Find first digit in the string
+            size_t digitPos = deviceId_.find_first_of("0123456789");
+            if (digitPos != std::string::npos) {
+                camIndex = std::stoi(deviceId_.substr(digitPos));
+            }
+        } catch (...) {
+            camIndex = 0;
+        }
+
+        // Open Camera
+        // Prefer V4L2 on Linux: it honours FOURCC/FPS requests and can hand out
+        // undecoded MJPEG. CAP_ANY lets OpenCV pick elsewhere.
+#ifdef __linux__
+        opened = capture_.open(camIndex, cv::CAP_V4L2) || capture_.open(camIndex, cv::CAP_ANY);
+#else
+        opened = capture_.open(camIndex, cv::CAP_ANY);
+#endif
+    }
+    if (!opened) {
+        if (playback_) {
+            std::cerr << "Error: Could not open " << deviceId_ << std::endl;
+        } else {
+            std::cerr << "Error: Could not open camera with index " << camIndex << std::endl;
+        }
+        return false;
+    }
+
+    if (playback_) {
+        // Nothing to negotiate; report what the file holds
+        negotiated_.fourcc = fourccToString((int)capture_.get(cv::CAP_PROP_FOURCC));
+        negotiated_.width = (int)capture_.get(cv::CAP_PROP_FRAME_WIDTH);
+        negotiated_.height = (int)capture_.get(cv::CAP_PROP_FRAME_HEIGHT);
+        negotiated_.negotiatedFps = capture_.get(cv::CAP_PROP_FPS);
+    } else {
+        negotiateFormat();
+    }
+
+    // With MJPEG, ask the backend for the raw bitstream so decoding happens
+    // on our workers instead of serializing with read().
+    compressedCapture_ = false;
+    if (!playback_ && negotiated_.fourcc == "MJPG" && profile_.decodeThreads > 0 &&
+        capture_.set(cv::CAP_PROP_CONVERT_RGB, 0)) {
+        compressedCapture_ = true;
+        decodePool_ = std::make_unique<core::utils::ThreadPool>(profile_.decodeThreads);
+    }
+    negotiated_.parallelDecode = compressedCapture_;
+
+    captureSequence_ = 0;
+    publishedSequence_ = 0;
+    changeDetector_.setConfig(profile_.changeDetection);
+    statsWindowStart_ = std::chrono::steady_clock::now();
+
+    std::cout << "CameraSource started: " << deviceId_ << " (Index: " << camIndex << ", "
+              << negotiated_.fourcc << " " << negotiated_.width << "x" << negotiated_.height
+              << "@" << negotiated_.negotiatedFps << ")" << std::endl;
+    return true;
+}
+
+void CameraSource::closeDevice() {
+    // Drains in-flight decodes before the device goes away
+    decodePool_.reset();
+
     if (capture_.isOpened()) {
         capture_.release();
     }
@@ -61,21 +157,132 @@ bool CameraSource::getFrame(VideoFrame& frame) {
     if (!newFrameAvailable_) {
         return false;
     }
-    
-    frame = currentFrame_; // Copy frame data
+
+    frame = currentFrame_; // Shares the pixel buffer, no copy
     newFrameAvailable_ = false;
     return true;
 }
 
+bool CameraSource::getLatestFrame(VideoFrame& frame) {
+    std::lock_guard<std::mutex> lock(frameMutex_);
+    if (currentFrame_.empty()) {
+        return false;
+    }
+    frame = currentFrame_;
+    return true;
+}
+
 std::string CameraSource::getName() const {
     return "Camera-" + deviceId_;
 }
 
+CameraStats CameraSource::getStats() {
+    auto now = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(now - statsWindowStart_).count();
+    statsWindowStart_ = now;
+
+    auto rate = [seconds](StageMeter& meter, double& fps, double* avgMs) {
+        uint64_t count = meter.count.load();
+        uint64_t busy = meter.busyUs.load();
+        uint64_t frames = count - meter.lastCount;
+        fps = seconds > 0.0 ? frames / seconds : 0.0;
+        if (avgMs) {
+            *avgMs = frames ? (busy - meter.lastBusyUs) / 1000.0 / frames : 0.0;
+        }
+        meter.lastCount = count;
+        meter.lastBusyUs = busy;
+    };
+
+    CameraStats stats = negotiated_;
+    rate(captureMeter_, stats.captureFps, nullptr);
+    rate(decodeMeter_, stats.decodeFps, &stats.avgDecodeMs);
+    rate(convertMeter_, stats.convertFps, &stats.avgConvertMs);
+    rate(publishMeter_, stats.publishFps, nullptr);
+    stats.droppedFrames = droppedFrames_.load();
+    {
+        std::lock_guard<std::mutex> lock(frameMutex_);
+        stats.unchangedFrames = changeDetector_.getStats().unchangedFrames;
+    }
+    return stats;
+}
+
+bool CameraSource::tryFormat(const std::string& fourcc, int width, int height, double fps) {
+    if (!fourcc.empty()) {
+        capture_.set(cv::CAP_PROP_FOURCC, stringToFourcc(fourcc));
+    }
+    capture_.set(cv::CAP_PROP_FRAME_WIDTH, width);
+    capture_.set(cv::CAP_PROP_FRAME_HEIGHT, height);
+    capture_.set(cv::CAP_PROP_FPS, fps);
+
+    negotiated_.fourcc = fourccToString((int)capture_.get(cv::CAP_PROP_FOURCC));
+    negotiated_.width = (int)capture_.get(cv::CAP_PROP_FRAME_WIDTH);
+    negotiated_.height = (int)capture_.get(cv::CAP_PROP_FRAME_HEIGHT);
+    negotiated_.negotiatedFps = capture_.get(cv::CAP_PROP_FPS);
+
+    bool formatOk = fourcc.empty() || negotiated_.fourcc == fourcc;
+    bool sizeOk = negotiated_.width == width && negotiated_.height == height;
+    // Backends that cannot report the rate return 0; trust the request then
+    bool fpsOk = negotiated_.negotiatedFps <= 0.0 || negotiated_.negotiatedFps >= fps * 0.9;
+    return formatOk && sizeOk && fpsOk;
+}
+
+bool CameraSource::negotiateFormat() {
+    // Without the full-frame output only the consumer outputs matter, so
+    // ask the device for the least that still serves all of them
+    cv::Size request(profile_.width, profile_.height);
+    double fps = profile_.fps;
+    if (!profile_.fullFrameOutput && !outputs_.empty()) {
+        ScaleSize needed = outputs_.requiredResolution(profile_.width, profile_.height);
+        for (const auto& size : profile_.fallbackSizes) {
+            bool sameAspect = (int64_t)size.width * profile_.height == (int64_t)size.height * profile_.width;
+            if (sameAspect && size.width >= needed.width && size.height >= needed.height &&
+                size.width < request.width) {
+                request = size;
+            }
+        }
+        double wanted = outputs_.requiredFps();
+        if (wanted > 0.0) fps = std::min(fps, wanted);
+    }
+
+    // Requested size first, then each fallback size no larger than the profile's
+    std::vector<cv::Size> sizes = {request};
+    if (request.width != profile_.width || request.height != profile_.height) {
+        sizes.push_back(cv::Size(profile_.width, profile_.height));
+    }
+    for (const auto& size : profile_.fallbackSizes) {
+        if (size.width * size.height < profile_.width * profile_.height && size != request) {
+            sizes.push_back(size);
+        }
+    }
+
+    std::vector<std::string> fourccs = profile_.fourccs;
+    if (fourccs.empty()) fourccs.push_back("");
+
+    // Sizes outer, FOURCCs inner: a format that cannot reach the rate at
+    // this size (YUYV over USB 2.0) gives way to the next FOURCC first
+    for (const auto& size : sizes) {
+        for (const auto& fourcc : fourccs) {
+            if (tryFormat(fourcc, size.width, size.height, fps)) {
+                return true;
+            }
+        }
+    }
+
+    // Nothing matched exactly: settle for the first choice at the requested
+    // size and let the driver pick the closest mode.
+    tryFormat(fourccs.front(), request.width, request.height, fps);
+    std::cerr << "Warning: Camera " << deviceId_ << " could not satisfy " << request.width << "x"
+              << request.height << "@" << fps << ", using " << negotiated_.fourcc << " "
+              << negotiated_.width << "x" << negotiated_.height << "@" << negotiated_.negotiatedFps
+              << std::endl;
+    return false;
+}
+
 void CameraSource::captureLoop() {
-    cv::Mat rawFrame;
-    cv::Mat rgbaFrame;
-    
     while (running_) {
+        // A fresh Mat per read: in-flight decodes may still reference the last one
+        cv::Mat rawFrame;
+
         // 1. Read frame from OpenCV
         if (!capture_.read(rawFrame)) {
             // Failed to read (camera disconnected?), sleep briefly and retry
@@ -83,34 +290,139 @@ void CameraSource::captureLoop() {
             continue;
         }
 
-        if (rawFrame.empty()) continue;
+        handleRawFrame(rawFrame, nowMicros());
 
-        // 2. Convert Color Space (BGR -> RGBA)
-        // VideoFrame expects RGBA buffer
-        cv::cvtColor(rawFrame, rgbaFrame, cv::COLOR_BGR2RGBA);
+        // No explicit sleep needed here as capture.read() blocks until next frame
+    }
+}
 
-        // 3. Prepare VideoFrame
-        VideoFrame frame(rgbaFrame.cols, rgbaFrame.rows, VideoFrame::Format::RGBA);
-        
-        // Copy data efficiently
-        // Note: rgbaFrame.data is contiguous
-        size_t dataSize = rgbaFrame.total() * rgbaFrame.elemSize();
-        if (frame.data.size() != dataSize) {
-            frame.data.resize(dataSize);
+void CameraSource::handleRawFrame(const cv::Mat& rawFrame, uint64_t timestamp) {
+    if (rawFrame.empty()) return;
+    captureMeter_.count++;
+    uint64_t sequence = ++captureSequence_;
+
+    // 2a. Compressed MJPEG: hand off to the decode workers. A 1xN 8UC1
+    // buffer is the undecoded bitstream; anything else was already decoded.
+    if (compressedCapture_ && rawFrame.rows == 1 && rawFrame.type() == CV_8UC1) {
+        if (decodesInFlight_.load() >= profile_.decodeThreads * 2) {
+            // Workers are behind; dropping here keeps latency bounded
+            droppedFrames_++;
+            return;
         }
-        std::memcpy(frame.data.data(), rgbaFrame.data, dataSize);
-        
-        frame.timestamp = std::chrono::duration_cast<std::chrono::microseconds>(
-            std::chrono::system_clock::now().time_since_epoch()
-        ).count();
-
-        // 4. Update shared state
-        {
-            std::lock_guard<std::mutex> lock(frameMutex_);
-            currentFrame_ = std::move(frame);
-            newFrameAvailable_ = true;
+        decodesInFlight_++;
+        decodePool_->enqueue([this, rawFrame, sequence, timestamp]() {
+            decodeAndPublish(rawFrame, sequence, timestamp);
+            decodesInFlight_--;
+        });
+        return;
+    }
+
+    // 2b. Already decoded by the backend: convert inline
+    convertAndPublish(rawFrame, sequence, timestamp);
+}
+
+void CameraSource::decodeAndPublish(cv::Mat compressed, uint64_t sequence, uint64_t timestamp) {
+    uint64_t start = steadyMicros();
+    cv::Mat bgr = cv::imdecode(compressed, cv::IMREAD_COLOR);
+    decodeMeter_.busyUs += steadyMicros() - start;
+    if (bgr.empty()) {
+        droppedFrames_++;
+        return;
+    }
+    decodeMeter_.count++;
+    convertAndPublish(bgr, sequence, timestamp);
+}
+
+void CameraSource::convertAndPublish(const cv::Mat& bgr, uint64_t sequence, uint64_t timestamp) {
+    uint64_t start = steadyMicros();
+
+    if (!outputs_.empty()) {
+        publishOutputs(bgr, timestamp);
+    }
+    if (!profile_.fullFrameOutput) {
+        convertMeter_.busyUs += steadyMicros() - start;
+        convertMeter_.count++;
+        publishMeter_.count++;
+        return;
+    }
+
+    // Convert Color Space (BGR -> RGBA) straight into an aligned, pooled
+    // frame. The cv::Mat header aliases the frame's first plane, so
+    // cvtColor writes the pixels in place and no extra copy is needed.
+    VideoFrame frame = framePool_.acquire(bgr.cols, bgr.rows, VideoFrame::Format::RGBA);
+    cv::Mat rgbaView(frame.height, frame.width, CV_8UC4, frame.plane(0), frame.stride(0));
+    cv::cvtColor(bgr, rgbaView, cv::COLOR_BGR2RGBA);
+    frame.timestamp = timestamp;
+
+    convertMeter_.busyUs += steadyMicros() - start;
+    convertMeter_.count++;
+
+    // Update shared state. Workers can finish out of order; a frame older
+    // than the one already published is stale and is dropped.
+    {
+        std::lock_guard<std::mutex> lock(frameMutex_);
+        if (sequence <= publishedSequence_) {
+            droppedFrames_++;
+            return;
         }
-        
-        // No explicit sleep needed here as capture.read() blocks until next frame
+        publishedSequence_ = sequence;
+        if (profile_.detectChanges) {
+            changeDetector_.process(frame);
+        }
+        currentFrame_ = std::move(frame);
+        newFrameAvailable_ = true;
+        publishMeter_.count++;
+    }
+    notifyFrame();
+}
+
+void CameraSource::publishOutputs(const cv::Mat& bgr, uint64_t timestamp) {
+    for (int id : outputs_.due(timestamp)) {
+        SourceOutputConfig config = outputs_.resolve(id, bgr.cols, bgr.rows, profile_.width, profile_.height);
+
+        // Crop and scale while still 3 bytes per pixel, so the conversion
+        // only ever touches the pixels this output keeps
+        cv::Mat scaled = bgr(cv::Rect(config.crop.x, config.crop.y, config.crop.width, config.crop.height));
+        if (scaled.cols != config.width || scaled.rows != config.height) {
+            bool shrinking = config.width < scaled.cols && config.height < scaled.rows;
+            cv::Mat roi = scaled;
+            cv::resize(roi, scaled, cv::Size(config.width, config.height), 0, 0,
+                       shrinking ? cv::INTER_AREA : cv::INTER_LINEAR);
+        }
+
+        // Pooled like full frames; every plane below is overwritten in full
+        VideoFrame frame = framePool_.acquire(config.width, config.height, config.format);
+        if (config.format == VideoFrame::Format::RGBA) {
+            cv::Mat rgbaView(frame.height, frame.width, CV_8UC4, frame.plane(0), frame.stride(0));
+            cv::cvtColor(scaled, rgbaView, cv::COLOR_BGR2RGBA);
+        } else {
+            // OpenCV writes I420 packed (Y, then U, then V); repack into
+            // the frame's aligned planes, interleaving chroma for NV12
+            cv::Mat i420;
+            cv::cvtColor(scaled, i420, cv::COLOR_BGR2YUV_I420);
+            int w = frame.width, h = frame.height, cw = w / 2, ch = h / 2;
+            const uint8_t* y = i420.ptr();
+            const uint8_t* u = y + (size_t)w * h;
+            const uint8_t* v = u + (size_t)cw * ch;
+            for (int row = 0; row < h; ++row) {
+                std::memcpy(frame.plane(0) + (size_t)row * frame.stride(0), y + (size_t)row * w, w);
+            }
+            for (int row = 0; row < ch; ++row) {
+                const uint8_t* uRow = u + (size_t)row * cw;
+                const uint8_t* vRow = v + (size_t)row * cw;
+                if (config.format == VideoFrame::Format::I420) {
+                    std::memcpy(frame.plane(1) + (size_t)row * frame.stride(1), uRow, cw);
+                    std::memcpy(frame.plane(2) + (size_t)row * frame.stride(2), vRow, cw);
+                } else {
+                    uint8_t* uv = frame.plane(1) + (size_t)row * frame.stride(1);
+                    for (int x = 0; x < cw; ++x) {
+                        uv[x * 2] = uRow[x];
+                        uv[x * 2 + 1] = vRow[x];
+                    }
+                }
+            }
+        }
+        frame.timestamp = timestamp;
+        outputs_.deliver(id, std::move(frame));
     }
 }
@@ -2,26 +2,116 @@
 #define CAMERA_SOURCE_H
 
 #include "VideoSource.h"
+#include "FrameChangeDetector.h"
+#include "SourceOutputs.h"
+#include "VideoFramePool.h"
+#include "utils/thread_pool.h"
+#ifdef __linux__
+#include "V4L2DeviceEnumerator.h"
+#endif
 #include <thread>
 #include <atomic>
 #include <mutex>
+#include <memory>
+#include <chrono>
+#include <vector>
 #include <opencv2/opencv.hpp>
 #include <opencv2/core/utils/logger.hpp>
 
+// Capture format requested from the device. Sizes are tried in order, the
+// requested one first, then the smaller fallback sizes; at each size every
+// FOURCC is tried in order, so resolution is kept before format.
+struct CameraProfile {
+    int width = 1280;
+    int height = 720;
+    double fps = 30.0;
+    std::vector<std::string> fourccs = {"MJPG", "YUYV"};
+    std::vector<cv::Size> fallbackSizes = {{1280, 720}, {640, 480}, {640, 360}};
+    int decodeThreads = 3; // MJPEG decode workers; 0 decodes on the capture thread
+
+    // Flags frames of a static scene as unchanged. The threshold absorbs
+    // sensor noise, which never leaves two camera frames bit-identical.
+    bool detectChanges = false;
+    ChangeDetectorConfig changeDetection = {32, 2.0, 0.0};
+
+    // Also publish every frame in full through getFrame(). Turning it off
+    // lets the outputs shape the capture request: the smallest fallback
+    // size of the same aspect ratio that covers every output, at the
+    // highest rate any of them asks for.
+    bool fullFrameOutput = true;
+};
+
+struct CameraStats {
+    // What the driver accepted during negotiation
+    std::string fourcc;
+    int width = 0;
+    int height = 0;
+    double negotiatedFps = 0.0;
+    bool parallelDecode = false;
+
+    // Achieved rates since the previous getStats() call
+    double captureFps = 0.0;
+    double decodeFps = 0.0;
+    double convertFps = 0.0;
+    double publishFps = 0.0;
+    double avgDecodeMs = 0.0;
+    double avgConvertMs = 0.0;
+    uint64_t droppedFrames = 0;
+    uint64_t unchangedFrames = 0; // Flagged by change detection, in total
+};
+
 class CameraSource : public VideoSource {
 public:
-    CameraSource(const std::string& deviceId);
+    CameraSource(const std::string& deviceId, const CameraProfile& profile = CameraProfile());
     ~CameraSource() override;
 
+    // Plays back a recording or image sequence ("frames/%03d.png") in place
+    // of a device, e.g. to test capture without cameras. Nothing is
+    // negotiated; frames arrive as fast as they are read.
+    static std::shared_ptr<CameraSource> fromFile(const std::string& path,
+                                                  const CameraProfile& profile = CameraProfile());
+
     bool start() override;
     void stop() override;
     bool getFrame(VideoFrame& frame) override;
+    bool getLatestFrame(VideoFrame& frame) override;
     std::string getName() const override;
 
+    // Takes effect on the next start()
+    void setProfile(const CameraProfile& profile) { profile_ = profile; }
+    CameraStats getStats();
+
+    // Extra consumers with their own crop, size, format and rate, all
+    // served from this capture. Crops are in profile width x height
+    // coordinates. Outputs added before start() can narrow the request.
+    int addOutput(const SourceOutputConfig& config) { return outputs_.add(config); }
+    bool removeOutput(int id) { return outputs_.remove(id); }
+    bool getOutputFrame(int id, VideoFrame& frame) { return outputs_.getFrame(id, frame); }
+
 private:
+    struct StageMeter {
+        std::atomic<uint64_t> count{0};
+        std::atomic<uint64_t> busyUs{0};
+        uint64_t lastCount = 0;
+        uint64_t lastBusyUs = 0;
+    };
+
+    friend class MultiCameraCapture;
+
+    bool openDevice();
+    void closeDevice();
     void captureLoop();
+    // Timestamps, decodes (or dispatches the decode of) and publishes one read
+    void handleRawFrame(const cv::Mat& rawFrame, uint64_t timestamp);
+    bool negotiateFormat();
+    bool tryFormat(const std::string& fourcc, int width, int height, double fps);
+    void decodeAndPublish(cv::Mat compressed, uint64_t sequence, uint64_t timestamp);
+    void convertAndPublish(const cv::Mat& bgr, uint64_t sequence, uint64_t timestamp);
+    void publishOutputs(const cv::Mat& bgr, uint64_t timestamp);
 
-    std::string deviceId_;
+    std::string deviceId_; // The file path when playing back
+    bool playback_;
+    CameraProfile profile_;
     std::atomic<bool> running_;
     std::thread captureThread_;
     
@@ -31,11 +121,54 @@ private:
     std::mutex frameMutex_;
     VideoFrame currentFrame_;
     bool newFrameAvailable_;
+    uint64_t publishedSequence_;
+    // Runs under frameMutex_, where frames are already in capture order
+    FrameChangeDetector changeDetector_;
+    SourceOutputs outputs_;
+    // Full and output frames; a buffer is converted into again once every
+    // consumer, including a borrower across the FFI, has dropped it
+    VideoFramePool framePool_;
+
+    // Set while a MultiCameraCapture owns reads from capture_
+    bool externallyDriven_;
+    uint64_t captureSequence_;
+
+    // MJPEG path: compressed buffers are handed to decodePool_ so read(),
+    // decode and color conversion of consecutive frames overlap.
+    std::unique_ptr<core::utils::ThreadPool> decodePool_;
+    std::atomic<int> decodesInFlight_;
+    bool compressedCapture_;
+
+    CameraStats negotiated_;
+    StageMeter captureMeter_;
+    StageMeter decodeMeter_;
+    StageMeter convertMeter_;
+    StageMeter publishMeter_;
+    std::atomic<uint64_t> droppedFrames_;
+    std::chrono::steady_clock::time_point statsWindowStart_;
 };
 
 class CameraDeviceManager {
 public:
     static std::vector<std::string> getDeviceList() {
+#ifdef __linux__
+        // Served from the sysfs cache, which the hotplug watcher keeps
+        // current; no capture device is opened.
+        auto& enumerator = V4L2DeviceEnumerator::getInstance();
+        enumerator.startWatchingOnce();
+        std::vector<std::string> devices;
+        for (const auto& device : enumerator.getDevices()) {
+            devices.push_back("Camera " + std::to_string(device.index));
+        }
+        return devices;
+#else
+        return probeDeviceList();
+#endif
+    }
+
+    // Opens each index with OpenCV. Slow (seconds without cameras); only
+    // used where no native enumerator exists.
+    static std::vector<std::string> probeDeviceList() {
         // Silence OpenCV logs during probing
         cv::utils::logging::setLogLevel(cv::utils::logging::LOG_LEVEL_SILENT);
         
@@ -0,0 +1,229 @@
+#include "ContentAnalyzer.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define CONTENT_SSE2 1
+#endif
+
+namespace {
+
+constexpr int kHistogramBins = 64;
+// A jump in mean SAD this large counts as a full cut on its own
+constexpr double kCutSad = 32.0;
+
+int effectiveStep(int step, int width, int height) {
+    step = std::clamp(step, 4, 32) & ~3;
+    while (step > 4 && (width < step || height < step)) step -= 4;
+    return step;
+}
+
+// Sum of (R + 2G + B) over the odd rows of a step x step RGBA cell
+uint32_t rgbaCellSum(const uint8_t* cell, int stride, int step) {
+    uint32_t channels[4] = {0, 0, 0, 0};
+#if defined(CONTENT_SSE2)
+    // 16-bit lanes hold R,G,B,A of even and odd pixels; at most
+    // step * step / 4 values each, which fits for step <= 32
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc = _mm_setzero_si128();
+    for (int r = 1; r < step; r += 2) {
+        const uint8_t* row = cell + (size_t)r * stride;
+        for (int x = 0; x < step * 4; x += 16) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x));
+            acc = _mm_add_epi16(acc, _mm_add_epi16(_mm_unpacklo_epi8(v, zero), _mm_unpackhi_epi8(v, zero)));
+        }
+    }
+    __m128i wide = _mm_add_epi32(_mm_unpacklo_epi16(acc, zero), _mm_unpackhi_epi16(acc, zero));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(channels), wide);
+#else
+    for (int r = 1; r < step; r += 2) {
+        const uint8_t* row = cell + (size_t)r * stride;
+        for (int x = 0; x < step; ++x) {
+            for (int c = 0; c < 4; ++c) channels[c] += row[x * 4 + c];
+        }
+    }
+#endif
+    return channels[0] + 2 * channels[1] + channels[2];
+}
+
+// Sum of the odd rows of a step x step luma cell
+uint32_t lumaCellSum(const uint8_t* cell, int stride, int step) {
+    uint32_t sum = 0;
+    for (int r = 1; r < step; r += 2) {
+        const uint8_t* row = cell + (size_t)r * stride;
+        int x = 0;
+#if defined(CONTENT_SSE2)
+        for (; x + 8 <= step; x += 8) {
+            __m128i v = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(row + x));
+            sum += (uint32_t)_mm_cvtsi128_si32(_mm_sad_epu8(v, _mm_setzero_si128()));
+        }
+#endif
+        for (; x < step; ++x) sum += row[x];
+    }
+    return sum;
+}
+
+void absDiff(const uint8_t* a, const uint8_t* b, uint8_t* out, size_t count) {
+    size_t i = 0;
+#if defined(CONTENT_SSE2)
+    for (; i + 16 <= count; i += 16) {
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        __m128i d = _mm_or_si128(_mm_subs_epu8(va, vb), _mm_subs_epu8(vb, va));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), d);
+    }
+#endif
+    for (; i < count; ++i) out[i] = a[i] > b[i] ? a[i] - b[i] : b[i] - a[i];
+}
+
+std::array<uint32_t, kHistogramBins> histogramOf(const std::vector<uint8_t>& cells) {
+    std::array<uint32_t, kHistogramBins> histogram{};
+    for (uint8_t v : cells) histogram[v >> 2]++;
+    return histogram;
+}
+
+} // namespace
+
+ContentAnalyzer::ContentAnalyzer(const ContentAnalyzerConfig& config)
+    : config_(config)
+    , cols_(0)
+    , rows_(0)
+    , step_(0)
+    , previousFormat_(VideoFrame::Format::RGBA)
+    , previousHistogram_{}
+    , previousMeanSad_(0.0)
+    , framesSinceCut_(0)
+    , totalAnalyzeMs_(0.0)
+    , totalMotionActivity_(0.0) {
+}
+
+void ContentAnalyzer::setConfig(const ContentAnalyzerConfig& config) {
+    config_ = config;
+    // Grids from the old step are not comparable with the new one
+    reset();
+}
+
+void ContentAnalyzer::reset() {
+    previous_.clear();
+    previousMeanSad_ = 0.0;
+}
+
+bool ContentAnalyzer::downsampleLuma(const VideoFrame& frame, int step, std::vector<uint8_t>& cells, int& cols,
+                                     int& rows) {
+    if (frame.empty() || frame.width < 4 || frame.height < 4) return false;
+    step = effectiveStep(step, frame.width, frame.height);
+    cols = frame.width / step;
+    rows = frame.height / step;
+    cells.resize((size_t)cols * rows);
+
+    bool rgba = frame.format == VideoFrame::Format::RGBA;
+    // Weights sum to 4 for RGBA; half the rows are read
+    uint32_t count = (uint32_t)(step * (step / 2) * (rgba ? 4 : 1));
+    const uint8_t* base = frame.plane(0);
+    int stride = frame.stride(0);
+    for (int cy = 0; cy < rows; ++cy) {
+        const uint8_t* row = base + (size_t)cy * step * stride;
+        uint8_t* out = cells.data() + (size_t)cy * cols;
+        for (int cx = 0; cx < cols; ++cx) {
+            uint32_t sum = rgba ? rgbaCellSum(row + (size_t)cx * step * 4, stride, step)
+                                : lumaCellSum(row + (size_t)cx * step, stride, step);
+            out[cx] = (uint8_t)((sum + count / 2) / count);
+        }
+    }
+    return true;
+}
+
+std::shared_ptr<const FrameAnalysis> ContentAnalyzer::process(VideoFrame& frame) {
+    if (frame.empty() || frame.width < 4 || frame.height < 4) return nullptr;
+    auto start = std::chrono::steady_clock::now();
+    framesSinceCut_++;
+
+    int step = effectiveStep(config_.sampleStep, frame.width, frame.height);
+    int cols = frame.width / step, rows = frame.height / step;
+    bool comparable = !previous_.empty() && cols == cols_ && rows == rows_ && step == step_ &&
+                      frame.format == previousFormat_;
+
+    // Motion cells are whole groups of luma cells
+    int group = std::max(1, config_.motionCellSize / step);
+    auto analysis = std::make_shared<FrameAnalysis>();
+    analysis->motionCols = (cols + group - 1) / group;
+    analysis->motionRows = (rows + group - 1) / group;
+    analysis->motion.assign((size_t)analysis->motionCols * analysis->motionRows, 0);
+
+    if (comparable && frame.unchanged) {
+        // The producer already knows nothing moved: nothing to read
+        previousMeanSad_ = 0.0;
+    } else if (!comparable) {
+        // First frame, or the geometry changed: the encoder restarts anyway
+        downsampleLuma(frame, step, current_, cols, rows);
+        analysis->sceneChangeScore = 1.0;
+        analysis->histogramDistance = 1.0;
+        analysis->sceneCut = true;
+        analysis->motionActivity = 1.0;
+        std::fill(analysis->motion.begin(), analysis->motion.end(), 255);
+        previousHistogram_ = histogramOf(current_);
+        previousMeanSad_ = 0.0;
+        previous_.swap(current_);
+    } else {
+        downsampleLuma(frame, step, current_, cols, rows);
+        diff_.resize(current_.size());
+        absDiff(current_.data(), previous_.data(), diff_.data(), diff_.size());
+
+        std::vector<uint32_t> sums(analysis->motion.size(), 0), counts(analysis->motion.size(), 0);
+        uint64_t total = 0;
+        for (int cy = 0; cy < rows; ++cy) {
+            const uint8_t* d = diff_.data() + (size_t)cy * cols;
+            size_t motionRow = (size_t)(cy / group) * analysis->motionCols;
+            for (int cx = 0; cx < cols; ++cx) {
+                sums[motionRow + cx / group] += d[cx];
+                counts[motionRow + cx / group]++;
+            }
+        }
+        int moving = 0;
+        for (size_t i = 0; i < sums.size(); ++i) {
+            total += sums[i];
+            double mean = (double)sums[i] / std::max(1u, counts[i]);
+            analysis->motion[i] = (uint8_t)std::min(255.0, std::round(mean));
+            if (mean > config_.motionThreshold) moving++;
+        }
+        analysis->motionActivity = (double)moving / std::max<size_t>(1, sums.size());
+        analysis->meanSad = (double)total / std::max<size_t>(1, diff_.size());
+
+        auto histogram = histogramOf(current_);
+        uint64_t histogramDelta = 0;
+        for (int i = 0; i < kHistogramBins; ++i) {
+            histogramDelta += histogram[i] > previousHistogram_[i] ? histogram[i] - previousHistogram_[i]
+                                                                   : previousHistogram_[i] - histogram[i];
+        }
+        analysis->histogramDistance = (double)histogramDelta / (2.0 * std::max<size_t>(1, current_.size()));
+
+        // Only a jump in SAD suggests a cut; steady motion keeps it high
+        // from frame to frame
+        double jump = std::min(analysis->meanSad, std::abs(analysis->meanSad - previousMeanSad_));
+        analysis->sceneChangeScore =
+            std::clamp(0.5 * analysis->histogramDistance + 0.5 * std::min(1.0, jump / kCutSad), 0.0, 1.0);
+        analysis->sceneCut = analysis->sceneChangeScore >= config_.cutThreshold &&
+                             framesSinceCut_ >= config_.minCutInterval;
+
+        previousHistogram_ = histogram;
+        previousMeanSad_ = analysis->meanSad;
+        previous_.swap(current_);
+    }
+
+    cols_ = cols;
+    rows_ = rows;
+    step_ = step;
+    previousFormat_ = frame.format;
+    if (analysis->sceneCut) framesSinceCut_ = 0;
+    frame.analysis = analysis;
+
+    stats_.frames++;
+    if (analysis->sceneCut) stats_.sceneCuts++;
+    totalAnalyzeMs_ += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    totalMotionActivity_ += analysis->motionActivity;
+    stats_.avgAnalyzeMs = totalAnalyzeMs_ / stats_.frames;
+    stats_.avgMotionActivity = totalMotionActivity_ / stats_.frames;
+    return analysis;
+}
@@ -0,0 +1,72 @@
+#ifndef CONTENT_ANALYZER_H
+#define CONTENT_ANALYZER_H
+
+#include "VideoFrame.h"
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+struct ContentAnalyzerConfig {
+    int sampleStep = 8;            // Luma is averaged over sampleStep x sampleStep cells (multiple of 4, 4..32)
+    int motionCellSize = 64;       // Motion map cell edge in frame pixels
+    double motionThreshold = 4.0;  // Mean luma difference above which a motion cell counts as moving
+    double cutThreshold = 0.45;    // sceneChangeScore at or above which a frame is a scene cut
+    int minCutInterval = 5;        // Frames after a cut before the next one can be declared
+};
+
+struct ContentAnalyzerStats {
+    uint64_t frames = 0;
+    uint64_t sceneCuts = 0;
+    double avgAnalyzeMs = 0.0;
+    double avgMotionActivity = 0.0;
+};
+
+// Per-frame content analysis for the encoder. Each frame is reduced to a
+// grid of mean luma values with SIMD (SSE2, scalar elsewhere), reading
+// every other row; the grid is compared with the previous frame's for a
+// scene-change score (luma histogram distance plus the jump in mean SAD,
+// so steady motion does not read as a cut) and a coarse motion map. The
+// result is attached to the frame as VideoFrame::analysis. Not
+// thread-safe; run it where frames are already serialized.
+class ContentAnalyzer {
+public:
+    explicit ContentAnalyzer(const ContentAnalyzerConfig& config = ContentAnalyzerConfig());
+
+    void setConfig(const ContentAnalyzerConfig& config);
+    const ContentAnalyzerConfig& getConfig() const { return config_; }
+
+    // Analyzes `frame`, attaches the result to it and returns it. Null for
+    // frames too small to analyze.
+    std::shared_ptr<const FrameAnalysis> process(VideoFrame& frame);
+
+    // Forgets the previous frame; the next one is reported as a cut
+    void reset();
+
+    ContentAnalyzerStats getStats() const { return stats_; }
+
+    // Mean luma of each step x step cell over its odd rows, row-major;
+    // RGBA luma is (R + 2G + B) / 4. step is rounded down to a multiple of
+    // 4 in 4..32 (smaller for tiny frames); partial edge cells are left out.
+    static bool downsampleLuma(const VideoFrame& frame, int step, std::vector<uint8_t>& cells, int& cols,
+                               int& rows);
+
+private:
+    ContentAnalyzerConfig config_;
+    std::vector<uint8_t> current_;
+    std::vector<uint8_t> previous_;
+    std::vector<uint8_t> diff_;
+    int cols_;
+    int rows_;
+    int step_;
+    VideoFrame::Format previousFormat_;
+    std::array<uint32_t, 64> previousHistogram_;
+    double previousMeanSad_;
+    int framesSinceCut_;
+
+    ContentAnalyzerStats stats_;
+    double totalAnalyzeMs_;
+    double totalMotionActivity_;
+};
+
+#endif // CONTENT_ANALYZER_H
@@ -0,0 +1,234 @@
+#include "FrameChangeDetector.h"
+#include <algorithm>
+#include <chrono>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define FRAME_SAD_SSE2 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define FRAME_SAD_NEON 1
+#endif
+
+namespace {
+
+// Subsampling divisor of a plane relative to the luma/RGBA grid
+int planeDivisor(const VideoFrame& frame, int index) {
+    return (frame.format != VideoFrame::Format::RGBA && index > 0) ? 2 : 1;
+}
+
+void setAllChanged(VideoFrame& frame, int tileSize) {
+    auto map = std::make_shared<TileChangeMap>();
+    map->tileSize = tileSize;
+    map->tilesX = (frame.width + tileSize - 1) / tileSize;
+    map->tilesY = (frame.height + tileSize - 1) / tileSize;
+    map->tiles.assign((size_t)map->tilesX * map->tilesY, 1);
+    map->changedTiles = (int)map->tiles.size();
+    frame.unchanged = false;
+    frame.dirtyRects.assign(1, VideoRect{0, 0, frame.width, frame.height});
+    frame.changeMap = std::move(map);
+}
+
+// Horizontal runs of changed tiles per tile row, each merged into the
+// rect above it when that rect spans exactly the same columns.
+std::vector<VideoRect> rectsFromTiles(const TileChangeMap& map, int width, int height) {
+    std::vector<VideoRect> rects;
+    std::vector<size_t> open, nextOpen; // Rects ending on the current row boundary
+    for (int ty = 0; ty < map.tilesY; ++ty) {
+        int y = ty * map.tileSize;
+        int h = std::min(map.tileSize, height - y);
+        nextOpen.clear();
+        for (int tx = 0; tx < map.tilesX;) {
+            if (!map.changed(tx, ty)) { ++tx; continue; }
+            int start = tx;
+            while (tx < map.tilesX && map.changed(tx, ty)) ++tx;
+            int x = start * map.tileSize;
+            int w = std::min(tx * map.tileSize, width) - x;
+
+            auto above = std::find_if(open.begin(), open.end(), [&](size_t i) {
+                return rects[i].x == x && rects[i].width == w;
+            });
+            if (above != open.end()) {
+                rects[*above].height += h;
+                nextOpen.push_back(*above);
+            } else {
+                nextOpen.push_back(rects.size());
+                rects.push_back({x, y, w, h});
+            }
+        }
+        open.swap(nextOpen);
+    }
+    return rects;
+}
+
+} // namespace
+
+FrameChangeDetector::FrameChangeDetector(const ChangeDetectorConfig& config)
+    : config_(config), referenceIsPrevious_(false), totalCompareMs_(0.0), totalChangedFraction_(0.0) {
+    config_.tileSize = std::max(8, config_.tileSize);
+}
+
+void FrameChangeDetector::setConfig(const ChangeDetectorConfig& config) {
+    config_ = config;
+    config_.tileSize = std::max(8, config_.tileSize);
+    // Maps from the old grid are not comparable with the new one
+    reset();
+}
+
+void FrameChangeDetector::reset() {
+    reference_ = VideoFrame();
+    referenceIsPrevious_ = false;
+}
+
+uint64_t FrameChangeDetector::blockSad(const uint8_t* a, const uint8_t* b, size_t bytes) {
+    uint64_t sum = 0;
+    size_t i = 0;
+#if defined(FRAME_SAD_SSE2)
+    // psadbw sums |a - b| of 8 bytes into each 64-bit half
+    __m128i acc0 = _mm_setzero_si128();
+    __m128i acc1 = _mm_setzero_si128();
+    for (; i + 64 <= bytes; i += 64) {
+        __m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i + 16));
+        __m128i a2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i + 32));
+        __m128i a3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i + 48));
+        __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i + 16));
+        __m128i b2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i + 32));
+        __m128i b3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i + 48));
+        acc0 = _mm_add_epi64(acc0, _mm_add_epi64(_mm_sad_epu8(a0, b0), _mm_sad_epu8(a1, b1)));
+        acc1 = _mm_add_epi64(acc1, _mm_add_epi64(_mm_sad_epu8(a2, b2), _mm_sad_epu8(a3, b3)));
+    }
+    for (; i + 16 <= bytes; i += 16) {
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        acc0 = _mm_add_epi64(acc0, _mm_sad_epu8(va, vb));
+    }
+    __m128i acc = _mm_add_epi64(acc0, acc1);
+    alignas(16) uint64_t halves[2];
+    _mm_store_si128(reinterpret_cast<__m128i*>(halves), acc);
+    sum = halves[0] + halves[1];
+#elif defined(FRAME_SAD_NEON)
+    uint32x4_t acc = vdupq_n_u32(0);
+    for (; i + 16 <= bytes; i += 16) {
+        uint8x16_t diff = vabdq_u8(vld1q_u8(a + i), vld1q_u8(b + i));
+        acc = vpadalq_u16(acc, vpaddlq_u8(diff));
+    }
+    sum = (uint64_t)vgetq_lane_u32(acc, 0) + vgetq_lane_u32(acc, 1) +
+          vgetq_lane_u32(acc, 2) + vgetq_lane_u32(acc, 3);
+#endif
+    for (; i < bytes; ++i) {
+        sum += a[i] > b[i] ? a[i] - b[i] : b[i] - a[i];
+    }
+    return sum;
+}
+
+bool FrameChangeDetector::tileChanged(const VideoFrame& frame, int tx, int ty) const {
+    int x0 = tx * config_.tileSize;
+    int y0 = ty * config_.tileSize;
+    int x1 = std::min(x0 + config_.tileSize, frame.width);
+    int y1 = std::min(y0 + config_.tileSize, frame.height);
+
+    for (int i = 0; i < frame.planeCount; ++i) {
+        int div = planeDivisor(frame, i);
+        int bps = frame.planeRowBytes(i) / std::max(1, frame.planeWidth(i));
+        int px0 = x0 / div, px1 = std::min(frame.planeWidth(i), (x1 + div - 1) / div);
+        int py0 = y0 / div, py1 = std::min(frame.planeHeight(i), (y1 + div - 1) / div);
+        size_t rowBytes = (size_t)(px1 - px0) * bps;
+        if (rowBytes == 0 || py1 <= py0) continue;
+
+        // Stop as soon as the tile is over budget; only static tiles are read in full
+        double limit = config_.tileThreshold * rowBytes * (py1 - py0);
+        uint64_t sad = 0;
+        const uint8_t* cur = frame.plane(i) + (size_t)py0 * frame.stride(i) + (size_t)px0 * bps;
+        const uint8_t* ref = reference_.plane(i) + (size_t)py0 * reference_.stride(i) + (size_t)px0 * bps;
+        for (int y = py0; y < py1; ++y) {
+            sad += blockSad(cur, ref, rowBytes);
+            if ((double)sad > limit) return true;
+            cur += frame.stride(i);
+            ref += reference_.stride(i);
+        }
+    }
+    return false;
+}
+
+bool FrameChangeDetector::hintCovers(const VideoFrame& frame, int tx, int ty) const {
+    int x0 = tx * config_.tileSize, y0 = ty * config_.tileSize;
+    int x1 = x0 + config_.tileSize, y1 = y0 + config_.tileSize;
+    for (const auto& r : frame.dirtyRects) {
+        if (r.x < x1 && r.x + r.width > x0 && r.y < y1 && r.y + r.height > y0) return true;
+    }
+    return false;
+}
+
+bool FrameChangeDetector::process(VideoFrame& frame) {
+    if (frame.empty()) return true;
+    auto start = std::chrono::steady_clock::now();
+    stats_.frames++;
+
+    auto finish = [this, start](double changedFraction) {
+        totalCompareMs_ += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        totalChangedFraction_ += changedFraction;
+        stats_.avgCompareMs = totalCompareMs_ / stats_.frames;
+        stats_.avgChangedFraction = totalChangedFraction_ / stats_.frames;
+    };
+
+    // The producer already knows nothing moved (e.g. no X damage)
+    if (frame.unchanged) {
+        stats_.hintedFrames++;
+        stats_.unchangedFrames++;
+        finish(0.0);
+        return false;
+    }
+
+    if (reference_.empty() || reference_.width != frame.width || reference_.height != frame.height ||
+        reference_.format != frame.format) {
+        setAllChanged(frame, config_.tileSize);
+        reference_ = frame;
+        referenceIsPrevious_ = true;
+        finish(1.0);
+        return true;
+    }
+
+    auto map = std::make_shared<TileChangeMap>();
+    map->tileSize = config_.tileSize;
+    map->tilesX = (frame.width + config_.tileSize - 1) / config_.tileSize;
+    map->tilesY = (frame.height + config_.tileSize - 1) / config_.tileSize;
+    map->tiles.assign((size_t)map->tilesX * map->tilesY, 0);
+
+    // Same buffer as the reference: nothing to compare
+    bool sameBuffer = frame.buffer == reference_.buffer && frame.plane(0) == reference_.plane(0);
+    bool useHints = referenceIsPrevious_ && !frame.dirtyRects.empty();
+    if (!sameBuffer) {
+        for (int ty = 0; ty < map->tilesY; ++ty) {
+            for (int tx = 0; tx < map->tilesX; ++tx) {
+                if (useHints && !hintCovers(frame, tx, ty)) continue;
+                if (tileChanged(frame, tx, ty)) {
+                    map->tiles[(size_t)ty * map->tilesX + tx] = 1;
+                    map->changedTiles++;
+                }
+            }
+        }
+    }
+
+    double fraction = map->changedFraction();
+    if (map->changedTiles == 0 || fraction <= config_.unchangedFraction) {
+        // Keep comparing against the last changed frame so slow drift
+        // still adds up to a change eventually
+        frame.unchanged = true;
+        frame.dirtyRects.clear();
+        frame.changeMap = std::move(map);
+        referenceIsPrevious_ = sameBuffer;
+        stats_.unchangedFrames++;
+        finish(fraction);
+        return false;
+    }
+
+    frame.unchanged = false;
+    frame.dirtyRects = rectsFromTiles(*map, frame.width, frame.height);
+    frame.changeMap = std::move(map);
+    reference_ = frame;
+    referenceIsPrevious_ = true;
+    finish(fraction);
+    return true;
+}
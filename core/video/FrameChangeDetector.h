@@ -0,0 +1,60 @@
+#ifndef FRAME_CHANGE_DETECTOR_H
+#define FRAME_CHANGE_DETECTOR_H
+
+#include "VideoFrame.h"
+#include <cstdint>
+#include <cstddef>
+
+struct ChangeDetectorConfig {
+    int tileSize = 32;              // Tile edge in pixels (luma/RGBA coordinates)
+    double tileThreshold = 0.0;     // Mean absolute difference per byte above which a tile counts as changed (0 = exact)
+    double unchangedFraction = 0.0; // Frame is unchanged when at most this share of tiles changed
+};
+
+struct ChangeDetectorStats {
+    uint64_t frames = 0;
+    uint64_t unchangedFrames = 0;
+    uint64_t hintedFrames = 0;    // Frames the producer had already flagged unchanged
+    double avgCompareMs = 0.0;
+    double avgChangedFraction = 0.0;
+};
+
+// Compares each frame against the last changed one, tile by tile, using a
+// SIMD sum of absolute differences (SSE2 / NEON, scalar elsewhere).
+// Marks the frame unchanged or fills dirtyRects and changeMap so later
+// stages (conversion, scaling, encoder submission) can skip or do partial
+// work. Not thread-safe; run it where frames are already serialized.
+class FrameChangeDetector {
+public:
+    explicit FrameChangeDetector(const ChangeDetectorConfig& config = ChangeDetectorConfig());
+
+    void setConfig(const ChangeDetectorConfig& config);
+    const ChangeDetectorConfig& getConfig() const { return config_; }
+
+    // Annotates `frame` in place. Returns true if it differs from the
+    // reference, false if it is unchanged.
+    bool process(VideoFrame& frame);
+
+    // Forgets the reference; the next frame is reported fully changed
+    void reset();
+
+    ChangeDetectorStats getStats() const { return stats_; }
+
+    // Sum of absolute differences over `bytes` bytes
+    static uint64_t blockSad(const uint8_t* a, const uint8_t* b, size_t bytes);
+
+private:
+    bool tileChanged(const VideoFrame& frame, int tx, int ty) const;
+    bool hintCovers(const VideoFrame& frame, int tx, int ty) const;
+
+    ChangeDetectorConfig config_;
+    VideoFrame reference_;
+    // True while reference_ is the frame right before the next one, so the
+    // producer's dirtyRects describe the difference to it as well
+    bool referenceIsPrevious_;
+    ChangeDetectorStats stats_;
+    double totalCompareMs_;
+    double totalChangedFraction_;
+};
+
+#endif // FRAME_CHANGE_DETECTOR_H
@@ -0,0 +1,170 @@
+#include "FrameScheduler.h"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <chrono>
+#include <ctime>
+#include <limits>
+
+namespace {
+
+// Coarse waits use the condition variable (so subscribe/stop can interrupt
+// them); the final stretch is an absolute clock_nanosleep for precision.
+constexpr int64_t kPreciseSleepWindowNs = 2000000;
+
+// Subscriptions whose deadline falls within this window are released in the
+// same wakeup, which is what lines up 30 and 60 fps sources.
+constexpr int64_t kCoalesceWindowNs = 200000;
+
+void sleepUntil(int64_t deadlineNs) {
+    timespec ts;
+    ts.tv_sec = deadlineNs / 1000000000LL;
+    ts.tv_nsec = deadlineNs % 1000000000LL;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+    }
+}
+
+} // namespace
+
+FrameRate FrameRate::fromFps(double fps) {
+    // Recognise the NTSC family so 29.97 becomes exactly 30000/1001
+    double ntsc = fps * 1.001;
+    if (std::fabs(ntsc - std::round(ntsc)) < 0.01 && std::fabs(fps - std::round(fps)) > 0.01) {
+        return {(int)std::lround(ntsc) * 1000, 1001};
+    }
+    if (std::fabs(fps - std::round(fps)) < 1e-6) {
+        return {(int)std::lround(fps), 1};
+    }
+    return {(int)std::lround(fps * 1000), 1000};
+}
+
+FrameScheduler::FrameScheduler() : nextId_(1), epochNs_(monotonicNowNs()), stopping_(false) {
+    thread_ = std::thread(&FrameScheduler::run, this);
+}
+
+FrameScheduler::~FrameScheduler() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+        for (auto& entry : subscriptions_) {
+            entry.second->closed = true;
+            entry.second->ready.notify_all();
+        }
+    }
+    changed_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+FrameScheduler& FrameScheduler::getInstance() {
+    // Intentionally never destroyed: sources held by other singletons may
+    // still unsubscribe during static destruction.
+    static FrameScheduler* instance = new FrameScheduler();
+    return *instance;
+}
+
+int64_t FrameScheduler::monotonicNowNs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+int64_t FrameScheduler::deadlineFor(const FrameRate& rate, uint64_t tick) const {
+    // epoch + tick * den / num seconds, exact in integer arithmetic
+    unsigned __int128 ns = (unsigned __int128)tick * (uint64_t)rate.den * 1000000000ULL / (uint64_t)rate.num;
+    return epochNs_ + (int64_t)ns;
+}
+
+uint64_t FrameScheduler::ticksAt(const FrameRate& rate, int64_t timeNs) const {
+    if (timeNs <= epochNs_) return 0;
+    unsigned __int128 elapsed = (unsigned __int128)(timeNs - epochNs_) * (uint64_t)rate.num;
+    return (uint64_t)(elapsed / ((uint64_t)rate.den * 1000000000ULL));
+}
+
+int FrameScheduler::subscribe(FrameRate rate) {
+    if (rate.num <= 0 || rate.den <= 0) {
+        rate = FrameRate();
+    }
+    auto sub = std::make_shared<Subscription>();
+    sub->rate = rate;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    sub->nextTick = ticksAt(rate, monotonicNowNs()) + 1;
+    int id = nextId_++;
+    subscriptions_[id] = sub;
+    changed_.notify_all();
+    return id;
+}
+
+void FrameScheduler::unsubscribe(int id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = subscriptions_.find(id);
+    if (it == subscriptions_.end()) return;
+    it->second->closed = true;
+    it->second->ready.notify_all();
+    subscriptions_.erase(it);
+    changed_.notify_all();
+}
+
+bool FrameScheduler::waitForTick(int id, Tick& tick) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto it = subscriptions_.find(id);
+    if (it == subscriptions_.end()) return false;
+
+    // Hold a reference: unsubscribe() may erase the map entry while we wait
+    std::shared_ptr<Subscription> sub = it->second;
+    sub->ready.wait(lock, [&sub]() { return sub->pending || sub->closed; });
+    if (sub->closed) return false;
+
+    sub->pending = false;
+    tick.index = sub->readyTick;
+    tick.deadlineNs = deadlineFor(sub->rate, sub->readyTick);
+    tick.missed = sub->missed;
+    sub->missed = 0;
+    return true;
+}
+
+void FrameScheduler::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_) {
+        if (subscriptions_.empty()) {
+            changed_.wait(lock);
+            continue;
+        }
+
+        int64_t earliest = std::numeric_limits<int64_t>::max();
+        for (const auto& entry : subscriptions_) {
+            earliest = std::min(earliest, deadlineFor(entry.second->rate, entry.second->nextTick));
+        }
+
+        int64_t now = monotonicNowNs();
+        if (earliest - now > kPreciseSleepWindowNs) {
+            // Interruptible coarse wait; re-evaluate in case subscriptions changed
+            changed_.wait_for(lock, std::chrono::nanoseconds(earliest - now - kPreciseSleepWindowNs));
+            continue;
+        }
+
+        lock.unlock();
+        sleepUntil(earliest);
+        lock.lock();
+
+        now = monotonicNowNs();
+        for (auto& entry : subscriptions_) {
+            Subscription& sub = *entry.second;
+            if (deadlineFor(sub.rate, sub.nextTick) > now + kCoalesceWindowNs) continue;
+
+            // If we woke late, release only the most recent due tick
+            uint64_t due = std::max(sub.nextTick, ticksAt(sub.rate, now + kCoalesceWindowNs));
+            sub.missed += due - sub.nextTick;
+            if (sub.pending) {
+                // Consumer has not picked up the previous tick yet
+                sub.missed++;
+            }
+            sub.readyTick = due;
+            sub.nextTick = due + 1;
+            sub.pending = true;
+            sub.ready.notify_all();
+        }
+    }
+}
@@ -0,0 +1,73 @@
+#ifndef FRAME_SCHEDULER_H
+#define FRAME_SCHEDULER_H
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+// Exact rational frame rate, e.g. {30000, 1001} for 29.97 fps
+struct FrameRate {
+    int num = 30;
+    int den = 1;
+
+    double fps() const { return den > 0 ? (double)num / den : 0.0; }
+    int64_t intervalNs() const { return num > 0 ? (int64_t)den * 1000000000LL / num : 0; }
+
+    static FrameRate fromFps(double fps);
+};
+
+// Central frame clock. Every subscription is paced against one shared
+// epoch with absolute deadlines (clock_nanosleep TIMER_ABSTIME), so there is
+// no cumulative drift, and sources running at the same (or a multiple)
+// rate are woken on the very same tick.
+class FrameScheduler {
+public:
+    struct Tick {
+        uint64_t index = 0;     // Frame number since the shared epoch at this rate
+        int64_t deadlineNs = 0; // CLOCK_MONOTONIC time the tick was due
+        uint64_t missed = 0;    // Ticks skipped since the previous wakeup
+    };
+
+    FrameScheduler();
+    ~FrameScheduler();
+
+    static FrameScheduler& getInstance();
+
+    // Returns a subscription id; its first tick is the next one on the epoch grid
+    int subscribe(FrameRate rate);
+    void unsubscribe(int id);
+
+    // Blocks until the subscription's next tick. Returns false once the
+    // subscription is removed or the scheduler shuts down.
+    bool waitForTick(int id, Tick& tick);
+
+    static int64_t monotonicNowNs();
+
+private:
+    struct Subscription {
+        FrameRate rate;
+        uint64_t nextTick = 0;
+        uint64_t readyTick = 0;
+        uint64_t missed = 0;
+        bool pending = false;
+        bool closed = false;
+        std::condition_variable ready;
+    };
+
+    int64_t deadlineFor(const FrameRate& rate, uint64_t tick) const;
+    uint64_t ticksAt(const FrameRate& rate, int64_t timeNs) const;
+    void run();
+
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    std::map<int, std::shared_ptr<Subscription>> subscriptions_;
+    int nextId_;
+    int64_t epochNs_;
+    bool stopping_;
+    std::thread thread_;
+};
+
+#endif // FRAME_SCHEDULER_H
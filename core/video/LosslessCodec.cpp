@@ -0,0 +1,310 @@
+#include "LosslessCodec.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define LOSSLESS_SSE2 1
+#endif
+
+namespace {
+
+constexpr uint8_t kMagic[4] = {'H', 'M', 'L', '1'};
+constexpr int kGroup = 16;
+constexpr int kPad = 16;           // Zero bytes left of each row buffer, so x - bpp stays in bounds
+constexpr uint8_t kZeroRun = 0x80; // Token (kZeroRun | n): n + 1 all-zero groups
+constexpr int kMaxRun = 128;
+constexpr int kMaxDimension = 16384;
+
+int roundUp(int v, int to) {
+    return (v + to - 1) / to * to;
+}
+
+struct PlaneGeometry {
+    int rowBytes;
+    int rows;
+    int bpp;       // Bytes between horizontally adjacent samples of one channel
+    int sliceRows; // Plane rows per slice
+};
+
+PlaneGeometry planeGeometry(const VideoFrame& frame, int index, int sliceRows) {
+    PlaneGeometry g;
+    g.rowBytes = frame.planeRowBytes(index);
+    g.rows = frame.planeHeight(index);
+    g.bpp = std::max(1, g.rowBytes / std::max(1, frame.planeWidth(index)));
+    bool chroma = frame.format != VideoFrame::Format::RGBA && index > 0;
+    g.sliceRows = chroma ? sliceRows / 2 : sliceRows;
+    return g;
+}
+
+void putU16(std::vector<uint8_t>& out, uint32_t v) {
+    out.push_back((uint8_t)v);
+    out.push_back((uint8_t)(v >> 8));
+}
+
+void putU32(std::vector<uint8_t>& out, uint32_t v) {
+    putU16(out, v & 0xFFFF);
+    putU16(out, v >> 16);
+}
+
+uint32_t getU16(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8);
+}
+
+uint32_t getU32(const uint8_t* p) {
+    return getU16(p) | (getU16(p + 2) << 16);
+}
+
+// RGBA rows are coded as (R - G, G, B - G, A), which removes most of the
+// correlation between channels; other planes are coded as they are
+void toCodingSpace(const uint8_t* src, uint8_t* dst, int rowBytes, bool rgba) {
+    if (!rgba) {
+        std::memcpy(dst, src, rowBytes);
+        return;
+    }
+    int i = 0;
+#if defined(LOSSLESS_SSE2)
+    const __m128i low = _mm_set1_epi32(0xFF);
+    for (; i + 16 <= rowBytes; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m128i g = _mm_and_si128(_mm_srli_epi32(v, 8), low);
+        __m128i rb = _mm_or_si128(g, _mm_slli_epi32(g, 16));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_sub_epi8(v, rb));
+    }
+#endif
+    for (; i < rowBytes; i += 4) {
+        uint8_t g = src[i + 1];
+        dst[i] = (uint8_t)(src[i] - g);
+        dst[i + 1] = g;
+        dst[i + 2] = (uint8_t)(src[i + 2] - g);
+        dst[i + 3] = src[i + 3];
+    }
+}
+
+void fromCodingSpace(const uint8_t* src, uint8_t* dst, int rowBytes, bool rgba) {
+    if (!rgba) {
+        std::memcpy(dst, src, rowBytes);
+        return;
+    }
+    for (int i = 0; i < rowBytes; i += 4) {
+        uint8_t g = src[i + 1];
+        dst[i] = (uint8_t)(src[i] + g);
+        dst[i + 1] = g;
+        dst[i + 2] = (uint8_t)(src[i + 2] + g);
+        dst[i + 3] = src[i + 3];
+    }
+}
+
+inline int medianPredict(int a, int b, int c) {
+    int lo = std::min(a, b), hi = std::max(a, b);
+    return c >= hi ? lo : (c <= lo ? hi : a + b - c);
+}
+
+// Zigzagged prediction residuals of one row (a = left, b = above,
+// c = above-left), padded with zeros to whole groups
+void residualRow(const uint8_t* cur, const uint8_t* prev, int rowBytes, int bpp, uint8_t* out) {
+    int i = 0;
+#if defined(LOSSLESS_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i lowByte = _mm_set1_epi16(0xFF);
+    for (; i < rowBytes; i += 16) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cur + i));
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cur + i - bpp));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(prev + i));
+        __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(prev + i - bpp));
+        __m128i halves[2];
+        for (int h = 0; h < 2; ++h) {
+            __m128i x16 = h ? _mm_unpackhi_epi8(x, zero) : _mm_unpacklo_epi8(x, zero);
+            __m128i a16 = h ? _mm_unpackhi_epi8(a, zero) : _mm_unpacklo_epi8(a, zero);
+            __m128i b16 = h ? _mm_unpackhi_epi8(b, zero) : _mm_unpacklo_epi8(b, zero);
+            __m128i c16 = h ? _mm_unpackhi_epi8(c, zero) : _mm_unpacklo_epi8(c, zero);
+            // median(a, b, a + b - c) == the LOCO-I predictor
+            __m128i gradient = _mm_sub_epi16(_mm_add_epi16(a16, b16), c16);
+            __m128i pred = _mm_max_epi16(_mm_min_epi16(a16, b16),
+                                         _mm_min_epi16(_mm_max_epi16(a16, b16), gradient));
+            halves[h] = _mm_and_si128(_mm_sub_epi16(x16, pred), lowByte);
+        }
+        __m128i r = _mm_packus_epi16(halves[0], halves[1]);
+        // Zigzag: 0, -1, 1, -2, ... -> 0, 1, 2, 3, ...
+        __m128i sign = _mm_cmpgt_epi8(zero, r);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_xor_si128(_mm_add_epi8(r, r), sign));
+    }
+#else
+    for (; i < rowBytes; ++i) {
+        int8_t r = (int8_t)(uint8_t)(cur[i] - medianPredict(cur[i - bpp], prev[i], prev[i - bpp]));
+        out[i] = (uint8_t)((r << 1) ^ (r >> 7));
+    }
+#endif
+    std::memset(out + rowBytes, 0, roundUp(rowBytes, kGroup) - rowBytes);
+}
+
+class GroupWriter {
+public:
+    explicit GroupWriter(std::vector<uint8_t>& out) : out_(out), run_(0) {}
+
+    void write(const uint8_t* z) {
+        uint8_t peak = 0;
+        for (int k = 0; k < kGroup; ++k) peak = std::max(peak, z[k]);
+        if (peak == 0) {
+            if (++run_ == kMaxRun) flush();
+            return;
+        }
+        flush();
+        int bits = 0;
+        while ((1 << bits) <= peak) ++bits;
+        out_.push_back((uint8_t)bits);
+        // Two halves of 8 values, `bits` bytes each
+        for (int h = 0; h < 2; ++h) {
+            uint64_t packed = 0;
+            for (int j = 0; j < 8; ++j) packed |= (uint64_t)z[h * 8 + j] << (j * bits);
+            for (int k = 0; k < bits; ++k) out_.push_back((uint8_t)(packed >> (8 * k)));
+        }
+    }
+
+    void flush() {
+        if (run_ > 0) out_.push_back((uint8_t)(kZeroRun | (run_ - 1)));
+        run_ = 0;
+    }
+
+private:
+    std::vector<uint8_t>& out_;
+    int run_;
+};
+
+class GroupReader {
+public:
+    GroupReader(const uint8_t* data, const uint8_t* end) : p_(data), end_(end), run_(0) {}
+
+    bool read(uint8_t* z) {
+        if (run_ > 0) {
+            run_--;
+            std::memset(z, 0, kGroup);
+            return true;
+        }
+        if (p_ >= end_) return false;
+        uint8_t token = *p_++;
+        if (token & kZeroRun) {
+            run_ = token & 0x7F;
+            std::memset(z, 0, kGroup);
+            return true;
+        }
+        int bits = token;
+        if (bits < 1 || bits > 8 || end_ - p_ < 2 * bits) return false;
+        uint32_t mask = (1u << bits) - 1;
+        for (int h = 0; h < 2; ++h) {
+            uint64_t packed = 0;
+            for (int k = 0; k < bits; ++k) packed |= (uint64_t)p_[k] << (8 * k);
+            p_ += bits;
+            for (int j = 0; j < 8; ++j) z[h * 8 + j] = (uint8_t)((packed >> (j * bits)) & mask);
+        }
+        return true;
+    }
+
+    bool finished() const { return p_ == end_ && run_ == 0; }
+
+private:
+    const uint8_t* p_;
+    const uint8_t* end_;
+    int run_;
+};
+
+int maxRowBytes(const VideoFrame& frame) {
+    int bytes = 0;
+    for (int i = 0; i < frame.planeCount; ++i) bytes = std::max(bytes, frame.planeRowBytes(i));
+    return bytes;
+}
+
+} // namespace
+
+bool LosslessCodec::encode(const VideoFrame& frame, std::vector<uint8_t>& out, int sliceRows) {
+    if (frame.empty() || frame.width > kMaxDimension || frame.height > kMaxDimension) return false;
+    sliceRows = std::clamp(sliceRows & ~1, 2, 0xFFFE);
+    int sliceCount = (frame.height + sliceRows - 1) / sliceRows;
+    bool rgba = frame.format == VideoFrame::Format::RGBA;
+
+    out.insert(out.end(), kMagic, kMagic + 4);
+    putU32(out, (uint32_t)frame.width);
+    putU32(out, (uint32_t)frame.height);
+    out.push_back((uint8_t)frame.format);
+    out.push_back(0);
+    putU16(out, (uint32_t)sliceRows);
+    putU32(out, (uint32_t)sliceCount);
+    size_t table = out.size();
+    out.resize(out.size() + (size_t)sliceCount * 4);
+
+    int rowBuffer = kPad + roundUp(maxRowBytes(frame), kGroup) + kGroup;
+    std::vector<uint8_t> cur(rowBuffer, 0), prev(rowBuffer, 0), residuals(rowBuffer, 0);
+    out.reserve(out.size() + frame.packedSize() / 2);
+
+    for (int s = 0; s < sliceCount; ++s) {
+        size_t start = out.size();
+        GroupWriter writer(out);
+        for (int i = 0; i < frame.planeCount; ++i) {
+            PlaneGeometry g = planeGeometry(frame, i, sliceRows);
+            int r0 = s * g.sliceRows, r1 = std::min(g.rows, r0 + g.sliceRows);
+            // Slices start from zero context so they decode independently
+            std::fill(prev.begin(), prev.end(), 0);
+            for (int y = r0; y < r1; ++y) {
+                toCodingSpace(frame.plane(i) + (size_t)y * frame.stride(i), cur.data() + kPad, g.rowBytes, rgba && i == 0);
+                residualRow(cur.data() + kPad, prev.data() + kPad, g.rowBytes, g.bpp, residuals.data());
+                for (int x = 0; x < g.rowBytes; x += kGroup) writer.write(residuals.data() + x);
+                std::swap(cur, prev);
+            }
+        }
+        writer.flush();
+        uint32_t size = (uint32_t)(out.size() - start);
+        for (int k = 0; k < 4; ++k) out[table + (size_t)s * 4 + k] = (uint8_t)(size >> (8 * k));
+    }
+    return true;
+}
+
+bool LosslessCodec::decode(const uint8_t* data, size_t size, VideoFrame& frame) {
+    const size_t headerSize = 20;
+    if (!data || size < headerSize || std::memcmp(data, kMagic, 4) != 0) return false;
+    uint32_t width = getU32(data + 4), height = getU32(data + 8);
+    uint8_t formatCode = data[12];
+    int sliceRows = (int)getU16(data + 14);
+    uint32_t sliceCount = getU32(data + 16);
+    if (width == 0 || height == 0 || width > kMaxDimension || height > kMaxDimension ||
+        formatCode > (uint8_t)VideoFrame::Format::NV12 || sliceRows < 2 || (sliceRows & 1) ||
+        sliceCount != (height + sliceRows - 1) / sliceRows || size < headerSize + (size_t)sliceCount * 4) {
+        return false;
+    }
+
+    VideoFrame decoded((int)width, (int)height, (VideoFrame::Format)formatCode);
+    bool rgba = decoded.format == VideoFrame::Format::RGBA;
+    int rowBuffer = kPad + roundUp(maxRowBytes(decoded), kGroup) + kGroup;
+    std::vector<uint8_t> cur(rowBuffer, 0), prev(rowBuffer, 0);
+    uint8_t z[kGroup];
+
+    const uint8_t* payload = data + headerSize + (size_t)sliceCount * 4;
+    const uint8_t* end = data + size;
+    for (uint32_t s = 0; s < sliceCount; ++s) {
+        uint32_t sliceSize = getU32(data + headerSize + (size_t)s * 4);
+        if ((size_t)(end - payload) < sliceSize) return false;
+        GroupReader reader(payload, payload + sliceSize);
+        for (int i = 0; i < decoded.planeCount; ++i) {
+            PlaneGeometry g = planeGeometry(decoded, i, sliceRows);
+            int r0 = (int)s * g.sliceRows, r1 = std::min(g.rows, r0 + g.sliceRows);
+            std::fill(prev.begin(), prev.end(), 0);
+            for (int y = r0; y < r1; ++y) {
+                uint8_t* c = cur.data() + kPad;
+                const uint8_t* p = prev.data() + kPad;
+                for (int x0 = 0; x0 < g.rowBytes; x0 += kGroup) {
+                    if (!reader.read(z)) return false;
+                    int x1 = std::min(g.rowBytes, x0 + kGroup);
+                    for (int x = x0; x < x1; ++x) {
+                        int residual = (z[x - x0] >> 1) ^ -(z[x - x0] & 1);
+                        c[x] = (uint8_t)(medianPredict(c[x - g.bpp], p[x], p[x - g.bpp]) + residual);
+                    }
+                }
+                fromCodingSpace(c, decoded.plane(i) + (size_t)y * decoded.stride(i), g.rowBytes, rgba && i == 0);
+                std::swap(cur, prev);
+            }
+        }
+        if (!reader.finished()) return false;
+        payload += sliceSize;
+    }
+    frame = decoded;
+    return true;
+}
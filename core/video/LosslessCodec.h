@@ -0,0 +1,26 @@
+#ifndef LOSSLESS_CODEC_H
+#define LOSSLESS_CODEC_H
+
+#include "VideoFrame.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Fast lossless intra codec behind the in-tree encoder. A frame is cut into
+// horizontal slices of sliceRows luma rows that are coded independently.
+// Samples are predicted with the LOCO-I median edge predictor (RGBA after
+// a G-relative color transform) and the residuals are bit-packed in groups
+// of 16, with runs of all-zero groups collapsed into one byte, which suits
+// screen content. Residuals are computed with SSE2; decoding is scalar.
+class LosslessCodec {
+public:
+    static constexpr int kDefaultSliceRows = 64;
+
+    // Appends the encoded frame to `out`. False for empty frames.
+    static bool encode(const VideoFrame& frame, std::vector<uint8_t>& out, int sliceRows = kDefaultSliceRows);
+
+    // Decodes into a newly allocated frame. False on malformed input.
+    static bool decode(const uint8_t* data, size_t size, VideoFrame& frame);
+};
+
+#endif // LOSSLESS_CODEC_H
@@ -0,0 +1,184 @@
+#include "MultiCameraCapture.h"
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+
+namespace {
+
+uint64_t nowMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()
+    ).count();
+}
+
+// waitAny timeout; short enough that stop() is noticed promptly
+constexpr int64_t kWaitTimeoutNs = 100 * 1000 * 1000;
+
+} // namespace
+
+MultiCameraCapture::MultiCameraCapture(Mode mode) : mode_(mode), running_(false) {
+}
+
+MultiCameraCapture::~MultiCameraCapture() {
+    stop();
+    for (auto& camera : cameras_) {
+        camera->externallyDriven_ = false;
+    }
+}
+
+bool MultiCameraCapture::addCamera(std::shared_ptr<CameraSource> camera) {
+    if (!camera || running_) return false;
+    if (camera->running_) {
+        std::cerr << "MultiCameraCapture: " << camera->getName() << " is already running on its own thread"
+                  << std::endl;
+        return false;
+    }
+    camera->externallyDriven_ = true;
+    cameras_.push_back(std::move(camera));
+    return true;
+}
+
+void MultiCameraCapture::removeCamera(const std::shared_ptr<CameraSource>& camera) {
+    if (running_) return;
+    auto it = std::find(cameras_.begin(), cameras_.end(), camera);
+    if (it != cameras_.end()) {
+        (*it)->externallyDriven_ = false;
+        cameras_.erase(it);
+    }
+}
+
+bool MultiCameraCapture::start() {
+    if (running_) return true;
+
+    active_.clear();
+    for (auto& camera : cameras_) {
+        if (camera->openDevice()) {
+            camera->running_ = true;
+            active_.push_back(camera);
+        }
+    }
+    if (active_.empty()) {
+        std::cerr << "MultiCameraCapture: no camera could be opened" << std::endl;
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(statsMutex_);
+        stats_ = Stats();
+        stats_.activeMode = mode_;
+    }
+
+    running_ = true;
+    captureThread_ = std::thread(&MultiCameraCapture::captureLoop, this);
+    std::cout << "MultiCameraCapture started: " << active_.size() << " cameras on one thread" << std::endl;
+    return true;
+}
+
+void MultiCameraCapture::stop() {
+    if (!running_) return;
+
+    running_ = false;
+    if (captureThread_.joinable()) {
+        captureThread_.join();
+    }
+    for (auto& camera : active_) {
+        camera->running_ = false;
+        camera->closeDevice();
+    }
+    active_.clear();
+}
+
+MultiCameraCapture::Stats MultiCameraCapture::getStats() const {
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    return stats_;
+}
+
+void MultiCameraCapture::captureLoop() {
+    // cv::VideoCapture copies share the underlying device handle, which is
+    // what waitAny expects to receive.
+    std::vector<cv::VideoCapture> captures;
+    for (auto& camera : active_) {
+        captures.push_back(camera->capture_);
+    }
+
+    Mode mode = mode_;
+    while (running_) {
+        if (mode == Mode::WaitAny) {
+            if (!waitAnyRound(captures)) {
+                std::cerr << "MultiCameraCapture: waitAny unsupported by backend, "
+                          << "switching to synchronized grab" << std::endl;
+                mode = Mode::Synchronized;
+                std::lock_guard<std::mutex> lock(statsMutex_);
+                stats_.activeMode = mode;
+            }
+            continue;
+        }
+        synchronizedRound(captures);
+    }
+}
+
+bool MultiCameraCapture::waitAnyRound(std::vector<cv::VideoCapture>& captures) {
+    std::vector<int> ready;
+    try {
+        if (!cv::VideoCapture::waitAny(captures, ready, kWaitTimeoutNs)) {
+            return true; // Timed out; check running_ and wait again
+        }
+    } catch (const cv::Exception&) {
+        return false;
+    }
+
+    uint64_t timestamp = nowMicros();
+    uint64_t published = 0;
+    for (int index : ready) {
+        // waitAny already dequeued the buffer; retrieve() only decodes/copies it
+        cv::Mat rawFrame;
+        if (captures[index].retrieve(rawFrame)) {
+            active_[index]->handleRawFrame(rawFrame, timestamp);
+            published++;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    stats_.rounds++;
+    stats_.framesPublished += published;
+    return true;
+}
+
+void MultiCameraCapture::synchronizedRound(std::vector<cv::VideoCapture>& captures) {
+    // Latch every camera first so the exposures we keep are as close in time
+    // as the devices allow; the slower retrieve() work happens afterwards.
+    std::vector<uint64_t> grabTimes(captures.size(), 0);
+    std::vector<bool> grabbed(captures.size(), false);
+    bool any = false;
+    for (size_t i = 0; i < captures.size(); ++i) {
+        grabbed[i] = captures[i].grab();
+        grabTimes[i] = nowMicros();
+        any = any || grabbed[i];
+    }
+    if (!any) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        return;
+    }
+
+    uint64_t first = UINT64_MAX;
+    uint64_t last = 0;
+    uint64_t published = 0;
+    for (size_t i = 0; i < captures.size(); ++i) {
+        if (!grabbed[i]) continue;
+        cv::Mat rawFrame;
+        if (captures[i].retrieve(rawFrame)) {
+            active_[i]->handleRawFrame(rawFrame, grabTimes[i]);
+            first = std::min(first, grabTimes[i]);
+            last = std::max(last, grabTimes[i]);
+            published++;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    stats_.rounds++;
+    stats_.framesPublished += published;
+    if (published > 0) {
+        stats_.lastSkewMs = (last - first) / 1000.0;
+        stats_.maxSkewMs = std::max(stats_.maxSkewMs, stats_.lastSkewMs);
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef MULTI_CAMERA_CAPTURE_H
+#define MULTI_CAMERA_CAPTURE_H
+
+#include "CameraSource.h"
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <mutex>
+
+// Drives several cameras from a single thread instead of one blocking
+// read() thread per CameraSource. Frames are still published into each
+// camera's own mailbox, so consumers keep calling CameraSource::getFrame().
+class MultiCameraCapture {
+public:
+    enum class Mode {
+        // Sleep in cv::VideoCapture::waitAny (V4L2) and retrieve whichever
+        // cameras are ready. Falls back to Synchronized if unsupported.
+        WaitAny,
+        // grab() every camera back to back, then retrieve() them all, so
+        // frames of one round carry near-identical timestamps.
+        Synchronized
+    };
+
+    struct Stats {
+        uint64_t rounds = 0;
+        uint64_t framesPublished = 0;
+        double lastSkewMs = 0.0;  // Spread of grab times within the last synchronized round
+        double maxSkewMs = 0.0;
+        Mode activeMode = Mode::WaitAny;
+    };
+
+    explicit MultiCameraCapture(Mode mode = Mode::WaitAny);
+    ~MultiCameraCapture();
+
+    // Cameras must be added while stopped. Their own start()/stop() become
+    // no-ops until they are removed.
+    bool addCamera(std::shared_ptr<CameraSource> camera);
+    void removeCamera(const std::shared_ptr<CameraSource>& camera);
+
+    bool start();
+    void stop();
+
+    Stats getStats() const;
+
+private:
+    void captureLoop();
+    bool waitAnyRound(std::vector<cv::VideoCapture>& captures);
+    void synchronizedRound(std::vector<cv::VideoCapture>& captures);
+
+    Mode mode_;
+    std::vector<std::shared_ptr<CameraSource>> cameras_;
+    std::vector<std::shared_ptr<CameraSource>> active_;
+    std::atomic<bool> running_;
+    std::thread captureThread_;
+
+    mutable std::mutex statsMutex_;
+    Stats stats_;
+};
+
+#endif // MULTI_CAMERA_CAPTURE_H
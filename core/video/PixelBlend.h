@@ -0,0 +1,98 @@
+#ifndef PIXEL_BLEND_H
+#define PIXEL_BLEND_H
+
+// Premultiplied-alpha blending kernels shared by the compositor and the
+// text overlay. SSE2 where available, scalar elsewhere; both paths round
+// identically.
+
+#include <algorithm>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define PIXEL_BLEND_SSE2 1
+#endif
+
+// x / 255, rounded, for x in [0, 255 * 255]
+inline int div255(int x) {
+    return (x + 128 + ((x + 128) >> 8)) >> 8;
+}
+
+#if defined(PIXEL_BLEND_SSE2)
+inline __m128i div255x8(__m128i x) {
+    __m128i t = _mm_add_epi16(x, _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+// Alpha of each pixel copied into all four of its 16-bit lanes
+inline __m128i broadcastAlpha(__m128i px16) {
+    return _mm_shufflehi_epi16(_mm_shufflelo_epi16(px16, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+}
+#endif
+
+// Premultiplied RGBA "over" onto an opaque row: dst = src + dst * (1 - srcA)
+inline void blendPremultipliedSpan(const uint8_t* src, uint8_t* dst, int count) {
+    int x = 0;
+#if defined(PIXEL_BLEND_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alpha = _mm_set1_epi32((int)0xFF000000u);
+    const __m128i full = _mm_set1_epi16(255);
+    for (; x + 4 <= count; x += 4) {
+        __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 4));
+        int opaqueMask = _mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(s, alpha), alpha));
+        if (opaqueMask == 0xFFFF) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4), s);
+            continue;
+        }
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(s, alpha), zero)) == 0xFFFF) {
+            continue; // Fully transparent, e.g. outside a rounded corner
+        }
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + x * 4));
+        __m128i sLo = _mm_unpacklo_epi8(s, zero), sHi = _mm_unpackhi_epi8(s, zero);
+        __m128i dLo = _mm_unpacklo_epi8(d, zero), dHi = _mm_unpackhi_epi8(d, zero);
+        dLo = div255x8(_mm_mullo_epi16(dLo, _mm_sub_epi16(full, broadcastAlpha(sLo))));
+        dHi = div255x8(_mm_mullo_epi16(dHi, _mm_sub_epi16(full, broadcastAlpha(sHi))));
+        __m128i out = _mm_packus_epi16(_mm_add_epi16(sLo, dLo), _mm_add_epi16(sHi, dHi));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4), out);
+    }
+#endif
+    for (; x < count; ++x) {
+        const uint8_t* s = src + x * 4;
+        uint8_t* d = dst + x * 4;
+        int inv = 255 - s[3];
+        for (int c = 0; c < 4; ++c) {
+            d[c] = (uint8_t)std::min(255, s[c] + div255(d[c] * inv));
+        }
+    }
+}
+
+// Single-channel variant with a separate alpha row, for Y/U/V planes:
+// dst = src + dst * (1 - alpha), src already premultiplied
+inline void blendPremultipliedPlane(const uint8_t* src, const uint8_t* alpha, uint8_t* dst, int count) {
+    int x = 0;
+#if defined(PIXEL_BLEND_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi8((char)0xFF);
+    const __m128i full = _mm_set1_epi16(255);
+    for (; x + 16 <= count; x += 16) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(alpha + x));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(a, zero)) == 0xFFFF) continue;
+        __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(a, ones)) == 0xFFFF) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), s);
+            continue;
+        }
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + x));
+        __m128i dLo = div255x8(_mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), _mm_sub_epi16(full, _mm_unpacklo_epi8(a, zero))));
+        __m128i dHi = div255x8(_mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), _mm_sub_epi16(full, _mm_unpackhi_epi8(a, zero))));
+        __m128i out = _mm_packus_epi16(_mm_add_epi16(_mm_unpacklo_epi8(s, zero), dLo),
+                                       _mm_add_epi16(_mm_unpackhi_epi8(s, zero), dHi));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), out);
+    }
+#endif
+    for (; x < count; ++x) {
+        dst[x] = (uint8_t)std::min(255, src[x] + div255(dst[x] * (255 - alpha[x])));
+    }
+}
+
+#endif // PIXEL_BLEND_H
@@ -0,0 +1,275 @@
+#include "PreviewService.h"
+#include "SourceManager.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define PREVIEW_SSE2 1
+#endif
+
+#ifdef __linux__
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+int64_t threadCpuNs() {
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// Adds `rows` RGBA rows into 16-bit sums (at most 257 rows fit)
+void sumRows(const uint8_t* const* rows, int rowCount, int bytes, uint16_t* sums) {
+    int x = 0;
+#if defined(PREVIEW_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    for (; x + 16 <= bytes; x += 16) {
+        __m128i lo = _mm_setzero_si128(), hi = _mm_setzero_si128();
+        for (int r = 0; r < rowCount; ++r) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[r] + x));
+            lo = _mm_add_epi16(lo, _mm_unpacklo_epi8(v, zero));
+            hi = _mm_add_epi16(hi, _mm_unpackhi_epi8(v, zero));
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(sums + x), lo);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(sums + x + 8), hi);
+    }
+#endif
+    for (; x < bytes; ++x) {
+        int sum = 0;
+        for (int r = 0; r < rowCount; ++r) sum += rows[r][x];
+        sums[x] = (uint16_t)sum;
+    }
+}
+
+// Preview size inside the configured box, keeping the aspect ratio and
+// never upscaling
+void fitSize(int srcWidth, int srcHeight, int boxWidth, int boxHeight, int& width, int& height) {
+    if ((int64_t)srcWidth * boxHeight > (int64_t)srcHeight * boxWidth) {
+        width = boxWidth;
+        height = (int)((int64_t)boxWidth * srcHeight / srcWidth);
+    } else {
+        height = boxHeight;
+        width = (int)((int64_t)boxHeight * srcWidth / srcHeight);
+    }
+    width = std::clamp(width, 1, srcWidth);
+    height = std::clamp(height, 1, srcHeight);
+}
+
+} // namespace
+
+PreviewService::PreviewService(const PreviewConfig& config)
+    : config_(config)
+    , framePool_(128)
+    , running_(false)
+    , subscription_(0)
+    , totalScaleMs_(0.0)
+    , startWallNs_(0)
+    , threadCpuNs_(0) {
+}
+
+PreviewService::~PreviewService() {
+    stop();
+}
+
+bool PreviewService::start() {
+    if (running_) return true;
+    running_ = true;
+    subscription_ = FrameScheduler::getInstance().subscribe(FrameRate::fromFps(config_.fps));
+    previewThread_ = std::thread(&PreviewService::previewLoop, this);
+    return true;
+}
+
+void PreviewService::stop() {
+    if (!running_) return;
+    running_ = false;
+    FrameScheduler::getInstance().unsubscribe(subscription_);
+    if (previewThread_.joinable()) {
+        previewThread_.join();
+    }
+}
+
+std::shared_ptr<const VideoFrame> PreviewService::getPreview(const std::string& sourceName) const {
+    auto previews = getPreviews();
+    if (!previews) return nullptr;
+    auto it = previews->find(sourceName);
+    return it != previews->end() ? it->second : nullptr;
+}
+
+std::shared_ptr<const PreviewService::PreviewMap> PreviewService::getPreviews() const {
+    return std::atomic_load(&previews_);
+}
+
+PreviewStats PreviewService::getStats() const {
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    PreviewStats stats = stats_;
+    int64_t wallNs = FrameScheduler::monotonicNowNs() - startWallNs_;
+    stats.cpuFraction = startWallNs_ && wallNs > 0 ? (double)threadCpuNs_ / wallNs : 0.0;
+    return stats;
+}
+
+void PreviewService::previewLoop() {
+#ifdef __linux__
+    // Lowest priority for this thread only (Linux nice values are per thread)
+    setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), 19);
+#endif
+    FrameScheduler::Tick tick;
+    while (running_ && FrameScheduler::getInstance().waitForTick(subscription_, tick)) {
+        update();
+    }
+}
+
+void PreviewService::update() {
+    int64_t cpuStart = threadCpuNs();
+    auto current = std::atomic_load(&previews_);
+    auto next = std::make_shared<PreviewMap>();
+    uint64_t produced = 0, skipped = 0;
+    double scaleMs = 0.0;
+
+    SourceManager& manager = SourceManager::getInstance();
+    for (const auto& name : manager.getSourceNames()) {
+        auto source = manager.getSource(name);
+        VideoFrame frame;
+        if (!source || !source->getLatestFrame(frame) || frame.empty()) continue;
+
+        SourceState& state = states_[name];
+        std::shared_ptr<const VideoFrame> previous;
+        if (current) {
+            auto it = current->find(name);
+            if (it != current->end()) previous = it->second;
+        }
+
+        // The very frame already previewed: nothing published since
+        if (previous && frame.buffer == state.buffer.lock() && frame.timestamp == state.timestamp) {
+            (*next)[name] = previous;
+            skipped++;
+            continue;
+        }
+        if (frame.format != VideoFrame::Format::RGBA) {
+            if (!state.warnedFormat) {
+                std::cerr << "PreviewService: " << name << " is not RGBA, no preview" << std::endl;
+                state.warnedFormat = true;
+            }
+            continue;
+        }
+
+        int width, height;
+        fitSize(frame.width, frame.height, config_.width, config_.height, width, height);
+        auto start = std::chrono::steady_clock::now();
+        // Pooled: a buffer returns only once no reader holds its preview
+        VideoFrame preview = framePool_.acquire(width, height, VideoFrame::Format::RGBA);
+        downscale(frame, preview, config_.sampleRows);
+        preview.timestamp = frame.timestamp;
+        scaleMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        state.buffer = frame.buffer;
+        state.timestamp = frame.timestamp;
+        (*next)[name] = std::make_shared<const VideoFrame>(std::move(preview));
+        produced++;
+    }
+
+    // Removed sources drop out of the snapshot, and their state with them
+    for (auto it = states_.begin(); it != states_.end();) {
+        if (!manager.getSource(it->first)) {
+            it = states_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    std::atomic_store(&previews_, std::shared_ptr<const PreviewMap>(std::move(next)));
+
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    if (!startWallNs_) startWallNs_ = FrameScheduler::monotonicNowNs();
+    stats_.rounds++;
+    stats_.previews += produced;
+    stats_.skippedUnchanged += skipped;
+    totalScaleMs_ += scaleMs;
+    stats_.avgScaleMs = stats_.previews ? totalScaleMs_ / stats_.previews : 0.0;
+    threadCpuNs_ += threadCpuNs() - cpuStart;
+}
+
+bool PreviewService::downscale(const VideoFrame& src, VideoFrame& dst, int sampleRows) {
+    if (src.empty() || dst.empty() || src.format != VideoFrame::Format::RGBA ||
+        dst.format != VideoFrame::Format::RGBA) {
+        return false;
+    }
+    sampleRows = std::clamp(sampleRows, 1, 16);
+
+    // Block edges per output column, and each block's reciprocal pixel
+    // count (redone only when the number of sampled rows changes)
+    std::vector<int> columns(dst.width + 1);
+    int narrowest = src.width, widest = 1;
+    for (int x = 0; x <= dst.width; ++x) columns[x] = (int)((int64_t)x * src.width / dst.width);
+    for (int x = 0; x < dst.width; ++x) {
+        narrowest = std::min(narrowest, std::max(1, columns[x + 1] - columns[x]));
+        widest = std::max(widest, columns[x + 1] - columns[x]);
+    }
+    std::vector<float> reciprocals(dst.width);
+    std::vector<uint16_t> fixedScale(dst.width);
+    int reciprocalRows = 0;
+    std::vector<uint16_t> sums((size_t)src.width * 4 + 16);
+    const uint8_t* rows[16];
+
+    for (int y = 0; y < dst.height; ++y) {
+        int y0 = (int)((int64_t)y * src.height / dst.height);
+        int y1 = std::max(y0 + 1, (int)((int64_t)(y + 1) * src.height / dst.height));
+        int rowCount = std::min(sampleRows, y1 - y0);
+        for (int r = 0; r < rowCount; ++r) {
+            int sy = y0 + (int)((int64_t)(2 * r + 1) * (y1 - y0) / (2 * rowCount));
+            rows[r] = src.plane(0) + (size_t)sy * src.stride(0);
+        }
+        sumRows(rows, rowCount, src.width * 4, sums.data());
+        if (rowCount != reciprocalRows) {
+            for (int x = 0; x < dst.width; ++x) {
+                int count = std::max(1, columns[x + 1] - columns[x]) * rowCount;
+                reciprocals[x] = 1.0f / (float)count;
+                fixedScale[x] = (uint16_t)std::min(65535, (65536 + count - 1) / count);
+            }
+            reciprocalRows = rowCount;
+        }
+        uint8_t* out = dst.plane(0) + (size_t)y * dst.stride(0);
+        int x = 0;
+
+#if defined(PREVIEW_SSE2)
+        // Every block sum fits 16 bits (the usual case): add two source
+        // pixels per instruction and divide with a 0.16 fixed-point multiply
+        if (narrowest * rowCount >= 2 && widest * rowCount <= 256) {
+            const uint16_t* s = sums.data();
+            for (; x < dst.width; ++x) {
+                int sx = columns[x], x1 = columns[x + 1];
+                __m128i pairs = _mm_setzero_si128();
+                for (; sx + 2 <= x1; sx += 2) {
+                    pairs = _mm_add_epi16(pairs, _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + sx * 4)));
+                }
+                __m128i total = _mm_add_epi16(pairs, _mm_srli_si128(pairs, 8));
+                if (sx < x1) {
+                    total = _mm_add_epi16(total, _mm_loadl_epi64(reinterpret_cast<const __m128i*>(s + sx * 4)));
+                }
+                // Half the count rounds to nearest
+                int count = (x1 - columns[x]) * rowCount;
+                total = _mm_add_epi16(total, _mm_set1_epi16((short)(count / 2)));
+                __m128i avg = _mm_mulhi_epu16(total, _mm_set1_epi16((short)fixedScale[x]));
+                int packed = _mm_cvtsi128_si32(_mm_packus_epi16(avg, avg));
+                std::memcpy(out + x * 4, &packed, 4);
+            }
+        }
+#endif
+        for (; x < dst.width; ++x) {
+            uint32_t total[4] = {0, 0, 0, 0};
+            for (int sx = columns[x]; sx < std::max(columns[x] + 1, columns[x + 1]); ++sx) {
+                for (int c = 0; c < 4; ++c) total[c] += sums[sx * 4 + c];
+            }
+            for (int c = 0; c < 4; ++c) {
+                out[x * 4 + c] = (uint8_t)std::min(255, (int)(total[c] * reciprocals[x] + 0.5f));
+            }
+        }
+    }
+    return true;
+}
@@ -0,0 +1,87 @@
+#ifndef PREVIEW_SERVICE_H
+#define PREVIEW_SERVICE_H
+
+#include "VideoFrame.h"
+#include "VideoFramePool.h"
+#include "FrameScheduler.h"
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+struct PreviewConfig {
+    int width = 320;   // Bounding box; previews keep the source's aspect ratio
+    int height = 180;
+    double fps = 5.0;
+    int sampleRows = 2; // Source rows averaged per preview row; more is smoother and slower
+};
+
+struct PreviewStats {
+    uint64_t rounds = 0;
+    uint64_t previews = 0;          // Thumbnails produced
+    uint64_t skippedUnchanged = 0;  // Source had nothing new since its last preview
+    double avgScaleMs = 0.0;
+    double cpuFraction = 0.0;       // Preview thread CPU time over wall time, of one core
+};
+
+// Low-rate thumbnails of every SourceManager source for the operator UI.
+// A nice'd thread wakes at the preview rate, takes each source's latest
+// frame by reference (getLatestFrame(), so the real consumers still get
+// every frame) and box-downscales it with SSE2, sampling only a few rows
+// per block. Results are published as an immutable snapshot that readers
+// load atomically, without blocking on the preview thread.
+class PreviewService {
+public:
+    explicit PreviewService(const PreviewConfig& config = PreviewConfig());
+    ~PreviewService();
+
+    // Takes effect on the next start()
+    void setConfig(const PreviewConfig& config) { config_ = config; }
+
+    bool start();
+    void stop();
+
+    using PreviewMap = std::map<std::string, std::shared_ptr<const VideoFrame>>;
+
+    // Latest thumbnail of a source, null if none yet. Safe from any thread.
+    std::shared_ptr<const VideoFrame> getPreview(const std::string& sourceName) const;
+    std::shared_ptr<const PreviewMap> getPreviews() const;
+
+    // Produces one round of previews on the calling thread; the preview
+    // thread calls this once per tick
+    void update();
+
+    PreviewStats getStats() const;
+
+    // Box-averages an RGBA frame into dst, averaging at most sampleRows
+    // evenly spaced rows of each block. False unless both are RGBA.
+    static bool downscale(const VideoFrame& src, VideoFrame& dst, int sampleRows);
+
+private:
+    struct SourceState {
+        std::weak_ptr<FrameBuffer> buffer; // What the last preview was made from; never pins it
+        uint64_t timestamp = 0;
+        bool warnedFormat = false;
+    };
+
+    void previewLoop();
+
+    PreviewConfig config_;
+    VideoFramePool framePool_; // Two frames per source in steady state: published and in progress
+    std::map<std::string, SourceState> states_; // update() only
+    std::shared_ptr<const PreviewMap> previews_; // Accessed with std::atomic_load/store
+
+    std::atomic<bool> running_;
+    std::atomic<int> subscription_;
+    std::thread previewThread_;
+
+    mutable std::mutex statsMutex_;
+    PreviewStats stats_;
+    double totalScaleMs_;
+    int64_t startWallNs_;
+    int64_t threadCpuNs_;
+};
+
+#endif // PREVIEW_SERVICE_H
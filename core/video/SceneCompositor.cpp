@@ -0,0 +1,473 @@
+#include "SceneCompositor.h"
+#include "SourceManager.h"
+#include "PixelBlend.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+constexpr int kTileSize = 64;
+
+uint64_t nowMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()
+    ).count();
+}
+
+bool sameRect(const VideoRect& a, const VideoRect& b) {
+    return a.x == b.x && a.y == b.y && a.width == b.width && a.height == b.height;
+}
+
+VideoRect intersect(const VideoRect& a, const VideoRect& b) {
+    int x0 = std::max(a.x, b.x), y0 = std::max(a.y, b.y);
+    int x1 = std::min(a.x + a.width, b.x + b.width), y1 = std::min(a.y + a.height, b.y + b.height);
+    return {x0, y0, std::max(0, x1 - x0), std::max(0, y1 - y0)};
+}
+
+bool contains(const VideoRect& outer, const VideoRect& inner) {
+    return inner.x >= outer.x && inner.y >= outer.y && inner.x + inner.width <= outer.x + outer.width &&
+           inner.y + inner.height <= outer.y + outer.height;
+}
+
+bool rowOpaque(const uint8_t* p, int count) {
+    int x = 0;
+#if defined(PIXEL_BLEND_SSE2)
+    const __m128i alpha = _mm_set1_epi32((int)0xFF000000u);
+    for (; x + 4 <= count; x += 4) {
+        __m128i v = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + x * 4)), alpha);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(v, alpha)) != 0xFFFF) return false;
+    }
+#endif
+    for (; x < count; ++x) {
+        if (p[x * 4 + 3] != 255) return false;
+    }
+    return true;
+}
+
+bool frameOpaque(const VideoFrame& frame) {
+    for (int y = 0; y < frame.height; ++y) {
+        if (!rowOpaque(frame.plane(0) + (size_t)y * frame.stride(0), frame.width)) return false;
+    }
+    return true;
+}
+
+// Straight RGBA -> premultiplied, alpha scaled by scale/255
+void premultiplySpan(const uint8_t* src, uint8_t* dst, int count, int scale) {
+    int x = 0;
+#if defined(PIXEL_BLEND_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i factor = _mm_set1_epi16((short)scale);
+    const __m128i alphaLanes = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+    auto half = [&](__m128i px) {
+        __m128i a = div255x8(_mm_mullo_epi16(broadcastAlpha(px), factor));
+        __m128i rgb = div255x8(_mm_mullo_epi16(px, a));
+        return _mm_or_si128(_mm_andnot_si128(alphaLanes, rgb), _mm_and_si128(alphaLanes, a));
+    };
+    for (; x + 4 <= count; x += 4) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 4));
+        __m128i lo = half(_mm_unpacklo_epi8(v, zero));
+        __m128i hi = half(_mm_unpackhi_epi8(v, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4), _mm_packus_epi16(lo, hi));
+    }
+#endif
+    for (; x < count; ++x) {
+        const uint8_t* s = src + x * 4;
+        uint8_t* d = dst + x * 4;
+        int a = div255(s[3] * scale);
+        d[0] = (uint8_t)div255(s[0] * a);
+        d[1] = (uint8_t)div255(s[1] * a);
+        d[2] = (uint8_t)div255(s[2] * a);
+        d[3] = (uint8_t)a;
+    }
+}
+
+// Premultiplies a whole layer with opacity and an anti-aliased rounded
+// corner mask. Only the corner squares need per-pixel coverage.
+void premultiplyLayer(const VideoFrame& src, VideoFrame& dst, float opacity, int radius) {
+    int scale = std::clamp((int)std::lround(opacity * 255.0f), 0, 255);
+    radius = std::clamp(radius, 0, std::min(src.width, src.height) / 2);
+    for (int y = 0; y < src.height; ++y) {
+        const uint8_t* in = src.plane(0) + (size_t)y * src.stride(0);
+        uint8_t* out = dst.plane(0) + (size_t)y * dst.stride(0);
+        bool cornerRow = y < radius || y >= src.height - radius;
+        if (!cornerRow) {
+            premultiplySpan(in, out, src.width, scale);
+            continue;
+        }
+
+        double cy = y < radius ? radius : src.height - radius;
+        premultiplySpan(in + radius * 4, out + radius * 4, src.width - 2 * radius, scale);
+        for (int x : {0, src.width - radius}) {
+            double cx = x == 0 ? radius : src.width - radius;
+            for (int i = 0; i < radius; ++i) {
+                double dx = x + i + 0.5 - cx, dy = y + 0.5 - cy;
+                double coverage = std::clamp(radius - std::sqrt(dx * dx + dy * dy) + 0.5, 0.0, 1.0);
+                premultiplySpan(in + (x + i) * 4, out + (x + i) * 4, 1, (int)std::lround(scale * coverage));
+            }
+        }
+    }
+}
+
+} // namespace
+
+SceneCompositor::SceneCompositor(const std::string& name, size_t threadCount)
+    : name_(name), pool_(std::make_unique<core::utils::ThreadPool>(threadCount)), scaler_(threadCount),
+      tilesX_(0), tilesY_(0), running_(false), subscription_(0), newFrameAvailable_(false),
+      totalComposeMs_(0.0), totalDirty_(0.0) {
+    applyScene(scene_);
+}
+
+SceneCompositor::~SceneCompositor() {
+    stop();
+}
+
+void SceneCompositor::setScene(const SceneDescription& scene) {
+    std::lock_guard<std::mutex> lock(sceneMutex_);
+    pendingScene_ = std::make_unique<SceneDescription>(scene);
+}
+
+void SceneCompositor::markDirty(const VideoRect& rect) {
+    VideoRect r = intersect(rect, {0, 0, scene_.width, scene_.height});
+    if (r.width <= 0 || r.height <= 0) return;
+    for (int ty = r.y / kTileSize; ty <= (r.y + r.height - 1) / kTileSize; ++ty) {
+        for (int tx = r.x / kTileSize; tx <= (r.x + r.width - 1) / kTileSize; ++tx) {
+            dirtyTiles_[(size_t)ty * tilesX_ + tx] = 1;
+        }
+    }
+}
+
+void SceneCompositor::applyScene(const SceneDescription& scene) {
+    bool resized = tilesX_ == 0 || scene.width != scene_.width || scene.height != scene_.height;
+    bool recolored = std::memcmp(scene.background, scene_.background, 4) != 0;
+    scene_ = scene;
+    std::stable_sort(scene_.layers.begin(), scene_.layers.end(),
+                     [](const SceneLayer& a, const SceneLayer& b) { return a.zOrder < b.zOrder; });
+
+    if (resized) {
+        tilesX_ = (scene_.width + kTileSize - 1) / kTileSize;
+        tilesY_ = (scene_.height + kTileSize - 1) / kTileSize;
+        lastOutput_ = VideoFrame();
+    }
+    if (resized || recolored) {
+        dirtyTiles_.assign((size_t)tilesX_ * tilesY_, 1);
+    }
+
+    std::vector<std::unique_ptr<LayerState>> next;
+    for (const auto& layer : scene_.layers) {
+        auto found = std::find_if(layers_.begin(), layers_.end(), [&layer](const std::unique_ptr<LayerState>& s) {
+            return s && s->layer.id == layer.id;
+        });
+
+        std::unique_ptr<LayerState> state;
+        if (found == layers_.end()) {
+            state = std::make_unique<LayerState>();
+        } else {
+            state = std::move(*found);
+            const SceneLayer& old = state->layer;
+            bool moved = !sameRect(old.crop, layer.crop) || !sameRect(old.dest, layer.dest) ||
+                         old.opacity != layer.opacity || old.cornerRadius != layer.cornerRadius ||
+                         old.visible != layer.visible;
+            // A different position in the stack changes what covers what
+            bool restacked = (size_t)(found - layers_.begin()) != next.size();
+            if (moved || restacked) {
+                markDirty(state->bounds);
+            }
+            if (moved) {
+                state->geometryDirty = true;
+            }
+        }
+
+        auto source = layer.source ? layer.source : SourceManager::getInstance().getSource(layer.sourceName);
+        if (source != state->source) {
+            markDirty(state->bounds);
+            state->source = source;
+            state->sourceFrame = VideoFrame();
+            state->seenBuffer.reset();
+            state->prepared = VideoFrame();
+            state->detector.reset();
+            state->geometryDirty = true;
+        }
+        state->layer = layer;
+        next.push_back(std::move(state));
+    }
+
+    // Whatever was under removed layers shows through now
+    for (const auto& state : layers_) {
+        if (state) markDirty(state->bounds);
+    }
+    layers_ = std::move(next);
+}
+
+void SceneCompositor::pollSources() {
+    for (auto& state : layers_) {
+        if (!state->layer.visible || !state->source) continue;
+
+        // Looked at, not taken, so the encoder or an FFI consumer of the same
+        // source still gets every frame. Sources that keep no latest frame
+        // can only be consumed.
+        VideoFrame frame;
+        if (!state->source->getLatestFrame(frame) && !state->source->getFrame(frame)) continue;
+        if (frame.empty()) continue;
+        // The very frame looked at last time: nothing published since
+        if (frame.buffer == state->seenBuffer.lock() && frame.timestamp == state->seenTimestamp) continue;
+        state->seenBuffer = frame.buffer;
+        state->seenTimestamp = frame.timestamp;
+        if (frame.format != VideoFrame::Format::RGBA) {
+            if (!state->warnedFormat) {
+                std::cerr << "SceneCompositor: layer " << state->layer.id << " needs RGBA frames" << std::endl;
+                state->warnedFormat = true;
+            }
+            continue;
+        }
+
+        // Republished buffer: same pixels as what is on the canvas
+        if (!state->sourceFrame.empty() && frame.buffer == state->sourceFrame.buffer &&
+            frame.plane(0) == state->sourceFrame.plane(0)) {
+            continue;
+        }
+
+        // Producer hints are relative to its previous frame, which may have
+        // been skipped here; compare against what was last composed instead
+        frame.unchanged = false;
+        frame.dirtyRects.clear();
+        frame.changeMap.reset();
+        if (!state->detector.process(frame) && !state->sourceFrame.empty()) continue;
+
+        state->sourceFrame = std::move(frame);
+        state->needsPrepare = true;
+    }
+}
+
+void SceneCompositor::prepareLayer(LayerState& state) {
+    const SceneLayer& layer = state.layer;
+    state.needsPrepare = false;
+    if (state.sourceFrame.empty()) return;
+
+    const VideoFrame& src = state.sourceFrame;
+    VideoRect crop = layer.crop;
+    if (crop.width <= 0 || crop.height <= 0) crop = {0, 0, src.width, src.height};
+    VideoFrame view = src.crop(crop.x, crop.y, crop.width, crop.height);
+    if (view.empty()) return;
+
+    int width = layer.dest.width > 0 ? layer.dest.width : view.width;
+    int height = layer.dest.height > 0 ? layer.dest.height : view.height;
+    VideoRect bounds{layer.dest.x, layer.dest.y, width, height};
+
+    VideoFrame scaled = (view.width == width && view.height == height)
+                            ? view : scaler_.scale(view, width, height, ScaleMode::Bilinear);
+
+    if (layer.opacity >= 1.0f && layer.cornerRadius <= 0 && frameOpaque(scaled)) {
+        // Opaque and unmasked: premultiplied already, use as is
+        state.prepared = scaled;
+        state.opaque = true;
+    } else {
+        VideoFrame prepared = framePool_.acquire(width, height, VideoFrame::Format::RGBA);
+        premultiplyLayer(scaled, prepared, layer.opacity, layer.cornerRadius);
+        state.prepared = prepared;
+        state.opaque = false;
+    }
+
+    // Only the changed part of the source needs recomposing, unless the
+    // layer itself moved or was restyled
+    if (!state.geometryDirty && sameRect(bounds, state.bounds) && !scaled.dirtyRects.empty()) {
+        for (const auto& r : scaled.dirtyRects) {
+            markDirty({bounds.x + r.x, bounds.y + r.y, r.width, r.height});
+        }
+    } else {
+        markDirty(state.bounds);
+        markDirty(bounds);
+    }
+    state.bounds = bounds;
+    state.geometryDirty = false;
+
+    std::lock_guard<std::mutex> lock(frameMutex_);
+    stats_.layerUpdates++;
+}
+
+void SceneCompositor::composeTile(int tileIndex, VideoFrame& output) const {
+    int tx = tileIndex % tilesX_, ty = tileIndex / tilesX_;
+    VideoRect tile = intersect({tx * kTileSize, ty * kTileSize, kTileSize, kTileSize},
+                               {0, 0, scene_.width, scene_.height});
+
+    auto usable = [](const LayerState& s) { return s.layer.visible && !s.prepared.empty(); };
+
+    // Start from the topmost opaque layer covering the whole tile;
+    // everything below it is hidden
+    int first = -1;
+    for (int i = (int)layers_.size() - 1; i >= 0; --i) {
+        const LayerState& s = *layers_[i];
+        if (usable(s) && s.opaque && contains(s.bounds, tile)) {
+            first = i;
+            break;
+        }
+    }
+
+    if (first < 0) {
+        for (int y = tile.y; y < tile.y + tile.height; ++y) {
+            uint8_t* row = output.plane(0) + (size_t)y * output.stride(0) + (size_t)tile.x * 4;
+            for (int x = 0; x < tile.width; ++x) std::memcpy(row + x * 4, scene_.background, 4);
+        }
+        first = 0;
+    }
+
+    for (size_t i = first; i < layers_.size(); ++i) {
+        const LayerState& s = *layers_[i];
+        if (!usable(s)) continue;
+        VideoRect r = intersect(s.bounds, tile);
+        if (r.width <= 0 || r.height <= 0) continue;
+        for (int y = r.y; y < r.y + r.height; ++y) {
+            const uint8_t* src = s.prepared.plane(0) + (size_t)(y - s.bounds.y) * s.prepared.stride(0) +
+                                 (size_t)(r.x - s.bounds.x) * 4;
+            uint8_t* dst = output.plane(0) + (size_t)y * output.stride(0) + (size_t)r.x * 4;
+            if (s.opaque) {
+                std::memcpy(dst, src, (size_t)r.width * 4);
+            } else {
+                blendPremultipliedSpan(src, dst, r.width);
+            }
+        }
+    }
+}
+
+bool SceneCompositor::renderFrame(VideoFrame& output) {
+    {
+        std::lock_guard<std::mutex> lock(sceneMutex_);
+        if (pendingScene_) {
+            applyScene(*pendingScene_);
+            pendingScene_.reset();
+        }
+    }
+
+    pollSources();
+    for (auto& state : layers_) {
+        if (state->needsPrepare || (state->geometryDirty && !state->sourceFrame.empty())) {
+            prepareLayer(*state);
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    if (lastOutput_.empty()) {
+        std::fill(dirtyTiles_.begin(), dirtyTiles_.end(), 1);
+    }
+    int dirtyCount = (int)std::count(dirtyTiles_.begin(), dirtyTiles_.end(), 1);
+
+    VideoFrame frame;
+    if (dirtyCount == 0) {
+        // Static scene: hand out the previous canvas again
+        frame = lastOutput_;
+        frame.unchanged = true;
+        frame.dirtyRects.clear();
+    } else {
+        frame = framePool_.acquire(scene_.width, scene_.height, VideoFrame::Format::RGBA);
+        const VideoFrame& previous = lastOutput_;
+        pool_->parallelFor((int)dirtyTiles_.size(), [this, &frame, &previous](int begin, int end) {
+            for (int t = begin; t < end; ++t) {
+                if (dirtyTiles_[t]) {
+                    composeTile(t, frame);
+                    continue;
+                }
+                // Clean tile: carry it over from the previous canvas
+                int x = (t % tilesX_) * kTileSize, y0 = (t / tilesX_) * kTileSize;
+                int w = std::min(kTileSize, scene_.width - x), y1 = std::min(y0 + kTileSize, scene_.height);
+                for (int y = y0; y < y1; ++y) {
+                    std::memcpy(frame.plane(0) + (size_t)y * frame.stride(0) + (size_t)x * 4,
+                                previous.plane(0) + (size_t)y * previous.stride(0) + (size_t)x * 4, (size_t)w * 4);
+                }
+            }
+        }, 4);
+
+        frame.unchanged = false;
+        frame.dirtyRects.clear();
+        for (int ty = 0; ty < tilesY_; ++ty) {
+            for (int tx = 0; tx < tilesX_;) {
+                if (!dirtyTiles_[(size_t)ty * tilesX_ + tx]) { ++tx; continue; }
+                int begin = tx;
+                while (tx < tilesX_ && dirtyTiles_[(size_t)ty * tilesX_ + tx]) ++tx;
+                frame.dirtyRects.push_back(intersect({begin * kTileSize, ty * kTileSize, (tx - begin) * kTileSize, kTileSize},
+                                                     {0, 0, scene_.width, scene_.height}));
+            }
+        }
+        std::fill(dirtyTiles_.begin(), dirtyTiles_.end(), 0);
+        lastOutput_ = frame;
+    }
+    frame.timestamp = nowMicros();
+    output = frame;
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::lock_guard<std::mutex> lock(frameMutex_);
+    stats_.frames++;
+    if (dirtyCount == 0) stats_.unchangedFrames++;
+    totalComposeMs_ += ms;
+    totalDirty_ += (double)dirtyCount / dirtyTiles_.size();
+    stats_.avgComposeMs = totalComposeMs_ / stats_.frames;
+    stats_.avgDirtyFraction = totalDirty_ / stats_.frames;
+    return true;
+}
+
+bool SceneCompositor::start() {
+    if (running_) return true;
+
+    FrameRate rate;
+    {
+        std::lock_guard<std::mutex> lock(sceneMutex_);
+        rate = pendingScene_ ? pendingScene_->frameRate : scene_.frameRate;
+    }
+    running_ = true;
+    subscription_ = FrameScheduler::getInstance().subscribe(rate);
+    renderThread_ = std::thread(&SceneCompositor::captureLoop, this);
+    std::cout << "SceneCompositor started: " << name_ << " @" << rate.fps() << std::endl;
+    return true;
+}
+
+void SceneCompositor::stop() {
+    if (!running_) return;
+
+    running_ = false;
+    FrameScheduler::getInstance().unsubscribe(subscription_);
+    if (renderThread_.joinable()) {
+        renderThread_.join();
+    }
+    std::cout << "SceneCompositor stopped: " << name_ << std::endl;
+}
+
+bool SceneCompositor::getFrame(VideoFrame& frame) {
+    std::lock_guard<std::mutex> lock(frameMutex_);
+    if (!newFrameAvailable_) {
+        return false;
+    }
+
+    frame = currentFrame_;
+    newFrameAvailable_ = false;
+    return true;
+}
+
+bool SceneCompositor::getLatestFrame(VideoFrame& frame) {
+    std::lock_guard<std::mutex> lock(frameMutex_);
+    if (currentFrame_.empty()) {
+        return false;
+    }
+    frame = currentFrame_;
+    return true;
+}
+
+CompositorStats SceneCompositor::getStats() const {
+    std::lock_guard<std::mutex> lock(frameMutex_);
+    return stats_;
+}
+
+void SceneCompositor::captureLoop() {
+    FrameScheduler::Tick tick;
+    while (running_ && FrameScheduler::getInstance().waitForTick(subscription_, tick)) {
+        VideoFrame frame;
+        if (!renderFrame(frame)) continue;
+
+        {
+            std::lock_guard<std::mutex> lock(frameMutex_);
+            currentFrame_ = std::move(frame);
+            newFrameAvailable_ = true;
+        }
+        notifyFrame();
+    }
+}
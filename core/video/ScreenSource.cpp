@@ -3,7 +3,8 @@
 #include <chrono>
 
 ScreenSource::ScreenSource(int screenIndex) 
-    : screenIndex_(screenIndex), running_(false), newFrameAvailable_(false) {
+    : screenIndex_(screenIndex), frameRate_{60, 1}, x11Capture_(screenIndex), fullFrameOutput_(true),
+      subscription_(0), running_(false), newFrameAvailable_(false) {
 }
 
 ScreenSource::~ScreenSource() {
@@ -12,8 +13,25 @@ ScreenSource::~ScreenSource() {
 
 bool ScreenSource::start() {
     if (running_) return true;
+
+    // Real capture when an X server is reachable, generated frames otherwise
+    if (!x11Capture_.open()) {
+        std::cout << "ScreenSource: no X11 display, using generated frames" << std::endl;
+    }
     
+    // Only the outputs' needs count when nobody takes the full frame
+    FrameRate rate = frameRate_;
+    VideoRect region;
+    if (!fullFrameOutput_ && !outputs_.empty()) {
+        if (x11Capture_.isOpen()) region = outputs_.requiredRegion(x11Capture_.width(), x11Capture_.height());
+        double wanted = outputs_.requiredFps();
+        if (wanted > 0.0 && wanted < rate.fps()) rate = FrameRate::fromFps(wanted);
+    }
+    x11Capture_.setCaptureRegion(region);
+
+    changeDetector_.setConfig(changeConfig_);
     running_ = true;
+    subscription_ = FrameScheduler::getInstance().subscribe(rate);
     captureThread_ = std::thread(&ScreenSource::captureLoop, this);
     std::cout << "ScreenSource started: Display " << screenIndex_ << std::endl;
     return true;
@@ -23,9 +41,12 @@ void ScreenSource::stop() {
     if (!running_) return;
 
     running_ = false;
+    // Wakes the capture thread out of waitForTick()
+    FrameScheduler::getInstance().unsubscribe(subscription_);
     if (captureThread_.joinable()) {
         captureThread_.join();
     }
+    x11Capture_.close();
     std::cout << "ScreenSource stopped: Display " << screenIndex_ << std::endl;
 }
 
@@ -40,40 +61,67 @@ bool ScreenSource::getFrame(VideoFrame& frame) {
     return true;
 }
 
+bool ScreenSource::getLatestFrame(VideoFrame& frame) {
+    std::lock_guard<std::mutex> lock(frameMutex_);
+    if (currentFrame_.empty()) {
+        return false;
+    }
+    frame = currentFrame_;
+    return true;
+}
+
 std::string ScreenSource::getName() const {
     return "Screen-" + std::to_string(screenIndex_);
 }
 
+ScreenCaptureStats ScreenSource::getStats() const {
+    return x11Capture_.getStats();
+}
+
+ChangeDetectorStats ScreenSource::getChangeStats() {
+    std::lock_guard<std::mutex> lock(frameMutex_);
+    return changeStats_;
+}
+
 void ScreenSource::captureLoop() {
-    // Mock capture loop: Generate frames at ~60 FPS for screen capture
+    // Mock frame size when no display is available
     int width = 1920;
     int height = 1080;
+    FrameScheduler::Tick tick;
     
-    while (running_) {
-        auto start = std::chrono::high_resolution_clock::now();
-
-        // Simulate screen capture
-        VideoFrame frame(width, height, VideoFrame::Format::RGBA);
-        
-        // Mock data
-        if (!frame.data.empty()) frame.data[0] = 255; 
+    while (running_ && FrameScheduler::getInstance().waitForTick(subscription_, tick)) {
+        VideoFrame frame;
+        if (x11Capture_.isOpen()) {
+            if (!x11Capture_.capture(frame)) continue;
+        } else {
+            // Simulate screen capture: a zeroed frame with one marked pixel
+            frame = VideoFrame(width, height, VideoFrame::Format::RGBA);
+            if (!frame.empty()) frame.plane(0)[0] = 255;
+        }
         
         frame.timestamp = std::chrono::duration_cast<std::chrono::microseconds>(
             std::chrono::system_clock::now().time_since_epoch()
         ).count();
 
+        // Refines X damage (which over-reports) or, without it, finds the
+        // changed tiles itself
+        changeDetector_.process(frame);
+
+        if (!outputs_.empty()) {
+            outputs_.publish(frame);
+        }
+        if (!fullFrameOutput_) {
+            std::lock_guard<std::mutex> lock(frameMutex_);
+            changeStats_ = changeDetector_.getStats();
+            continue;
+        }
+
         {
             std::lock_guard<std::mutex> lock(frameMutex_);
             currentFrame_ = std::move(frame);
+            changeStats_ = changeDetector_.getStats();
             newFrameAvailable_ = true;
         }
-
-        auto end = std::chrono::high_resolution_clock::now();
-        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
-        
-        // Sleep to maintain ~60 FPS (16ms)
-        if (elapsed.count() < 16) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(16 - elapsed.count()));
-        }
+        notifyFrame();
     }
 }
@@ -2,6 +2,10 @@
 #define SCREEN_SOURCE_H
 
 #include "VideoSource.h"
+#include "FrameScheduler.h"
+#include "X11ScreenCapture.h"
+#include "FrameChangeDetector.h"
+#include "SourceOutputs.h"
 #include <thread>
 #include <atomic>
 #include <mutex>
@@ -14,18 +18,50 @@ public:
     bool start() override;
     void stop() override;
     bool getFrame(VideoFrame& frame) override;
+    bool getLatestFrame(VideoFrame& frame) override;
     std::string getName() const override;
 
+    // Capture rate, paced by the shared FrameScheduler. Takes effect on start().
+    void setFrameRate(FrameRate rate) { frameRate_ = rate; }
+    FrameRate getFrameRate() const { return frameRate_; }
+
+    // Per-frame capture cost and dirty-area fraction
+    ScreenCaptureStats getStats() const;
+
+    // Tile comparison that marks repeated frames unchanged. Exact by
+    // default; takes effect on start().
+    void setChangeDetection(const ChangeDetectorConfig& config) { changeConfig_ = config; }
+    ChangeDetectorStats getChangeStats();
+
+    // Extra consumers with their own crop, size, format and rate, all
+    // served from one capture. Crops are in screen pixels.
+    int addOutput(const SourceOutputConfig& config) { return outputs_.add(config); }
+    bool removeOutput(int id) { return outputs_.remove(id); }
+    bool getOutputFrame(int id, VideoFrame& frame) { return outputs_.getFrame(id, frame); }
+
+    // Also publish every frame in full through getFrame(). Turning it off
+    // lets the outputs present at start() narrow the capture to the union
+    // of their crops, at the highest rate any of them asks for.
+    void setFullFrameOutput(bool enabled) { fullFrameOutput_ = enabled; }
+
 private:
     void captureLoop();
 
     int screenIndex_;
+    FrameRate frameRate_;
+    X11ScreenCapture x11Capture_;
+    ChangeDetectorConfig changeConfig_;
+    FrameChangeDetector changeDetector_; // Capture thread only
+    SourceOutputs outputs_;
+    bool fullFrameOutput_;
+    std::atomic<int> subscription_;
     std::atomic<bool> running_;
     std::thread captureThread_;
     
     std::mutex frameMutex_;
     VideoFrame currentFrame_;
     bool newFrameAvailable_;
+    ChangeDetectorStats changeStats_;
 };
 
 #endif // SCREEN_SOURCE_H
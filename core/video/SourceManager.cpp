@@ -9,20 +9,43 @@ SourceManager& SourceManager::getInstance() {
 void SourceManager::addSource(std::shared_ptr<VideoSource> source) {
     if (!source) return;
     std::string name = source->getName();
-    sources_[name] = source;
+    std::shared_ptr<VideoSource> replaced;
+    int replacedListener = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = sources_.find(name);
+        if (it != sources_.end()) {
+            replaced = it->second;
+            replacedListener = listenerIds_[name];
+        }
+        sources_[name] = source;
+        seen_.erase(name);
+        listenerIds_[name] = source->addFrameListener([this]() { ready_.notify(); });
+    }
+    if (replaced) replaced->removeFrameListener(replacedListener);
+    // It may have published before anyone listened
+    ready_.notify();
     std::cout << "Source added: " << name << std::endl;
 }
 
 void SourceManager::removeSource(const std::string& name) {
-    auto it = sources_.find(name);
-    if (it != sources_.end()) {
-        it->second->stop(); // Ensure it's stopped
+    std::shared_ptr<VideoSource> source;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = sources_.find(name);
+        if (it == sources_.end()) return;
+        source = it->second;
         sources_.erase(it);
-        std::cout << "Source removed: " << name << std::endl;
+        source->removeFrameListener(listenerIds_[name]);
+        listenerIds_.erase(name);
+        seen_.erase(name);
     }
+    source->stop(); // Ensure it's stopped
+    std::cout << "Source removed: " << name << std::endl;
 }
 
 std::shared_ptr<VideoSource> SourceManager::getSource(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex_);
     auto it = sources_.find(name);
     if (it != sources_.end()) {
         return it->second;
@@ -31,9 +54,43 @@ std::shared_ptr<VideoSource> SourceManager::getSource(const std::string& name) {
 }
 
 std::vector<std::string> SourceManager::getSourceNames() const {
+    std::lock_guard<std::mutex> lock(mutex_);
     std::vector<std::string> names;
     for (const auto& pair : sources_) {
         names.push_back(pair.first);
     }
     return names;
 }
+
+size_t SourceManager::collectFrames(std::vector<std::pair<std::string, VideoFrame>>& frames, size_t maxFrames) {
+    // Before looking, so a frame published meanwhile signals again
+    ready_.clear();
+    std::vector<std::pair<std::string, std::shared_ptr<VideoSource>>> sources;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        sources.assign(sources_.begin(), sources_.end());
+    }
+    size_t added = 0;
+    for (const auto& entry : sources) {
+        if (added == maxFrames) {
+            // Not every source was looked at; come back for the rest
+            ready_.notify();
+            break;
+        }
+        // As PreviewService does; sources that keep no latest frame can
+        // only be consumed
+        VideoFrame frame;
+        if (!entry.second->getLatestFrame(frame) && !entry.second->getFrame(frame)) continue;
+        if (frame.empty()) continue;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            SeenFrame& seen = seen_[entry.first];
+            if (frame.buffer == seen.buffer.lock() && frame.timestamp == seen.timestamp) continue;
+            seen.buffer = frame.buffer;
+            seen.timestamp = frame.timestamp;
+        }
+        frames.emplace_back(entry.first, std::move(frame));
+        added++;
+    }
+    return added;
+}
@@ -2,9 +2,12 @@
 #define SOURCE_MANAGER_H
 
 #include "VideoSource.h"
+#include "utils/ready_signal.h"
+#include <cstdint>
 #include <vector>
 #include <memory>
 #include <map>
+#include <mutex>
 #include <string>
 
 class SourceManager {
@@ -23,13 +26,31 @@ public:
     // List all active sources
     std::vector<std::string> getSourceNames() const;
 
+    // Readable while a source may have a frame collectFrames() has not
+    // taken yet, so a consumer can sleep in epoll instead of polling
+    int getReadyFd() const { return ready_.fd(); }
+    // The new frame of each source, up to maxFrames, in one pass. Returns
+    // how many were appended. Frames are looked at, not taken, so other
+    // consumers of the same sources still get every frame.
+    size_t collectFrames(std::vector<std::pair<std::string, VideoFrame>>& frames, size_t maxFrames = SIZE_MAX);
+
 private:
     SourceManager() = default;
     ~SourceManager() = default;
     SourceManager(const SourceManager&) = delete;
     SourceManager& operator=(const SourceManager&) = delete;
 
+    struct SeenFrame {
+        std::weak_ptr<FrameBuffer> buffer; // Never pins it
+        uint64_t timestamp = 0;
+    };
+
+    // Also read from the compositor and preview threads
+    mutable std::mutex mutex_;
     std::map<std::string, std::shared_ptr<VideoSource>> sources_;
+    std::map<std::string, int> listenerIds_;
+    std::map<std::string, SeenFrame> seen_; // What collectFrames() last returned
+    core::utils::ReadySignal ready_;
 };
 
 #endif // SOURCE_MANAGER_H
@@ -0,0 +1,246 @@
+#include "SourceOutputs.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+bool isYuv(VideoFrame::Format format) {
+    return format != VideoFrame::Format::RGBA;
+}
+
+inline uint8_t lumaOf(int r, int g, int b) {
+    return (uint8_t)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+}
+
+inline uint8_t chromaU(int r, int g, int b) {
+    return (uint8_t)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+}
+
+inline uint8_t chromaV(int r, int g, int b) {
+    return (uint8_t)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+}
+
+} // namespace
+
+SourceOutputs::SourceOutputs(size_t threadCount)
+    : nextId_(1)
+    , scaler_(threadCount) {
+}
+
+int SourceOutputs::add(const SourceOutputConfig& config) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    int id = nextId_++;
+    outputs_[id].config = config;
+    return id;
+}
+
+bool SourceOutputs::remove(int id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return outputs_.erase(id) > 0;
+}
+
+bool SourceOutputs::empty() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return outputs_.empty();
+}
+
+std::vector<int> SourceOutputs::ids() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<int> result;
+    for (const auto& entry : outputs_) result.push_back(entry.first);
+    return result;
+}
+
+bool SourceOutputs::getFrame(int id, VideoFrame& frame) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = outputs_.find(id);
+    if (it == outputs_.end() || !it->second.fresh) return false;
+    frame = it->second.latest;
+    it->second.fresh = false;
+    return true;
+}
+
+SourceOutputConfig SourceOutputs::resolve(int id, int frameWidth, int frameHeight, int referenceWidth,
+                                          int referenceHeight) const {
+    SourceOutputConfig config;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = outputs_.find(id);
+        if (it == outputs_.end()) return config;
+        config = it->second.config;
+    }
+    if (referenceWidth <= 0 || referenceHeight <= 0) {
+        referenceWidth = frameWidth;
+        referenceHeight = frameHeight;
+    }
+
+    VideoRect crop = config.crop;
+    if (crop.width <= 0 || crop.height <= 0) crop = {0, 0, referenceWidth, referenceHeight};
+    if (config.width <= 0 || config.height <= 0) {
+        config.width = crop.width;
+        config.height = crop.height;
+    }
+
+    // Reference -> frame coordinates, clamped to the frame
+    auto mapX = [&](int v) { return (int)std::clamp<int64_t>((int64_t)v * frameWidth / referenceWidth, 0, frameWidth); };
+    auto mapY = [&](int v) { return (int)std::clamp<int64_t>((int64_t)v * frameHeight / referenceHeight, 0, frameHeight); };
+    int x0 = mapX(crop.x), y0 = mapY(crop.y);
+    int x1 = mapX(crop.x + crop.width), y1 = mapY(crop.y + crop.height);
+    config.crop = {x0, y0, std::max(1, x1 - x0), std::max(1, y1 - y0)};
+
+    if (isYuv(config.format)) {
+        config.width = std::max(2, config.width & ~1);
+        config.height = std::max(2, config.height & ~1);
+    }
+    return config;
+}
+
+VideoRect SourceOutputs::requiredRegion(int sourceWidth, int sourceHeight) const {
+    std::vector<int> all = ids();
+    if (all.empty()) return {0, 0, sourceWidth, sourceHeight};
+    int x0 = sourceWidth, y0 = sourceHeight, x1 = 0, y1 = 0;
+    for (int id : all) {
+        VideoRect c = resolve(id, sourceWidth, sourceHeight).crop;
+        x0 = std::min(x0, c.x);
+        y0 = std::min(y0, c.y);
+        x1 = std::max(x1, c.x + c.width);
+        y1 = std::max(y1, c.y + c.height);
+    }
+    return {x0, y0, std::max(0, x1 - x0), std::max(0, y1 - y0)};
+}
+
+ScaleSize SourceOutputs::requiredResolution(int sourceWidth, int sourceHeight) const {
+    std::vector<int> all = ids();
+    if (all.empty()) return {sourceWidth, sourceHeight};
+    ScaleSize needed;
+    for (int id : all) {
+        SourceOutputConfig c = resolve(id, sourceWidth, sourceHeight);
+        int w = (int)std::ceil((double)c.width * sourceWidth / c.crop.width);
+        int h = (int)std::ceil((double)c.height * sourceHeight / c.crop.height);
+        needed.width = std::max(needed.width, std::min(w, sourceWidth));
+        needed.height = std::max(needed.height, std::min(h, sourceHeight));
+    }
+    return needed;
+}
+
+double SourceOutputs::requiredFps() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    double fps = 0.0;
+    for (const auto& entry : outputs_) {
+        if (entry.second.config.maxFps <= 0.0) return 0.0;
+        fps = std::max(fps, entry.second.config.maxFps);
+    }
+    return fps;
+}
+
+std::vector<int> SourceOutputs::due(uint64_t timestamp) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<int> result;
+    for (auto& entry : outputs_) {
+        Output& output = entry.second;
+        if (output.config.maxFps <= 0.0) {
+            result.push_back(entry.first);
+            continue;
+        }
+        // Scheduled on a fixed grid, with an eighth of an interval of
+        // slack so capture jitter does not skip a frame that is on time
+        uint64_t interval = (uint64_t)(1000000.0 / output.config.maxFps);
+        if (output.nextDueUs != 0 && timestamp + interval / 8 < output.nextDueUs) continue;
+        bool late = output.nextDueUs == 0 || timestamp > output.nextDueUs + interval;
+        output.nextDueUs = late ? timestamp + interval : output.nextDueUs + interval;
+        result.push_back(entry.first);
+    }
+    return result;
+}
+
+void SourceOutputs::deliver(int id, VideoFrame frame) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = outputs_.find(id);
+    if (it == outputs_.end()) return;
+    Output& output = it->second;
+    if (!output.latest.empty() && frame.timestamp < output.latest.timestamp) return;
+    output.latest = std::move(frame);
+    output.fresh = true;
+}
+
+void SourceOutputs::publish(const VideoFrame& rgba, int referenceWidth, int referenceHeight) {
+    if (rgba.empty() || rgba.format != VideoFrame::Format::RGBA) return;
+
+    for (int id : due(rgba.timestamp)) {
+        SourceOutputConfig config = resolve(id, rgba.width, rgba.height, referenceWidth, referenceHeight);
+        VideoFrame view = rgba.crop(config.crop.x, config.crop.y, config.crop.width, config.crop.height);
+
+        VideoFrame previous;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = outputs_.find(id);
+            if (it == outputs_.end()) continue;
+            previous = it->second.latest;
+        }
+
+        // Nothing changed inside the crop: the last output is still exact
+        if (view.unchanged && !previous.empty() && previous.width == config.width &&
+            previous.height == config.height && previous.format == config.format) {
+            previous.unchanged = true;
+            previous.dirtyRects.clear();
+            previous.changeMap.reset();
+            previous.timestamp = rgba.timestamp;
+            deliver(id, previous);
+            continue;
+        }
+
+        VideoFrame scaled = view;
+        if (view.width != config.width || view.height != config.height) {
+            bool halving = view.width >= config.width * 2 && view.height >= config.height * 2;
+            scaled = scaler_.scale(view, config.width, config.height, halving ? ScaleMode::Box : ScaleMode::Bilinear);
+        }
+
+        if (config.format == VideoFrame::Format::RGBA) {
+            deliver(id, scaled);
+            continue;
+        }
+        VideoFrame converted = scaler_.getFramePool().acquire(config.width, config.height, config.format);
+        convertFromRgba(scaled, converted);
+        converted.timestamp = scaled.timestamp;
+        converted.unchanged = scaled.unchanged;
+        converted.dirtyRects = scaled.dirtyRects;
+        converted.changeMap.reset();
+        deliver(id, converted);
+    }
+}
+
+bool SourceOutputs::convertFromRgba(const VideoFrame& src, VideoFrame& dst) {
+    if (src.empty() || dst.empty() || src.format != VideoFrame::Format::RGBA || !isYuv(dst.format) ||
+        src.width != dst.width || src.height != dst.height) {
+        return false;
+    }
+    bool nv12 = dst.format == VideoFrame::Format::NV12;
+    int w = src.width, h = src.height;
+
+    // One 2x2 block per chroma sample; odd edges repeat the last pixel
+    for (int y = 0; y < h; y += 2) {
+        const uint8_t* row0 = src.plane(0) + (size_t)y * src.stride(0);
+        const uint8_t* row1 = src.plane(0) + (size_t)std::min(y + 1, h - 1) * src.stride(0);
+        uint8_t* y0 = dst.plane(0) + (size_t)y * dst.stride(0);
+        uint8_t* y1 = dst.plane(0) + (size_t)std::min(y + 1, h - 1) * dst.stride(0);
+        uint8_t* u = dst.plane(1) + (size_t)(y / 2) * dst.stride(1);
+        uint8_t* v = nv12 ? u + 1 : dst.plane(2) + (size_t)(y / 2) * dst.stride(2);
+        int chromaStep = nv12 ? 2 : 1;
+
+        for (int x = 0; x < w; x += 2) {
+            int xr = std::min(x + 1, w - 1);
+            const uint8_t* p[4] = {row0 + x * 4, row0 + xr * 4, row1 + x * 4, row1 + xr * 4};
+            y0[x] = lumaOf(p[0][0], p[0][1], p[0][2]);
+            y0[xr] = lumaOf(p[1][0], p[1][1], p[1][2]);
+            y1[x] = lumaOf(p[2][0], p[2][1], p[2][2]);
+            y1[xr] = lumaOf(p[3][0], p[3][1], p[3][2]);
+
+            int r = (p[0][0] + p[1][0] + p[2][0] + p[3][0] + 2) >> 2;
+            int g = (p[0][1] + p[1][1] + p[2][1] + p[3][1] + 2) >> 2;
+            int b = (p[0][2] + p[1][2] + p[2][2] + p[3][2] + 2) >> 2;
+            u[(x / 2) * chromaStep] = chromaU(r, g, b);
+            v[(x / 2) * chromaStep] = chromaV(r, g, b);
+        }
+    }
+    return true;
+}
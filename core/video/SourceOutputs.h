@@ -0,0 +1,83 @@
+#ifndef SOURCE_OUTPUTS_H
+#define SOURCE_OUTPUTS_H
+
+#include "VideoFrame.h"
+#include "VideoScaler.h"
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+
+// What one consumer wants from a source
+struct SourceOutputConfig {
+    VideoRect crop;        // Source pixels; empty = whole frame
+    int width = 0;         // Output size; 0 = crop size. Rounded down to even for I420/NV12
+    int height = 0;
+    VideoFrame::Format format = VideoFrame::Format::RGBA;
+    double maxFps = 0.0;   // 0 = every source frame
+};
+
+// Consumer outputs served from a single capture. Each output has its own
+// crop, size, format and rate limit and its own latest-frame mailbox, so
+// several consumers can read one source without stealing frames from
+// each other. Sources use the required*() queries to narrow the capture
+// request, then either hand RGBA frames to publish() or produce each due
+// output themselves (fused into their conversion) and deliver() it.
+class SourceOutputs {
+public:
+    explicit SourceOutputs(size_t threadCount = 1);
+
+    int add(const SourceOutputConfig& config);
+    bool remove(int id);
+    bool empty() const;
+    std::vector<int> ids() const;
+
+    // Latest frame of one output; false if nothing new since the last call
+    bool getFrame(int id, VideoFrame& frame);
+
+    // Union of every output's crop in a sourceWidth x sourceHeight frame
+    VideoRect requiredRegion(int sourceWidth, int sourceHeight) const;
+    // Smallest full-frame size that still gives every output as many
+    // source pixels as output pixels
+    ScaleSize requiredResolution(int sourceWidth, int sourceHeight) const;
+    // Highest rate any output wants; 0 if one takes every frame
+    double requiredFps() const;
+
+    // Geometry of an output for a frame of the given size. Crops are given
+    // in reference coordinates (e.g. the requested capture size) and mapped
+    // onto the actual frame; a zero reference means the frame itself.
+    SourceOutputConfig resolve(int id, int frameWidth, int frameHeight, int referenceWidth = 0,
+                               int referenceHeight = 0) const;
+
+    // Ids whose rate limit lets a frame captured at `timestamp` through.
+    // Each call consumes the slot, so call it once per source frame.
+    std::vector<int> due(uint64_t timestamp);
+
+    // Publishes a frame the source built for `id`. Older than the one
+    // already waiting (parallel producers finishing out of order): dropped.
+    void deliver(int id, VideoFrame frame);
+
+    // Generic path for RGBA sources: crop (a view), scale and convert each
+    // due output. Outputs whose crop saw no change re-publish their last
+    // frame flagged unchanged. Crops are in `reference` coordinates as in
+    // resolve().
+    void publish(const VideoFrame& rgba, int referenceWidth = 0, int referenceHeight = 0);
+
+    // RGBA -> I420/NV12 (BT.601 limited range). dst must have src's size.
+    static bool convertFromRgba(const VideoFrame& src, VideoFrame& dst);
+
+private:
+    struct Output {
+        SourceOutputConfig config;
+        uint64_t nextDueUs = 0;
+        VideoFrame latest;
+        bool fresh = false;
+    };
+
+    mutable std::mutex mutex_;
+    std::map<int, Output> outputs_;
+    int nextId_;
+    VideoScaler scaler_; // publish() only, which the source calls from one thread
+};
+
+#endif // SOURCE_OUTPUTS_H
@@ -0,0 +1,489 @@
+#include "TextOverlay.h"
+#include "PixelBlend.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+namespace {
+
+// Classic 5x7 font for ASCII 32..126: five columns per glyph, bit 0 is
+// the top row.
+const uint8_t kFont5x7[95][5] = {
+    {0x00, 0x00, 0x00, 0x00, 0x00}, {0x00, 0x00, 0x5F, 0x00, 0x00}, {0x00, 0x07, 0x00, 0x07, 0x00}, // ' ' ! "
+    {0x14, 0x7F, 0x14, 0x7F, 0x14}, {0x24, 0x2A, 0x7F, 0x2A, 0x12}, {0x23, 0x13, 0x08, 0x64, 0x62}, // # $ %
+    {0x36, 0x49, 0x55, 0x22, 0x50}, {0x00, 0x05, 0x03, 0x00, 0x00}, {0x00, 0x1C, 0x22, 0x41, 0x00}, // & ' (
+    {0x00, 0x41, 0x22, 0x1C, 0x00}, {0x08, 0x2A, 0x1C, 0x2A, 0x08}, {0x08, 0x08, 0x3E, 0x08, 0x08}, // ) * +
+    {0x00, 0x50, 0x30, 0x00, 0x00}, {0x08, 0x08, 0x08, 0x08, 0x08}, {0x00, 0x60, 0x60, 0x00, 0x00}, // , - .
+    {0x20, 0x10, 0x08, 0x04, 0x02}, {0x3E, 0x51, 0x49, 0x45, 0x3E}, {0x00, 0x42, 0x7F, 0x40, 0x00}, // / 0 1
+    {0x42, 0x61, 0x51, 0x49, 0x46}, {0x21, 0x41, 0x45, 0x4B, 0x31}, {0x18, 0x14, 0x12, 0x7F, 0x10}, // 2 3 4
+    {0x27, 0x45, 0x45, 0x45, 0x39}, {0x3C, 0x4A, 0x49, 0x49, 0x30}, {0x01, 0x71, 0x09, 0x05, 0x03}, // 5 6 7
+    {0x36, 0x49, 0x49, 0x49, 0x36}, {0x06, 0x49, 0x49, 0x29, 0x1E}, {0x00, 0x36, 0x36, 0x00, 0x00}, // 8 9 :
+    {0x00, 0x56, 0x36, 0x00, 0x00}, {0x08, 0x14, 0x22, 0x41, 0x00}, {0x14, 0x14, 0x14, 0x14, 0x14}, // ; < =
+    {0x00, 0x41, 0x22, 0x14, 0x08}, {0x02, 0x01, 0x51, 0x09, 0x06}, {0x32, 0x49, 0x79, 0x41, 0x3E}, // > ? @
+    {0x7E, 0x11, 0x11, 0x11, 0x7E}, {0x7F, 0x49, 0x49, 0x49, 0x36}, {0x3E, 0x41, 0x41, 0x41, 0x22}, // A B C
+    {0x7F, 0x41, 0x41, 0x22, 0x1C}, {0x7F, 0x49, 0x49, 0x49, 0x41}, {0x7F, 0x09, 0x09, 0x09, 0x01}, // D E F
+    {0x3E, 0x41, 0x49, 0x49, 0x7A}, {0x7F, 0x08, 0x08, 0x08, 0x7F}, {0x00, 0x41, 0x7F, 0x41, 0x00}, // G H I
+    {0x20, 0x40, 0x41, 0x3F, 0x01}, {0x7F, 0x08, 0x14, 0x22, 0x41}, {0x7F, 0x40, 0x40, 0x40, 0x40}, // J K L
+    {0x7F, 0x02, 0x0C, 0x02, 0x7F}, {0x7F, 0x04, 0x08, 0x10, 0x7F}, {0x3E, 0x41, 0x41, 0x41, 0x3E}, // M N O
+    {0x7F, 0x09, 0x09, 0x09, 0x06}, {0x3E, 0x41, 0x51, 0x21, 0x5E}, {0x7F, 0x09, 0x19, 0x29, 0x46}, // P Q R
+    {0x46, 0x49, 0x49, 0x49, 0x31}, {0x01, 0x01, 0x7F, 0x01, 0x01}, {0x3F, 0x40, 0x40, 0x40, 0x3F}, // S T U
+    {0x1F, 0x20, 0x40, 0x20, 0x1F}, {0x3F, 0x40, 0x38, 0x40, 0x3F}, {0x63, 0x14, 0x08, 0x14, 0x63}, // V W X
+    {0x07, 0x08, 0x70, 0x08, 0x07}, {0x61, 0x51, 0x49, 0x45, 0x43}, {0x00, 0x7F, 0x41, 0x41, 0x00}, // Y Z [
+    {0x02, 0x04, 0x08, 0x10, 0x20}, {0x00, 0x41, 0x41, 0x7F, 0x00}, {0x04, 0x02, 0x01, 0x02, 0x04}, // \ ] ^
+    {0x40, 0x40, 0x40, 0x40, 0x40}, {0x00, 0x01, 0x02, 0x04, 0x00}, {0x20, 0x54, 0x54, 0x54, 0x78}, // _ ` a
+    {0x7F, 0x48, 0x44, 0x44, 0x38}, {0x38, 0x44, 0x44, 0x44, 0x20}, {0x38, 0x44, 0x44, 0x48, 0x7F}, // b c d
+    {0x38, 0x54, 0x54, 0x54, 0x18}, {0x08, 0x7E, 0x09, 0x01, 0x02}, {0x0C, 0x52, 0x52, 0x52, 0x3E}, // e f g
+    {0x7F, 0x08, 0x04, 0x04, 0x78}, {0x00, 0x44, 0x7D, 0x40, 0x00}, {0x20, 0x40, 0x44, 0x3D, 0x00}, // h i j
+    {0x7F, 0x10, 0x28, 0x44, 0x00}, {0x00, 0x41, 0x7F, 0x40, 0x00}, {0x7C, 0x04, 0x18, 0x04, 0x78}, // k l m
+    {0x7C, 0x08, 0x04, 0x04, 0x78}, {0x38, 0x44, 0x44, 0x44, 0x38}, {0x7C, 0x14, 0x14, 0x14, 0x08}, // n o p
+    {0x08, 0x14, 0x14, 0x18, 0x7C}, {0x7C, 0x08, 0x04, 0x04, 0x08}, {0x48, 0x54, 0x54, 0x54, 0x20}, // q r s
+    {0x04, 0x3F, 0x44, 0x40, 0x20}, {0x3C, 0x40, 0x40, 0x20, 0x7C}, {0x1C, 0x20, 0x40, 0x20, 0x1C}, // t u v
+    {0x3C, 0x40, 0x30, 0x40, 0x3C}, {0x44, 0x28, 0x10, 0x28, 0x44}, {0x0C, 0x50, 0x50, 0x50, 0x3C}, // w x y
+    {0x44, 0x64, 0x54, 0x4C, 0x44}, {0x00, 0x08, 0x36, 0x41, 0x00}, {0x00, 0x00, 0x7F, 0x00, 0x00}, // z { |
+    {0x00, 0x41, 0x36, 0x08, 0x00}, {0x08, 0x04, 0x08, 0x10, 0x08}                                   // } ~
+};
+
+constexpr int kGlyphColumns = 5;
+constexpr int kGlyphRows = 8; // Seven drawn rows plus line spacing
+constexpr int kFirstGlyph = 32;
+constexpr int kGlyphCount = 95;
+
+int outlineWidthFor(const TextStyle& style) {
+    return style.outline[3] == 0 ? 0 : std::max(1, std::max(1, style.scale) / 2);
+}
+
+uint32_t premultiplied(const uint8_t rgba[4]) {
+    int a = rgba[3];
+    return (uint32_t)div255(rgba[0] * a) | (uint32_t)div255(rgba[1] * a) << 8 |
+           (uint32_t)div255(rgba[2] * a) << 16 | (uint32_t)a << 24;
+}
+
+// Premultiplied `top` over premultiplied `bottom`
+uint32_t over(uint32_t top, uint32_t bottom) {
+    int inv = 255 - (int)(top >> 24);
+    uint32_t out = 0;
+    for (int shift = 0; shift < 32; shift += 8) {
+        int c = (int)((top >> shift) & 0xFF) + div255((int)((bottom >> shift) & 0xFF) * inv);
+        out |= (uint32_t)std::min(255, c) << shift;
+    }
+    return out;
+}
+
+bool sameRect(const VideoRect& a, const VideoRect& b) {
+    return a.x == b.x && a.y == b.y && a.width == b.width && a.height == b.height;
+}
+
+VideoRect clipToFrame(const VideoRect& r, const VideoFrame& frame) {
+    int x0 = std::max(r.x, 0), y0 = std::max(r.y, 0);
+    int x1 = std::min(r.x + r.width, frame.width), y1 = std::min(r.y + r.height, frame.height);
+    return {x0, y0, std::max(0, x1 - x0), std::max(0, y1 - y0)};
+}
+
+// BT.601 limited range, as OpenCV's RGB -> I420 conversion. Inputs are
+// premultiplied, so the offsets are scaled by alpha too.
+inline uint8_t lumaOf(int r, int g, int b, int a) {
+    return (uint8_t)std::clamp(div255(16 * a) + ((66 * r + 129 * g + 25 * b + 128) >> 8), 0, 255);
+}
+
+inline uint8_t chromaU(int r, int g, int b, int a) {
+    return (uint8_t)std::clamp(div255(128 * a) + ((-38 * r - 74 * g + 112 * b + 128) >> 8), 0, 255);
+}
+
+inline uint8_t chromaV(int r, int g, int b, int a) {
+    return (uint8_t)std::clamp(div255(128 * a) + ((112 * r - 94 * g - 18 * b + 128) >> 8), 0, 255);
+}
+
+} // namespace
+
+GlyphAtlas::GlyphAtlas(int scale, int outlineWidth) {
+    scale = std::max(1, scale);
+    outlineWidth = std::max(0, outlineWidth);
+    cellWidth_ = kGlyphColumns * scale + std::max(scale, 2 * outlineWidth);
+    cellHeight_ = kGlyphRows * scale + 2 * outlineWidth;
+    size_t cellSize = (size_t)cellWidth_ * cellHeight_;
+    masks_.assign(cellSize * kGlyphCount, 0);
+
+    for (int g = 0; g < kGlyphCount; ++g) {
+        uint8_t* mask = masks_.data() + cellSize * g;
+        for (int y = 0; y < kGlyphRows * scale; ++y) {
+            for (int x = 0; x < kGlyphColumns * scale; ++x) {
+                if (kFont5x7[g][x / scale] & (1 << (y / scale))) {
+                    mask[(size_t)(y + outlineWidth) * cellWidth_ + x + outlineWidth] = 2;
+                }
+            }
+        }
+        if (outlineWidth == 0) continue;
+
+        // Outline: empty pixels within outlineWidth of a filled one
+        for (int y = 0; y < cellHeight_; ++y) {
+            for (int x = 0; x < cellWidth_; ++x) {
+                if (mask[(size_t)y * cellWidth_ + x] != 0) continue;
+                bool near = false;
+                for (int dy = -outlineWidth; dy <= outlineWidth && !near; ++dy) {
+                    int yy = y + dy;
+                    if (yy < 0 || yy >= cellHeight_) continue;
+                    for (int dx = -outlineWidth; dx <= outlineWidth; ++dx) {
+                        int xx = x + dx;
+                        if (xx >= 0 && xx < cellWidth_ && mask[(size_t)yy * cellWidth_ + xx] == 2) {
+                            near = true;
+                            break;
+                        }
+                    }
+                }
+                if (near) mask[(size_t)y * cellWidth_ + x] = 1;
+            }
+        }
+    }
+}
+
+const uint8_t* GlyphAtlas::glyph(char c) const {
+    int index = (unsigned char)c - kFirstGlyph;
+    if (index < 0 || index >= kGlyphCount) index = '?' - kFirstGlyph;
+    return masks_.data() + (size_t)cellWidth_ * cellHeight_ * index;
+}
+
+TextOverlay::TextOverlay()
+    : nextId_(1)
+    , frameCount_(0)
+    , totalApplyMs_(0.0) {
+}
+
+int TextOverlay::addText(const std::string& text, int x, int y, const TextStyle& style) {
+    return addItem(OverlayField::Text, text, x, y, style);
+}
+
+int TextOverlay::addTimestamp(int x, int y, const TextStyle& style) {
+    return addItem(OverlayField::Timestamp, "", x, y, style);
+}
+
+int TextOverlay::addFrameCounter(const std::string& prefix, int x, int y, const TextStyle& style) {
+    return addItem(OverlayField::FrameCounter, prefix, x, y, style);
+}
+
+int TextOverlay::addItem(OverlayField field, const std::string& text, int x, int y, const TextStyle& style) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Item item;
+    item.field = field;
+    item.text = text;
+    item.x = x;
+    item.y = y;
+    item.style = style;
+    item.style.scale = std::max(1, style.scale);
+    item.style.padding = std::max(0, style.padding);
+    item.atlas = atlasFor(item.style);
+
+    uint32_t background = premultiplied(item.style.background);
+    item.palette[0] = background;
+    item.palette[1] = over(premultiplied(item.style.outline), background);
+    item.palette[2] = over(premultiplied(item.style.color), background);
+
+    int id = nextId_++;
+    items_.emplace(id, std::move(item));
+    return id;
+}
+
+std::shared_ptr<const GlyphAtlas> TextOverlay::atlasFor(const TextStyle& style) {
+    int outline = outlineWidthFor(style);
+    int key = style.scale * 64 + outline;
+    auto it = atlases_.find(key);
+    if (it != atlases_.end()) return it->second;
+    auto atlas = std::make_shared<const GlyphAtlas>(style.scale, outline);
+    atlases_[key] = atlas;
+    return atlas;
+}
+
+bool TextOverlay::setText(int id, const std::string& text) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = items_.find(id);
+    if (it == items_.end()) return false;
+    it->second.text = text;
+    return true;
+}
+
+bool TextOverlay::setPosition(int id, int x, int y) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = items_.find(id);
+    if (it == items_.end()) return false;
+    it->second.x = x;
+    it->second.y = y;
+    return true;
+}
+
+bool TextOverlay::remove(int id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = items_.find(id);
+    if (it == items_.end()) return false;
+    if (it->second.drawn) removedRects_.push_back(it->second.lastRect);
+    items_.erase(it);
+    return true;
+}
+
+void TextOverlay::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& entry : items_) {
+        if (entry.second.drawn) removedRects_.push_back(entry.second.lastRect);
+    }
+    items_.clear();
+}
+
+VideoRect TextOverlay::measure(const std::string& text, const TextStyle& style) {
+    int scale = std::max(1, style.scale);
+    int outline = outlineWidthFor(style);
+    int padding = std::max(0, style.padding);
+    int cellWidth = kGlyphColumns * scale + std::max(scale, 2 * outline);
+    int cellHeight = kGlyphRows * scale + 2 * outline;
+    return {0, 0, (int)text.size() * cellWidth + 2 * padding, cellHeight + 2 * padding};
+}
+
+std::string TextOverlay::currentText(const Item& item, const VideoFrame& frame) const {
+    char buffer[64];
+    switch (item.field) {
+        case OverlayField::Timestamp: {
+            time_t seconds = (time_t)(frame.timestamp / 1000000);
+            int millis = (int)(frame.timestamp / 1000 % 1000);
+            struct tm utc;
+            gmtime_r(&seconds, &utc);
+            snprintf(buffer, sizeof(buffer), "%04d-%02d-%02d %02d:%02d:%02d.%03d", utc.tm_year + 1900,
+                     utc.tm_mon + 1, utc.tm_mday, utc.tm_hour, utc.tm_min, utc.tm_sec, millis);
+            return buffer;
+        }
+        case OverlayField::FrameCounter:
+            snprintf(buffer, sizeof(buffer), "%llu", (unsigned long long)frameCount_);
+            return item.text + buffer;
+        default:
+            return item.text;
+    }
+}
+
+void TextOverlay::render(Item& item, const std::string& text) {
+    const GlyphAtlas& atlas = *item.atlas;
+    int padding = item.style.padding;
+    bool relayout = item.box.empty() || text.size() != item.rendered.size();
+
+    if (relayout) {
+        VideoRect size = measure(text, item.style);
+        item.box = VideoFrame(size.width, size.height);
+        for (int y = 0; y < size.height; ++y) {
+            uint32_t* row = reinterpret_cast<uint32_t*>(item.box.plane(0) + (size_t)y * item.box.stride(0));
+            std::fill(row, row + size.width, item.palette[0]);
+        }
+        item.yuv.clear();
+        item.rendered.assign(text.size(), '\0'); // Forces every cell below
+    }
+
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == item.rendered[i]) continue;
+        const uint8_t* mask = atlas.glyph(text[i]);
+        int x0 = padding + (int)i * atlas.cellWidth();
+        for (int y = 0; y < atlas.cellHeight(); ++y) {
+            uint32_t* row = reinterpret_cast<uint32_t*>(item.box.plane(0) + (size_t)(padding + y) * item.box.stride(0)) + x0;
+            const uint8_t* m = mask + (size_t)y * atlas.cellWidth();
+            for (int x = 0; x < atlas.cellWidth(); ++x) row[x] = item.palette[m[x]];
+        }
+
+        int x1 = x0 + atlas.cellWidth();
+        if (item.yuvDirtyBegin >= item.yuvDirtyEnd) {
+            item.yuvDirtyBegin = x0;
+            item.yuvDirtyEnd = x1;
+        } else {
+            item.yuvDirtyBegin = std::min(item.yuvDirtyBegin, x0);
+            item.yuvDirtyEnd = std::max(item.yuvDirtyEnd, x1);
+        }
+        stats_.glyphsRendered++;
+    }
+    if (relayout) {
+        item.yuvDirtyBegin = 0;
+        item.yuvDirtyEnd = item.box.width;
+    }
+    item.rendered = text;
+    item.changed = true;
+}
+
+void TextOverlay::convertYuv(Item& item) {
+    const VideoFrame& box = item.box;
+    int w = box.width, h = box.height;
+    int cw = (w + 1) / 2, ch = (h + 1) / 2;
+    size_t lumaSize = (size_t)w * h, chromaSize = (size_t)cw * ch;
+    if (item.yuv.empty()) {
+        item.yuv.assign(lumaSize * 2 + chromaSize * 3, 0);
+        item.yuvDirtyBegin = 0;
+        item.yuvDirtyEnd = w;
+    }
+    if (item.yuvDirtyBegin >= item.yuvDirtyEnd) return;
+
+    uint8_t* lumaP = item.yuv.data();
+    uint8_t* lumaA = lumaP + lumaSize;
+    uint8_t* chromaUP = lumaA + lumaSize;
+    uint8_t* chromaVP = chromaUP + chromaSize;
+    uint8_t* chromaA = chromaVP + chromaSize;
+
+    int begin = item.yuvDirtyBegin & ~1;
+    int end = std::min(w, (item.yuvDirtyEnd + 1) & ~1);
+    for (int y = 0; y < h; ++y) {
+        const uint8_t* row = box.plane(0) + (size_t)y * box.stride(0);
+        for (int x = begin; x < end; ++x) {
+            const uint8_t* p = row + x * 4;
+            lumaP[(size_t)y * w + x] = lumaOf(p[0], p[1], p[2], p[3]);
+            lumaA[(size_t)y * w + x] = p[3];
+        }
+    }
+    for (int cy = 0; cy < ch; ++cy) {
+        for (int cx = begin / 2; cx < (end + 1) / 2; ++cx) {
+            int sum[4] = {0, 0, 0, 0}, count = 0;
+            for (int y = cy * 2; y < std::min(h, cy * 2 + 2); ++y) {
+                for (int x = cx * 2; x < std::min(w, cx * 2 + 2); ++x) {
+                    const uint8_t* p = box.plane(0) + (size_t)y * box.stride(0) + x * 4;
+                    for (int c = 0; c < 4; ++c) sum[c] += p[c];
+                    count++;
+                }
+            }
+            int r = sum[0] / count, g = sum[1] / count, b = sum[2] / count, a = sum[3] / count;
+            size_t i = (size_t)cy * cw + cx;
+            chromaUP[i] = chromaU(r, g, b, a);
+            chromaVP[i] = chromaV(r, g, b, a);
+            chromaA[i] = (uint8_t)a;
+        }
+    }
+    item.yuvDirtyBegin = item.yuvDirtyEnd = 0;
+}
+
+VideoRect TextOverlay::placement(const Item& item, const VideoFrame& frame) const {
+    VideoRect rect{item.x, item.y, item.box.width, item.box.height};
+    if (item.x < 0) rect.x = frame.width - rect.width + item.x;
+    if (item.y < 0) rect.y = frame.height - rect.height + item.y;
+    if (frame.format != VideoFrame::Format::RGBA) {
+        rect.x &= ~1;
+        rect.y &= ~1;
+    }
+    return rect;
+}
+
+void TextOverlay::blitRgba(const Item& item, const VideoRect& rect, VideoFrame& frame) {
+    VideoRect clip = clipToFrame(rect, frame);
+    if (clip.width == 0 || clip.height == 0) return;
+    int sx = clip.x - rect.x, sy = clip.y - rect.y;
+    for (int y = 0; y < clip.height; ++y) {
+        const uint8_t* src = item.box.plane(0) + (size_t)(sy + y) * item.box.stride(0) + (size_t)sx * 4;
+        uint8_t* dst = frame.plane(0) + (size_t)(clip.y + y) * frame.stride(0) + (size_t)clip.x * 4;
+        blendPremultipliedSpan(src, dst, clip.width);
+    }
+}
+
+void TextOverlay::blitYuv(const Item& item, const VideoRect& rect, VideoFrame& frame) {
+    VideoRect clip = clipToFrame(rect, frame);
+    if (clip.width == 0 || clip.height == 0) return;
+    int w = item.box.width, h = item.box.height;
+    int cw = (w + 1) / 2, ch = (h + 1) / 2;
+    size_t lumaSize = (size_t)w * h, chromaSize = (size_t)cw * ch;
+    const uint8_t* lumaP = item.yuv.data();
+    const uint8_t* lumaA = lumaP + lumaSize;
+    const uint8_t* chromaUP = lumaA + lumaSize;
+    const uint8_t* chromaVP = chromaUP + chromaSize;
+    const uint8_t* chromaA = chromaVP + chromaSize;
+
+    int sx = clip.x - rect.x, sy = clip.y - rect.y;
+    for (int y = 0; y < clip.height; ++y) {
+        size_t s = (size_t)(sy + y) * w + sx;
+        uint8_t* dst = frame.plane(0) + (size_t)(clip.y + y) * frame.stride(0) + clip.x;
+        blendPremultipliedPlane(lumaP + s, lumaA + s, dst, clip.width);
+    }
+
+    // Box origins are even, so chroma samples line up with the frame's
+    int csx = sx / 2, csy = sy / 2;
+    int cx0 = clip.x / 2, cy0 = clip.y / 2;
+    int cols = std::min((clip.width + 1) / 2, frame.planeWidth(1) - cx0);
+    int rows = std::min((clip.height + 1) / 2, frame.planeHeight(1) - cy0);
+    for (int y = 0; y < rows; ++y) {
+        size_t s = (size_t)(csy + y) * cw + csx;
+        if (frame.format == VideoFrame::Format::I420) {
+            blendPremultipliedPlane(chromaUP + s, chromaA + s, frame.plane(1) + (size_t)(cy0 + y) * frame.stride(1) + cx0, cols);
+            blendPremultipliedPlane(chromaVP + s, chromaA + s, frame.plane(2) + (size_t)(cy0 + y) * frame.stride(2) + cx0, cols);
+        } else {
+            uint8_t* dst = frame.plane(1) + (size_t)(cy0 + y) * frame.stride(1) + (size_t)cx0 * 2;
+            for (int x = 0; x < cols; ++x) {
+                int inv = 255 - chromaA[s + x];
+                dst[x * 2] = (uint8_t)std::min(255, chromaUP[s + x] + div255(dst[x * 2] * inv));
+                dst[x * 2 + 1] = (uint8_t)std::min(255, chromaVP[s + x] + div255(dst[x * 2 + 1] * inv));
+            }
+        }
+    }
+}
+
+bool TextOverlay::apply(VideoFrame& frame) {
+    if (frame.empty()) return false;
+    auto start = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(mutex_);
+    frameCount_++;
+
+    std::vector<VideoRect> changedRects;
+    changedRects.swap(removedRects_);
+    if (!items_.empty() && frame.buffer.use_count() > 1) {
+        // Into a recycled buffer rather than clone()'s fresh one, which
+        // would cost an allocation and page faults on top of the copy
+        VideoFrame copy = framePool_.acquire(frame.width, frame.height, frame.format);
+        for (int i = 0; i < frame.planeCount; ++i) {
+            for (int y = 0; y < frame.planeHeight(i); ++y) {
+                std::memcpy(copy.plane(i) + (size_t)y * copy.stride(i), frame.plane(i) + (size_t)y * frame.stride(i),
+                            frame.planeRowBytes(i));
+            }
+        }
+        copy.timestamp = frame.timestamp;
+        copy.unchanged = frame.unchanged;
+        copy.dirtyRects = frame.dirtyRects;
+        copy.changeMap = frame.changeMap;
+        copy.analysis = frame.analysis;
+        frame = std::move(copy);
+        stats_.copiedFrames++;
+    }
+
+    for (auto& entry : items_) {
+        Item& item = entry.second;
+        std::string text = currentText(item, frame);
+        if (text != item.rendered || item.box.empty()) render(item, text);
+
+        VideoRect rect = placement(item, frame);
+        if (item.drawn && !sameRect(rect, item.lastRect)) {
+            changedRects.push_back(item.lastRect);
+            item.changed = true;
+        }
+        if (item.changed || !item.drawn) changedRects.push_back(rect);
+
+        if (frame.format == VideoFrame::Format::RGBA) {
+            blitRgba(item, rect, frame);
+        } else {
+            convertYuv(item);
+            blitYuv(item, rect, frame);
+        }
+        item.lastRect = rect;
+        item.drawn = true;
+        item.changed = false;
+    }
+
+    // The hints describe the frame as published, overlay included. Boxes
+    // that moved or re-rendered are new content even on an unchanged frame;
+    // an empty dirty list already means "everything".
+    std::vector<VideoRect> visible;
+    for (const auto& r : changedRects) {
+        VideoRect clipped = clipToFrame(r, frame);
+        if (clipped.width > 0 && clipped.height > 0) visible.push_back(clipped);
+    }
+    if (!visible.empty() && (frame.unchanged || !frame.dirtyRects.empty())) {
+        if (frame.unchanged) frame.dirtyRects.clear();
+        frame.unchanged = false;
+        frame.dirtyRects.insert(frame.dirtyRects.end(), visible.begin(), visible.end());
+        frame.changeMap.reset();
+    }
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    stats_.frames++;
+    totalApplyMs_ += ms;
+    stats_.avgApplyMs = totalApplyMs_ / stats_.frames;
+    return true;
+}
+
+OverlayStats TextOverlay::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
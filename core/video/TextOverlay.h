@@ -0,0 +1,127 @@
+#ifndef TEXT_OVERLAY_H
+#define TEXT_OVERLAY_H
+
+#include "VideoFrame.h"
+#include "VideoFramePool.h"
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct TextStyle {
+    int scale = 2;                               // Font pixels are scale x scale device pixels
+    uint8_t color[4] = {255, 255, 255, 255};     // RGBA
+    uint8_t outline[4] = {0, 0, 0, 255};         // Alpha 0 disables the outline
+    uint8_t background[4] = {0, 0, 0, 0};        // Box behind the text
+    int padding = 2;                             // Background margin in device pixels
+};
+
+enum class OverlayField {
+    Text,         // Fixed string, changed with setText()
+    Timestamp,    // Frame timestamp as UTC "YYYY-MM-DD HH:MM:SS.mmm"
+    FrameCounter  // Text followed by the number of frames seen by apply()
+};
+
+struct OverlayStats {
+    uint64_t frames = 0;
+    uint64_t glyphsRendered = 0;  // Character cells re-rendered from the atlas
+    uint64_t copiedFrames = 0;    // Shared frames copied before drawing
+    double avgApplyMs = 0.0;
+};
+
+// Glyph masks of the embedded 5x7 bitmap font, rasterised once per scale
+// and outline width. Each printable ASCII glyph is a cellWidth x
+// cellHeight map of 0 (empty), 1 (outline) or 2 (fill).
+class GlyphAtlas {
+public:
+    GlyphAtlas(int scale, int outlineWidth);
+
+    int cellWidth() const { return cellWidth_; }
+    int cellHeight() const { return cellHeight_; }
+    // Row-major mask for `c`; characters outside 32..126 map to '?'
+    const uint8_t* glyph(char c) const;
+
+private:
+    int cellWidth_;
+    int cellHeight_;
+    std::vector<uint8_t> masks_;
+};
+
+// Burns text, timestamps and frame counters into frames. Each item keeps
+// its rendered box cached as premultiplied RGBA (plus Y/U/V and alpha
+// planes for I420/NV12, converted lazily); when the text changes only the
+// character cells that differ are redrawn from the atlas. Per frame the
+// cached boxes are alpha-blended into their own rectangles and nothing
+// else is touched. A negative x or y is a margin from the right/bottom
+// edge instead; on I420/NV12 boxes snap to even coordinates.
+class TextOverlay {
+public:
+    TextOverlay();
+
+    // Returns an item id for the setters below
+    int addText(const std::string& text, int x, int y, const TextStyle& style = TextStyle());
+    int addTimestamp(int x, int y, const TextStyle& style = TextStyle());
+    int addFrameCounter(const std::string& prefix, int x, int y, const TextStyle& style = TextStyle());
+
+    bool setText(int id, const std::string& text);
+    bool setPosition(int id, int x, int y);
+    bool remove(int id);
+    void clear();
+
+    // Draws every item into `frame` (RGBA, I420 or NV12). Updates the
+    // change hints when the overlay itself changed. Returns false for an
+    // empty frame.
+    //
+    // Only the boxes are touched when `frame` owns its pixels. A frame that
+    // shares them, e.g. one from a source's getFrame() while the source
+    // still holds it, cannot be drawn on in place: it is first copied whole
+    // into a pooled frame, which then replaces `frame`.
+    bool apply(VideoFrame& frame);
+
+    OverlayStats getStats() const;
+
+    // Box size of `text` in `style`, padding included
+    static VideoRect measure(const std::string& text, const TextStyle& style);
+
+private:
+    struct Item {
+        OverlayField field = OverlayField::Text;
+        std::string text;         // Text, or the counter prefix
+        int x = 0;
+        int y = 0;
+        TextStyle style;
+        std::shared_ptr<const GlyphAtlas> atlas;
+        uint32_t palette[3];      // Premultiplied background, outline-over-background, fill-over-background
+
+        std::string rendered;     // Text currently in the cache
+        VideoFrame box;           // Premultiplied RGBA
+        std::vector<uint8_t> yuv; // Y, A, then U, V, chroma A planes
+        int yuvDirtyBegin = 0;    // Columns of `box` not yet converted
+        int yuvDirtyEnd = 0;
+        VideoRect lastRect;       // Where it was drawn last frame
+        bool drawn = false;       // lastRect is valid
+        bool changed = true;      // Pixels or placement differ from the last frame
+    };
+
+    int addItem(OverlayField field, const std::string& text, int x, int y, const TextStyle& style);
+    std::shared_ptr<const GlyphAtlas> atlasFor(const TextStyle& style);
+    std::string currentText(const Item& item, const VideoFrame& frame) const;
+    void render(Item& item, const std::string& text);
+    void convertYuv(Item& item);
+    VideoRect placement(const Item& item, const VideoFrame& frame) const;
+    static void blitRgba(const Item& item, const VideoRect& rect, VideoFrame& frame);
+    static void blitYuv(const Item& item, const VideoRect& rect, VideoFrame& frame);
+
+    mutable std::mutex mutex_;
+    std::map<int, Item> items_;
+    std::map<int, std::shared_ptr<const GlyphAtlas>> atlases_; // By scale * 64 + outline width
+    std::vector<VideoRect> removedRects_; // Still on the previous frame
+    VideoFramePool framePool_;            // Copies of shared frames
+    int nextId_;
+    uint64_t frameCount_;
+    OverlayStats stats_;
+    double totalApplyMs_;
+};
+
+#endif // TEXT_OVERLAY_H
@@ -0,0 +1,297 @@
+#include "V4L2DeviceEnumerator.h"
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <chrono>
+#include <dirent.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <linux/videodev2.h>
+
+namespace {
+
+std::string readAttribute(const std::string& path) {
+    std::ifstream in(path);
+    std::string value;
+    std::getline(in, value);
+    return value;
+}
+
+std::string fourccToString(uint32_t code) {
+    std::string s;
+    for (int i = 0; i < 4; ++i) {
+        s.push_back((char)((code >> (8 * i)) & 0xFF));
+    }
+    return s;
+}
+
+int xioctl(int fd, unsigned long request, void* arg) {
+    int r;
+    do {
+        r = ioctl(fd, request, arg);
+    } while (r == -1 && errno == EINTR);
+    return r;
+}
+
+} // namespace
+
+V4L2DeviceEnumerator::V4L2DeviceEnumerator(const std::string& sysfsRoot, const std::string& devRoot)
+    : sysfsRoot_(sysfsRoot), devRoot_(devRoot), scanned_(false), generation_(0),
+      watchAttempted_(false), watching_(false), inotifyFd_(-1), wakeFd_(-1) {
+}
+
+V4L2DeviceEnumerator::~V4L2DeviceEnumerator() {
+    stopWatching();
+}
+
+V4L2DeviceEnumerator& V4L2DeviceEnumerator::getInstance() {
+    static V4L2DeviceEnumerator instance;
+    return instance;
+}
+
+std::vector<V4L2DeviceInfo> V4L2DeviceEnumerator::getDevices() {
+    std::lock_guard<std::mutex> lock(cacheMutex_);
+    if (!scanned_) {
+        cache_ = scan();
+        scanned_ = true;
+        generation_++;
+    }
+    return cache_;
+}
+
+void V4L2DeviceEnumerator::refresh() {
+    auto devices = scan();
+    std::lock_guard<std::mutex> lock(cacheMutex_);
+    // Keep probed formats for devices that are still present
+    for (auto& device : devices) {
+        for (const auto& old : cache_) {
+            if (old.index == device.index && old.name == device.name) {
+                device.formats = old.formats;
+            }
+        }
+    }
+    cache_ = std::move(devices);
+    scanned_ = true;
+    generation_++;
+}
+
+std::vector<V4L2DeviceInfo> V4L2DeviceEnumerator::scan() const {
+    std::vector<V4L2DeviceInfo> devices;
+
+    DIR* dir = opendir(sysfsRoot_.c_str());
+    if (!dir) return devices;
+
+    while (dirent* entry = readdir(dir)) {
+        std::string node = entry->d_name;
+        if (node.compare(0, 5, "video") != 0) continue;
+
+        V4L2DeviceInfo info;
+        try {
+            info.index = std::stoi(node.substr(5));
+        } catch (...) {
+            continue;
+        }
+
+        std::string base = sysfsRoot_ + "/" + node;
+        info.name = readAttribute(base + "/name");
+        info.devicePath = devRoot_ + "/" + node;
+
+        // UVC exposes a metadata node next to each capture node; the sysfs
+        // "index" attribute is 0 only for the primary (capture) node.
+        std::string nodeIndex = readAttribute(base + "/index");
+        info.isCapture = nodeIndex.empty() || nodeIndex == "0";
+
+        // Opening the node (without streaming) is cheap and gives the real
+        // capability bits; skip it when the node is absent (fake trees).
+        int fd = open(info.devicePath.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+        if (fd >= 0) {
+            v4l2_capability cap;
+            std::memset(&cap, 0, sizeof(cap));
+            if (xioctl(fd, VIDIOC_QUERYCAP, &cap) == 0) {
+                uint32_t caps = (cap.capabilities & V4L2_CAP_DEVICE_CAPS) ? cap.device_caps : cap.capabilities;
+                info.isCapture = (caps & V4L2_CAP_VIDEO_CAPTURE) != 0;
+                info.busInfo = reinterpret_cast<const char*>(cap.bus_info);
+            }
+            close(fd);
+        }
+
+        if (info.isCapture) {
+            devices.push_back(std::move(info));
+        }
+    }
+    closedir(dir);
+
+    std::sort(devices.begin(), devices.end(),
+              [](const V4L2DeviceInfo& a, const V4L2DeviceInfo& b) { return a.index < b.index; });
+    return devices;
+}
+
+void V4L2DeviceEnumerator::probeFormats(V4L2DeviceInfo& device) {
+    device.formats.clear();
+    int fd = open(device.devicePath.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) return;
+
+    v4l2_fmtdesc fmt;
+    std::memset(&fmt, 0, sizeof(fmt));
+    fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    while (xioctl(fd, VIDIOC_ENUM_FMT, &fmt) == 0) {
+        V4L2FormatInfo format;
+        format.fourcc = fourccToString(fmt.pixelformat);
+        format.description = reinterpret_cast<const char*>(fmt.description);
+
+        v4l2_frmsizeenum size;
+        std::memset(&size, 0, sizeof(size));
+        size.pixel_format = fmt.pixelformat;
+        while (xioctl(fd, VIDIOC_ENUM_FRAMESIZES, &size) == 0) {
+            V4L2FrameSize frameSize;
+            if (size.type == V4L2_FRMSIZE_TYPE_DISCRETE) {
+                frameSize.width = size.discrete.width;
+                frameSize.height = size.discrete.height;
+            } else {
+                // Stepwise/continuous: report the maximum
+                frameSize.width = size.stepwise.max_width;
+                frameSize.height = size.stepwise.max_height;
+            }
+
+            v4l2_frmivalenum interval;
+            std::memset(&interval, 0, sizeof(interval));
+            interval.pixel_format = fmt.pixelformat;
+            interval.width = frameSize.width;
+            interval.height = frameSize.height;
+            while (xioctl(fd, VIDIOC_ENUM_FRAMEINTERVALS, &interval) == 0) {
+                if (interval.type == V4L2_FRMIVAL_TYPE_DISCRETE && interval.discrete.numerator > 0) {
+                    frameSize.fps.push_back((double)interval.discrete.denominator / interval.discrete.numerator);
+                }
+                if (interval.type != V4L2_FRMIVAL_TYPE_DISCRETE) break;
+                interval.index++;
+            }
+
+            format.sizes.push_back(std::move(frameSize));
+            if (size.type != V4L2_FRMSIZE_TYPE_DISCRETE) break;
+            size.index++;
+        }
+
+        device.formats.push_back(std::move(format));
+        fmt.index++;
+    }
+    close(fd);
+}
+
+std::future<std::vector<V4L2DeviceInfo>> V4L2DeviceEnumerator::probeFormatsAsync() {
+    return std::async(std::launch::async, [this]() {
+        auto devices = getDevices();
+        for (auto& device : devices) {
+            probeFormats(device);
+        }
+
+        std::lock_guard<std::mutex> lock(cacheMutex_);
+        for (auto& cached : cache_) {
+            for (const auto& probed : devices) {
+                if (probed.index == cached.index && probed.name == cached.name) {
+                    cached.formats = probed.formats;
+                }
+            }
+        }
+        return devices;
+    });
+}
+
+bool V4L2DeviceEnumerator::startWatching(ChangeCallback callback) {
+    std::lock_guard<std::mutex> lock(watchMutex_);
+    watchAttempted_ = true;
+    return startWatchingLocked(std::move(callback));
+}
+
+bool V4L2DeviceEnumerator::startWatchingOnce() {
+    std::lock_guard<std::mutex> lock(watchMutex_);
+    if (watchAttempted_) return watching_;
+    watchAttempted_ = true;
+    return startWatchingLocked(nullptr);
+}
+
+bool V4L2DeviceEnumerator::startWatchingLocked(ChangeCallback callback) {
+    if (watching_) return true;
+
+    inotifyFd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd_ < 0) {
+        std::cerr << "V4L2DeviceEnumerator: inotify unavailable: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    // Device nodes come and go under /dev; sysfs itself does not emit inotify
+    // events, but a fake tree used in tests does, so watch both.
+    const uint32_t mask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO;
+    int watches = 0;
+    if (inotify_add_watch(inotifyFd_, devRoot_.c_str(), mask) >= 0) watches++;
+    if (inotify_add_watch(inotifyFd_, sysfsRoot_.c_str(), mask) >= 0) watches++;
+    if (watches == 0) {
+        close(inotifyFd_);
+        inotifyFd_ = -1;
+        return false;
+    }
+
+    wakeFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    callback_ = std::move(callback);
+    getDevices();
+
+    watching_ = true;
+    watchThread_ = std::thread(&V4L2DeviceEnumerator::watchLoop, this);
+    return true;
+}
+
+void V4L2DeviceEnumerator::stopWatching() {
+    std::lock_guard<std::mutex> lock(watchMutex_);
+    if (!watching_) return;
+
+    watching_ = false;
+    uint64_t one = 1;
+    if (write(wakeFd_, &one, sizeof(one)) < 0) {
+        // The thread also wakes up on its poll timeout
+    }
+    if (watchThread_.joinable()) {
+        watchThread_.join();
+    }
+    close(inotifyFd_);
+    close(wakeFd_);
+    inotifyFd_ = -1;
+    wakeFd_ = -1;
+}
+
+void V4L2DeviceEnumerator::watchLoop() {
+    alignas(inotify_event) char events[4096];
+
+    while (watching_) {
+        pollfd fds[2] = {{inotifyFd_, POLLIN, 0}, {wakeFd_, POLLIN, 0}};
+        if (poll(fds, 2, 1000) <= 0 || !(fds[0].revents & POLLIN)) continue;
+
+        bool relevant = false;
+        ssize_t len;
+        while ((len = read(inotifyFd_, events, sizeof(events))) > 0) {
+            for (char* p = events; p < events + len;) {
+                auto* event = reinterpret_cast<inotify_event*>(p);
+                if (event->len > 0 && std::strncmp(event->name, "video", 5) == 0) {
+                    relevant = true;
+                }
+                p += sizeof(inotify_event) + event->len;
+            }
+        }
+        if (!relevant) continue;
+
+        // udev creates the node before it finishes setting permissions and
+        // sysfs attributes; give it a moment so the rescan sees the final state.
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        while (read(inotifyFd_, events, sizeof(events)) > 0) {
+        }
+
+        refresh();
+        if (callback_) {
+            callback_(getDevices());
+        }
+    }
+}
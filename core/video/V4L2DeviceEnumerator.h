@@ -0,0 +1,91 @@
+#ifndef V4L2_DEVICE_ENUMERATOR_H
+#define V4L2_DEVICE_ENUMERATOR_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <future>
+#include <functional>
+#include <cstdint>
+
+struct V4L2FrameSize {
+    int width = 0;
+    int height = 0;
+    std::vector<double> fps; // Discrete frame rates; empty if the driver reports none
+};
+
+struct V4L2FormatInfo {
+    std::string fourcc;
+    std::string description;
+    std::vector<V4L2FrameSize> sizes;
+};
+
+struct V4L2DeviceInfo {
+    int index = -1;          // N in videoN, matches the OpenCV camera index
+    std::string name;        // sysfs "name" attribute
+    std::string devicePath;  // e.g. /dev/video0
+    std::string busInfo;     // From VIDIOC_QUERYCAP when the node could be queried
+    bool isCapture = true;   // False for metadata/output nodes
+    std::vector<V4L2FormatInfo> formats; // Filled by probeFormatsAsync()
+};
+
+// Enumerates cameras from /sys/class/video4linux without opening capture
+// streams, caches the result and keeps it current by watching for device
+// nodes appearing and disappearing with inotify. Both roots can point at a
+// fake tree so the enumerator is testable without hardware.
+class V4L2DeviceEnumerator {
+public:
+    using ChangeCallback = std::function<void(const std::vector<V4L2DeviceInfo>&)>;
+
+    explicit V4L2DeviceEnumerator(const std::string& sysfsRoot = "/sys/class/video4linux",
+                                  const std::string& devRoot = "/dev");
+    ~V4L2DeviceEnumerator();
+
+    static V4L2DeviceEnumerator& getInstance();
+
+    // Cached capture devices. Scans on first use only.
+    std::vector<V4L2DeviceInfo> getDevices();
+
+    // Force a synchronous rescan of sysfs
+    void refresh();
+
+    // Watch for hotplug; the callback runs on the watcher thread after each
+    // change. Does nothing if already watching. Safe to call concurrently.
+    bool startWatching(ChangeCallback callback = nullptr);
+    // startWatching() on the first call only, so callers that merely want
+    // a current cache neither retry nor log again where inotify fails
+    bool startWatchingOnce();
+    void stopWatching();
+
+    // Queries formats, sizes and frame rates of every cached device in the
+    // background and merges them into the cache when done.
+    std::future<std::vector<V4L2DeviceInfo>> probeFormatsAsync();
+
+    uint64_t getGeneration() const { return generation_.load(); }
+
+private:
+    std::vector<V4L2DeviceInfo> scan() const;
+    static void probeFormats(V4L2DeviceInfo& device);
+    bool startWatchingLocked(ChangeCallback callback);
+    void watchLoop();
+
+    std::string sysfsRoot_;
+    std::string devRoot_;
+
+    std::mutex cacheMutex_;
+    std::vector<V4L2DeviceInfo> cache_;
+    bool scanned_;
+    std::atomic<uint64_t> generation_;
+
+    std::mutex watchMutex_; // Serializes starting and stopping the watcher
+    bool watchAttempted_;
+    std::atomic<bool> watching_;
+    std::thread watchThread_;
+    int inotifyFd_;
+    int wakeFd_;
+    ChangeCallback callback_;
+};
+
+#endif // V4L2_DEVICE_ENUMERATOR_H
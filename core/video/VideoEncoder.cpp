@@ -0,0 +1,316 @@
+#include "VideoEncoder.h"
+#include "LosslessCodec.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+int resolvedWorkers(const VideoEncoderConfig& config) {
+    if (config.workerCount > 0) return config.workerCount;
+    return (int)std::max(1u, std::thread::hardware_concurrency());
+}
+
+double msSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+VideoEncoder::VideoEncoder(const VideoEncoderConfig& config)
+    : config_(config)
+    // Every in-flight copy holds a pooled frame
+    , framePool_((size_t)std::max(1, config.maxInFlight) + 1)
+    , nextSequence_(0)
+    , inFlight_(0)
+    , stopping_(false)
+    , running_(false)
+    , nextDelivery_(0)
+    , encodedFrames_(0)
+    , queuedPackets_(0)
+    , encodedBytesIn_(0)
+    , totalEncodeMs_(0.0)
+    , totalLatencyMs_(0.0) {
+    config_.maxInFlight = std::max(1, config_.maxInFlight);
+    config_.outputDepth = std::max(1, config_.outputDepth);
+}
+
+VideoEncoder::~VideoEncoder() {
+    stop();
+}
+
+bool VideoEncoder::start() {
+    if (running_) return true;
+    if (config_.width <= 0 || config_.height <= 0) {
+        std::cerr << "VideoEncoder: invalid size " << config_.width << "x" << config_.height << std::endl;
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(queueMutex_);
+        stopping_ = false;
+    }
+    running_ = true;
+    int count = resolvedWorkers(config_);
+    for (int i = 0; i < count; ++i) {
+        workers_.emplace_back(&VideoEncoder::workerLoop, this);
+    }
+    std::cout << "VideoEncoder started: " << config_.width << "x" << config_.height << " with " << count
+              << " workers" << std::endl;
+    return true;
+}
+
+void VideoEncoder::stop() {
+    {
+        std::lock_guard<std::mutex> lock(queueMutex_);
+        if (!running_) return;
+        stopping_ = true;
+    }
+    queueReady_.notify_all();
+    queueSpace_.notify_all();
+    for (auto& worker : workers_) {
+        if (worker.joinable()) worker.join();
+    }
+    workers_.clear();
+    running_ = false;
+}
+
+void VideoEncoder::flush() {
+    std::unique_lock<std::mutex> lock(queueMutex_);
+    queueSpace_.wait(lock, [this]() { return inFlight_ == 0; });
+}
+
+bool VideoEncoder::submit(const VideoFrame& frame, bool sceneCut) {
+    return enqueue(frame, sceneCut, true) == SubmitResult::Accepted;
+}
+
+SubmitResult VideoEncoder::trySubmit(const VideoFrame& frame, bool sceneCut) {
+    return enqueue(frame, sceneCut, false);
+}
+
+bool VideoEncoder::submitPacked(const uint8_t* data, size_t size, int64_t timestamp, bool sceneCut) {
+    VideoFrame frame;
+    if (!copyPacked(data, size, timestamp, frame)) {
+        countRejected();
+        return false;
+    }
+    return submit(frame, sceneCut);
+}
+
+SubmitResult VideoEncoder::trySubmitPacked(const uint8_t* data, size_t size, int64_t timestamp, bool sceneCut) {
+    {
+        std::lock_guard<std::mutex> lock(queueMutex_);
+        if (running_ && !stopping_ && inFlight_ >= config_.maxInFlight) {
+            std::lock_guard<std::mutex> statsLock(statsMutex_);
+            stats_.wouldBlock++;
+            return SubmitResult::WouldBlock;
+        }
+    }
+    VideoFrame frame;
+    if (!copyPacked(data, size, timestamp, frame)) {
+        countRejected();
+        return SubmitResult::Rejected;
+    }
+    return enqueue(frame, sceneCut, false);
+}
+
+SubmitResult VideoEncoder::enqueue(const VideoFrame& frame, bool sceneCut, bool block) {
+    if (frame.empty() || frame.width != config_.width || frame.height != config_.height) {
+        countRejected();
+        return SubmitResult::Rejected;
+    }
+
+    bool blocked = false;
+    int inFlight = 0;
+    {
+        std::unique_lock<std::mutex> lock(queueMutex_);
+        auto full = [this]() { return inFlight_ >= config_.maxInFlight; };
+        if (running_ && !stopping_ && full()) {
+            if (!block) {
+                lock.unlock();
+                std::lock_guard<std::mutex> statsLock(statsMutex_);
+                stats_.wouldBlock++;
+                return SubmitResult::WouldBlock;
+            }
+            blocked = true;
+            queueSpace_.wait(lock, [&]() { return stopping_ || !full(); });
+        }
+        if (!running_ || stopping_) {
+            lock.unlock();
+            countRejected();
+            return SubmitResult::Rejected;
+        }
+        inFlight = ++inFlight_;
+        queue_.push_back(Job{nextSequence_++, frame, sceneCut, std::chrono::steady_clock::now()});
+    }
+    queueReady_.notify_one();
+
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    stats_.submitted++;
+    stats_.bytesIn += frame.packedSize();
+    stats_.peakInFlight = std::max(stats_.peakInFlight, inFlight);
+    if (blocked) stats_.blockedSubmits++;
+    return SubmitResult::Accepted;
+}
+
+bool VideoEncoder::copyPacked(const uint8_t* data, size_t size, int64_t timestamp, VideoFrame& frame) {
+    int w = config_.width, h = config_.height;
+    size_t pixels = (size_t)std::max(0, w) * std::max(0, h);
+    size_t i420Size = pixels + 2 * (size_t)((w + 1) / 2) * ((h + 1) / 2);
+    if (!data || pixels == 0) return false;
+
+    if (size == pixels * 4) {
+        frame = framePool_.acquire(w, h, VideoFrame::Format::RGBA);
+        for (int y = 0; y < h; ++y) {
+            std::memcpy(frame.plane(0) + (size_t)y * frame.stride(0), data + (size_t)y * w * 4, (size_t)w * 4);
+        }
+    } else if (size == pixels * 3) {
+        frame = framePool_.acquire(w, h, VideoFrame::Format::RGBA);
+        for (int y = 0; y < h; ++y) {
+            const uint8_t* src = data + (size_t)y * w * 3;
+            uint8_t* dst = frame.plane(0) + (size_t)y * frame.stride(0);
+            for (int x = 0; x < w; ++x) {
+                dst[x * 4] = src[x * 3];
+                dst[x * 4 + 1] = src[x * 3 + 1];
+                dst[x * 4 + 2] = src[x * 3 + 2];
+                dst[x * 4 + 3] = 255;
+            }
+        }
+    } else if (size == i420Size) {
+        frame = framePool_.acquire(w, h, VideoFrame::Format::I420);
+        const uint8_t* src = data;
+        for (int i = 0; i < frame.planeCount; ++i) {
+            int rowBytes = frame.planeRowBytes(i);
+            for (int y = 0; y < frame.planeHeight(i); ++y) {
+                std::memcpy(frame.plane(i) + (size_t)y * frame.stride(i), src, rowBytes);
+                src += rowBytes;
+            }
+        }
+    } else {
+        return false;
+    }
+    frame.timestamp = (uint64_t)timestamp;
+    return true;
+}
+
+void VideoEncoder::countRejected() {
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    stats_.rejected++;
+}
+
+void VideoEncoder::setPacketCallback(PacketCallback callback) {
+    std::lock_guard<std::mutex> lock(outputMutex_);
+    callback_ = std::move(callback);
+}
+
+bool VideoEncoder::getPacket(EncodedPacket& packet) {
+    std::lock_guard<std::mutex> lock(outputMutex_);
+    if (packets_.empty()) return false;
+    packet = std::move(packets_.front());
+    packets_.pop_front();
+    queuedPackets_ = (int)packets_.size();
+    return true;
+}
+
+void VideoEncoder::recyclePacket(EncodedPacket&& packet) {
+    std::lock_guard<std::mutex> lock(bufferMutex_);
+    // Enough for every in-flight frame plus a reader holding a few
+    if (spareBuffers_.size() < (size_t)config_.maxInFlight * 2 && packet.data.capacity() > 0) {
+        spareBuffers_.push_back(std::move(packet.data));
+    }
+    packet.data = std::vector<uint8_t>();
+}
+
+std::vector<uint8_t> VideoEncoder::takeBuffer() {
+    std::lock_guard<std::mutex> lock(bufferMutex_);
+    if (spareBuffers_.empty()) return std::vector<uint8_t>();
+    std::vector<uint8_t> buffer = std::move(spareBuffers_.back());
+    spareBuffers_.pop_back();
+    buffer.clear();
+    return buffer;
+}
+
+VideoEncoderStats VideoEncoder::getStats() const {
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    VideoEncoderStats stats = stats_;
+    if (stats.encoded > 0) {
+        stats.avgEncodeMs = totalEncodeMs_ / stats.encoded;
+        stats.avgLatencyMs = totalLatencyMs_ / stats.encoded;
+    }
+    stats.inFlight = inFlight_;
+    stats.queuedPackets = queuedPackets_;
+    if (stats.bytesOut > 0) stats.compressionRatio = (double)encodedBytesIn_ / stats.bytesOut;
+    return stats;
+}
+
+void VideoEncoder::workerLoop() {
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex_);
+            queueReady_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+            // Stopping drains the queue first
+            if (queue_.empty()) return;
+            job = std::move(queue_.front());
+            queue_.pop_front();
+        }
+        queueSpace_.notify_one();
+
+        auto start = std::chrono::steady_clock::now();
+        Finished finished;
+        finished.packet.sequence = job.sequence;
+        finished.packet.timestamp = (int64_t)job.frame.timestamp;
+        finished.packet.sceneCut = job.sceneCut;
+        finished.submitted = job.submitted;
+        finished.packet.data = takeBuffer();
+        LosslessCodec::encode(job.frame, finished.packet.data, config_.sliceRows);
+        size_t inputBytes = job.frame.packedSize();
+        job.frame = VideoFrame(); // Back to the pool before delivery
+        double encodeMs = msSince(start);
+
+        {
+            std::lock_guard<std::mutex> lock(statsMutex_);
+            totalEncodeMs_ += encodeMs;
+            encodedBytesIn_ += inputBytes;
+            stats_.bytesOut += finished.packet.data.size();
+        }
+        deliver(job.sequence, std::move(finished));
+    }
+}
+
+void VideoEncoder::deliver(uint64_t sequence, Finished finished) {
+    std::lock_guard<std::mutex> lock(outputMutex_);
+    finished_.emplace(sequence, std::move(finished));
+    int delivered = 0;
+    while (!finished_.empty() && finished_.begin()->first == nextDelivery_) {
+        auto node = finished_.begin();
+        double latencyMs = msSince(node->second.submitted);
+        uint64_t dropped = 0;
+        if (callback_) {
+            callback_(node->second.packet);
+            recyclePacket(std::move(node->second.packet));
+        } else {
+            packets_.push_back(std::move(node->second.packet));
+            if (packets_.size() > (size_t)config_.outputDepth) {
+                recyclePacket(std::move(packets_.front()));
+                packets_.pop_front();
+                dropped = 1;
+            }
+            queuedPackets_ = (int)packets_.size();
+        }
+        finished_.erase(node);
+        nextDelivery_++;
+        encodedFrames_++;
+        delivered++;
+
+        std::lock_guard<std::mutex> statsLock(statsMutex_);
+        stats_.encoded++;
+        stats_.droppedPackets += dropped;
+        totalLatencyMs_ += latencyMs;
+    }
+    if (delivered == 0) return;
+    {
+        std::lock_guard<std::mutex> queueLock(queueMutex_);
+        inFlight_ -= delivered;
+    }
+    queueSpace_.notify_all();
+}
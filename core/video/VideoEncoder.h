@@ -0,0 +1,154 @@
+#ifndef VIDEO_ENCODER_H
+#define VIDEO_ENCODER_H
+
+#include "VideoFrame.h"
+#include "VideoFramePool.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct VideoEncoderConfig {
+    int width = 0;
+    int height = 0;
+    int fps = 30;
+    int bitrate = 0;       // Bits per second; recorded only, the codec is lossless
+    int workerCount = 0;   // 0 = hardware concurrency
+    int maxInFlight = 8;   // Frames submitted but not yet delivered before submit() blocks
+    int sliceRows = 64;
+    int outputDepth = 64;  // Packets kept for getPacket() without a callback; the oldest are dropped beyond
+};
+
+struct EncodedPacket {
+    uint64_t sequence = 0;
+    int64_t timestamp = 0;   // As submitted, microseconds; intra-only, so also the decode timestamp
+    bool keyframe = true;    // Every packet is intra-coded
+    bool sceneCut = false;   // The submitter hinted a cut here
+    std::vector<uint8_t> data;
+};
+
+struct VideoEncoderStats {
+    uint64_t submitted = 0;
+    uint64_t encoded = 0;
+    uint64_t rejected = 0;        // Wrong size or format, or submitted while stopped
+    uint64_t blockedSubmits = 0;  // submit() had to wait for an in-flight slot
+    uint64_t wouldBlock = 0;      // trySubmit() calls turned away for the same reason
+    uint64_t droppedPackets = 0;  // Output overflowed with nobody reading it
+    uint64_t bytesIn = 0;
+    uint64_t bytesOut = 0;
+    double avgEncodeMs = 0.0;     // Per frame on one worker
+    double avgLatencyMs = 0.0;    // submit() to in-order delivery
+    double compressionRatio = 0.0; // Raw over coded bytes of encoded frames
+    int inFlight = 0;             // Submitted, not yet delivered
+    int peakInFlight = 0;
+    int queuedPackets = 0;        // Delivered, waiting for getPacket()
+};
+
+enum class SubmitResult {
+    Accepted,
+    WouldBlock,  // maxInFlight frames are pending; retry after a packet comes out
+    Rejected     // Stopped, or a size/layout mismatch
+};
+
+// In-tree encoder stage behind video_ffi.h. At most maxInFlight frames are
+// between submission and delivery (submit() blocks, trySubmit() reports
+// WouldBlock), which paces the producer. N worker threads each code whole
+// frames with LosslessCodec; finished frames are reassembled in submission
+// order before they are delivered to the packet callback or the getPacket()
+// queue. Packet buffers come from a pool: hand them back with
+// recyclePacket() once consumed.
+class VideoEncoder {
+public:
+    using PacketCallback = std::function<void(const EncodedPacket&)>;
+
+    explicit VideoEncoder(const VideoEncoderConfig& config);
+    ~VideoEncoder();
+
+    bool start();
+    // Encodes everything already submitted, then stops the workers
+    void stop();
+    bool isRunning() const { return running_; }
+    // Waits until everything submitted so far has been delivered. Must not
+    // be called from the packet callback.
+    void flush();
+
+    // Queues a frame at the configured size, sharing its pixels. Blocks
+    // while maxInFlight frames are pending. False when stopped or mismatched.
+    bool submit(const VideoFrame& frame, bool sceneCut = false);
+    SubmitResult trySubmit(const VideoFrame& frame, bool sceneCut = false);
+
+    // Copies a tightly packed RGBA, RGB24 or I420 buffer at the configured
+    // size (told apart by byte count) and submits it. For the FFI, whose
+    // buffers belong to the caller.
+    bool submitPacked(const uint8_t* data, size_t size, int64_t timestamp, bool sceneCut = false);
+    // Checks for a free slot before copying
+    SubmitResult trySubmitPacked(const uint8_t* data, size_t size, int64_t timestamp, bool sceneCut = false);
+
+    // Runs in submission order on a worker thread; keep it short
+    void setPacketCallback(PacketCallback callback);
+    // Oldest undelivered packet, when no callback is set
+    bool getPacket(EncodedPacket& packet);
+    // Returns the packet's buffer to the pool
+    void recyclePacket(EncodedPacket&& packet);
+
+    uint64_t getEncodedFrames() const { return encodedFrames_; }
+    VideoEncoderStats getStats() const;
+
+private:
+    struct Job {
+        uint64_t sequence;
+        VideoFrame frame;
+        bool sceneCut;
+        std::chrono::steady_clock::time_point submitted;
+    };
+
+    struct Finished {
+        EncodedPacket packet;
+        std::chrono::steady_clock::time_point submitted;
+    };
+
+    SubmitResult enqueue(const VideoFrame& frame, bool sceneCut, bool block);
+    bool copyPacked(const uint8_t* data, size_t size, int64_t timestamp, VideoFrame& frame);
+    void countRejected();
+    void workerLoop();
+    void deliver(uint64_t sequence, Finished finished);
+    std::vector<uint8_t> takeBuffer();
+
+    VideoEncoderConfig config_;
+    VideoFramePool framePool_; // Copies made by submitPacked()
+
+    std::mutex queueMutex_;
+    std::condition_variable queueReady_;
+    std::condition_variable queueSpace_; // Also signalled on every delivery, for flush()
+    std::deque<Job> queue_;
+    uint64_t nextSequence_;
+    std::atomic<int> inFlight_; // Written under queueMutex_
+    bool stopping_;
+    std::atomic<bool> running_;
+    std::vector<std::thread> workers_;
+
+    // Reassembly; the callback runs under this lock so delivery stays ordered
+    std::mutex outputMutex_;
+    std::map<uint64_t, Finished> finished_;
+    uint64_t nextDelivery_;
+    std::deque<EncodedPacket> packets_;
+    PacketCallback callback_;
+    std::atomic<uint64_t> encodedFrames_;
+    std::atomic<int> queuedPackets_;
+
+    std::mutex bufferMutex_;
+    std::vector<std::vector<uint8_t>> spareBuffers_;
+
+    mutable std::mutex statsMutex_;
+    VideoEncoderStats stats_;
+    uint64_t encodedBytesIn_; // Input behind bytesOut, for the ratio
+    double totalEncodeMs_;
+    double totalLatencyMs_;
+};
+
+#endif // VIDEO_ENCODER_H
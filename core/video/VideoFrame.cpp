@@ -0,0 +1,259 @@
+#include "VideoFrame.h"
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <new>
+
+namespace {
+
+size_t alignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+bool isChromaPlane(VideoFrame::Format fmt, int index) {
+    return fmt != VideoFrame::Format::RGBA && index > 0;
+}
+
+int bytesPerSample(VideoFrame::Format fmt, int index) {
+    switch (fmt) {
+        case VideoFrame::Format::RGBA: return 4;
+        case VideoFrame::Format::NV12: return index == 0 ? 1 : 2;
+        case VideoFrame::Format::I420:
+        default:                       return 1;
+    }
+}
+
+int subsampledWidth(VideoFrame::Format fmt, int index, int w) {
+    return isChromaPlane(fmt, index) ? (w + 1) / 2 : w;
+}
+
+int subsampledHeight(VideoFrame::Format fmt, int index, int h) {
+    return isChromaPlane(fmt, index) ? (h + 1) / 2 : h;
+}
+
+// Aligned layout used by every engine allocation: each plane starts on
+// kFrameAlignment and each stride is a multiple of it.
+size_t computeLayout(int w, int h, VideoFrame::Format fmt, int* strides, size_t* offsets) {
+    size_t total = 0;
+    int count = VideoFrame::planeCountFor(fmt);
+    for (int i = 0; i < count; ++i) {
+        int rowBytes = subsampledWidth(fmt, i, w) * bytesPerSample(fmt, i);
+        strides[i] = VideoFrame::alignedStride(rowBytes);
+        offsets[i] = total;
+        total = alignUp(total + (size_t)strides[i] * subsampledHeight(fmt, i, h), kFrameAlignment);
+    }
+    return total;
+}
+
+} // namespace
+
+// --- FrameBuffer ---
+
+FrameBuffer::FrameBuffer(uint8_t* data, size_t size, bool external, ReleaseCallback release)
+    : data_(data), size_(size), external_(external), release_(std::move(release)) {
+}
+
+FrameBuffer::~FrameBuffer() {
+    if (external_) {
+        if (release_) release_();
+    } else {
+        std::free(data_);
+    }
+}
+
+std::shared_ptr<FrameBuffer> FrameBuffer::allocate(size_t size, size_t alignment) {
+    // aligned_alloc requires the size to be a multiple of the alignment
+    size_t padded = alignUp(std::max<size_t>(size, 1), alignment);
+    void* mem = std::aligned_alloc(alignment, padded);
+    if (!mem) {
+        throw std::bad_alloc();
+    }
+    return std::shared_ptr<FrameBuffer>(new FrameBuffer(static_cast<uint8_t*>(mem), size, false, nullptr));
+}
+
+std::shared_ptr<FrameBuffer> FrameBuffer::wrap(uint8_t* data, size_t size, ReleaseCallback release) {
+    return std::shared_ptr<FrameBuffer>(new FrameBuffer(data, size, true, std::move(release)));
+}
+
+// --- VideoFrame ---
+
+VideoFrame::VideoFrame(int w, int h, Format fmt)
+    : width(w), height(h), timestamp(0), format(fmt), planeCount(planeCountFor(fmt)), unchanged(false) {
+    if (w > 0 && h > 0) {
+        int strides[kMaxPlanes];
+        size_t offsets[kMaxPlanes];
+        size_t size = computeLayout(w, h, fmt, strides, offsets);
+        buffer = FrameBuffer::allocate(size);
+        // aligned_alloc leaves the memory as it found it; never publish that
+        std::memset(buffer->data(), 0, size);
+        for (int i = 0; i < planeCount; ++i) {
+            planes[i].data = buffer->data() + offsets[i];
+            planes[i].stride = strides[i];
+            planes[i].offset = offsets[i];
+        }
+    }
+}
+
+VideoFrame VideoFrame::wrap(int w, int h, Format fmt, uint8_t* data, size_t size, int stride,
+                            FrameBuffer::ReleaseCallback release) {
+    int strides[kMaxPlanes] = {stride, 0, 0};
+    size_t offsets[kMaxPlanes] = {0, 0, 0};
+    if (fmt == Format::I420) {
+        strides[1] = strides[2] = stride / 2;
+        offsets[1] = (size_t)stride * h;
+        offsets[2] = offsets[1] + (size_t)strides[1] * ((h + 1) / 2);
+    } else if (fmt == Format::NV12) {
+        strides[1] = stride;
+        offsets[1] = (size_t)stride * h;
+    }
+    return fromBuffer(w, h, fmt, FrameBuffer::wrap(data, size, std::move(release)), strides, offsets);
+}
+
+VideoFrame VideoFrame::fromBuffer(int w, int h, Format fmt, std::shared_ptr<FrameBuffer> buffer,
+                                  const int* strides, const size_t* offsets) {
+    VideoFrame frame(0, 0, fmt);
+    frame.width = w;
+    frame.height = h;
+    frame.buffer = std::move(buffer);
+    for (int i = 0; i < frame.planeCount; ++i) {
+        frame.planes[i].data = frame.buffer->data() + offsets[i];
+        frame.planes[i].stride = strides[i];
+        frame.planes[i].offset = offsets[i];
+    }
+    return frame;
+}
+
+int VideoFrame::planeWidth(int index) const {
+    return subsampledWidth(format, index, width);
+}
+
+int VideoFrame::planeHeight(int index) const {
+    return subsampledHeight(format, index, height);
+}
+
+int VideoFrame::planeRowBytes(int index) const {
+    return planeWidth(index) * bytesPerSample(format, index);
+}
+
+bool VideoFrame::isAligned() const {
+    for (int i = 0; i < planeCount; ++i) {
+        if (reinterpret_cast<uintptr_t>(planes[i].data) % kFrameAlignment != 0 ||
+            planes[i].stride % kFrameAlignment != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t VideoFrame::packedSize() const {
+    if (empty()) return 0;
+    size_t size = 0;
+    for (int i = 0; i < planeCount; ++i) {
+        size += (size_t)planeRowBytes(i) * planeHeight(i);
+    }
+    return size;
+}
+
+bool VideoFrame::copyTo(uint8_t* dst, size_t dstSize) const {
+    if (!dst || dstSize < packedSize()) return false;
+
+    for (int i = 0; i < planeCount; ++i) {
+        int rowBytes = planeRowBytes(i);
+        int rows = planeHeight(i);
+        if (planes[i].stride == rowBytes) {
+            std::memcpy(dst, planes[i].data, (size_t)rowBytes * rows);
+            dst += (size_t)rowBytes * rows;
+            continue;
+        }
+        for (int y = 0; y < rows; ++y) {
+            std::memcpy(dst, planes[i].data + (size_t)y * planes[i].stride, rowBytes);
+            dst += rowBytes;
+        }
+    }
+    return true;
+}
+
+VideoFrame VideoFrame::crop(int x, int y, int w, int h) const {
+    if (format != Format::RGBA) {
+        x &= ~1;
+        y &= ~1;
+    }
+    x = std::clamp(x, 0, width);
+    y = std::clamp(y, 0, height);
+    w = std::clamp(w, 0, width - x);
+    h = std::clamp(h, 0, height - y);
+
+    VideoFrame view = *this;
+    view.width = w;
+    view.height = h;
+    for (int i = 0; i < planeCount; ++i) {
+        int px = isChromaPlane(format, i) ? x / 2 : x;
+        int py = isChromaPlane(format, i) ? y / 2 : y;
+        size_t delta = (size_t)py * planes[i].stride + (size_t)px * bytesPerSample(format, i);
+        view.planes[i].data += delta;
+        view.planes[i].offset += delta;
+    }
+
+    // Carry change hints over into the view's coordinates
+    view.changeMap.reset();
+    view.analysis.reset();
+    if (!dirtyRects.empty()) {
+        view.dirtyRects.clear();
+        for (const auto& r : dirtyRects) {
+            int x0 = std::max(r.x, x), y0 = std::max(r.y, y);
+            int x1 = std::min(r.x + r.width, x + w), y1 = std::min(r.y + r.height, y + h);
+            if (x1 > x0 && y1 > y0) {
+                view.dirtyRects.push_back({x0 - x, y0 - y, x1 - x0, y1 - y0});
+            }
+        }
+        view.unchanged = view.dirtyRects.empty();
+    }
+    return view;
+}
+
+VideoFrame VideoFrame::clone() const {
+    VideoFrame copy(width, height, format);
+    copy.timestamp = timestamp;
+    copy.unchanged = unchanged;
+    copy.dirtyRects = dirtyRects;
+    copy.changeMap = changeMap;
+    copy.analysis = analysis;
+    if (empty()) return copy;
+
+    for (int i = 0; i < planeCount; ++i) {
+        int rowBytes = planeRowBytes(i);
+        for (int row = 0; row < planeHeight(i); ++row) {
+            std::memcpy(copy.planes[i].data + (size_t)row * copy.planes[i].stride,
+                        planes[i].data + (size_t)row * planes[i].stride, rowBytes);
+        }
+    }
+    return copy;
+}
+
+void VideoFrame::makeWritable() {
+    if (empty() || buffer.use_count() == 1) return;
+    *this = clone();
+}
+
+int VideoFrame::planeCountFor(Format fmt) {
+    switch (fmt) {
+        case Format::I420: return 3;
+        case Format::NV12: return 2;
+        case Format::RGBA:
+        default:           return 1;
+    }
+}
+
+int VideoFrame::alignedStride(int rowBytes) {
+    return (int)alignUp((size_t)rowBytes, kFrameAlignment);
+}
+
+size_t VideoFrame::allocationSize(int w, int h, Format fmt) {
+    int strides[kMaxPlanes];
+    size_t offsets[kMaxPlanes];
+    return computeLayout(w, h, fmt, strides, offsets);
+}
+
+size_t VideoFrame::layout(int w, int h, Format fmt, int* strides, size_t* offsets) {
+    return computeLayout(w, h, fmt, strides, offsets);
+}
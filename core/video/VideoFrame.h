@@ -3,27 +3,155 @@
 
 #include <vector>
 #include <cstdint>
+#include <cstddef>
 #include <memory>
+#include <functional>
+
+// Frames allocated by the engine start every plane and every row on this
+// boundary, so SIMD kernels can use aligned loads.
+constexpr size_t kFrameAlignment = 64;
+constexpr int kMaxPlanes = 3;
+
+// Reference-counted pixel storage shared by VideoFrame copies.
+// Either owns an aligned allocation or wraps memory owned by someone else
+// (cv::Mat, V4L2 mmap buffer, FFI buffer) and calls the release callback
+// once the last frame referencing it is gone.
+class FrameBuffer {
+public:
+    using ReleaseCallback = std::function<void()>;
+
+    static std::shared_ptr<FrameBuffer> allocate(size_t size, size_t alignment = kFrameAlignment);
+    static std::shared_ptr<FrameBuffer> wrap(uint8_t* data, size_t size, ReleaseCallback release);
+
+    ~FrameBuffer();
+    FrameBuffer(const FrameBuffer&) = delete;
+    FrameBuffer& operator=(const FrameBuffer&) = delete;
+
+    uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool isExternal() const { return external_; }
+
+private:
+    FrameBuffer(uint8_t* data, size_t size, bool external, ReleaseCallback release);
+
+    uint8_t* data_;
+    size_t size_;
+    bool external_;
+    ReleaseCallback release_;
+};
+
+struct VideoRect {
+    int x = 0;
+    int y = 0;
+    int width = 0;
+    int height = 0;
+};
+
+// Per-tile change flags on a fixed grid of tileSize x tileSize pixels
+// (in luma/RGBA coordinates), produced by FrameChangeDetector.
+struct TileChangeMap {
+    int tileSize = 0;
+    int tilesX = 0;
+    int tilesY = 0;
+    int changedTiles = 0;
+    std::vector<uint8_t> tiles; // Row-major, non-zero = changed
+
+    bool changed(int tx, int ty) const { return tiles[(size_t)ty * tilesX + tx] != 0; }
+    double changedFraction() const { return tiles.empty() ? 1.0 : (double)changedTiles / tiles.size(); }
+};
+
+// Content hints for the encoder, produced by ContentAnalyzer. The motion
+// grid covers the whole frame, so it stays valid when the frame is scaled.
+struct FrameAnalysis {
+    double sceneChangeScore = 0.0;   // 0..1, how likely this frame starts a new shot
+    double histogramDistance = 0.0;  // 0..1, luma histogram change from the previous frame
+    double meanSad = 0.0;            // Mean absolute luma difference per sample, 0..255
+    bool sceneCut = false;           // Encode as a keyframe (IDR)
+    double motionActivity = 0.0;     // Share of motion cells above the motion threshold
+    int motionCols = 0;
+    int motionRows = 0;
+    std::vector<uint8_t> motion;     // Row-major mean luma difference per cell, saturated at 255
+};
+
+struct VideoPlane {
+    uint8_t* data = nullptr; // First visible pixel of the plane
+    int stride = 0;          // Bytes between the starts of consecutive rows
+    size_t offset = 0;       // Byte offset of the plane from the buffer base
+};
 
 struct VideoFrame {
     int width;
     int height;
     uint64_t timestamp; // Microseconds
-    std::vector<uint8_t> data; // Raw pixel data (e.g., RGBA or YUV)
-    
+
     enum class Format {
         RGBA,
         I420,
         NV12
     } format;
 
-    VideoFrame(int w = 0, int h = 0, Format fmt = Format::RGBA) 
-        : width(w), height(h), timestamp(0), format(fmt) {
-        if (w > 0 && h > 0) {
-            size_t size = w * h * 4; 
-            data.resize(size);
-        }
-    }
+    // Plane layout. RGBA uses one plane, I420 three (Y, U, V), NV12 two (Y, UV).
+    VideoPlane planes[kMaxPlanes];
+    int planeCount;
+
+    // Shared storage. Copying a VideoFrame shares pixels instead of copying
+    // them; call makeWritable() before modifying a frame that may be shared.
+    std::shared_ptr<FrameBuffer> buffer;
+
+    // Change hints from the producer, relative to its previous frame.
+    // unchanged: pixels are identical. Otherwise dirtyRects lists what
+    // changed; empty means unknown (treat the whole frame as changed).
+    bool unchanged;
+    std::vector<VideoRect> dirtyRects;
+    // Tile-level detail behind dirtyRects; null unless a detector ran.
+    // Views from crop() drop it since their origin is off the tile grid.
+    std::shared_ptr<const TileChangeMap> changeMap;
+    // Scene-change and motion hints; null unless an analyzer ran. Views
+    // from crop() drop it since it describes the whole frame.
+    std::shared_ptr<const FrameAnalysis> analysis;
+
+    // Allocates a zeroed, aligned frame with padded strides.
+    VideoFrame(int w = 0, int h = 0, Format fmt = Format::RGBA);
+
+    // Wraps externally owned memory laid out as consecutive planes, where
+    // `stride` is the luma (or RGBA) stride. `release` runs when the last
+    // reference is dropped.
+    static VideoFrame wrap(int w, int h, Format fmt, uint8_t* data, size_t size, int stride,
+                           FrameBuffer::ReleaseCallback release);
+
+    // Builds a frame over an existing buffer with explicit per-plane layout.
+    static VideoFrame fromBuffer(int w, int h, Format fmt, std::shared_ptr<FrameBuffer> buffer,
+                                 const int* strides, const size_t* offsets);
+
+    uint8_t* plane(int index) const { return planes[index].data; }
+    int stride(int index) const { return planes[index].stride; }
+    int planeWidth(int index) const;
+    int planeHeight(int index) const;
+    int planeRowBytes(int index) const;
+
+    bool empty() const { return !buffer || width <= 0 || height <= 0; }
+    bool isAligned() const;
+
+    // Size of the frame with rows tightly packed (what the FFI copy produces)
+    size_t packedSize() const;
+    // Copies all planes tightly packed into dst. Returns false if dstSize is too small.
+    bool copyTo(uint8_t* dst, size_t dstSize) const;
+
+    // Returns a view sharing this frame's buffer. For I420/NV12 the origin is
+    // rounded down to even coordinates so chroma stays aligned with luma.
+    VideoFrame crop(int x, int y, int w, int h) const;
+
+    // Deep copy into a freshly allocated aligned frame
+    VideoFrame clone() const;
+
+    // Ensures this frame is the sole owner of its pixels, copying if needed
+    void makeWritable();
+
+    static int planeCountFor(Format fmt);
+    static int alignedStride(int rowBytes);
+    static size_t allocationSize(int w, int h, Format fmt);
+    // Plane strides and offsets the constructor lays out; returns allocationSize()
+    static size_t layout(int w, int h, Format fmt, int* strides, size_t* offsets);
 };
 
 #endif // VIDEO_FRAME_H
@@ -0,0 +1,38 @@
+#include "VideoFramePool.h"
+
+VideoFramePool::VideoFramePool(size_t maxFramesPerShape)
+    : maxFramesPerShape_(maxFramesPerShape) {
+}
+
+VideoFrame VideoFramePool::acquire(int width, int height, VideoFrame::Format format) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& frames = frames_[Shape(width, height, format)];
+    for (const auto& pooled : frames) {
+        // Only the pool still references it
+        if (pooled.buffer.use_count() == 1) {
+            VideoFrame frame = pooled;
+            frame.timestamp = 0;
+            return frame;
+        }
+    }
+
+    VideoFrame frame(width, height, format);
+    if (frames.size() < maxFramesPerShape_) {
+        frames.push_back(frame);
+    }
+    return frame;
+}
+
+size_t VideoFramePool::getPooledCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t count = 0;
+    for (const auto& entry : frames_) {
+        count += entry.second.size();
+    }
+    return count;
+}
+
+void VideoFramePool::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    frames_.clear();
+}
@@ -0,0 +1,33 @@
+#ifndef VIDEO_FRAME_POOL_H
+#define VIDEO_FRAME_POOL_H
+
+#include "VideoFrame.h"
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+// Recycles aligned frames by size and format. A pooled frame is handed out
+// again once every VideoFrame sharing its buffer is gone, so steady-state
+// pipelines stop allocating after the first few frames.
+class VideoFramePool {
+public:
+    explicit VideoFramePool(size_t maxFramesPerShape = 8);
+
+    // Returns a writable frame with no change hints. A reused frame keeps
+    // its previous pixels, so the caller must overwrite all of them. Past
+    // the per-shape limit the frame is allocated outside the pool.
+    VideoFrame acquire(int width, int height, VideoFrame::Format format);
+
+    size_t getPooledCount() const;
+    void clear();
+
+private:
+    using Shape = std::tuple<int, int, VideoFrame::Format>;
+
+    size_t maxFramesPerShape_;
+    mutable std::mutex mutex_;
+    std::map<Shape, std::vector<VideoFrame>> frames_;
+};
+
+#endif // VIDEO_FRAME_POOL_H
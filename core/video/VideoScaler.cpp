@@ -0,0 +1,407 @@
+#include "VideoScaler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SCALER_SSE2 1
+#endif
+
+namespace {
+
+// Fixed point: weights carry 14 fractional bits, the intermediate rows
+// between the two passes carry 6 (pixel value * 64).
+constexpr int kWeightBits = 14;
+constexpr int kInterBits = 6;
+constexpr int kHorizontalShift = kWeightBits - kInterBits;
+constexpr int kVerticalShift = kWeightBits + kInterBits;
+
+// Output rows per parallel band; each band re-filters a few source rows at
+// its edges, so bands should stay well above the tap count.
+constexpr int kBandRows = 32;
+
+constexpr double kPi = 3.14159265358979323846;
+
+double kernelRadius(ScaleMode mode) {
+    switch (mode) {
+        case ScaleMode::Box:      return 0.5;
+        case ScaleMode::Bilinear: return 1.0;
+        case ScaleMode::Bicubic:  return 2.0;
+        case ScaleMode::Lanczos:
+        default:                  return 3.0;
+    }
+}
+
+double sinc(double x) {
+    if (x == 0.0) return 1.0;
+    x *= kPi;
+    return std::sin(x) / x;
+}
+
+double kernel(ScaleMode mode, double x) {
+    x = std::fabs(x);
+    switch (mode) {
+        case ScaleMode::Bilinear:
+            return x < 1.0 ? 1.0 - x : 0.0;
+        case ScaleMode::Bicubic: {
+            // Catmull-Rom (Keys, a = -0.5)
+            const double a = -0.5;
+            if (x < 1.0) return ((a + 2.0) * x - (a + 3.0)) * x * x + 1.0;
+            if (x < 2.0) return ((a * x - 5.0 * a) * x + 8.0 * a) * x - 4.0 * a;
+            return 0.0;
+        }
+        case ScaleMode::Lanczos:
+            return x < 3.0 ? sinc(x) * sinc(x / 3.0) : 0.0;
+        case ScaleMode::Box:
+        default:
+            return x < 0.5 ? 1.0 : 0.0;
+    }
+}
+
+// Taps for one dimension: output i reads source [start[i], start[i] + taps)
+struct FilterBank {
+    int taps = 0;
+    int rowTaps = 0; // Per-output weight stride: 4, or taps rounded up to 8; padding weights are zero
+    std::vector<int> start;
+    std::vector<int16_t> weights; // rowTaps per output, kWeightBits fixed point
+
+    FilterBank(int srcSize, int dstSize, ScaleMode mode) {
+        double scale = (double)srcSize / dstSize;
+        double stretch = std::max(1.0, scale);
+        double support = kernelRadius(mode) * stretch;
+        int window = (int)std::ceil(support) * 2 + 2;
+
+        // Pass 1: quantized weights over the kernel footprint, with taps past
+        // the edges folded onto the edge pixel (edge replication)
+        std::vector<int> first(dstSize);
+        std::vector<int16_t> raw((size_t)dstSize * window, 0);
+        std::vector<double> w(window);
+        for (int i = 0; i < dstSize; ++i) {
+            double center = (i + 0.5) * scale - 0.5;
+            int lo = std::clamp((int)std::floor(center - support), 0, srcSize - 1);
+            first[i] = lo;
+
+            std::fill(w.begin(), w.end(), 0.0);
+            double sum = 0.0;
+            for (int x = (int)std::floor(center - support); x <= (int)std::ceil(center + support); ++x) {
+                double weight;
+                if (mode == ScaleMode::Box) {
+                    // Exact overlap of the pixel with the box footprint
+                    weight = std::max(0.0, std::min(x + 0.5, center + support) - std::max(x - 0.5, center - support));
+                } else {
+                    weight = kernel(mode, (x - center) / stretch);
+                }
+                if (weight == 0.0) continue;
+                w[std::clamp(std::clamp(x, 0, srcSize - 1) - lo, 0, window - 1)] += weight;
+                sum += weight;
+            }
+            if (sum == 0.0) {
+                w[std::clamp((int)std::lround(center) - lo, 0, window - 1)] = sum = 1.0;
+            }
+
+            // Push the rounding error onto the largest tap so flat areas stay flat
+            int16_t* out = &raw[(size_t)i * window];
+            int total = 0, largest = 0;
+            for (int k = 0; k < window; ++k) {
+                out[k] = (int16_t)std::lround(w[k] / sum * (1 << kWeightBits));
+                total += out[k];
+                if (std::abs(out[k]) > std::abs(out[largest])) largest = k;
+            }
+            out[largest] = (int16_t)(out[largest] + ((1 << kWeightBits) - total));
+        }
+
+        // Pass 2: trim zero taps. The footprint is a conservative bound;
+        // e.g. a 2:1 box really needs 2 taps, not 4.
+        std::vector<int> used(dstSize * 2);
+        taps = 1;
+        for (int i = 0; i < dstSize; ++i) {
+            const int16_t* in = &raw[(size_t)i * window];
+            int a = 0, b = window - 1;
+            while (a < b && in[a] == 0) ++a;
+            while (b > a && in[b] == 0) --b;
+            used[i * 2] = a;
+            used[i * 2 + 1] = b;
+            taps = std::max(taps, b - a + 1);
+        }
+        taps = std::min(taps, srcSize);
+        rowTaps = taps <= 4 ? 4 : (taps + 7) & ~7;
+        start.resize(dstSize);
+        weights.assign((size_t)dstSize * rowTaps, 0);
+        for (int i = 0; i < dstSize; ++i) {
+            int a = first[i] + used[i * 2];
+            start[i] = std::clamp(a, 0, srcSize - taps);
+            for (int k = used[i * 2]; k <= used[i * 2 + 1]; ++k) {
+                weights[(size_t)i * rowTaps + (first[i] + k - start[i])] = raw[(size_t)i * window + k];
+            }
+        }
+    }
+};
+
+int16_t toIntermediate(int sum) {
+    int v = (sum + (1 << (kHorizontalShift - 1))) >> kHorizontalShift;
+    return (int16_t)std::clamp(v, -32768, 32767);
+}
+
+// One source row -> intermediate row at destination width
+template <int C>
+void filterRowScalar(const uint8_t* src, int16_t* dst, int x, const FilterBank& bank) {
+    const uint8_t* s = src + (size_t)bank.start[x] * C;
+    const int16_t* w = &bank.weights[(size_t)x * bank.rowTaps];
+    int sum[C] = {};
+    for (int k = 0; k < bank.taps; ++k) {
+        for (int c = 0; c < C; ++c) sum[c] += s[k * C + c] * w[k];
+    }
+    for (int c = 0; c < C; ++c) dst[x * C + c] = toIntermediate(sum[c]);
+}
+
+template <int C>
+void filterRow(const uint8_t* src, int srcWidth, int16_t* dst, int dstWidth, const FilterBank& bank) {
+    int x = 0;
+#if defined(SCALER_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i round = _mm_set1_epi32(1 << (kHorizontalShift - 1));
+    if (C == 1 && bank.taps <= 4) {
+        // Four outputs of up to four taps each: two per madd register
+        auto load4 = [src](int at) {
+            int32_t v;
+            std::memcpy(&v, src + at, 4);
+            return _mm_cvtsi32_si128(v);
+        };
+        for (; x + 4 <= dstWidth && bank.start[x + 3] + 4 <= srcWidth; x += 4) {
+            const int16_t* w = &bank.weights[(size_t)x * 4];
+            __m128i p01 = _mm_unpacklo_epi8(_mm_unpacklo_epi32(load4(bank.start[x]), load4(bank.start[x + 1])), zero);
+            __m128i p23 = _mm_unpacklo_epi8(_mm_unpacklo_epi32(load4(bank.start[x + 2]), load4(bank.start[x + 3])), zero);
+            __m128i s01 = _mm_madd_epi16(p01, _mm_loadu_si128(reinterpret_cast<const __m128i*>(w)));
+            __m128i s23 = _mm_madd_epi16(p23, _mm_loadu_si128(reinterpret_cast<const __m128i*>(w + 8)));
+            __m128 even = _mm_shuffle_ps(_mm_castsi128_ps(s01), _mm_castsi128_ps(s23), _MM_SHUFFLE(2, 0, 2, 0));
+            __m128 odd = _mm_shuffle_ps(_mm_castsi128_ps(s01), _mm_castsi128_ps(s23), _MM_SHUFFLE(3, 1, 3, 1));
+            __m128i sum = _mm_add_epi32(_mm_add_epi32(_mm_castps_si128(even), _mm_castps_si128(odd)), round);
+            sum = _mm_srai_epi32(sum, kHorizontalShift);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + x), _mm_packs_epi32(sum, sum));
+        }
+    }
+    for (; x < dstWidth; ++x) {
+        const uint8_t* s = src + (size_t)bank.start[x] * C;
+        const int16_t* w = &bank.weights[(size_t)x * bank.rowTaps];
+        __m128i acc = round;
+        if (C == 1) {
+            // Eight taps per madd; the zero padding weights may read past
+            // the window, so stop short of the row end
+            if (bank.rowTaps < 8 || bank.start[x] + bank.rowTaps > srcWidth) break;
+            for (int k = 0; k < bank.taps; k += 8) {
+                __m128i px = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(s + k)), zero);
+                acc = _mm_add_epi32(acc, _mm_madd_epi16(px, _mm_loadu_si128(reinterpret_cast<const __m128i*>(w + k))));
+            }
+            acc = _mm_add_epi32(acc, _mm_srli_si128(acc, 8));
+            acc = _mm_add_epi32(acc, _mm_srli_si128(acc, 4));
+            int v = _mm_cvtsi128_si32(acc) - (1 << (kHorizontalShift - 1)) * 3;
+            dst[x] = (int16_t)std::clamp(v >> kHorizontalShift, -32768, 32767);
+            continue;
+        }
+
+        // Two pixels per madd, channels interleaved as (p0c, p1c) pairs
+        int k = 0;
+        for (; k + 1 < bank.taps; k += 2) {
+            __m128i wab = _mm_set1_epi32((int)((uint32_t)(uint16_t)w[k] | ((uint32_t)(uint16_t)w[k + 1] << 16)));
+            __m128i px;
+            if (C == 4) {
+                px = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(s + k * 4)), zero);
+                px = _mm_unpacklo_epi16(px, _mm_srli_si128(px, 8));
+            } else {
+                int32_t pair;
+                std::memcpy(&pair, s + k * 2, 4);
+                px = _mm_unpacklo_epi8(_mm_cvtsi32_si128(pair), zero);
+                px = _mm_shufflelo_epi16(px, _MM_SHUFFLE(3, 1, 2, 0));
+            }
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(px, wab));
+        }
+        if (k < bank.taps) {
+            int32_t last = 0;
+            std::memcpy(&last, s + k * C, C);
+            __m128i px = _mm_unpacklo_epi8(_mm_cvtsi32_si128(last), zero);
+            px = _mm_unpacklo_epi16(px, zero);
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(px, _mm_set1_epi32((int)(uint16_t)w[k])));
+        }
+        __m128i v = _mm_srai_epi32(acc, kHorizontalShift);
+        v = _mm_packs_epi32(v, v);
+        if (C == 4) {
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + x * 4), v);
+        } else {
+            int32_t out = _mm_cvtsi128_si32(v);
+            std::memcpy(dst + x * 2, &out, 4);
+        }
+    }
+#endif
+    for (; x < dstWidth; ++x) {
+        filterRowScalar<C>(src, dst, x, bank);
+    }
+}
+
+// Weighted sum of intermediate rows -> one output row
+void blendRows(const int16_t* const* rows, const int16_t* w, int taps, uint8_t* dst, int count) {
+    int x = 0;
+#if defined(SCALER_SSE2)
+    const __m128i round = _mm_set1_epi32(1 << (kVerticalShift - 1));
+    for (; x + 8 <= count; x += 8) {
+        __m128i lo = round, hi = round;
+        int k = 0;
+        // Two rows per madd: interleave (a0,b0,a1,b1,...) against (wa,wb,wa,wb,...)
+        for (; k + 1 < taps; k += 2) {
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[k] + x));
+            __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[k + 1] + x));
+            __m128i wab = _mm_set1_epi32((int)((uint32_t)(uint16_t)w[k] | ((uint32_t)(uint16_t)w[k + 1] << 16)));
+            lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), wab));
+            hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), wab));
+        }
+        if (k < taps) {
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[k] + x));
+            __m128i wa = _mm_set1_epi32((int)(uint16_t)w[k]);
+            lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(a, _mm_setzero_si128()), wa));
+            hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(a, _mm_setzero_si128()), wa));
+        }
+        lo = _mm_srai_epi32(lo, kVerticalShift);
+        hi = _mm_srai_epi32(hi, kVerticalShift);
+        __m128i packed = _mm_packs_epi32(lo, hi);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + x), _mm_packus_epi16(packed, packed));
+    }
+#endif
+    for (; x < count; ++x) {
+        int sum = 1 << (kVerticalShift - 1);
+        for (int k = 0; k < taps; ++k) sum += rows[k][x] * w[k];
+        dst[x] = (uint8_t)std::clamp(sum >> kVerticalShift, 0, 255);
+    }
+}
+
+int channelsOf(VideoFrame::Format fmt, int plane) {
+    switch (fmt) {
+        case VideoFrame::Format::RGBA: return 4;
+        case VideoFrame::Format::NV12: return plane == 0 ? 1 : 2;
+        case VideoFrame::Format::I420:
+        default:                       return 1;
+    }
+}
+
+// Change hints carried into the scaled frame, padded by the filter reach
+VideoRect scaleRect(const VideoRect& r, double sx, double sy, int pad, int width, int height) {
+    int x0 = std::max(0, (int)std::floor(r.x * sx) - pad);
+    int y0 = std::max(0, (int)std::floor(r.y * sy) - pad);
+    int x1 = std::min(width, (int)std::ceil((r.x + r.width) * sx) + pad);
+    int y1 = std::min(height, (int)std::ceil((r.y + r.height) * sy) + pad);
+    return {x0, y0, std::max(0, x1 - x0), std::max(0, y1 - y0)};
+}
+
+} // namespace
+
+VideoScaler::VideoScaler(size_t threadCount)
+    : pool_(std::make_unique<core::utils::ThreadPool>(threadCount)) {
+}
+
+void VideoScaler::scalePlane(const uint8_t* src, int srcStride, int srcWidth, int srcHeight,
+                             uint8_t* dst, int dstStride, int dstWidth, int dstHeight,
+                             int channels, ScaleMode mode) {
+    FilterBank horizontal(srcWidth, dstWidth, mode);
+    FilterBank vertical(srcHeight, dstHeight, mode);
+    const int rowSamples = dstWidth * channels;
+    // 16-byte aligned intermediate rows
+    const int interStride = (rowSamples + 7) & ~7;
+
+    pool_->parallelFor(dstHeight, [&](int y0, int y1) {
+        // Source rows this band reads, filtered horizontally once each
+        int first = vertical.start[y0];
+        int last = vertical.start[y1 - 1] + vertical.taps;
+        thread_local std::vector<int16_t> inter;
+        inter.resize((size_t)(last - first) * interStride);
+
+        for (int sy = first; sy < last; ++sy) {
+            const uint8_t* in = src + (size_t)sy * srcStride;
+            int16_t* out = &inter[(size_t)(sy - first) * interStride];
+            switch (channels) {
+                case 4:  filterRow<4>(in, srcWidth, out, dstWidth, horizontal); break;
+                case 2:  filterRow<2>(in, srcWidth, out, dstWidth, horizontal); break;
+                default: filterRow<1>(in, srcWidth, out, dstWidth, horizontal); break;
+            }
+        }
+
+        std::vector<const int16_t*> rows(vertical.taps);
+        for (int y = y0; y < y1; ++y) {
+            for (int k = 0; k < vertical.taps; ++k) {
+                rows[k] = &inter[(size_t)(vertical.start[y] + k - first) * interStride];
+            }
+            blendRows(rows.data(), &vertical.weights[(size_t)y * vertical.rowTaps], vertical.taps,
+                      dst + (size_t)y * dstStride, rowSamples);
+        }
+    }, kBandRows);
+}
+
+bool VideoScaler::scale(const VideoFrame& src, VideoFrame& dst, ScaleMode mode) {
+    if (src.empty() || dst.empty() || src.format != dst.format) {
+        return false;
+    }
+
+    for (int i = 0; i < src.planeCount; ++i) {
+        scalePlane(src.plane(i), src.stride(i), src.planeWidth(i), src.planeHeight(i),
+                   dst.plane(i), dst.stride(i), dst.planeWidth(i), dst.planeHeight(i),
+                   channelsOf(src.format, i), mode);
+    }
+
+    dst.timestamp = src.timestamp;
+    dst.unchanged = src.unchanged;
+    dst.changeMap.reset();
+    dst.analysis = src.analysis; // Frame-relative, survives scaling
+    dst.dirtyRects.clear();
+    double sx = (double)dst.width / src.width, sy = (double)dst.height / src.height;
+    int pad = (int)std::ceil(kernelRadius(mode));
+    for (const auto& r : src.dirtyRects) {
+        dst.dirtyRects.push_back(scaleRect(r, sx, sy, pad, dst.width, dst.height));
+    }
+    return true;
+}
+
+VideoFrame VideoScaler::scale(const VideoFrame& src, int width, int height, ScaleMode mode) {
+    if (src.empty() || width <= 0 || height <= 0) {
+        return VideoFrame();
+    }
+    VideoFrame dst = framePool_.acquire(width, height, src.format);
+    scale(src, dst, mode);
+    return dst;
+}
+
+std::vector<VideoFrame> VideoScaler::scaleLadder(const VideoFrame& src, const std::vector<ScaleSize>& sizes,
+                                                 ScaleMode mode) {
+    std::vector<VideoFrame> results(sizes.size());
+    if (src.empty()) return results;
+
+    // Largest first, so each level can feed the smaller ones
+    std::vector<size_t> order(sizes.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&sizes](size_t a, size_t b) {
+        return (int64_t)sizes[a].width * sizes[a].height > (int64_t)sizes[b].width * sizes[b].height;
+    });
+
+    bool cheapMode = mode == ScaleMode::Box || mode == ScaleMode::Bilinear;
+    std::vector<const VideoFrame*> done;
+    for (size_t index : order) {
+        const ScaleSize& size = sizes[index];
+        if (size.width <= 0 || size.height <= 0) continue;
+
+        // Smallest finished level that can stand in for the source
+        const VideoFrame* input = &src;
+        for (const VideoFrame* level : done) {
+            bool larger = level->width >= size.width && level->height >= size.height;
+            bool exactHalf = level->width == size.width * 2 && level->height == size.height * 2;
+            if ((cheapMode ? larger : exactHalf) &&
+                (int64_t)level->width * level->height < (int64_t)input->width * input->height) {
+                input = level;
+            }
+        }
+
+        if (input->width == size.width && input->height == size.height) {
+            results[index] = *input; // Same size: share the pixels
+        } else {
+            results[index] = scale(*input, size.width, size.height, mode);
+        }
+        done.push_back(&results[index]);
+    }
+    return results;
+}
@@ -0,0 +1,57 @@
+#ifndef VIDEO_SCALER_H
+#define VIDEO_SCALER_H
+
+#include "VideoFrame.h"
+#include "VideoFramePool.h"
+#include "utils/thread_pool.h"
+#include <memory>
+#include <vector>
+
+enum class ScaleMode {
+    Box,      // Area average; fastest, good for large integer downscales
+    Bilinear,
+    Bicubic,  // Catmull-Rom
+    Lanczos   // Lanczos-3; sharpest, most taps
+};
+
+struct ScaleSize {
+    int width = 0;
+    int height = 0;
+};
+
+// Separable resampler for RGBA, I420 and NV12. Filter taps are
+// precomputed in fixed point per output row/column, the vertical pass is
+// SSE2-vectorized, and output rows are split into bands across a thread
+// pool. Downscaling widens the kernel by the scale factor, so every mode
+// is anti-aliased.
+class VideoScaler {
+public:
+    // threadCount == 0 uses every hardware thread
+    explicit VideoScaler(size_t threadCount = 0);
+
+    // Scales src into dst, which must already have the target size and
+    // src's format. Returns false on a format mismatch or empty frame.
+    bool scale(const VideoFrame& src, VideoFrame& dst, ScaleMode mode);
+
+    // Scales into a pooled frame
+    VideoFrame scale(const VideoFrame& src, int width, int height, ScaleMode mode);
+
+    // Produces every size in one call, returned in the order requested.
+    // Box and bilinear levels are derived from the next larger level;
+    // bicubic and Lanczos only reuse a level exactly twice the target,
+    // otherwise they go back to the source.
+    std::vector<VideoFrame> scaleLadder(const VideoFrame& src, const std::vector<ScaleSize>& sizes,
+                                        ScaleMode mode);
+
+    VideoFramePool& getFramePool() { return framePool_; }
+
+private:
+    void scalePlane(const uint8_t* src, int srcStride, int srcWidth, int srcHeight,
+                    uint8_t* dst, int dstStride, int dstWidth, int dstHeight,
+                    int channels, ScaleMode mode);
+
+    std::unique_ptr<core::utils::ThreadPool> pool_;
+    VideoFramePool framePool_;
+};
+
+#endif // VIDEO_SCALER_H
@@ -2,6 +2,9 @@
 #define VIDEO_SOURCE_H
 
 #include "VideoFrame.h"
+#include <functional>
+#include <map>
+#include <mutex>
 #include <string>
 
 class VideoSource {
@@ -17,8 +20,41 @@ public:
     // Retrieve the latest frame. Returns false if no new frame is available.
     virtual bool getFrame(VideoFrame& frame) = 0;
 
+    // The most recently published frame, shared rather than copied, without
+    // consuming it: getFrame() still reports it as new. For observers such
+    // as previews. Returns false if nothing was published yet or the source
+    // does not keep its last frame.
+    virtual bool getLatestFrame(VideoFrame&) { return false; }
+
     // Get source identifier/name
     virtual std::string getName() const = 0;
+
+    // Calls listener on the producing thread whenever getFrame() gains a
+    // new frame, e.g. to wake a consumer sleeping on a ReadySignal. It must
+    // be quick and must not call into the source. Sources that are only
+    // polled never call it. Returns an id for removeFrameListener().
+    int addFrameListener(std::function<void()> listener) {
+        std::lock_guard<std::mutex> lock(listenerMutex_);
+        frameListeners_[++lastListenerId_] = std::move(listener);
+        return lastListenerId_;
+    }
+
+    // Once this returns the listener is not running and will not run again
+    void removeFrameListener(int id) {
+        std::lock_guard<std::mutex> lock(listenerMutex_);
+        frameListeners_.erase(id);
+    }
+
+protected:
+    void notifyFrame() {
+        std::lock_guard<std::mutex> lock(listenerMutex_);
+        for (auto& entry : frameListeners_) entry.second();
+    }
+
+private:
+    std::mutex listenerMutex_;
+    std::map<int, std::function<void()>> frameListeners_;
+    int lastListenerId_ = 0;
 };
 
 #endif // VIDEO_SOURCE_H
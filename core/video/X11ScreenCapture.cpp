@@ -0,0 +1,416 @@
+#include "X11ScreenCapture.h"
+#include <iostream>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+#ifdef HAVE_X11_SHM
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/extensions/XShm.h>
+#ifdef HAVE_XDAMAGE
+#include <X11/extensions/Xdamage.h>
+#include <X11/extensions/Xfixes.h>
+#endif
+#include <sys/ipc.h>
+#include <sys/shm.h>
+
+namespace {
+
+// Damage is tracked in bands of rows. A band is the unit that is re-read
+// from the server and re-converted into a frame.
+constexpr int kBandRows = 16;
+
+// Output frames cycled so the one consumers still hold is never rewritten
+constexpr size_t kMaxSlots = 4;
+
+// Set only while XShmAttach is checked. Errors on any other connection,
+// such as the host application's own, go on to the handler it installed.
+thread_local Display* t_attachDisplay = nullptr;
+thread_local bool t_attachFailed = false;
+XErrorHandler g_previousHandler = nullptr;
+
+int recordAttachError(Display* display, XErrorEvent* event) {
+    if (display == t_attachDisplay) {
+        t_attachFailed = true;
+        return 0;
+    }
+    return g_previousHandler ? g_previousHandler(display, event) : 0;
+}
+
+// BGRX/RGBX (server byte order on little-endian hosts) -> RGBA, opaque alpha
+void convertRow(const uint32_t* src, uint32_t* dst, int width, bool swapRedBlue) {
+    if (swapRedBlue) {
+        for (int x = 0; x < width; ++x) {
+            uint32_t p = src[x];
+            dst[x] = ((p & 0xFF) << 16) | (p & 0xFF00) | ((p >> 16) & 0xFF) | 0xFF000000u;
+        }
+    } else {
+        for (int x = 0; x < width; ++x) {
+            dst[x] = src[x] | 0xFF000000u;
+        }
+    }
+}
+
+} // namespace
+
+struct X11ScreenCapture::Impl {
+    struct Slot {
+        VideoFrame frame;
+        std::vector<uint8_t> staleBands; // Bands that changed since this slot was last refreshed
+    };
+
+    int screenIndex;
+    Display* display = nullptr;
+    Window root = 0;
+    int width = 0;
+    int height = 0;
+    int bandCount = 0;
+    bool swapRedBlue = true;
+
+    // Staging image the server writes into (shared segment when shm is true)
+    XImage* image = nullptr;
+    XShmSegmentInfo shmInfo{};
+    bool shm = false;
+
+#ifdef HAVE_XDAMAGE
+    Damage damage = 0;
+    XserverRegion damageRegion = 0;
+#endif
+    bool damageEnabled = false;
+
+    VideoRect requestedRegion;
+    VideoRect region; // requestedRegion clamped to the screen
+
+    std::vector<Slot> slots;
+    VideoFrame last;
+    bool hasLast = false;
+
+    mutable std::mutex statsMutex;
+    ScreenCaptureStats stats;
+    double totalCaptureMs = 0.0;
+    double totalDirty = 0.0;
+
+    explicit Impl(int index) : screenIndex(index) {}
+
+    void readRows(int y0, int y1) {
+        if (shm) {
+            // A full-width band is contiguous in the segment, so the server
+            // can write it in place at the band's offset.
+            XImage band = *image;
+            band.height = y1 - y0;
+            band.data = image->data + (size_t)y0 * image->bytes_per_line;
+            XShmGetImage(display, root, &band, 0, y0, AllPlanes);
+        } else {
+            XGetSubImage(display, root, region.x, y0, region.width, y1 - y0, AllPlanes, ZPixmap, image, region.x, y0);
+        }
+    }
+
+    void convertRows(VideoFrame& frame, int y0, int y1) {
+        for (int y = y0; y < y1; ++y) {
+            convertRow(reinterpret_cast<const uint32_t*>(image->data + (size_t)y * image->bytes_per_line) + region.x,
+                       reinterpret_cast<uint32_t*>(frame.plane(0) + (size_t)y * frame.stride(0)) + region.x,
+                       region.width, swapRedBlue);
+        }
+    }
+
+    void applyRegion() {
+        VideoRect r = requestedRegion;
+        if (r.width <= 0 || r.height <= 0) r = {0, 0, width, height};
+        int x0 = std::clamp(r.x, 0, width), y0 = std::clamp(r.y, 0, height);
+        int x1 = std::clamp(r.x + r.width, x0, width), y1 = std::clamp(r.y + r.height, y0, height);
+        region = {x0, y0, x1 - x0, y1 - y0};
+        // Slots and `last` hold pixels of the old region only
+        slots.clear();
+        last = VideoFrame();
+        hasLast = false;
+    }
+
+    // Calls fn(y0, y1) for each run of consecutive set bands
+    template <class Fn>
+    void forEachBandRun(const std::vector<uint8_t>& bands, Fn fn) {
+        for (int b = 0; b < bandCount;) {
+            if (!bands[b]) {
+                ++b;
+                continue;
+            }
+            int start = b;
+            while (b < bandCount && bands[b]) ++b;
+            fn(start * kBandRows, std::min(height, b * kBandRows));
+        }
+    }
+
+    Slot* acquireSlot() {
+        for (auto& slot : slots) {
+            // Only the slot itself references it: no consumer and not `last`
+            if (slot.frame.buffer.use_count() == 1) return &slot;
+        }
+        if (slots.size() < kMaxSlots) {
+            // Only the region's bands are ever read into staging
+            std::vector<uint8_t> stale(bandCount, 0);
+            for (int b = region.y / kBandRows; b * kBandRows < region.y + region.height; ++b) stale[b] = 1;
+            slots.push_back({VideoFrame(width, height, VideoFrame::Format::RGBA), std::move(stale)});
+            return &slots.back();
+        }
+        return nullptr;
+    }
+};
+
+X11ScreenCapture::X11ScreenCapture(int screenIndex) : impl_(std::make_unique<Impl>(screenIndex)) {
+}
+
+X11ScreenCapture::~X11ScreenCapture() {
+    close();
+}
+
+bool X11ScreenCapture::open() {
+    if (impl_->display) return true;
+    Impl& d = *impl_;
+
+    d.display = XOpenDisplay(nullptr);
+    if (!d.display) {
+        return false;
+    }
+
+    int screen = d.screenIndex < ScreenCount(d.display) ? d.screenIndex : DefaultScreen(d.display);
+    d.root = RootWindow(d.display, screen);
+    d.width = DisplayWidth(d.display, screen);
+    d.height = DisplayHeight(d.display, screen);
+    d.bandCount = (d.height + kBandRows - 1) / kBandRows;
+    Visual* visual = DefaultVisual(d.display, screen);
+    int depth = DefaultDepth(d.display, screen);
+
+    if (XShmQueryExtension(d.display)) {
+        d.image = XShmCreateImage(d.display, visual, depth, ZPixmap, nullptr, &d.shmInfo, d.width, d.height);
+        if (d.image) {
+            d.shmInfo.shmid = shmget(IPC_PRIVATE, (size_t)d.image->bytes_per_line * d.image->height, IPC_CREAT | 0600);
+            void* address = d.shmInfo.shmid >= 0 ? shmat(d.shmInfo.shmid, nullptr, 0) : (void*)-1;
+            if (address == (void*)-1) {
+                // Out of SysV segments, or no access to them (containers)
+                std::cerr << "X11ScreenCapture: no shared memory segment (" << std::strerror(errno)
+                          << "), using XGetImage" << std::endl;
+                if (d.shmInfo.shmid >= 0) shmctl(d.shmInfo.shmid, IPC_RMID, nullptr);
+                XDestroyImage(d.image);
+                d.image = nullptr;
+            } else {
+                d.shmInfo.shmaddr = d.image->data = (char*)address;
+                d.shmInfo.readOnly = False;
+
+                // Attaching fails on remote displays; catch it instead of letting
+                // Xlib's default handler terminate the process.
+                t_attachDisplay = d.display;
+                t_attachFailed = false;
+                g_previousHandler = XSetErrorHandler(recordAttachError);
+                Bool attached = XShmAttach(d.display, &d.shmInfo);
+                XSync(d.display, False);
+                XSetErrorHandler(g_previousHandler);
+                t_attachDisplay = nullptr;
+                // Removed once both sides detach
+                shmctl(d.shmInfo.shmid, IPC_RMID, nullptr);
+
+                if (attached && !t_attachFailed) {
+                    d.shm = true;
+                } else {
+                    shmdt(d.shmInfo.shmaddr);
+                    d.image->data = nullptr;
+                    XDestroyImage(d.image);
+                    d.image = nullptr;
+                }
+            }
+        }
+    }
+    if (!d.shm) {
+        // No MIT-SHM: stage through a client-side image with XGetSubImage
+        d.image = XGetImage(d.display, d.root, 0, 0, d.width, d.height, AllPlanes, ZPixmap);
+    }
+    if (!d.image || d.image->bits_per_pixel != 32) {
+        std::cerr << "X11ScreenCapture: unsupported visual (need 32 bpp)" << std::endl;
+        close();
+        return false;
+    }
+    d.swapRedBlue = d.image->red_mask == 0xFF0000;
+    d.applyRegion();
+
+#ifdef HAVE_XDAMAGE
+    int eventBase, errorBase;
+    if (XDamageQueryExtension(d.display, &eventBase, &errorBase) &&
+        XFixesQueryExtension(d.display, &eventBase, &errorBase)) {
+        d.damage = XDamageCreate(d.display, d.root, XDamageReportNonEmpty);
+        d.damageRegion = XFixesCreateRegion(d.display, nullptr, 0);
+        d.damageEnabled = true;
+    }
+#endif
+
+    {
+        std::lock_guard<std::mutex> lock(d.statsMutex);
+        d.stats = ScreenCaptureStats();
+        d.stats.sharedMemory = d.shm;
+        d.stats.damageTracking = d.damageEnabled;
+    }
+    std::cout << "X11ScreenCapture: " << d.width << "x" << d.height << (d.shm ? " via MIT-SHM" : " via XGetImage")
+              << (d.damageEnabled ? " with XDamage" : "") << std::endl;
+    return true;
+}
+
+void X11ScreenCapture::close() {
+    Impl& d = *impl_;
+    if (!d.display) return;
+
+#ifdef HAVE_XDAMAGE
+    if (d.damageEnabled) {
+        XDamageDestroy(d.display, d.damage);
+        XFixesDestroyRegion(d.display, d.damageRegion);
+        d.damageEnabled = false;
+    }
+#endif
+    if (d.image) {
+        if (d.shm) {
+            XShmDetach(d.display, &d.shmInfo);
+            shmdt(d.shmInfo.shmaddr);
+            d.image->data = nullptr;
+            d.shm = false;
+        }
+        XDestroyImage(d.image);
+        d.image = nullptr;
+    }
+    XCloseDisplay(d.display);
+    d.display = nullptr;
+    d.slots.clear();
+    d.last = VideoFrame();
+    d.hasLast = false;
+}
+
+bool X11ScreenCapture::isOpen() const {
+    return impl_->display != nullptr;
+}
+
+bool X11ScreenCapture::capture(VideoFrame& frame) {
+    Impl& d = *impl_;
+    if (!d.display) return false;
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<VideoRect> rects;
+    bool full = !d.hasLast || !d.damageEnabled;
+
+#ifdef HAVE_XDAMAGE
+    if (d.damageEnabled) {
+        // Events only announce damage; the region itself is fetched below.
+        // Drain them so the queue cannot grow.
+        while (XPending(d.display)) {
+            XEvent event;
+            XNextEvent(d.display, &event);
+        }
+        XDamageSubtract(d.display, d.damage, None, d.damageRegion);
+        int count = 0;
+        XRectangle* damaged = XFixesFetchRegion(d.display, d.damageRegion, &count);
+        // Damage outside the capture region is ignored
+        const VideoRect& area = d.region;
+        for (int i = 0; i < count && !full; ++i) {
+            int x0 = std::max<int>(area.x, damaged[i].x), y0 = std::max<int>(area.y, damaged[i].y);
+            int x1 = std::min(area.x + area.width, damaged[i].x + damaged[i].width);
+            int y1 = std::min(area.y + area.height, damaged[i].y + damaged[i].height);
+            if (x1 > x0 && y1 > y0) rects.push_back({x0, y0, x1 - x0, y1 - y0});
+        }
+        if (damaged) XFree(damaged);
+    }
+#endif
+    if (full) {
+        rects.assign(1, d.region);
+    }
+
+    double dirtyArea = 0.0;
+    if (rects.empty()) {
+        // Static screen: hand out the previous frame again at no cost
+        frame = d.last;
+        frame.unchanged = true;
+        frame.dirtyRects.clear();
+    } else {
+        std::vector<uint8_t> damagedBands(d.bandCount, 0);
+        for (const auto& r : rects) {
+            for (int b = r.y / kBandRows; b * kBandRows < r.y + r.height; ++b) damagedBands[b] = 1;
+            dirtyArea += (double)r.width * r.height;
+        }
+
+        // 1. Pull only the damaged rows from the server into staging
+        d.forEachBandRun(damagedBands, [&d](int y0, int y1) { d.readRows(y0, y1); });
+
+        // 2. Every slot now lags behind staging in those bands
+        for (auto& slot : d.slots) {
+            for (int b = 0; b < d.bandCount; ++b) slot.staleBands[b] |= damagedBands[b];
+        }
+
+        // 3. Bring a free slot up to date, converting only its stale bands
+        Impl::Slot* slot = d.acquireSlot();
+        if (slot) {
+            d.forEachBandRun(slot->staleBands, [&d, slot](int y0, int y1) { d.convertRows(slot->frame, y0, y1); });
+            std::fill(slot->staleBands.begin(), slot->staleBands.end(), 0);
+            frame = slot->frame;
+        } else {
+            // Consumers hold every slot; fall back to a one-off full conversion
+            frame = VideoFrame(d.width, d.height, VideoFrame::Format::RGBA);
+            d.convertRows(frame, d.region.y, d.region.y + d.region.height);
+        }
+        frame.unchanged = false;
+        // A whole-screen read leaves the hint as "everything changed"
+        bool wholeScreen = d.region.width == d.width && d.region.height == d.height;
+        frame.dirtyRects = full && wholeScreen ? std::vector<VideoRect>() : rects;
+        d.last = frame;
+        d.hasLast = true;
+    }
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    double dirtyFraction = std::min(1.0, dirtyArea / ((double)d.width * d.height));
+
+    std::lock_guard<std::mutex> lock(d.statsMutex);
+    d.stats.frames++;
+    if (rects.empty()) d.stats.unchangedFrames++;
+    d.stats.lastCaptureMs = ms;
+    d.stats.lastDirtyFraction = dirtyFraction;
+    d.totalCaptureMs += ms;
+    d.totalDirty += dirtyFraction;
+    d.stats.avgCaptureMs = d.totalCaptureMs / d.stats.frames;
+    d.stats.avgDirtyFraction = d.totalDirty / d.stats.frames;
+    return true;
+}
+
+void X11ScreenCapture::setCaptureRegion(const VideoRect& region) {
+    impl_->requestedRegion = region;
+    if (impl_->display) impl_->applyRegion();
+}
+
+int X11ScreenCapture::width() const {
+    return impl_->width;
+}
+
+int X11ScreenCapture::height() const {
+    return impl_->height;
+}
+
+ScreenCaptureStats X11ScreenCapture::getStats() const {
+    std::lock_guard<std::mutex> lock(impl_->statsMutex);
+    return impl_->stats;
+}
+
+#else // !HAVE_X11_SHM
+
+// Built without X11 headers: capture is unavailable and ScreenSource falls
+// back to its generated frames.
+struct X11ScreenCapture::Impl {
+    ScreenCaptureStats stats;
+};
+
+X11ScreenCapture::X11ScreenCapture(int) : impl_(std::make_unique<Impl>()) {}
+X11ScreenCapture::~X11ScreenCapture() = default;
+bool X11ScreenCapture::open() { return false; }
+void X11ScreenCapture::close() {}
+bool X11ScreenCapture::isOpen() const { return false; }
+bool X11ScreenCapture::capture(VideoFrame&) { return false; }
+void X11ScreenCapture::setCaptureRegion(const VideoRect&) {}
+int X11ScreenCapture::width() const { return 0; }
+int X11ScreenCapture::height() const { return 0; }
+ScreenCaptureStats X11ScreenCapture::getStats() const { return impl_->stats; }
+
+#endif // HAVE_X11_SHM
@@ -0,0 +1,55 @@
+#ifndef X11_SCREEN_CAPTURE_H
+#define X11_SCREEN_CAPTURE_H
+
+#include "VideoFrame.h"
+#include <memory>
+#include <cstdint>
+
+struct ScreenCaptureStats {
+    bool sharedMemory = false;   // XShm in use (otherwise XGetImage)
+    bool damageTracking = false; // XDamage in use (otherwise every frame is a full read)
+    uint64_t frames = 0;
+    uint64_t unchangedFrames = 0;
+    double lastCaptureMs = 0.0;
+    double avgCaptureMs = 0.0;
+    double lastDirtyFraction = 0.0; // Share of the screen re-read for the last frame
+    double avgDirtyFraction = 0.0;
+};
+
+// Linux screen capture through MIT-SHM: the X server writes pixels straight
+// into a shared segment, so nothing crosses the socket. With XDamage only
+// the rows that changed since the last capture are re-read, and the output
+// frame carries them as dirtyRects. X11 types stay in the .cpp so Xlib's
+// macros do not leak into the rest of the engine.
+class X11ScreenCapture {
+public:
+    explicit X11ScreenCapture(int screenIndex);
+    ~X11ScreenCapture();
+
+    X11ScreenCapture(const X11ScreenCapture&) = delete;
+    X11ScreenCapture& operator=(const X11ScreenCapture&) = delete;
+
+    // Connects to $DISPLAY; false if no X server or screen is available
+    bool open();
+    void close();
+    bool isOpen() const;
+
+    // Produces the current screen contents as RGBA. When nothing changed the
+    // previous frame is returned again with unchanged = true.
+    bool capture(VideoFrame& frame);
+
+    // Limits reads and conversion to `region` (empty = whole screen).
+    // Frames keep the screen's size, but pixels outside the region are not
+    // refreshed. Call while no capture() is running.
+    void setCaptureRegion(const VideoRect& region);
+
+    int width() const;
+    int height() const;
+    ScreenCaptureStats getStats() const;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+#endif // X11_SCREEN_CAPTURE_H
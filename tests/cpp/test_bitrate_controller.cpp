@@ -0,0 +1,259 @@
+#include <iostream>
+#include <cassert>
+#include <algorithm>
+#include <deque>
+#include <vector>
+#include "streaming/BitrateController.h"
+#include "streaming/LinkEmulator.h"
+
+// Closed loop in simulated time: an encoder that follows the controller's
+// decisions writes frames into an emulated link, and the controller samples
+// the link every 100 ms as StreamController samples the publisher.
+class Simulation {
+public:
+    LinkEmulator link;
+    BitrateController controller;
+
+    std::vector<double> latencies; // Capture to last byte acknowledged, per frame
+    uint64_t framesSent = 0;
+    uint64_t droppedNonReference = 0;
+    bool sawRecovering = false;
+
+    Simulation(const LinkEmulatorConfig& linkConfig, const BitrateControllerConfig& config = BitrateControllerConfig())
+        : link(linkConfig), controller(config) {}
+
+    // Runs until untilMs; onStep sees every control decision
+    template <typename Step>
+    void run(double untilMs, Step onStep) {
+        for (; now_ < untilMs; now_ += 5.0) {
+            link.advance(now_);
+            while (!frames_.empty() && link.ackedBytes() >= frames_.front().endOffset) {
+                latencies.push_back(now_ - frames_.front().capturedMs);
+                frames_.pop_front();
+            }
+            if (now_ >= nextFrameMs_) produceFrame();
+            if (now_ >= nextControlMs_) {
+                controller.update(link.sample(now_));
+                sawRecovering |= controller.decision().recovering;
+                onStep(now_, controller.decision());
+                nextControlMs_ += 100.0;
+            }
+        }
+    }
+    void run(double untilMs) {
+        run(untilMs, [](double, const BitrateDecision&) {});
+    }
+
+    double percentileLatency(size_t from, double fraction) const {
+        std::vector<double> sorted(latencies.begin() + std::min(from, latencies.size()), latencies.end());
+        if (sorted.empty()) return 0.0;
+        std::sort(sorted.begin(), sorted.end());
+        return sorted[std::min(sorted.size() - 1, (size_t)(sorted.size() * fraction))];
+    }
+
+private:
+    struct Frame {
+        uint64_t endOffset;
+        double capturedMs;
+    };
+
+    // Frames average target/fps; a keyframe every two seconds is three times
+    // that, and every other inter frame is a non-reference frame
+    void produceFrame() {
+        const BitrateDecision& decision = controller.decision();
+        bool keyframe = frameIndex_ % (uint64_t)(2 * decision.fps) == 0;
+        bool nonReference = !keyframe && frameIndex_ % 2 == 1;
+        frameIndex_++;
+        nextFrameMs_ += 1000.0 / decision.fps;
+        if (nonReference && decision.dropNonReference) {
+            droppedNonReference++;
+            return;
+        }
+        size_t bytes = (size_t)(decision.targetKbps * 1000.0 / 8.0 / decision.fps * (keyframe ? 3.0 : 0.95));
+        link.write(bytes);
+        written_ += bytes;
+        frames_.push_back({written_, now_});
+        framesSent++;
+    }
+
+    double now_ = 0.0;
+    double nextFrameMs_ = 0.0;
+    double nextControlMs_ = 0.0;
+    uint64_t frameIndex_ = 0;
+    uint64_t written_ = 0;
+    std::deque<Frame> frames_;
+};
+
+void test_link_emulator() {
+    std::cout << "Testing the link emulator..." << std::endl;
+    LinkEmulatorConfig config;
+    config.bandwidthKbps = 8000; // 1 MB/s
+    config.delayMs = 25;
+    LinkEmulator link(config);
+    link.write(100000);
+    assert(link.queuedBytes() == 100000);
+    link.advance(49);
+    assert(link.ackedBytes() == 0); // Nothing acknowledged before one RTT
+    for (double t = 50; t <= 200; t += 1) link.advance(t);
+    // 100 KB at 1 MB/s leaves the wire at 100 ms; the last ACK is back one RTT later
+    assert(link.ackedBytes() == 100000 && link.queuedBytes() == 0);
+    assert(link.rttMs() >= 50.0 && link.rttMs() < 60.0);
+
+    // Queueing behind the bottleneck shows up in RTT
+    link.write(400000);
+    for (double t = 201; t <= 330; t += 1) link.advance(t);
+    assert(link.rttMs() > 100.0);
+
+    // Losses are resent, so everything still arrives
+    config.lossRate = 0.05;
+    LinkEmulator lossy(config);
+    lossy.write(500000);
+    for (double t = 0; t <= 2000; t += 1) lossy.advance(t);
+    assert(lossy.lostPackets() > 0 && lossy.ackedBytes() == 500000);
+    std::cout << "Link emulator test passed!" << std::endl;
+}
+
+void test_step_changes() {
+    std::cout << "\nTesting convergence under bandwidth steps (6000 -> 1500 -> 8000 kbps)..." << std::endl;
+    LinkEmulatorConfig linkConfig;
+    linkConfig.bandwidthKbps = 6000;
+    linkConfig.delayMs = 20;
+    linkConfig.jitterMs = 5;
+    BitrateControllerConfig config;
+    config.maxKbps = 7000;
+    Simulation sim(linkConfig, config);
+
+    // Start-up: probe from 2500 kbps up to the 1080p rung
+    double reachedTopMs = -1;
+    sim.run(20000, [&](double now, const BitrateDecision& decision) {
+        if (reachedTopMs < 0 && decision.rung == 0) reachedTopMs = now;
+    });
+    assert(reachedTopMs > 0);
+    assert(sim.controller.decision().targetKbps > 4500 && sim.controller.decision().targetKbps <= 6000);
+    size_t stepFrom = sim.latencies.size();
+
+    // Capacity drops to a quarter
+    linkConfig.bandwidthKbps = 1500;
+    sim.link.setConfig(linkConfig);
+    double downMs = -1, drainedMs = -1, lowSum = 0;
+    int lowSamples = 0;
+    size_t droppedBefore = sim.droppedNonReference;
+    sim.run(40000, [&](double now, const BitrateDecision& decision) {
+        if (downMs < 0 && decision.targetKbps <= 1500) downMs = now - 20000;
+        if (downMs >= 0 && drainedMs < 0 && sim.controller.getStats().queueDelayMs < config.clearDelayMs) {
+            drainedMs = now - 20000;
+        }
+        if (now >= 30000) {
+            lowSum += decision.targetKbps;
+            lowSamples++;
+        }
+    });
+    double lowAverage = lowSum / lowSamples;
+    double stepP95 = sim.percentileLatency(stepFrom, 0.95);
+    BitrateDecision low = sim.controller.decision();
+    assert(downMs >= 0 && downMs < 2000);
+    assert(drainedMs >= 0 && drainedMs < 8000);
+    assert(lowAverage >= 1200 && lowAverage <= 1600); // Tracks capacity once settled
+    assert(low.rung >= 2 && !low.recovering);
+    assert(sim.droppedNonReference > droppedBefore); // Shed while the queue drained
+    size_t lowFrom = sim.latencies.size();
+
+    // Capacity comes back above where we started
+    linkConfig.bandwidthKbps = 8000;
+    sim.link.setConfig(linkConfig);
+    double upMs = -1;
+    sim.run(70000, [&](double now, const BitrateDecision& decision) {
+        if (upMs < 0 && decision.rung == 0) upMs = now - 40000;
+    });
+    double lowP95 = sim.percentileLatency(lowFrom, 0.95);
+    assert(upMs >= 0 && upMs < 25000);
+    assert(sim.controller.decision().targetKbps >= 5500 && !sim.controller.decision().dropNonReference);
+    size_t tailFrom = sim.latencies.size();
+    sim.run(80000);
+    double tailP95 = sim.percentileLatency(tailFrom, 0.95);
+    assert(tailP95 < 300.0);
+
+    BitrateControllerStats stats = sim.controller.getStats();
+    std::cout << "Reached 1080p after " << reachedTopMs / 1000.0 << " s" << std::endl;
+    std::cout << "Step down: target under capacity after " << downMs << " ms, queue drained after " << drainedMs
+              << " ms, p95 frame latency " << stepP95 << " ms" << std::endl;
+    std::cout << "At 1500 kbps: averaged " << lowAverage << " kbps, " << low.width << "x" << low.height
+              << ", p95 latency " << lowP95 << " ms" << std::endl;
+    std::cout << "Step up: back at 1080p after " << upMs / 1000.0 << " s, p95 latency " << tailP95 << " ms"
+              << std::endl;
+    std::cout << stats.decreases << " decreases, " << stats.rungChanges << " rung changes, "
+              << sim.droppedNonReference << " non-reference frames dropped" << std::endl;
+    std::cout << "Step change test passed!" << std::endl;
+}
+
+void test_loss_and_jitter() {
+    std::cout << "\nTesting stability with 1% loss and 40 ms jitter at 4000 kbps..." << std::endl;
+    LinkEmulatorConfig linkConfig;
+    linkConfig.bandwidthKbps = 4000;
+    linkConfig.delayMs = 40;
+    linkConfig.jitterMs = 40;
+    linkConfig.lossRate = 0.01;
+    linkConfig.seed = 7;
+    Simulation sim(linkConfig);
+    sim.run(20000);
+    size_t from = sim.latencies.size();
+    int minTarget = 1 << 30, maxTarget = 0;
+    double sum = 0;
+    int samples = 0;
+    sim.run(60000, [&](double, const BitrateDecision& decision) {
+        minTarget = std::min(minTarget, decision.targetKbps);
+        maxTarget = std::max(maxTarget, decision.targetKbps);
+        sum += decision.targetKbps;
+        samples++;
+    });
+    double p95 = sim.percentileLatency(from, 0.95);
+    std::cout << "Target ranged " << minTarget << "-" << maxTarget << " kbps, averaged " << sum / samples
+              << " kbps, p95 frame latency " << p95 << " ms, " << sim.link.lostPackets() << " packets lost"
+              << std::endl;
+    // Probing overshoots a little before each cut, but never collapses
+    assert(minTarget >= 2000 && maxTarget <= 4600);
+    assert(sum / samples >= 2800 && sum / samples <= 4000);
+    assert(!sim.sawRecovering && p95 < 600.0);
+    std::cout << "Loss and jitter test passed!" << std::endl;
+}
+
+void test_outage_recovery() {
+    std::cout << "\nTesting RECOVERING across a 3 s near-outage..." << std::endl;
+    LinkEmulatorConfig linkConfig;
+    linkConfig.bandwidthKbps = 5000;
+    Simulation sim(linkConfig);
+    sim.run(10000);
+    assert(!sim.sawRecovering);
+
+    linkConfig.bandwidthKbps = 100;
+    sim.link.setConfig(linkConfig);
+    double enteredMs = -1;
+    sim.run(13000, [&](double now, const BitrateDecision& decision) {
+        if (enteredMs < 0 && decision.recovering) enteredMs = now - 10000;
+    });
+    assert(enteredMs >= 0);
+    BitrateDecision during = sim.controller.decision();
+    assert(during.recovering && during.dropNonReference && during.fps == 15);
+
+    linkConfig.bandwidthKbps = 5000;
+    sim.link.setConfig(linkConfig);
+    double exitedMs = -1;
+    sim.run(30000, [&](double now, const BitrateDecision& decision) {
+        if (exitedMs < 0 && !decision.recovering) exitedMs = now - 13000;
+    });
+    assert(exitedMs >= 0 && exitedMs < 10000);
+    assert(sim.controller.decision().fps == 30 && sim.controller.getStats().recoveries == 1);
+    std::cout << "Entered RECOVERING after " << enteredMs << " ms, left " << exitedMs
+              << " ms after the link returned; " << sim.droppedNonReference << " non-reference frames dropped"
+              << std::endl;
+    std::cout << "Outage recovery test passed!" << std::endl;
+}
+
+int main() {
+    test_link_emulator();
+    test_step_changes();
+    test_loss_and_jitter();
+    test_outage_recovery();
+    std::cout << "\nAll bitrate controller tests passed!" << std::endl;
+    return 0;
+}
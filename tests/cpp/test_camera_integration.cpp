@@ -41,10 +41,10 @@ int main() {
         if (camera.getFrame(frame)) {
             frameCount++;
             
-            if (!frame.data.empty()) {
+            if (!frame.empty()) {
                 // Wrap raw data in cv::Mat
                 // Note: VideoFrame is RGBA, cv::imshow expects BGR usually
-                cv::Mat rgbaFrame(frame.height, frame.width, CV_8UC4, frame.data.data());
+                cv::Mat rgbaFrame(frame.height, frame.width, CV_8UC4, frame.plane(0), frame.stride(0));
                 cv::Mat bgrFrame;
                 cv::cvtColor(rgbaFrame, bgrFrame, cv::COLOR_RGBA2BGR);
 
@@ -65,8 +65,13 @@ int main() {
         // Report FPS every second
         auto now = std::chrono::steady_clock::now();
         if (std::chrono::duration_cast<std::chrono::seconds>(now - lastReport).count() >= 1) {
+            CameraStats stats = camera.getStats();
             std::cout << "FPS: " << frameCount << " | Resolution: " 
-                      << frame.width << "x" << frame.height << std::endl;
+                      << frame.width << "x" << frame.height
+                      << " | " << stats.fourcc << (stats.parallelDecode ? " (parallel decode)" : "")
+                      << " | capture " << stats.captureFps << " decode " << stats.decodeFps
+                      << " convert " << stats.convertFps << " publish " << stats.publishFps
+                      << " | dropped " << stats.droppedFrames << std::endl;
             frameCount = 0;
             lastReport = now;
         }
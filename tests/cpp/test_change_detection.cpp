@@ -0,0 +1,229 @@
+#include <iostream>
+#include <cassert>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <functional>
+#include "video/FrameChangeDetector.h"
+
+// Fills an RGBA frame from a per-pixel generator
+void fill(VideoFrame& frame, const std::function<uint32_t(int, int)>& pixel) {
+    for (int y = 0; y < frame.height; ++y) {
+        uint32_t* row = reinterpret_cast<uint32_t*>(frame.plane(0) + (size_t)y * frame.stride(0));
+        for (int x = 0; x < frame.width; ++x) row[x] = pixel(x, y);
+    }
+}
+
+uint32_t pattern(int x, int y) {
+    return (uint32_t)((x * 7) ^ (y * 13)) * 0x01010101u | 0xFF000000u;
+}
+
+// Stand-in for the downstream stage: RGBA -> I420 over a region
+void convertRegion(const VideoFrame& src, VideoFrame& dst, const VideoRect& r) {
+    for (int y = r.y; y < r.y + r.height; ++y) {
+        const uint8_t* in = src.plane(0) + (size_t)y * src.stride(0);
+        uint8_t* luma = dst.plane(0) + (size_t)y * dst.stride(0);
+        for (int x = r.x; x < r.x + r.width; ++x) {
+            const uint8_t* p = in + x * 4;
+            luma[x] = (uint8_t)((66 * p[0] + 129 * p[1] + 25 * p[2] + 128) / 256 + 16);
+        }
+        if (y % 2) continue;
+        uint8_t* u = dst.plane(1) + (size_t)(y / 2) * dst.stride(1);
+        uint8_t* v = dst.plane(2) + (size_t)(y / 2) * dst.stride(2);
+        for (int x = r.x & ~1; x < r.x + r.width; x += 2) {
+            const uint8_t* p = in + x * 4;
+            u[x / 2] = (uint8_t)((-38 * p[0] - 74 * p[1] + 112 * p[2] + 128) / 256 + 128);
+            v[x / 2] = (uint8_t)((112 * p[0] - 94 * p[1] - 18 * p[2] + 128) / 256 + 128);
+        }
+    }
+}
+
+void test_block_sad() {
+    std::cout << "Testing SIMD SAD against scalar..." << std::endl;
+    std::mt19937 rng(7);
+    std::vector<uint8_t> a(1000), b(1000);
+    for (size_t i = 0; i < a.size(); ++i) {
+        a[i] = (uint8_t)rng();
+        b[i] = (uint8_t)rng();
+    }
+    for (size_t len : {0, 1, 15, 16, 63, 64, 65, 200, 999}) {
+        for (size_t offset : {0, 1, 3}) {
+            uint64_t expected = 0;
+            for (size_t i = 0; i < len; ++i) expected += std::abs(a[offset + i] - b[offset + i]);
+            assert(FrameChangeDetector::blockSad(a.data() + offset, b.data() + offset, len) == expected);
+        }
+    }
+    std::cout << "SAD test passed!" << std::endl;
+}
+
+void test_tile_map() {
+    std::cout << "\nTesting unchanged frames and tile maps..." << std::endl;
+    FrameChangeDetector detector({32, 0.0, 0.0});
+
+    VideoFrame first(200, 100);
+    fill(first, pattern);
+    assert(detector.process(first));
+    assert(first.dirtyRects.size() == 1 && first.changeMap->changedTiles == 7 * 4);
+
+    // Same pixels in a different buffer
+    VideoFrame same = first.clone();
+    same.dirtyRects.clear();
+    same.changeMap.reset();
+    assert(!detector.process(same));
+    assert(same.unchanged && same.dirtyRects.empty());
+
+    // One pixel in tile (3, 2) and a band across the last column of tiles
+    VideoFrame edit = first.clone();
+    edit.dirtyRects.clear();
+    reinterpret_cast<uint32_t*>(edit.plane(0) + 70 * edit.stride(0))[100] ^= 0x10;
+    for (int y = 0; y < 100; ++y) edit.plane(0)[(size_t)y * edit.stride(0) + 199 * 4] ^= 0xFF;
+    assert(detector.process(edit));
+    const TileChangeMap& map = *edit.changeMap;
+    assert(map.tilesX == 7 && map.tilesY == 4 && map.changedTiles == 5);
+    assert(map.changed(3, 2) && map.changed(6, 0) && map.changed(6, 3) && !map.changed(0, 0));
+    // The column merges into one rect clipped to the frame edge
+    assert(edit.dirtyRects.size() == 2);
+    bool foundColumn = false;
+    for (const auto& r : edit.dirtyRects) {
+        if (r.x == 192 && r.y == 0 && r.width == 8 && r.height == 100) foundColumn = true;
+    }
+    assert(foundColumn);
+
+    std::cout << "Tile map test passed!" << std::endl;
+}
+
+void test_threshold_and_chroma() {
+    std::cout << "\nTesting noise threshold and chroma planes..." << std::endl;
+    std::mt19937 rng(1);
+    VideoFrame base(128, 64);
+    fill(base, pattern);
+    VideoFrame noisy = base.clone();
+    for (int y = 0; y < noisy.height; ++y) {
+        uint8_t* row = noisy.plane(0) + (size_t)y * noisy.stride(0);
+        for (int x = 0; x < noisy.width * 4; ++x) row[x] = (uint8_t)std::min(255, row[x] + (int)(rng() % 2));
+    }
+
+    FrameChangeDetector tolerant({32, 2.0, 0.0});
+    tolerant.process(base);
+    VideoFrame a = noisy;
+    assert(!tolerant.process(a));
+
+    FrameChangeDetector exact({32, 0.0, 0.0});
+    exact.process(base);
+    VideoFrame b = noisy.clone();
+    assert(exact.process(b));
+
+    // I420: a change in V alone is still a change
+    VideoFrame yuv(64, 64, VideoFrame::Format::I420);
+    for (int i = 0; i < 3; ++i) {
+        for (int y = 0; y < yuv.planeHeight(i); ++y) std::memset(yuv.plane(i) + (size_t)y * yuv.stride(i), 100, yuv.planeRowBytes(i));
+    }
+    FrameChangeDetector yuvDetector({32, 0.0, 0.0});
+    yuvDetector.process(yuv);
+    VideoFrame tinted = yuv.clone();
+    tinted.dirtyRects.clear();
+    tinted.plane(2)[(size_t)20 * tinted.stride(2) + 5] = 50; // Chroma (5, 20) -> luma tile (0, 1)
+    assert(yuvDetector.process(tinted));
+    assert(tinted.changeMap->changedTiles == 1 && tinted.changeMap->changed(0, 1));
+
+    std::cout << "Threshold/chroma test passed!" << std::endl;
+}
+
+void test_producer_hints() {
+    std::cout << "\nTesting producer hints..." << std::endl;
+    FrameChangeDetector detector;
+    VideoFrame first(128, 128);
+    fill(first, pattern);
+    detector.process(first);
+
+    // Hinted unchanged frames are not compared at all
+    VideoFrame repeat = first;
+    repeat.unchanged = true;
+    assert(!detector.process(repeat));
+    assert(detector.getStats().hintedFrames == 1);
+
+    // Only tiles under the producer's dirty rect are compared; damage that
+    // turned out to repaint identical pixels is dropped
+    VideoFrame next = first.clone();
+    next.dirtyRects = {{0, 0, 64, 32}};
+    next.plane(0)[5 * 4] ^= 1;
+    assert(detector.process(next));
+    assert(next.changeMap->changedTiles == 1 && next.dirtyRects.size() == 1);
+    assert(next.dirtyRects[0].width == 32 && next.dirtyRects[0].height == 32);
+
+    std::cout << "Producer hint test passed!" << std::endl;
+}
+
+// Runs `frames` frames through the downstream stage twice: once converting
+// everything, once converting only what the detector flagged.
+void bench(const char* name, int frames, const std::function<void(VideoFrame&, int)>& generate) {
+    const int w = 1280, h = 720;
+    std::vector<VideoFrame> input;
+    for (int i = 0; i < frames; ++i) {
+        VideoFrame frame(w, h);
+        generate(frame, i);
+        input.push_back(frame);
+    }
+    VideoFrame out(w, h, VideoFrame::Format::I420);
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (const auto& frame : input) convertRegion(frame, out, {0, 0, w, h});
+    double fullMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+    FrameChangeDetector detector;
+    int skipped = 0;
+    t0 = std::chrono::steady_clock::now();
+    for (auto frame : input) {
+        if (!detector.process(frame)) {
+            skipped++;
+            continue;
+        }
+        for (const auto& r : frame.dirtyRects) convertRegion(frame, out, r);
+    }
+    double detectMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+    auto stats = detector.getStats();
+    std::cout << name << ": convert all " << fullMs / frames << " ms/frame, detect+partial "
+              << detectMs / frames << " ms/frame (compare " << stats.avgCompareMs << " ms, "
+              << (int)(stats.avgChangedFraction * 100) << "% tiles changed, " << skipped
+              << " skipped), CPU saved " << (int)((1.0 - detectMs / fullMs) * 100) << "%" << std::endl;
+}
+
+void bench_content() {
+    std::cout << "\nBenchmarking downstream work saved (1280x720, 60 frames)..." << std::endl;
+    std::mt19937 rng(3);
+
+    // Desktop idling: every frame identical
+    bench("static", 60, [](VideoFrame& f, int) { fill(f, pattern); });
+
+    // A document scrolling: every row moves, but a toolbar stays put
+    bench("scrolling", 60, [](VideoFrame& f, int i) {
+        fill(f, [i](int x, int y) { return y < 64 ? pattern(x, y) : pattern(x, y + i * 4); });
+    });
+
+    // A small video playing in a window
+    bench("windowed video", 60, [&rng](VideoFrame& f, int) {
+        fill(f, [&rng](int x, int y) {
+            bool inside = x >= 400 && x < 720 && y >= 200 && y < 380;
+            return inside ? (uint32_t)rng() | 0xFF000000u : pattern(x, y);
+        });
+    });
+
+    // Full-screen camera-like content: everything changes every frame
+    bench("full-frame video", 60, [&rng](VideoFrame& f, int) {
+        fill(f, [&rng](int, int) { return (uint32_t)rng() | 0xFF000000u; });
+    });
+}
+
+int main() {
+    test_block_sad();
+    test_tile_map();
+    test_threshold_and_chroma();
+    test_producer_hints();
+    bench_content();
+    std::cout << "\nAll change detection tests passed!" << std::endl;
+    return 0;
+}
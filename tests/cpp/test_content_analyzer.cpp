@@ -0,0 +1,149 @@
+#include <iostream>
+#include <cassert>
+#include <cstring>
+#include <chrono>
+#include "video/ContentAnalyzer.h"
+#include "video/VideoScaler.h"
+#include "encoder_hints.h"
+
+// Textured RGBA frame with a bright square at (sx, sy); `seed` picks the scene
+VideoFrame scene(int w, int h, int seed, int sx = -1, int sy = -1, int offset = 0) {
+    VideoFrame frame(w, h);
+    for (int y = 0; y < h; ++y) {
+        uint8_t* row = frame.plane(0) + (size_t)y * frame.stride(0);
+        for (int x = 0; x < w; ++x) {
+            int v = seed == 0 ? ((x + offset) / 16 + y / 16) % 2 * 60 + 40 : 200 - ((x + offset) * 3 + y) % 50;
+            bool square = sx >= 0 && x >= sx && x < sx + 64 && y >= sy && y < sy + 64;
+            row[x * 4] = row[x * 4 + 1] = row[x * 4 + 2] = (uint8_t)(square ? 250 : v);
+            row[x * 4 + 3] = 255;
+        }
+    }
+    return frame;
+}
+
+void test_downsample() {
+    std::cout << "Testing SIMD luma downsample..." << std::endl;
+    VideoFrame green(64, 32);
+    for (int y = 0; y < 32; ++y) {
+        uint32_t* row = reinterpret_cast<uint32_t*>(green.plane(0) + (size_t)y * green.stride(0));
+        for (int x = 0; x < 64; ++x) row[x] = 0xFF00FF00u;
+    }
+    std::vector<uint8_t> cells;
+    int cols = 0, rows = 0;
+    assert(ContentAnalyzer::downsampleLuma(green, 8, cells, cols, rows));
+    assert(cols == 8 && rows == 4);
+    for (uint8_t v : cells) assert(v == 128); // (0 + 2 * 255 + 0) / 4, rounded
+
+    // I420 averages the luma plane
+    VideoFrame yuv(64, 32, VideoFrame::Format::I420);
+    for (int y = 0; y < 32; ++y) {
+        for (int x = 0; x < 64; ++x) yuv.plane(0)[(size_t)y * yuv.stride(0) + x] = (uint8_t)(x < 32 ? 20 : 220);
+    }
+    assert(ContentAnalyzer::downsampleLuma(yuv, 16, cells, cols, rows));
+    assert(cols == 4 && rows == 2 && cells[0] == 20 && cells[3] == 220);
+    std::cout << "Downsample test passed!" << std::endl;
+}
+
+void test_cuts_and_motion() {
+    std::cout << "\nTesting scene cuts and the motion map..." << std::endl;
+    ContentAnalyzer analyzer;
+    VideoFrame first = scene(640, 360, 0, 100, 100);
+    auto a = analyzer.process(first);
+    assert(a && a->sceneCut && first.analysis == a); // Nothing to compare with: keyframe
+    assert(a->motionCols == 10 && a->motionRows == 6); // 64-pixel cells
+
+    // Same picture: no motion, no cut
+    VideoFrame still = scene(640, 360, 0, 100, 100);
+    a = analyzer.process(still);
+    assert(!a->sceneCut && a->sceneChangeScore < 0.01 && a->motionActivity == 0.0);
+
+    // The square moves right: motion only around it
+    VideoFrame moved = scene(640, 360, 0, 164, 100);
+    a = analyzer.process(moved);
+    assert(!a->sceneCut && a->motionActivity > 0.0 && a->motionActivity <= 0.1);
+    assert(a->motion[1 * a->motionCols + 2] > 0); // Cell (2,1) covers the new position
+    assert(a->motion[5 * a->motionCols + 9] == 0);
+    for (int i = 0; i < 3; ++i) {
+        VideoFrame hold = scene(640, 360, 0, 164, 100);
+        analyzer.process(hold); // Past minCutInterval
+    }
+
+    // A hard cut to another scene
+    VideoFrame cut = scene(640, 360, 1);
+    a = analyzer.process(cut);
+    assert(a->sceneCut && a->sceneChangeScore >= 0.45);
+    VideoFrame after = scene(640, 360, 1);
+    a = analyzer.process(after);
+    assert(!a->sceneCut);
+
+    // A producer hint skips the work
+    VideoFrame hinted = scene(640, 360, 1);
+    hinted.unchanged = true;
+    a = analyzer.process(hinted);
+    assert(!a->sceneCut && a->motionActivity == 0.0 && a->meanSad == 0.0);
+    assert(analyzer.getStats().sceneCuts == 2);
+    std::cout << "Cut/motion test passed!" << std::endl;
+}
+
+void test_pans_and_flashes() {
+    std::cout << "\nTesting steady pans and flash bursts..." << std::endl;
+    ContentAnalyzer analyzer;
+    // Sustained pan: high SAD on every frame, but no jump after the start
+    int cuts = 0;
+    for (int i = 0; i < 30; ++i) {
+        VideoFrame frame = scene(640, 360, 1, -1, -1, i * 6);
+        cuts += analyzer.process(frame)->sceneCut ? 1 : 0;
+    }
+    assert(cuts == 1); // Only the very first frame
+
+    // Alternating scenes: at most one cut per minCutInterval frames
+    ContentAnalyzerConfig config;
+    config.minCutInterval = 5;
+    analyzer.setConfig(config);
+    cuts = 0;
+    for (int i = 0; i < 20; ++i) {
+        VideoFrame frame = scene(640, 360, i % 2);
+        cuts += analyzer.process(frame)->sceneCut ? 1 : 0;
+    }
+    assert(cuts == 4);
+    std::cout << "Pan/flash test passed!" << std::endl;
+}
+
+void test_frame_metadata_and_hints() {
+    std::cout << "\nTesting metadata propagation and encoder hints..." << std::endl;
+    ContentAnalyzer analyzer;
+    VideoFrame frame = scene(640, 360, 0, 0, 0);
+    analyzer.process(frame);
+
+    VideoScaler scaler;
+    VideoFrame scaled = scaler.scale(frame, 320, 180, ScaleMode::Box);
+    assert(scaled.analysis == frame.analysis); // The grid is frame-relative
+    assert(!frame.crop(0, 0, 64, 64).analysis);
+    assert(frame.clone().analysis == frame.analysis);
+
+    CFrameHints hints = encoderHintsFor(frame);
+    assert(hints.force_keyframe && hints.scene_change_score == 1.0f);
+    assert(hints.motion_cols == 10 && hints.motion_rows == 6 && hints.motion_map == frame.analysis->motion.data());
+    CFrameHints none = encoderHintsFor(VideoFrame(16, 16));
+    assert(!none.force_keyframe && !none.motion_map);
+    std::cout << "Metadata/hints test passed!" << std::endl;
+}
+
+void bench_analyzer() {
+    std::cout << "\nBenchmarking 1080p RGBA analysis..." << std::endl;
+    ContentAnalyzer analyzer;
+    VideoFrame frames[2] = {scene(1920, 1080, 0, 200, 200), scene(1920, 1080, 0, 260, 200)};
+    const int count = 60;
+    for (int i = 0; i < count; ++i) analyzer.process(frames[i % 2]);
+    std::cout << "analyze: " << analyzer.getStats().avgAnalyzeMs << " ms/frame" << std::endl;
+}
+
+int main() {
+    test_downsample();
+    test_cuts_and_motion();
+    test_pans_and_flashes();
+    test_frame_metadata_and_hints();
+    bench_analyzer();
+    std::cout << "\nAll content analyzer tests passed!" << std::endl;
+    return 0;
+}
@@ -2,6 +2,9 @@
 #include <cassert>
 #include "utils/logger.h"
 #include "utils/memory_pool.h"
+#include "utils/thread_pool.h"
+#include <atomic>
+#include <vector>
 
 using namespace core::utils;
 
@@ -69,10 +72,46 @@ void test_memory_pool() {
     std::cout << "MemoryPool test passed!" << std::endl;
 }
 
+void test_thread_pool() {
+    std::cout << "\nTesting ThreadPool..." << std::endl;
+
+    ThreadPool pool(4);
+    assert(pool.getThreadCount() == 4);
+
+    // Async tasks all run before the pool is destroyed
+    std::atomic<int> counter(0);
+    {
+        ThreadPool scoped(2);
+        for (int i = 0; i < 100; ++i) {
+            scoped.enqueue([&counter]() { counter++; });
+        }
+    }
+    assert(counter == 100);
+
+    // parallelFor covers every index exactly once
+    std::vector<int> hits(1000, 0);
+    pool.parallelFor((int)hits.size(), [&hits](int begin, int end) {
+        for (int i = begin; i < end; ++i) hits[i]++;
+    });
+    for (int h : hits) assert(h == 1);
+
+    // Nested parallelFor from inside a pool task must not deadlock
+    std::atomic<int> nested(0);
+    pool.parallelFor(8, [&pool, &nested](int begin, int end) {
+        for (int i = begin; i < end; ++i) {
+            pool.parallelFor(16, [&nested](int b, int e) { nested += e - b; });
+        }
+    });
+    assert(nested == 8 * 16);
+
+    std::cout << "ThreadPool test passed!" << std::endl;
+}
+
 int main() {
     try {
         test_logger();
         test_memory_pool();
+        test_thread_pool();
 
         std::cout << "\nAll tests passed!" << std::endl;
         return 0;
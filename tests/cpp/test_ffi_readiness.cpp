@@ -0,0 +1,241 @@
+#include <iostream>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <string>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+#include "audio_ffi.h"
+#include "screen_ffi.h"
+#include "source_manager_ffi.h"
+#include "utils/ready_signal.h"
+
+namespace {
+
+bool readable(int fd, int timeoutMs = 0) {
+    pollfd entry = {fd, POLLIN, 0};
+    return poll(&entry, 1, timeoutMs) == 1 && (entry.revents & POLLIN);
+}
+
+void test_ready_signal() {
+    std::cout << "Testing the readiness signal..." << std::endl;
+    core::utils::ReadySignal signal;
+    assert(signal.fd() >= 0 && !readable(signal.fd()));
+    for (int i = 0; i < 1000; ++i) signal.notify();
+    assert(readable(signal.fd()));
+    signal.clear();
+    assert(!readable(signal.fd()));
+    signal.clear();
+    signal.notify();
+    assert(readable(signal.fd()));
+    signal.clear();
+
+    // Raised from another thread while the consumer sleeps
+    std::thread producer([&signal]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        signal.notify();
+    });
+    assert(readable(signal.fd(), 2000));
+    producer.join();
+    std::cout << "Ready signal test passed!" << std::endl;
+}
+
+// A producer notifying while the consumer clears must never leave the fd
+// silent: every poll() while the producer runs has to wake up
+void test_ready_signal_stress() {
+    std::cout << "\nStressing notify() against clear()..." << std::endl;
+    core::utils::ReadySignal signal;
+    std::atomic<bool> running(true);
+    // Several producers, as when a few sources share the manager's signal
+    std::vector<std::thread> producers;
+    for (int i = 0; i < 4; ++i) {
+        producers.emplace_back([&]() {
+            while (running) {
+                signal.notify();
+                std::this_thread::sleep_for(std::chrono::microseconds(5));
+            }
+        });
+    }
+    long wakeups = 0;
+    bool stalled = false;
+    auto start = std::chrono::steady_clock::now();
+    while (std::chrono::steady_clock::now() - start < std::chrono::seconds(5)) {
+        if (!readable(signal.fd(), 1000)) {
+            stalled = true;
+            break;
+        }
+        signal.clear();
+        wakeups++;
+    }
+    running = false;
+    for (std::thread& producer : producers) producer.join();
+    std::cout << wakeups << " wakeups" << std::endl;
+    assert(!stalled && wakeups > 0);
+    std::cout << "Ready signal stress test passed!" << std::endl;
+}
+
+void test_screen_frames() {
+    std::cout << "\nTesting screen frames through the C API..." << std::endl;
+    ScreenContext* screen = screen_create(7);
+    assert(screen && !screen_set_frame_rate(screen, 0, 1) && screen_set_frame_rate(screen, 60, 1));
+    int fd = screen_get_ready_fd(screen);
+    assert(fd >= 0 && !readable(fd));
+    assert(screen_start(screen));
+
+    // Sleeps until a frame is there, then borrows it in place
+    assert(readable(fd, 2000));
+    CCameraFrame frame;
+    assert(screen_borrow_frame(screen, &frame));
+    assert(frame.width == 1920 && frame.height == 1080 && frame.format == CAMERA_FORMAT_RGBA && frame.handle);
+    screen_release_frame(screen, &frame);
+    assert(!frame.handle);
+
+    // Too small a buffer: the size comes back and the frame waits for the retry
+    assert(readable(fd, 2000));
+    std::vector<uint8_t> buffer(16);
+    size_t needed = 0;
+    int width = 0;
+    int height = 0;
+    uint64_t timestamp = 0;
+    assert(!screen_copy_frame(screen, buffer.data(), buffer.size(), &needed, &width, &height, &timestamp));
+    assert(needed == 1920u * 1080 * 4 && width == 1920);
+    screen_stop(screen);
+    buffer.resize(needed);
+    assert(screen_copy_frame(screen, buffer.data(), buffer.size(), &needed, &width, &height, &timestamp));
+    assert(!screen_copy_frame(screen, buffer.data(), buffer.size(), &needed, &width, &height, &timestamp));
+    screen_destroy(screen);
+    std::cout << "Screen frame test passed!" << std::endl;
+}
+
+struct ConsumerCounts {
+    int frames = 0;
+    int crossings = 0;  // FFI calls
+    int wakeups = 0;    // Times the consumer thread woke up
+};
+
+void report(const char* name, const ConsumerCounts& counts, double seconds) {
+    std::cout << name << ": " << counts.frames / seconds << " frames/s, " << counts.crossings / seconds
+              << " FFI calls/s, " << counts.wakeups / seconds << " wakeups/s" << std::endl;
+}
+
+// Three 30 fps screens consumed the way a Rust loop without readiness has
+// to (poll each source every millisecond), then through the manager's fd
+// and one batch call per wakeup
+void test_wakeups() {
+    std::cout << "\nComparing a polling consumer with one woken by the manager..." << std::endl;
+    const int kSources = 3;
+    const auto kRun = std::chrono::seconds(2);
+    std::vector<ScreenContext*> screens;
+    for (int i = 0; i < kSources; ++i) {
+        ScreenContext* screen = screen_create(i);
+        assert(screen_set_frame_rate(screen, 30, 1) && screen_start(screen));
+        screens.push_back(screen);
+    }
+
+    ConsumerCounts polling;
+    auto start = std::chrono::steady_clock::now();
+    while (std::chrono::steady_clock::now() - start < kRun) {
+        polling.wakeups++;
+        for (ScreenContext* screen : screens) {
+            CCameraFrame frame;
+            polling.crossings++;
+            if (screen_borrow_frame(screen, &frame)) {
+                polling.frames++;
+                polling.crossings++;
+                screen_release_frame(screen, &frame);
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    double pollingSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    report("Polling every 1 ms", polling, pollingSeconds);
+
+    for (ScreenContext* screen : screens) assert(screen_register_source(screen));
+    assert(source_manager_get_source_count() == kSources);
+    char name[64];
+    assert(source_manager_get_source_name(0, name, sizeof(name)) && std::string(name) == "Screen-0");
+    assert(!source_manager_get_source_name(0, name, 4) && !source_manager_get_source_name(kSources, name, 64));
+
+    int epollFd = epoll_create1(EPOLL_CLOEXEC);
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    assert(epoll_ctl(epollFd, EPOLL_CTL_ADD, source_manager_get_ready_fd(), &event) == 0);
+    ConsumerCounts woken;
+    CSourceFrame frames[8];
+    start = std::chrono::steady_clock::now();
+    while (std::chrono::steady_clock::now() - start < kRun) {
+        epoll_event ready;
+        if (epoll_wait(epollFd, &ready, 1, 100) != 1) continue;
+        woken.wakeups++;
+        woken.crossings += 2;
+        int count = source_manager_borrow_frames(frames, 8);
+        woken.frames += count;
+        for (int i = 0; i < count; ++i) assert(frames[i].frame.width == 1920 && frames[i].name[0] == 'S');
+        source_manager_release_frames(frames, count);
+    }
+    double wokenSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    report("Woken by the ready fd", woken, wokenSeconds);
+    close(epollFd);
+
+    // Every frame still arrives, for a small fraction of the calls and wakeups
+    assert(woken.frames / wokenSeconds >= 0.8 * polling.frames / pollingSeconds);
+    assert(woken.crossings * 10 < polling.crossings);
+    assert(woken.wakeups * 5 < polling.wakeups);
+
+    // The manager only looks at frames: each screen context still gets its
+    // newest one, and the manager does not hand the same frame out twice
+    for (ScreenContext* screen : screens) screen_stop(screen);
+    source_manager_release_frames(frames, source_manager_borrow_frames(frames, 8));
+    assert(source_manager_borrow_frames(frames, 8) == 0);
+    for (ScreenContext* screen : screens) {
+        CCameraFrame frame;
+        assert(screen_borrow_frame(screen, &frame));
+        screen_release_frame(screen, &frame);
+    }
+
+    assert(source_manager_remove_source("Screen-1") && !source_manager_remove_source("Screen-1"));
+    for (ScreenContext* screen : screens) screen_destroy(screen);
+    assert(source_manager_get_source_count() == 0);
+    std::cout << "Wakeup comparison passed!" << std::endl;
+}
+
+void test_audio_readiness() {
+    std::cout << "\nTesting audio readiness..." << std::endl;
+    // Playback wants audio while its queue is at the low-water mark
+    SpeakerContext* speaker = speaker_create(1000);
+    assert(speaker);
+    int fd = speaker_get_ready_fd(speaker);
+    assert(fd >= 0 && readable(fd));
+    std::vector<float> samples(4000, 0.25f);
+    assert(speaker_push_samples(speaker, samples.data(), 500));
+    assert(readable(fd) && speaker_get_queued_samples(speaker) == 500);
+    assert(speaker_push_samples(speaker, samples.data(), (int)samples.size()));
+    assert(!readable(fd) && speaker_get_queued_samples(speaker) == 4500);
+    assert(!speaker_push_samples(speaker, nullptr, 10));
+    speaker_destroy(speaker);
+
+    // Nothing captured without a running device
+    AudioContext* mic = audio_create(0);
+    assert(mic && audio_get_ready_fd(mic) >= 0 && !readable(audio_get_ready_fd(mic)));
+    int channels = 0;
+    int rate = 0;
+    uint64_t timestamp = 0;
+    assert(audio_read_samples(mic, samples.data(), (int)samples.size(), &channels, &rate, &timestamp) == 0);
+    audio_destroy(mic);
+    std::cout << "Audio readiness test passed!" << std::endl;
+}
+
+} // namespace
+
+int main() {
+    test_ready_signal();
+    test_ready_signal_stress();
+    test_screen_frames();
+    test_wakeups();
+    test_audio_readiness();
+    std::cout << "\nAll FFI readiness tests passed!" << std::endl;
+    return 0;
+}
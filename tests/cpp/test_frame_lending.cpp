@@ -0,0 +1,128 @@
+#include <iostream>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <vector>
+#include "frame_lending.h"
+#include "video/VideoFramePool.h"
+
+void test_lend_and_return() {
+    std::cout << "Testing frames lent across the C API..." << std::endl;
+    VideoFramePool pool(4);
+    VideoFrame captured = pool.acquire(1280, 720, VideoFrame::Format::RGBA);
+    std::memset(captured.plane(0), 0x5A, (size_t)captured.stride(0) * captured.height);
+    captured.timestamp = 123456;
+    captured.unchanged = true;
+    const uint8_t* pixels = captured.plane(0);
+
+    CCameraFrame lent;
+    lendFrame(captured, &lent);
+    // The caller reads the capture buffer itself
+    assert(lent.planes[0] == pixels && lent.strides[0] == captured.stride(0) && lent.plane_count == 1);
+    assert(lent.width == 1280 && lent.height == 720 && lent.format == CAMERA_FORMAT_RGBA);
+    assert(lent.timestamp == 123456 && lent.unchanged && lent.handle);
+
+    // While lent the pool converts into other buffers
+    captured = VideoFrame();
+    VideoFrame next = pool.acquire(1280, 720, VideoFrame::Format::RGBA);
+    assert(next.plane(0) != pixels);
+    assert(lent.planes[0][0] == 0x5A && lent.planes[0][(size_t)lent.strides[0] * 719 + 1279 * 4] == 0x5A);
+    next = VideoFrame();
+
+    returnLentFrame(&lent);
+    assert(!lent.handle && !lent.planes[0]);
+    returnLentFrame(&lent);
+    returnLentFrame(nullptr);
+    // Back in circulation once released
+    bool reused = false;
+    std::vector<VideoFrame> frames;
+    for (int i = 0; i < 2; ++i) {
+        frames.push_back(pool.acquire(1280, 720, VideoFrame::Format::RGBA));
+        reused = reused || frames.back().plane(0) == pixels;
+    }
+    assert(reused);
+
+    VideoFrame planar(640, 360, VideoFrame::Format::I420);
+    planar.timestamp = 7;
+    lendFrame(planar, &lent);
+    assert(lent.format == CAMERA_FORMAT_I420 && lent.plane_count == 3);
+    for (int i = 0; i < 3; ++i) {
+        assert(lent.planes[i] == planar.plane(i) && lent.strides[i] == planar.stride(i));
+    }
+    assert(!lent.unchanged);
+    returnLentFrame(&lent);
+    assert((int)VideoFrame::Format::NV12 == CAMERA_FORMAT_NV12);
+    std::cout << "Lending test passed!" << std::endl;
+}
+
+void test_checked_copy() {
+    std::cout << "\nTesting the size-checked copy..." << std::endl;
+    VideoFrame frame(101, 37, VideoFrame::Format::NV12);
+    for (int p = 0; p < frame.planeCount; ++p) {
+        for (int y = 0; y < frame.planeHeight(p); ++y) {
+            for (int x = 0; x < frame.planeRowBytes(p); ++x) {
+                frame.plane(p)[(size_t)y * frame.stride(p) + x] = (uint8_t)(p * 50 + y + x);
+            }
+        }
+    }
+    size_t needed = frame.packedSize();
+
+    // Too small: nothing written, the size reported
+    std::vector<uint8_t> buffer(needed + 16, 0xEE);
+    size_t frameSize = 0;
+    assert(!copyFramePacked(frame, buffer.data(), needed - 1, &frameSize));
+    assert(frameSize == needed);
+    for (uint8_t byte : buffer) assert(byte == 0xEE);
+    assert(!copyFramePacked(frame, nullptr, 0, &frameSize) && frameSize == needed);
+
+    assert(copyFramePacked(frame, buffer.data(), needed, nullptr));
+    size_t at = 0;
+    for (int p = 0; p < frame.planeCount; ++p) {
+        for (int y = 0; y < frame.planeHeight(p); ++y) {
+            for (int x = 0; x < frame.planeRowBytes(p); ++x) assert(buffer[at++] == (uint8_t)(p * 50 + y + x));
+        }
+    }
+    assert(at == needed && buffer[needed] == 0xEE);
+    std::cout << "Checked copy test passed!" << std::endl;
+}
+
+// What a Rust consumer pays per frame: borrow and release against a packed copy
+void test_benchmark(int width, int height) {
+    VideoFramePool pool(4);
+    const int kFrames = 200;
+    std::vector<uint8_t> buffer(VideoFrame::allocationSize(width, height, VideoFrame::Format::RGBA));
+    uint64_t sum = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kFrames; ++i) {
+        VideoFrame frame = pool.acquire(width, height, VideoFrame::Format::RGBA);
+        CCameraFrame lent;
+        lendFrame(frame, &lent);
+        sum += lent.planes[0][i];
+        returnLentFrame(&lent);
+    }
+    double lendUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / kFrames;
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kFrames; ++i) {
+        VideoFrame frame = pool.acquire(width, height, VideoFrame::Format::RGBA);
+        size_t frameSize;
+        assert(copyFramePacked(frame, buffer.data(), buffer.size(), &frameSize));
+        sum += buffer[i];
+    }
+    double copyUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / kFrames;
+
+    std::cout << width << "x" << height << " RGBA: borrow/release " << lendUs << " us, copy " << copyUs
+              << " us per frame (" << sum % 2 << ")" << std::endl;
+    assert(lendUs * 10 < copyUs);
+}
+
+int main() {
+    test_lend_and_return();
+    test_checked_copy();
+    std::cout << "\nBenchmarking per-frame cost across the C API..." << std::endl;
+    test_benchmark(1920, 1080);
+    test_benchmark(3840, 2160);
+    std::cout << "\nAll frame lending tests passed!" << std::endl;
+    return 0;
+}
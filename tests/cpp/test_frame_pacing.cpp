@@ -0,0 +1,119 @@
+#include <iostream>
+#include <cassert>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include "video/FrameScheduler.h"
+
+struct JitterReport {
+    double meanFps;
+    double p50Us;
+    double p99Us;
+};
+
+// Inter-frame error: |actual interval - nominal interval|
+JitterReport summarize(const std::vector<int64_t>& wakeNs, int64_t nominalNs) {
+    std::vector<double> errors;
+    for (size_t i = 1; i < wakeNs.size(); ++i) {
+        errors.push_back(std::fabs((double)(wakeNs[i] - wakeNs[i - 1] - nominalNs)) / 1000.0);
+    }
+    std::sort(errors.begin(), errors.end());
+    JitterReport report;
+    report.meanFps = (wakeNs.size() - 1) * 1e9 / (double)(wakeNs.back() - wakeNs.front());
+    report.p50Us = errors[errors.size() / 2];
+    report.p99Us = errors[std::min(errors.size() - 1, errors.size() * 99 / 100)];
+    return report;
+}
+
+void print(const char* name, const JitterReport& r) {
+    std::cout << name << ": " << r.meanFps << " fps | inter-frame error p50 " << r.p50Us
+              << " us, p99 " << r.p99Us << " us" << std::endl;
+}
+
+void test_rational_rates() {
+    std::cout << "Testing rational frame rates..." << std::endl;
+    FrameRate ntsc = FrameRate::fromFps(29.97);
+    assert(ntsc.num == 30000 && ntsc.den == 1001);
+    FrameRate ntsc60 = FrameRate::fromFps(59.94);
+    assert(ntsc60.num == 60000 && ntsc60.den == 1001);
+    FrameRate thirty = FrameRate::fromFps(30.0);
+    assert(thirty.num == 30 && thirty.den == 1);
+    std::cout << "Rational frame rate test passed!" << std::endl;
+}
+
+void test_aligned_ticks() {
+    std::cout << "\nTesting tick alignment across sources..." << std::endl;
+    FrameScheduler scheduler;
+    int fast = scheduler.subscribe({60, 1});
+    int slow = scheduler.subscribe({30, 1});
+
+    std::vector<int64_t> fastDeadlines;
+    std::thread fastThread([&]() {
+        FrameScheduler::Tick tick;
+        for (int i = 0; i < 20 && scheduler.waitForTick(fast, tick); ++i) {
+            fastDeadlines.push_back(tick.deadlineNs);
+        }
+    });
+
+    FrameScheduler::Tick tick;
+    std::vector<int64_t> slowDeadlines;
+    for (int i = 0; i < 8 && scheduler.waitForTick(slow, tick); ++i) {
+        slowDeadlines.push_back(tick.deadlineNs);
+    }
+    fastThread.join();
+
+    // Every 30 fps deadline is also a 60 fps deadline
+    for (int64_t deadline : slowDeadlines) {
+        if (deadline > fastDeadlines.back()) break;
+        assert(std::find(fastDeadlines.begin(), fastDeadlines.end(), deadline) != fastDeadlines.end());
+    }
+
+    scheduler.unsubscribe(fast);
+    scheduler.unsubscribe(slow);
+    assert(!scheduler.waitForTick(slow, tick));
+    std::cout << "Tick alignment test passed!" << std::endl;
+}
+
+void bench_pacing() {
+    std::cout << "\nBenchmarking pacing jitter (120 frames each)..." << std::endl;
+    const int frames = 120;
+
+    // Legacy: sleep (16 - elapsed) whole milliseconds
+    std::vector<int64_t> legacy;
+    for (int i = 0; i < frames; ++i) {
+        auto start = std::chrono::high_resolution_clock::now();
+        legacy.push_back(FrameScheduler::monotonicNowNs());
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::high_resolution_clock::now() - start);
+        std::this_thread::sleep_for(std::chrono::milliseconds(16 - elapsed.count()));
+    }
+    print("sleep_for(16ms) @60", summarize(legacy, 1000000000LL / 60));
+
+    FrameScheduler scheduler;
+    const FrameRate rates[] = {{60, 1}, {60000, 1001}};
+    for (const FrameRate& rate : rates) {
+        int id = scheduler.subscribe(rate);
+        std::vector<int64_t> wakes;
+        FrameScheduler::Tick tick;
+        for (int i = 0; i < frames && scheduler.waitForTick(id, tick); ++i) {
+            wakes.push_back(FrameScheduler::monotonicNowNs());
+        }
+        scheduler.unsubscribe(id);
+
+        JitterReport report = summarize(wakes, rate.intervalNs());
+        print(rate.den == 1 ? "FrameScheduler @60" : "FrameScheduler @59.94", report);
+        // Absolute deadlines must not drift like the legacy loop
+        assert(std::fabs(report.meanFps - rate.fps()) / rate.fps() < 0.02);
+    }
+}
+
+int main() {
+    test_rational_rates();
+    test_aligned_ticks();
+    bench_pacing();
+
+    std::cout << "\nAll tests passed!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,581 @@
+#include <iostream>
+#include <cassert>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "streaming/RecordingSink.h"
+
+namespace {
+
+// CTest reports this as skipped rather than passed
+constexpr int kSkipped = 77;
+
+const uint8_t kAvcConfig[] = {1, 0x64, 0, 0x1f, 0xff, 0xe1, 0, 4, 0x67, 0x64, 0, 0x1f, 1, 0, 2, 0x68, 0xee};
+const uint8_t kAacConfig[] = {0x12, 0x10}; // AAC LC, 44.1 kHz, stereo
+
+// Frame payloads carry their index, so the file can be checked packet by packet
+std::vector<uint8_t> makeFrame(size_t size, uint32_t index) {
+    std::vector<uint8_t> data(size);
+    for (size_t i = 0; i < size; ++i) data[i] = (uint8_t)(index * 7 + i);
+    for (int i = 0; i < 4 && i < (int)size; ++i) data[i] = (uint8_t)(index >> (24 - 8 * i));
+    return data;
+}
+
+uint32_t frameIndex(const std::vector<uint8_t>& data) {
+    return (uint32_t)data[0] << 24 | (uint32_t)data[1] << 16 | (uint32_t)data[2] << 8 | data[3];
+}
+
+// 30 fps video with a keyframe every gopFrames, inter frames presented
+// 33 ms late, and 20 ms audio frames, in timestamp order from startMs
+struct Source {
+    uint32_t startMs = 5000;
+    size_t keyframeBytes = 30000;
+    size_t frameBytes = 6000;
+    size_t audioBytes = 300;
+    int gopFrames = 30;
+    uint32_t nextVideo = 0;
+    uint32_t audioFrames = 0;
+    uint32_t videoSent = 0;
+    uint32_t audioSent = 0;
+    std::vector<double> addMs;
+
+    uint32_t videoMs(uint32_t index) const { return startMs + index * 100 / 3; }
+    uint32_t audioMs(uint32_t index) const { return startMs + index * 20; }
+
+    void headers(RecordingSink& sink) {
+        sink.addVideo(startMs, true, kAvcConfig, sizeof(kAvcConfig), 7, true);
+        sink.addAudio(startMs, kAacConfig, sizeof(kAacConfig), 10, true);
+    }
+
+    // Until media time endMs past startMs
+    void run(RecordingSink& sink, uint32_t endMs, bool timed = false) {
+        for (;;) {
+            uint32_t video = videoMs(nextVideo);
+            uint32_t audio = audioMs(audioFrames);
+            if (video >= startMs + endMs && audio >= startMs + endMs) break;
+            auto t0 = std::chrono::steady_clock::now();
+            if (audio < video || video >= startMs + endMs) {
+                std::vector<uint8_t> frame = makeFrame(audioBytes, audioFrames);
+                t0 = std::chrono::steady_clock::now();
+                if (sink.addAudio(audio, frame.data(), frame.size())) audioSent++;
+                audioFrames++;
+            } else {
+                bool keyframe = nextVideo % gopFrames == 0;
+                std::vector<uint8_t> frame = makeFrame(keyframe ? keyframeBytes : frameBytes, nextVideo);
+                t0 = std::chrono::steady_clock::now();
+                if (sink.addVideo(video, keyframe, frame.data(), frame.size(), 7, false, keyframe ? 0 : 33)) {
+                    videoSent++;
+                }
+                nextVideo++;
+            }
+            if (timed) {
+                addMs.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0)
+                                    .count());
+            }
+        }
+    }
+};
+
+// Just enough of a Matroska reader to check what RecordingSink writes
+struct MkvBlock {
+    int track;
+    int64_t timeMs;
+    bool keyframe;
+    std::vector<uint8_t> data;
+};
+
+struct MkvFile {
+    std::vector<uint8_t> bytes;
+    uint64_t segmentStart = 0;
+    uint64_t segmentSize = 0;
+    double durationMs = -1.0;
+    std::map<uint32_t, uint64_t> seeks;            // Element id to position in the Segment
+    std::map<int, std::string> codecs;             // Track number to codec id
+    std::map<int, std::vector<uint8_t>> codecPrivate;
+    double sampleRate = 0.0;
+    uint64_t channels = 0;
+    uint64_t pixelWidth = 0;
+    std::vector<MkvBlock> blocks;
+    std::vector<uint64_t> clusterPositions;
+    std::vector<std::pair<uint64_t, uint64_t>> cues; // Time, cluster position
+};
+
+bool readId(const std::vector<uint8_t>& b, size_t& pos, uint32_t& id) {
+    if (pos >= b.size() || b[pos] == 0) return false;
+    int length = 1;
+    while (!(b[pos] & (0x80 >> (length - 1)))) length++;
+    if (length > 4 || pos + length > b.size()) return false;
+    id = 0;
+    for (int i = 0; i < length; ++i) id = id << 8 | b[pos + i];
+    pos += length;
+    return true;
+}
+
+bool readSize(const std::vector<uint8_t>& b, size_t& pos, uint64_t& size) {
+    if (pos >= b.size() || b[pos] == 0) return false;
+    int length = 1;
+    while (!(b[pos] & (0x80 >> (length - 1)))) length++;
+    if (pos + length > b.size()) return false;
+    size = b[pos] & (0xFF >> length);
+    for (int i = 1; i < length; ++i) size = size << 8 | b[pos + i];
+    pos += length;
+    return true;
+}
+
+uint64_t readUint(const std::vector<uint8_t>& b, size_t pos, uint64_t size) {
+    uint64_t value = 0;
+    for (uint64_t i = 0; i < size; ++i) value = value << 8 | b[pos + i];
+    return value;
+}
+
+double readFloat(const std::vector<uint8_t>& b, size_t pos) {
+    uint64_t bits = readUint(b, pos, 8);
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// Calls visit(id, payload offset, size) for each child in [pos, end)
+template <typename Visit>
+bool forEach(const std::vector<uint8_t>& b, size_t pos, size_t end, Visit visit) {
+    while (pos < end) {
+        uint32_t id;
+        uint64_t size;
+        if (!readId(b, pos, id) || !readSize(b, pos, size) || pos + size > end) return false;
+        if (!visit(id, pos, size)) return false;
+        pos += size;
+    }
+    return true;
+}
+
+bool readMkv(const std::string& path, MkvFile& file) {
+    std::ifstream in(path, std::ios::binary);
+    file.bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    const std::vector<uint8_t>& b = file.bytes;
+    size_t pos = 0;
+    uint32_t id;
+    uint64_t size;
+    if (!readId(b, pos, id) || id != kMkvEbml || !readSize(b, pos, size)) return false;
+    std::string docType;
+    forEach(b, pos, pos + size, [&](uint32_t child, size_t at, uint64_t length) {
+        if (child == kMkvDocType) docType.assign((const char*)&b[at], length);
+        return true;
+    });
+    if (docType != "matroska") return false;
+    pos += size;
+    if (!readId(b, pos, id) || id != kMkvSegment || !readSize(b, pos, size)) return false;
+    file.segmentStart = pos;
+    file.segmentSize = size;
+    if (pos + size != b.size()) return false;
+
+    return forEach(b, pos, b.size(), [&](uint32_t element, size_t at, uint64_t length) {
+        if (element == kMkvSeekHead) {
+            return forEach(b, at, at + length, [&](uint32_t, size_t seek, uint64_t seekLength) {
+                uint32_t target = 0;
+                uint64_t position = 0;
+                forEach(b, seek, seek + seekLength, [&](uint32_t field, size_t value, uint64_t valueLength) {
+                    if (field == kMkvSeekId) target = (uint32_t)readUint(b, value, valueLength);
+                    if (field == kMkvSeekPosition) position = readUint(b, value, valueLength);
+                    return true;
+                });
+                file.seeks[target] = position;
+                return true;
+            });
+        }
+        if (element == kMkvInfo) {
+            return forEach(b, at, at + length, [&](uint32_t field, size_t value, uint64_t) {
+                if (field == kMkvDuration) file.durationMs = readFloat(b, value);
+                return true;
+            });
+        }
+        if (element == kMkvTracks) {
+            return forEach(b, at, at + length, [&](uint32_t, size_t entry, uint64_t entryLength) {
+                int track = 0;
+                std::string codec;
+                std::vector<uint8_t> codecPrivate;
+                forEach(b, entry, entry + entryLength, [&](uint32_t field, size_t value, uint64_t valueLength) {
+                    if (field == kMkvTrackNumber) track = (int)readUint(b, value, valueLength);
+                    if (field == kMkvCodecId) codec.assign((const char*)&b[value], valueLength);
+                    if (field == kMkvCodecPrivate) codecPrivate.assign(&b[value], &b[value] + valueLength);
+                    if (field == kMkvAudio || field == kMkvVideo) {
+                        forEach(b, value, value + valueLength, [&](uint32_t setting, size_t v, uint64_t vLength) {
+                            if (setting == kMkvSamplingFrequency) file.sampleRate = readFloat(b, v);
+                            if (setting == kMkvChannels) file.channels = readUint(b, v, vLength);
+                            if (setting == kMkvPixelWidth) file.pixelWidth = readUint(b, v, vLength);
+                            return true;
+                        });
+                    }
+                    return true;
+                });
+                file.codecs[track] = codec;
+                file.codecPrivate[track] = codecPrivate;
+                return true;
+            });
+        }
+        if (element == kMkvCluster) {
+            // Position of the cluster's id, relative to the Segment
+            size_t header = at - 12;
+            file.clusterPositions.push_back(header - file.segmentStart);
+            int64_t clusterMs = 0;
+            return forEach(b, at, at + length, [&](uint32_t field, size_t value, uint64_t valueLength) {
+                if (field == kMkvClusterTimestamp) clusterMs = (int64_t)readUint(b, value, valueLength);
+                if (field == kMkvSimpleBlock) {
+                    MkvBlock block;
+                    block.track = b[value] & 0x7F;
+                    block.timeMs = clusterMs + (int16_t)(b[value + 1] << 8 | b[value + 2]);
+                    block.keyframe = (b[value + 3] & kMkvBlockKeyframe) != 0;
+                    block.data.assign(&b[value + 4], &b[value] + valueLength);
+                    file.blocks.push_back(std::move(block));
+                }
+                return true;
+            });
+        }
+        if (element == kMkvCues) {
+            return forEach(b, at, at + length, [&](uint32_t, size_t point, uint64_t pointLength) {
+                uint64_t time = 0, position = 0;
+                forEach(b, point, point + pointLength, [&](uint32_t field, size_t value, uint64_t valueLength) {
+                    if (field == kMkvCueTime) time = readUint(b, value, valueLength);
+                    if (field == kMkvCueTrackPositions) {
+                        forEach(b, value, value + valueLength, [&](uint32_t f, size_t v, uint64_t vLength) {
+                            if (f == kMkvCueClusterPosition) position = readUint(b, v, vLength);
+                            return true;
+                        });
+                    }
+                    return true;
+                });
+                file.cues.emplace_back(time, position);
+                return true;
+            });
+        }
+        return true;
+    });
+}
+
+// Every inter frame follows the frame before it; a gap is always followed by a keyframe
+void checkDecodable(const MkvFile& file, int gopFrames) {
+    int64_t previous = -1;
+    for (const MkvBlock& block : file.blocks) {
+        if (block.track != 1) continue;
+        uint32_t index = frameIndex(block.data);
+        assert(block.keyframe == (index % gopFrames == 0));
+        if (!block.keyframe) assert((int64_t)index == previous + 1);
+        previous = index;
+    }
+}
+
+double percentile(std::vector<double> values, double p) {
+    if (values.empty()) return 0.0;
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, (size_t)(p * values.size()))];
+}
+
+} // namespace
+
+std::vector<uint8_t> test_file_layout(const std::string& dir, bool ioUring) {
+    std::cout << "Testing the Matroska layout (" << (ioUring ? "io_uring" : "writer thread") << ")..." << std::endl;
+    RecordingSinkConfig config;
+    config.writer.useIoUring = ioUring;
+    config.writer.chunkBytes = 64 * 1024;
+    config.writer.preallocateBytes = 4 * 1024 * 1024;
+    RecordingSink sink(config);
+    std::string path = dir + (ioUring ? "/layout_uring.mkv" : "/layout_thread.mkv");
+    assert(sink.start(path));
+
+    Source source;
+    source.headers(sink);
+    // Nothing is written before the first keyframe
+    std::vector<uint8_t> early = makeFrame(300, 0);
+    assert(!sink.addAudio(source.startMs - 10, early.data(), early.size()));
+    source.run(sink, 10000);
+    RecordingSinkStats stats = sink.getStats();
+    assert(stats.writer.ioUring == ioUring && stats.writer.preallocatedBytes >= 4 * 1024 * 1024);
+    assert(sink.stop());
+    stats = sink.getStats();
+    assert(!stats.recording && stats.droppedPackets == 0 && stats.skippedPackets == 1 && !stats.writer.failed);
+    assert(stats.packets == source.videoSent + source.audioSent && source.videoSent == source.nextVideo);
+
+    MkvFile file;
+    assert(readMkv(path, file));
+    struct stat st;
+    assert(stat(path.c_str(), &st) == 0 && (uint64_t)st.st_size == stats.fileBytes);
+    // The preallocation past the end was given back
+    assert((uint64_t)st.st_blocks * 512 < stats.fileBytes + 64 * 1024);
+    std::cout << file.bytes.size() << " bytes, " << file.blocks.size() << " blocks in "
+              << file.clusterPositions.size() << " clusters; " << stats.writer.writes << " writes, worst "
+              << stats.writer.maxWriteMs << " ms, " << stats.writer.fsyncs << " syncs" << std::endl;
+
+    assert(file.codecs[1] == "V_MPEG4/ISO/AVC" && file.codecs[2] == "A_AAC");
+    assert(file.codecPrivate[1] == std::vector<uint8_t>(kAvcConfig, kAvcConfig + sizeof(kAvcConfig)));
+    assert(file.codecPrivate[2] == std::vector<uint8_t>(kAacConfig, kAacConfig + sizeof(kAacConfig)));
+    assert(file.sampleRate == 44100.0 && file.channels == 2 && file.pixelWidth == 1280);
+
+    // The seek index points at the elements it names
+    for (uint32_t id : {kMkvInfo, kMkvTracks, kMkvCues}) {
+        assert(file.seeks.count(id));
+        size_t pos = file.segmentStart + file.seeks[id];
+        uint32_t found = 0;
+        assert(readId(file.bytes, pos, found) && found == id);
+    }
+
+    // Every packet, intact, at its presentation time from the first keyframe
+    uint32_t video = 0, audio = 0;
+    int64_t lastMs = 0;
+    for (const MkvBlock& block : file.blocks) {
+        lastMs = std::max(lastMs, block.timeMs);
+        if (block.track == 1) {
+            bool keyframe = video % source.gopFrames == 0;
+            assert(block.keyframe == keyframe && frameIndex(block.data) == video);
+            assert(block.data == makeFrame(keyframe ? source.keyframeBytes : source.frameBytes, video));
+            assert(block.timeMs == (int64_t)(source.videoMs(video) - source.startMs) + (keyframe ? 0 : 33));
+            video++;
+        } else {
+            assert(block.track == 2 && block.keyframe && block.data == makeFrame(source.audioBytes, audio));
+            assert(block.timeMs == (int64_t)(source.audioMs(audio) - source.startMs));
+            audio++;
+        }
+    }
+    assert(video == source.nextVideo && audio == source.audioFrames);
+    assert(file.durationMs == (double)lastMs);
+
+    // One cue per keyframe, at a cluster that starts with it
+    assert(file.cues.size() == (source.nextVideo + source.gopFrames - 1) / source.gopFrames);
+    for (const auto& cue : file.cues) {
+        assert(std::find(file.clusterPositions.begin(), file.clusterPositions.end(), cue.second) !=
+               file.clusterPositions.end());
+        assert(cue.first % 1000 == 0);
+    }
+    std::cout << "Layout test passed!" << std::endl;
+    return file.bytes;
+}
+
+void test_stall(const std::string& dir, RecordingDropPolicy policy) {
+    bool block = policy == RecordingDropPolicy::Block;
+    std::cout << "\nTesting a disk stall (" << (block ? "block" : "drop to keyframe") << ")..." << std::endl;
+    std::atomic<bool> stalled{false};
+    RecordingSinkConfig config;
+    config.maxQueuedBytes = 4 * 1024 * 1024;
+    config.dropPolicy = policy;
+    config.maxBlockMs = 20;
+    config.writer.chunkBytes = 128 * 1024;
+    config.writer.beforeWrite = [&](size_t) {
+        while (stalled) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    };
+    RecordingSink sink(config);
+    std::string path = dir + (block ? "/stall_block.mkv" : "/stall_drop.mkv");
+    assert(sink.start(path));
+    Source source;
+    source.keyframeBytes = 100000;
+    source.frameBytes = 20000;
+    source.headers(sink);
+    source.run(sink, 1000);
+
+    // Eight seconds of media is more than the queue holds
+    stalled = true;
+    source.run(sink, 9000, true);
+    RecordingSinkStats during = sink.getStats();
+    double worst = percentile(source.addMs, 1.0);
+    std::cout << "While stalled: " << during.droppedPackets << " packets dropped, " << during.writer.queuedBytes
+              << " bytes queued, worst add " << worst << " ms, longest wait " << during.maxBlockedMs << " ms"
+              << std::endl;
+    assert(during.droppedPackets > 0 && during.writer.queuedBytes <= config.maxQueuedBytes);
+    if (block) {
+        assert(during.maxBlockedMs >= 15 && during.maxBlockedMs < 200);
+    } else {
+        // Never waits on the disk
+        assert(during.maxBlockedMs == 0);
+    }
+
+    // Once the disk is back, at 50x real time, nothing more is lost
+    stalled = false;
+    for (uint32_t endMs = 9100; endMs <= 12000; endMs += 100) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        source.run(sink, endMs);
+    }
+    assert(sink.stop());
+    RecordingSinkStats stats = sink.getStats();
+    assert(stats.droppedPackets == during.droppedPackets && !stats.writer.failed);
+
+    // What is left decodes: recording resumed at a keyframe
+    MkvFile file;
+    assert(readMkv(path, file));
+    checkDecodable(file, source.gopFrames);
+    size_t videoBlocks = std::count_if(file.blocks.begin(), file.blocks.end(), [](const MkvBlock& b) {
+        return b.track == 1;
+    });
+    assert(videoBlocks == source.videoSent && videoBlocks < source.nextVideo);
+    std::cout << "Stall test passed!" << std::endl;
+}
+
+// The same stall with io_uring, where writes are in the kernel: a pipe
+// nobody reads stands in for the disk, since beforeWrite would force the
+// writer thread. Once the ring's slots are taken, add() must still return
+// at once and drop instead.
+void test_ring_stall(const std::string& dir) {
+    std::cout << "\nTesting a disk stall with io_uring..." << std::endl;
+    std::string path = dir + "/stall.fifo";
+    assert(mkfifo(path.c_str(), 0600) == 0);
+    int readFd = open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    assert(readFd >= 0);
+
+    RecordingSinkConfig config;
+    config.dropPolicy = RecordingDropPolicy::DropToKeyframe;
+    RecordingSink sink(config);
+    assert(sink.start(path));
+
+    // Reads once released, or after ten seconds so that a caller stuck on
+    // the ring fails the test instead of hanging it
+    std::atomic<bool> stalled{true};
+    std::atomic<bool> gaveUp{false};
+    std::atomic<uint64_t> drained{0};
+    std::thread reader([&]() {
+        auto stallEnd = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (stalled) {
+            if (std::chrono::steady_clock::now() >= stallEnd) {
+                gaveUp = true;
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        std::vector<uint8_t> buffer(1024 * 1024);
+        for (;;) {
+            pollfd entry = {readFd, POLLIN, 0};
+            poll(&entry, 1, 100);
+            ssize_t n = read(readFd, buffer.data(), buffer.size());
+            if (n > 0) drained += (uint64_t)n;
+            if (n == 0) break; // Writer closed
+        }
+    });
+
+    // About 20 Mbit/s: 30 s of it is more than the ring and the queue hold
+    Source source;
+    source.keyframeBytes = 300000;
+    source.frameBytes = 75000;
+    source.gopFrames = 60;
+    source.headers(sink);
+    source.run(sink, 30000, true);
+    RecordingSinkStats during = sink.getStats();
+    double worst = percentile(source.addMs, 1.0);
+    std::cout << "While stalled: " << during.droppedPackets << " packets dropped, " << during.writer.queuedBytes
+              << " bytes queued, worst add " << worst << " ms" << std::endl;
+    assert(during.writer.ioUring);
+    assert(during.droppedPackets > 0 && during.writer.queuedBytes <= config.maxQueuedBytes);
+    // Feeding finished while the pipe was still stalled: no add() waited
+    // for the reader to give up
+    assert(!gaveUp);
+
+    stalled = false;
+    for (uint32_t endMs = 30100; endMs <= 33000; endMs += 100) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        source.run(sink, endMs);
+    }
+    // A pipe cannot be seeked, so the sizes and index at the end fail;
+    // everything appended still arrives, and recording resumed
+    sink.stop();
+    reader.join();
+    close(readFd);
+    RecordingSinkStats stats = sink.getStats();
+    assert(drained == stats.fileBytes && stats.packets > during.packets);
+    std::cout << "io_uring stall test passed!" << std::endl;
+}
+
+void test_simultaneous(const std::string& dir, bool ioUring) {
+    const int kRecordings = 4;
+    std::cout << "\nBenchmarking " << kRecordings << " simultaneous recordings ("
+              << (ioUring ? "io_uring" : "writer thread") << ")..." << std::endl;
+    RecordingSinkConfig config;
+    config.dropPolicy = RecordingDropPolicy::Block;
+    config.maxBlockMs = 5000;
+    config.writer.useIoUring = ioUring;
+
+    std::vector<std::unique_ptr<RecordingSink>> sinks;
+    std::vector<Source> sources(kRecordings);
+    for (int i = 0; i < kRecordings; ++i) {
+        sinks.emplace_back(new RecordingSink(config));
+        assert(sinks.back()->start(dir + "/bench" + std::to_string(i) + (ioUring ? "u" : "t") + ".mkv"));
+        // About 20 Mbit/s of video, fed as fast as it is taken; 3 s each
+        // keeps the disk traffic at unit-test size
+        sources[i].keyframeBytes = 300000;
+        sources[i].frameBytes = 75000;
+        sources[i].gopFrames = 60;
+        sources[i].headers(*sinks[i]);
+    }
+    auto started = std::chrono::steady_clock::now();
+    std::vector<std::thread> feeders;
+    for (int i = 0; i < kRecordings; ++i) {
+        feeders.emplace_back([&, i]() { sources[i].run(*sinks[i], 3000, true); });
+    }
+    for (auto& feeder : feeders) feeder.join();
+    for (auto& sink : sinks) assert(sink->stop());
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    uint64_t bytes = 0;
+    double maxWriteMs = 0;
+    uint64_t syncs = 0;
+    std::vector<double> latencies;
+    for (int i = 0; i < kRecordings; ++i) {
+        RecordingSinkStats stats = sinks[i]->getStats();
+        assert(stats.droppedPackets == 0 && !stats.writer.failed && stats.writer.ioUring == ioUring);
+        bytes += stats.fileBytes;
+        maxWriteMs = std::max(maxWriteMs, stats.writer.maxWriteMs);
+        syncs += stats.writer.fsyncs;
+        latencies.insert(latencies.end(), sources[i].addMs.begin(), sources[i].addMs.end());
+    }
+    std::cout << bytes / (1024 * 1024) << " MB in " << seconds << " s: " << bytes / seconds / (1024 * 1024)
+              << " MB/s sustained, " << syncs << " syncs; add() p50 " << percentile(latencies, 0.5) * 1000
+              << " us, p99 " << percentile(latencies, 0.99) * 1000 << " us, p99.9 "
+              << percentile(latencies, 0.999) << " ms, max " << percentile(latencies, 1.0)
+              << " ms; slowest write " << maxWriteMs << " ms" << std::endl;
+}
+
+// io_uring may be compiled out, or refused by seccomp (Docker's default
+// profile) or an old kernel; the writer then falls back to its thread
+bool ioUringAvailable(const std::string& dir) {
+    RecordingSinkConfig config;
+    config.writer.useIoUring = true;
+    RecordingSink sink(config);
+    assert(sink.start(dir + "/probe.mkv"));
+    bool available = sink.getStats().writer.ioUring;
+    sink.stop();
+    return available;
+}
+
+int main() {
+    char dirTemplate[] = "/tmp/recordingXXXXXX";
+    std::string dir = mkdtemp(dirTemplate);
+    bool ioUring = ioUringAvailable(dir);
+    std::vector<uint8_t> thread = test_file_layout(dir, false);
+    if (ioUring) {
+        std::vector<uint8_t> ring = test_file_layout(dir, true);
+        // The two backends write the same bytes
+        assert(ring == thread);
+    }
+    test_stall(dir, RecordingDropPolicy::DropToKeyframe);
+    test_stall(dir, RecordingDropPolicy::Block);
+    if (ioUring) {
+        test_ring_stall(dir);
+        test_simultaneous(dir, true);
+    }
+    test_simultaneous(dir, false);
+    std::string cleanup = "rm -rf " + dir;
+    if (std::system(cleanup.c_str()) != 0) {
+        std::cerr << "Failed to remove " << dir << std::endl;
+    }
+    if (!ioUring) {
+        std::cout << "\nWriter-thread tests passed; io_uring is unavailable, so its tests were skipped" << std::endl;
+        return kSkipped;
+    }
+    std::cout << "\nAll recording sink tests passed!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,268 @@
+#include <iostream>
+#include <cassert>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "streaming/ReplayBuffer.h"
+
+namespace {
+
+// Frame payloads carry their index, so a clip can be checked packet by packet
+std::vector<uint8_t> makeFrame(size_t size, uint32_t index) {
+    std::vector<uint8_t> data(size);
+    for (size_t i = 0; i < size; ++i) data[i] = (uint8_t)(index * 13 + i);
+    for (int i = 0; i < 4 && i < (int)size; ++i) data[i] = (uint8_t)(index >> (24 - 8 * i));
+    return data;
+}
+
+uint32_t frameIndex(const uint8_t* data) {
+    return (uint32_t)data[0] << 24 | (uint32_t)data[1] << 16 | (uint32_t)data[2] << 8 | data[3];
+}
+
+// Feeds 30 fps video with a keyframe every gopFrames and 20 ms audio
+// frames, in timestamp order, up to endMs
+struct Source {
+    size_t keyframeBytes = 20000;
+    size_t frameBytes = 4000;
+    size_t audioBytes = 200;
+    int gopFrames = 30;
+    uint32_t nextVideo = 0;
+    uint32_t nextAudioMs = 0;
+
+    void run(ReplayBuffer& buffer, uint32_t endMs) {
+        for (;;) {
+            uint32_t videoMs = nextVideo * 100 / 3;
+            if (videoMs >= endMs && nextAudioMs >= endMs) break;
+            if (nextAudioMs < videoMs || videoMs >= endMs) {
+                std::vector<uint8_t> audio = makeFrame(audioBytes, nextAudioMs);
+                buffer.addAudio(nextAudioMs, audio.data(), audio.size());
+                nextAudioMs += 20;
+                continue;
+            }
+            bool keyframe = nextVideo % gopFrames == 0;
+            std::vector<uint8_t> frame = makeFrame(keyframe ? keyframeBytes : frameBytes, nextVideo);
+            buffer.addVideo(videoMs, keyframe, frame.data(), frame.size());
+            nextVideo++;
+        }
+    }
+};
+
+struct FlvTag {
+    uint8_t type;
+    uint32_t timestampMs;
+    std::vector<uint8_t> data;
+};
+
+// Parses a whole .flv file, checking the framing as it goes
+bool readFlv(const std::string& path, std::vector<FlvTag>& tags) {
+    std::ifstream file(path, std::ios::binary);
+    std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (bytes.size() < 13 || bytes[0] != 'F' || bytes[1] != 'L' || bytes[2] != 'V' || bytes[8] != 9) return false;
+    size_t pos = 13;
+    while (pos < bytes.size()) {
+        if (bytes.size() - pos < 15) return false;
+        const uint8_t* p = bytes.data() + pos;
+        uint32_t size = (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+        uint32_t timestamp = (uint32_t)p[7] << 24 | (uint32_t)p[4] << 16 | (uint32_t)p[5] << 8 | p[6];
+        if (bytes.size() - pos < 15 + size) return false;
+        const uint8_t* end = p + 11 + size;
+        uint32_t previous = (uint32_t)end[0] << 24 | (uint32_t)end[1] << 16 | (uint32_t)end[2] << 8 | end[3];
+        if (previous != 11 + size) return false;
+        tags.push_back(FlvTag{p[0], timestamp, std::vector<uint8_t>(p + 11, end)});
+        pos += 15 + size;
+    }
+    return true;
+}
+
+size_t residentBytes() {
+    std::ifstream statm("/proc/self/statm");
+    size_t total = 0, resident = 0;
+    statm >> total >> resident;
+    return resident * (size_t)sysconf(_SC_PAGESIZE);
+}
+
+} // namespace
+
+void test_window(const std::string& dir) {
+    std::cout << "Testing the time window and whole-GOP eviction..." << std::endl;
+    ReplayBufferConfig config;
+    config.durationMs = 2000;
+    ReplayBuffer buffer(config);
+
+    uint8_t sps[] = {1, 0x42, 0, 0x1f};
+    uint8_t asc[] = {0x12, 0x10};
+    buffer.addVideo(0, true, sps, sizeof(sps), 7, true);
+    buffer.addAudio(0, asc, sizeof(asc), 10, true);
+    // Audio before the first keyframe is not kept
+    std::vector<uint8_t> early = makeFrame(200, 0);
+    buffer.addAudio(0, early.data(), early.size());
+    Source source;
+    source.run(buffer, 10000);
+
+    ReplayBufferStats stats = buffer.getStats();
+    std::cout << stats.packets << " packets, " << stats.bytes << " bytes, window " << stats.windowMs << " ms, "
+              << stats.evictedGops << " GOPs evicted" << std::endl;
+    // Whole GOPs: at least the duration, less than one more GOP
+    assert(stats.windowMs >= 2000 && stats.windowMs < 3000);
+    assert(stats.evictedGops == 7 && stats.skippedPackets == 1);
+
+    // The last 1.5 s, from the keyframe before that point
+    ReplayClip done;
+    std::atomic<bool> called{false};
+    std::string path = dir + "/window.flv";
+    assert(buffer.saveClip(path, 1500, [&](const ReplayClip& clip) {
+        done = clip;
+        called = true;
+    }));
+    buffer.flush();
+    assert(called && done.ok && done.path == path && done.durationMs >= 1500 && done.durationMs < 2500);
+
+    std::vector<FlvTag> tags;
+    assert(readFlv(path, tags) && tags.size() == done.packets + 2);
+    assert(tags[0].type == 9 && tags[0].data[0] == 0x17 && tags[0].data[1] == 0 && tags[0].data.size() == 9);
+    assert(tags[1].type == 8 && tags[1].data[0] == 0xAF && tags[1].data[1] == 0);
+    const FlvTag& first = tags[2];
+    assert(first.type == 9 && first.timestampMs == 0 && first.data[0] == 0x17 && first.data[1] == 1);
+    uint32_t firstFrame = frameIndex(first.data.data() + 5);
+    assert(firstFrame % source.gopFrames == 0);
+
+    // Every video frame from the keyframe on, in order and intact
+    uint32_t expected = firstFrame;
+    uint32_t lastTimestamp = 0;
+    size_t audio = 0;
+    for (size_t i = 2; i < tags.size(); ++i) {
+        const FlvTag& tag = tags[i];
+        assert(tag.timestampMs >= lastTimestamp || tag.type == 8);
+        if (tag.type == 8) {
+            audio++;
+            continue;
+        }
+        lastTimestamp = tag.timestampMs;
+        bool keyframe = expected % source.gopFrames == 0;
+        assert(tag.data[0] == (keyframe ? 0x17 : 0x27));
+        assert(tag.data.size() == 5 + (keyframe ? source.keyframeBytes : source.frameBytes));
+        std::vector<uint8_t> frame = makeFrame(tag.data.size() - 5, expected);
+        assert(std::equal(frame.begin(), frame.end(), tag.data.begin() + 5));
+        expected++;
+    }
+    assert(expected == source.nextVideo && audio > 0);
+    std::cout << "Clip of " << done.packets << " packets, " << done.fileBytes << " bytes, " << done.durationMs
+              << " ms" << std::endl;
+
+    // A clip that cannot be written is reported, and the buffer carries on
+    bool failed = false;
+    assert(buffer.saveClip(dir + "/missing/clip.flv", 0, [&](const ReplayClip& clip) { failed = !clip.ok; }));
+    buffer.flush();
+    assert(failed && buffer.getStats().clipsFailed == 1 && buffer.getStats().clipsWritten == 1);
+    std::cout << "Window test passed!" << std::endl;
+}
+
+void test_byte_bound() {
+    std::cout << "\nTesting the byte bound..." << std::endl;
+    ReplayBufferConfig config;
+    config.durationMs = 60000;
+    config.maxBytes = 300 * 1024;
+    ReplayBuffer buffer(config);
+    Source source;
+    source.run(buffer, 10000);
+    ReplayBufferStats stats = buffer.getStats();
+    std::cout << stats.packets << " packets, " << stats.bytes << " bytes, window " << stats.windowMs << " ms"
+              << std::endl;
+    // A GOP is about 146 KB, so one or two fit
+    assert(stats.bytes <= config.maxBytes && stats.windowMs >= 900 && stats.windowMs < 2000);
+    assert(stats.evictedGops >= 8 && stats.skippedPackets == 0);
+
+    // A GOP bigger than the whole ring is never kept in part
+    ReplayBufferConfig tiny = config;
+    tiny.maxBytes = 64 * 1024;
+    ReplayBuffer small(tiny);
+    Source big;
+    big.run(small, 3000);
+    stats = small.getStats();
+    std::cout << "Ring smaller than a GOP: " << stats.packets << " packets kept, " << stats.skippedPackets
+              << " skipped" << std::endl;
+    assert(stats.skippedPackets > 0 && stats.bytes <= tiny.maxBytes);
+
+    // Index bound too
+    ReplayBufferConfig few = config;
+    few.maxBytes = 8 * 1024 * 1024;
+    few.maxPackets = 100;
+    ReplayBuffer indexed(few);
+    Source counted;
+    counted.run(indexed, 5000);
+    stats = indexed.getStats();
+    assert(stats.packets <= 100 && stats.packets >= 50 && stats.skippedPackets == 0);
+    std::cout << "Byte bound test passed!" << std::endl;
+}
+
+void test_flat_memory(const std::string& dir) {
+    std::cout << "\nTesting memory and add() latency over three simulated hours..." << std::endl;
+    ReplayBufferConfig config;
+    config.durationMs = 30000;
+    config.maxBytes = 16 * 1024 * 1024;
+    ReplayBuffer buffer(config);
+    Source source;
+    source.keyframeBytes = 40000;
+    source.frameBytes = 6000;
+    source.gopFrames = 60;
+
+    // Warm up for ten minutes so the ring and index have been touched
+    source.run(buffer, 10 * 60 * 1000);
+    size_t before = residentBytes();
+
+    double maxAddMs = 0;
+    uint64_t adds = 0;
+    int clips = 0;
+    auto started = std::chrono::steady_clock::now();
+    for (uint32_t minute = 10; minute < 180; ++minute) {
+        // A clip every ten minutes. While it is written the feed slows to
+        // 100x real time, still far ahead of a live encoder.
+        bool clip = minute % 10 == 0;
+        if (clip) {
+            assert(buffer.saveClip(dir + "/clip" + std::to_string(minute) + ".flv", 20000));
+            clips++;
+        }
+        for (uint32_t step = 0; step < 600; ++step) {
+            if (clip && step < 100) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            auto t0 = std::chrono::steady_clock::now();
+            uint32_t first = source.nextVideo;
+            source.run(buffer, minute * 60000 + (step + 1) * 100);
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+            adds += source.nextVideo - first;
+            // 100 ms of media is 3 video and 5 audio adds
+            maxAddMs = std::max(maxAddMs, ms / 8);
+        }
+    }
+    buffer.flush();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    size_t after = residentBytes();
+    ReplayBufferStats stats = buffer.getStats();
+    std::cout << "Resident memory " << before / 1024 << " KB after warm-up, " << after / 1024 << " KB after 3 h; "
+              << adds / seconds << " video frames/s fed, worst average add " << maxAddMs * 1000 << " us; "
+              << stats.clipsWritten << " clips written" << std::endl;
+    assert(stats.clipsWritten == (uint64_t)clips && stats.clipsFailed == 0);
+    assert(stats.bytes <= config.maxBytes && stats.windowMs >= 30000 && stats.windowMs < 32000);
+    assert(after <= before + 1024 * 1024);
+    std::cout << "Flat memory test passed!" << std::endl;
+}
+
+int main() {
+    char dirTemplate[] = "/tmp/replayXXXXXX";
+    std::string dir = mkdtemp(dirTemplate);
+    test_window(dir);
+    test_byte_bound();
+    test_flat_memory(dir);
+    std::string cleanup = "rm -rf " + dir;
+    if (std::system(cleanup.c_str()) != 0) {
+        std::cerr << "Failed to remove " << dir << std::endl;
+    }
+    std::cout << "\nAll replay buffer tests passed!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,623 @@
+#include <iostream>
+#include <cassert>
+#include <cstring>
+#include <chrono>
+#include <atomic>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include "streaming/RtmpPublisher.h"
+#include "streaming/StreamController.h"
+
+// In-process stand-in for an RTMP ingest server: answers the handshake and
+// the connect/createStream/publish commands, then records what arrives.
+class StandInServer {
+public:
+    struct Media {
+        uint8_t typeId;
+        uint32_t timestamp;
+        std::vector<uint8_t> payload; // Only kept when keepPayloads is set
+        size_t size;
+        int session;
+        std::chrono::steady_clock::time_point arrival;
+    };
+
+    std::atomic<bool> pauseReading{false};
+    bool keepPayloads = true;
+
+    std::mutex mutex;
+    std::vector<Media> media;
+    std::string app, streamKey;
+    double metadataWidth = 0;
+    bool pingAnswered = false;
+    bool deleted = false;
+    bool handshakeOk = false;
+    uint64_t mediaBytes = 0;
+    int sessions = 0;
+
+    StandInServer() {
+        listenFd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        assert(::bind(listenFd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0);
+        assert(::listen(listenFd_, 1) == 0);
+        socklen_t length = sizeof(address);
+        getsockname(listenFd_, reinterpret_cast<sockaddr*>(&address), &length);
+        port_ = ntohs(address.sin_port);
+        thread_ = std::thread(&StandInServer::run, this);
+    }
+
+    ~StandInServer() {
+        ::shutdown(listenFd_, SHUT_RDWR);
+        disconnect();
+        thread_.join();
+        ::close(listenFd_);
+    }
+
+    // Drops the current client; the next one is accepted as a new session
+    void disconnect() {
+        int fd = clientFd_;
+        if (fd >= 0) ::shutdown(fd, SHUT_RDWR);
+    }
+
+    int port() const { return port_; }
+    std::string url(const std::string& key) const {
+        return "rtmp://127.0.0.1:" + std::to_string(port_) + "/live/" + key;
+    }
+
+    size_t mediaCount() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return media.size();
+    }
+
+private:
+    bool readExactly(uint8_t* out, size_t size) {
+        size_t done = 0;
+        while (done < size) {
+            ssize_t n = ::recv(clientFd_, out + done, size - done, 0);
+            if (n <= 0) return false;
+            done += (size_t)n;
+        }
+        return true;
+    }
+
+    void send(uint32_t chunkStreamId, RtmpMessageType type, uint32_t streamId, std::vector<uint8_t> payload) {
+        RtmpMessage message;
+        message.chunkStreamId = chunkStreamId;
+        message.typeId = (uint8_t)type;
+        message.streamId = streamId;
+        message.payload = std::move(payload);
+        std::vector<uint8_t> bytes;
+        appendRtmpMessage(bytes, message, chunkSize_);
+        assert(::send(clientFd_, bytes.data(), bytes.size(), MSG_NOSIGNAL) == (ssize_t)bytes.size());
+    }
+
+    void run() {
+        for (;;) {
+            int fd = ::accept(listenFd_, nullptr, nullptr);
+            if (fd < 0) return;
+            clientFd_ = fd;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                sessions++;
+            }
+            session();
+            clientFd_ = -1;
+            ::close(fd);
+        }
+    }
+
+    void session() {
+        chunkSize_ = kRtmpDefaultChunkSize;
+
+        std::vector<uint8_t> c0c1(1 + kRtmpHandshakeSize), c2(kRtmpHandshakeSize);
+        if (!readExactly(c0c1.data(), c0c1.size()) || c0c1[0] != 3) return;
+        std::vector<uint8_t> reply(1 + 2 * kRtmpHandshakeSize, 0);
+        reply[0] = 3;
+        for (size_t i = 9; i <= kRtmpHandshakeSize; ++i) reply[i] = (uint8_t)(i * 7);
+        std::memcpy(reply.data() + 1 + kRtmpHandshakeSize, c0c1.data() + 1, kRtmpHandshakeSize); // S2 echoes C1
+        ::send(clientFd_, reply.data(), reply.size(), MSG_NOSIGNAL);
+        if (!readExactly(c2.data(), c2.size())) return;
+        handshakeOk = std::memcmp(c2.data(), reply.data() + 1, kRtmpHandshakeSize) == 0;
+
+        // Exercise the publisher's reader: a larger chunk size and an ack window
+        send(2, RtmpMessageType::SetChunkSize, 0, {0, 0, 0x10, 0});
+        chunkSize_ = 4096;
+        send(2, RtmpMessageType::WindowAckSize, 0, {0, 0, 0x10, 0});
+
+        RtmpChunkReader reader;
+        std::vector<uint8_t> buffer(256 * 1024);
+        for (;;) {
+            while (pauseReading) std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            ssize_t n = ::recv(clientFd_, buffer.data(), buffer.size(), 0);
+            if (n <= 0) return;
+            std::vector<RtmpMessage> messages;
+            assert(reader.feed(buffer.data(), (size_t)n, messages));
+            for (auto& message : messages) handle(message);
+        }
+    }
+
+    void handle(RtmpMessage& message) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto type = (RtmpMessageType)message.typeId;
+        if (type == RtmpMessageType::Audio || type == RtmpMessageType::Video) {
+            mediaBytes += message.payload.size();
+            Media item{message.typeId, message.timestamp, {}, message.payload.size(), sessions,
+                       std::chrono::steady_clock::now()};
+            if (keepPayloads) item.payload = std::move(message.payload);
+            media.push_back(std::move(item));
+            return;
+        }
+        if (type == RtmpMessageType::UserControl && message.payload.size() >= 6 && message.payload[1] == 7) {
+            pingAnswered = true;
+            return;
+        }
+        std::vector<AmfValue> values;
+        if (type != RtmpMessageType::CommandAmf0 && type != RtmpMessageType::DataAmf0) return;
+        assert(decodeAmf0(message.payload.data(), message.payload.size(), values) && !values.empty());
+        const std::string& name = values[0].string;
+        if (name == "connect") {
+            app = values[2].find("app")->string;
+            Amf0Writer result;
+            result.string("_result").number(values[1].number).null().beginObject()
+                .key("level").string("status").key("code").string("NetConnection.Connect.Success").endObject();
+            send(3, RtmpMessageType::CommandAmf0, 0, result.take());
+        } else if (name == "createStream") {
+            Amf0Writer result;
+            result.string("_result").number(values[1].number).null().number(1);
+            send(3, RtmpMessageType::CommandAmf0, 0, result.take());
+        } else if (name == "publish") {
+            streamKey = values[3].string;
+            bool denied = streamKey == "denied";
+            Amf0Writer status;
+            status.string("onStatus").number(0).null().beginObject()
+                .key("level").string(denied ? "error" : "status")
+                .key("code").string(denied ? "NetStream.Publish.BadName" : "NetStream.Publish.Start").endObject();
+            send(5, RtmpMessageType::CommandAmf0, message.streamId, status.take());
+            send(2, RtmpMessageType::UserControl, 0, {0, 6, 0, 0, 0x12, 0x34}); // Ping request
+        } else if (name == "@setDataFrame") {
+            const AmfValue* width = values.size() >= 3 ? values[2].find("width") : nullptr;
+            metadataWidth = width ? width->number : -1;
+        } else if (name == "deleteStream") {
+            deleted = true;
+        }
+    }
+
+    int listenFd_ = -1;
+    std::atomic<int> clientFd_{-1};
+    int port_ = 0;
+    uint32_t chunkSize_ = kRtmpDefaultChunkSize;
+    std::thread thread_;
+};
+
+RtmpPublisher::Payload makePayload(size_t size, uint8_t seed) {
+    auto data = std::make_shared<std::vector<uint8_t>>(size);
+    for (size_t i = 0; i < size; ++i) (*data)[i] = (uint8_t)(seed + i * 31);
+    return data;
+}
+
+bool waitFor(const std::function<bool()>& condition, int timeoutMs = 5000) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (!condition()) {
+        if (std::chrono::steady_clock::now() > deadline) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    return true;
+}
+
+void test_protocol() {
+    std::cout << "Testing URL parsing, AMF0 and chunking..." << std::endl;
+    RtmpUrl url;
+    assert(RtmpPublisher::parseUrl("rtmp://live.example.com/app/key", url));
+    assert(url.host == "live.example.com" && url.port == 1935 && url.app == "app" && url.streamKey == "key");
+    assert(RtmpPublisher::parseUrl("rtmp://10.0.0.2:1936/live/sub/key?x=1", url));
+    assert(url.port == 1936 && url.app == "live/sub" && url.streamKey == "key?x=1");
+    assert(url.tcUrl == "rtmp://10.0.0.2:1936/live/sub");
+    assert(!RtmpPublisher::parseUrl("http://host/app/key", url));
+    assert(!RtmpPublisher::parseUrl("rtmp://host/appOnly", url));
+    assert(!RtmpPublisher::parseUrl("rtmp://host:99999/app/key", url));
+
+    Amf0Writer writer;
+    writer.string("connect").number(1.5).boolean(true).null().beginObject().key("app").string("live").endObject();
+    std::vector<AmfValue> values;
+    assert(decodeAmf0(writer.data().data(), writer.data().size(), values) && values.size() == 5);
+    assert(values[1].number == 1.5 && values[2].boolean && values[3].type == AmfValue::Type::Null);
+    assert(values[4].find("app")->string == "live");
+    values.clear();
+    assert(!decodeAmf0(writer.data().data(), writer.data().size() - 2, values));
+
+    // A long message on a two-byte chunk stream id with an extended timestamp,
+    // fed one byte at a time
+    RtmpMessage message;
+    message.chunkStreamId = 100;
+    message.timestamp = 0x01234567;
+    message.typeId = 9;
+    message.streamId = 1;
+    message.payload.resize(1000);
+    for (size_t i = 0; i < message.payload.size(); ++i) message.payload[i] = (uint8_t)i;
+    std::vector<uint8_t> bytes;
+    appendRtmpMessage(bytes, message, 128);
+    RtmpChunkReader reader;
+    std::vector<RtmpMessage> out;
+    for (uint8_t byte : bytes) assert(reader.feed(&byte, 1, out));
+    assert(out.size() == 1 && out[0].chunkStreamId == 100 && out[0].timestamp == 0x01234567);
+    assert(out[0].streamId == 1 && out[0].payload == message.payload);
+
+    // A continuation chunk on an unknown stream is rejected
+    uint8_t bogus[] = {0xC7, 0x00};
+    RtmpChunkReader strict;
+    assert(!strict.feed(bogus, sizeof(bogus), out));
+    std::cout << "Protocol test passed!" << std::endl;
+}
+
+void test_publish() {
+    std::cout << "\nTesting a publish session against the stand-in server..." << std::endl;
+    StandInServer server;
+    RtmpPublisherConfig config;
+    config.width = 1280;
+    config.height = 720;
+    config.frameRate = 30;
+    RtmpPublisher publisher(config);
+    assert(publisher.start(server.url("testkey")));
+    assert(publisher.getState() == RtmpPublisher::State::Publishing);
+
+    assert(publisher.sendVideo(0, true, makePayload(40, 1), RtmpPublisher::kFlvVideoAvc, true));
+    assert(publisher.sendAudio(0, makePayload(2, 2), RtmpPublisher::kFlvAudioAac, true));
+    const int frames = 30;
+    for (int i = 0; i < frames; ++i) {
+        size_t size = i % 10 == 0 ? 20000 : 1500 + i * 97; // Keyframes span several chunks
+        assert(publisher.sendVideo(33 * i, i % 10 == 0, makePayload(size, (uint8_t)i), RtmpPublisher::kFlvVideoAvc,
+                                   false, 66));
+        assert(publisher.sendAudio(33 * i + 5, makePayload(300, (uint8_t)(100 + i))));
+    }
+    assert(waitFor([&]() { return server.mediaCount() == 2 + 2 * frames; }));
+    publisher.stop();
+    assert(publisher.getState() == RtmpPublisher::State::Idle);
+    assert(waitFor([&]() {
+        std::lock_guard<std::mutex> lock(server.mutex);
+        return server.deleted;
+    }));
+
+    std::lock_guard<std::mutex> lock(server.mutex);
+    assert(server.handshakeOk && server.app == "live" && server.streamKey == "testkey");
+    assert(server.metadataWidth == 1280 && server.pingAnswered);
+    const auto& media = server.media;
+    std::vector<uint8_t> sequenceHeader = {0x17, 0, 0, 0, 0};
+    assert(std::equal(sequenceHeader.begin(), sequenceHeader.end(), media[0].payload.begin()));
+    assert(media[1].payload[0] == 0xAF && media[1].payload[1] == 0);
+    for (int i = 0; i < frames; ++i) {
+        const auto& video = media[2 + 2 * i];
+        const auto& audio = media[3 + 2 * i];
+        auto expected = makePayload(i % 10 == 0 ? 20000 : 1500 + i * 97, (uint8_t)i);
+        assert(video.typeId == 9 && video.timestamp == (uint32_t)(33 * i));
+        assert(video.payload[0] == (i % 10 == 0 ? 0x17 : 0x27) && video.payload[1] == 1 && video.payload[4] == 66);
+        assert(std::equal(expected->begin(), expected->end(), video.payload.begin() + 5));
+        assert(audio.typeId == 8 && audio.timestamp == (uint32_t)(33 * i + 5) && audio.payload[1] == 1);
+        assert(audio.size == 302);
+    }
+    RtmpPublisherStats stats = publisher.getStats();
+    assert(stats.videoMessages == frames + 1 && stats.audioMessages == frames + 1 && stats.queuedBytes == 0);
+    std::cout << "Publish test passed!" << std::endl;
+}
+
+void test_refusals() {
+    std::cout << "\nTesting refused and failed connections..." << std::endl;
+    {
+        StandInServer server;
+        RtmpPublisher publisher;
+        assert(!publisher.start(server.url("denied")));
+        assert(publisher.getState() == RtmpPublisher::State::Error);
+        assert(!publisher.sendVideo(0, true, makePayload(10, 0)));
+    }
+    int port;
+    {
+        StandInServer closed; // Bound, then gone: nothing listens on the port
+        port = closed.port();
+    }
+    RtmpPublisherConfig config;
+    config.connectTimeoutMs = 2000;
+    RtmpPublisher publisher(config);
+    assert(!publisher.start("rtmp://127.0.0.1:" + std::to_string(port) + "/live/k"));
+
+    StreamController controller;
+    assert(!controller.startStreaming("rtmp://127.0.0.1:" + std::to_string(port) + "/live/k"));
+    assert(controller.getState() == StreamController::State::ERROR);
+    std::cout << "Refusal test passed!" << std::endl;
+}
+
+void test_backpressure() {
+    std::cout << "\nTesting the bounded queue on a stalled server..." << std::endl;
+    StandInServer server;
+    server.keepPayloads = false;
+    RtmpPublisherConfig config;
+    config.maxQueuedBytes = 1024 * 1024;
+    RtmpPublisher publisher(config);
+    assert(publisher.start(server.url("stall")));
+    server.pauseReading = true;
+
+    // Fill the socket buffers and then the queue
+    auto frame = makePayload(256 * 1024, 9);
+    int accepted = 0;
+    while (publisher.sendVideo(accepted, accepted == 0, frame) && accepted < 4000) accepted++;
+    assert(accepted < 4000);
+    RtmpPublisherStats stats = publisher.getStats();
+    assert(stats.droppedVideo == 1 && stats.queuedBytes <= config.maxQueuedBytes);
+
+    server.pauseReading = false;
+    assert(waitFor([&]() { return publisher.getStats().queuedBytes == 0; }));
+    // After a drop, inter frames wait for the next keyframe
+    assert(!publisher.sendVideo(accepted + 1, false, frame));
+    assert(publisher.sendVideo(accepted + 2, true, frame));
+    assert(publisher.sendVideo(accepted + 3, false, frame));
+    assert(waitFor([&]() { return server.mediaCount() == (size_t)accepted + 2; }));
+    stats = publisher.getStats();
+    assert(stats.droppedVideo == 2 && stats.peakQueuedBytes <= config.maxQueuedBytes);
+    std::cout << "Accepted " << accepted << " frames before the queue filled" << std::endl;
+    std::cout << "Backpressure test passed!" << std::endl;
+}
+
+void test_stream_control() {
+    std::cout << "\nTesting bitrate control through StreamController..." << std::endl;
+    StandInServer server;
+    server.keepPayloads = false;
+    RtmpPublisherConfig publisherConfig;
+    publisherConfig.maxQueuedBytes = 1024 * 1024;
+    BitrateControllerConfig controlConfig;
+    controlConfig.recoverHoldMs = 200;
+    StreamController controller;
+    controller.setPublisherConfig(publisherConfig);
+    controller.setBitrateControllerConfig(controlConfig);
+    std::vector<BitrateDecision> decisions;
+    controller.setEncoderControl([&](const BitrateDecision& decision) { decisions.push_back(decision); });
+    assert(controller.startStreaming(server.url("control")));
+    assert(decisions.size() == 1 && decisions[0].targetKbps == controlConfig.startKbps);
+
+    // A stalled peer: the queue cannot drain, so the stream goes to RECOVERING
+    // and frames nothing references are dropped before reaching the publisher
+    server.pauseReading = true;
+    auto frame = makePayload(256 * 1024, 3);
+    for (int i = 0; i < 64; ++i) controller.sendVideo(i, i == 0, frame);
+    assert(waitFor([&]() {
+        controller.updateNetworkStats();
+        return controller.getState() == StreamController::State::RECOVERING;
+    }));
+    // Nothing is acknowledged, so measured throughput and the target fall
+    assert(waitFor([&]() {
+        controller.updateNetworkStats();
+        return controller.getBitrateDecision().targetKbps < controlConfig.startKbps;
+    }));
+    BitrateDecision decision = controller.getBitrateDecision();
+    assert(decision.recovering && decision.dropNonReference && decision.fps == controlConfig.minFps);
+    assert(decisions.back() == decision);
+    assert(!controller.sendVideo(100, false, frame, RtmpPublisher::kFlvVideoAvc, false, 0, true));
+    assert(controller.getDroppedNonReference() == 1);
+    assert(controller.getPublisherStats().socketQueuedBytes > 0);
+
+    server.pauseReading = false;
+    assert(waitFor([&]() {
+        controller.updateNetworkStats();
+        return controller.getState() == StreamController::State::STREAMING;
+    }));
+    assert(!controller.getBitrateDecision().recovering && controller.getPublisherStats().rttMs >= 0.0);
+    assert(controller.getBitrateControllerStats().recoveries == 1);
+    controller.stopStreaming();
+    std::cout << "Stream control test passed!" << std::endl;
+}
+
+void test_fanout() {
+    std::cout << "\nTesting fan-out of one encode to three outputs..." << std::endl;
+    StandInServer first, second, stalled;
+    stalled.keepPayloads = false;
+    const size_t maxQueued = 512 * 1024;
+    std::vector<StreamOutputConfig> outputs(3);
+    outputs[0].url = first.url("one");
+    outputs[1].url = second.url("two");
+    outputs[2].url = stalled.url("three");
+    for (auto& output : outputs) {
+        output.publisher.maxQueuedBytes = maxQueued;
+        output.reconnectDelayMs = 50;
+    }
+    StreamController controller;
+    controller.setGopCacheBytes(0); // Reconnects below wait for a keyframe
+    assert(controller.startStreaming(outputs));
+    stalled.pauseReading = true;
+
+    // One slow endpoint: the others get every packet, it drops on its own
+    std::vector<std::weak_ptr<const std::vector<uint8_t>>> sent;
+    auto header = makePayload(32, 0);
+    assert(controller.sendVideo(0, true, header, RtmpPublisher::kFlvVideoAvc, true));
+    const int frames = 600;
+    for (int i = 0; i < frames; ++i) {
+        auto frame = makePayload(i % 30 == 0 ? 60000 : 16 * 1024, (uint8_t)i);
+        sent.push_back(frame);
+        assert(controller.sendVideo(33 * i, i % 30 == 0, frame));
+        if (i % 100 == 0) controller.updateNetworkStats();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    assert(waitFor([&]() {
+        return first.mediaCount() == frames + 1 && second.mediaCount() == frames + 1;
+    }));
+    std::vector<StreamOutputStatus> status = controller.getOutputStatus();
+    assert(status.size() == 3 && status[0].connected && status[1].connected && status[2].connected);
+    assert(status[0].publisher.droppedVideo == 0 && status[1].publisher.droppedVideo == 0);
+    assert(status[2].publisher.droppedVideo > 0 && status[2].publisher.peakQueuedBytes <= maxQueued);
+    assert(controller.getState() == StreamController::State::STREAMING);
+
+    // Payloads are shared, so only what the stalled output still queues is alive
+    size_t live = 0;
+    for (auto& weak : sent) {
+        if (auto payload = weak.lock()) live += payload->size();
+    }
+    std::cout << "Stalled output dropped " << status[2].publisher.droppedVideo << " frames; " << live
+              << " payload bytes still held for three outputs" << std::endl;
+    assert(live <= maxQueued);
+    stalled.pauseReading = false;
+
+    // The second endpoint drops the connection: only that output reconnects,
+    // gets the sequence header again and waits for a keyframe
+    second.disconnect();
+    assert(waitFor([&]() {
+        StreamOutputStatus again = controller.getOutputStatus()[1];
+        return again.connects == 2 && again.connected && second.mediaCount() == frames + 2;
+    }));
+    auto inter = makePayload(1000, 1);
+    auto keyframe = makePayload(2000, 2);
+    assert(controller.sendVideo(33 * frames, false, inter));
+    assert(controller.sendVideo(33 * (frames + 1), true, keyframe));
+    assert(waitFor([&]() { return first.mediaCount() == frames + 3 && second.mediaCount() == frames + 3; }));
+    status = controller.getOutputStatus();
+    assert(status[0].connects == 1 && status[1].skippedVideo == 1 && status[2].connects == 1);
+    {
+        std::lock_guard<std::mutex> lock(second.mutex);
+        assert(second.sessions == 2);
+        const auto& replayed = second.media[frames + 1].payload;
+        assert(replayed[0] == 0x17 && replayed[1] == 0);
+        const auto& resumed = second.media[frames + 2].payload;
+        assert(resumed[0] == 0x17 && resumed[1] == 1 && resumed.size() == keyframe->size() + 5);
+    }
+    controller.stopStreaming();
+    std::cout << "Fan-out test passed!" << std::endl;
+}
+
+// Streams 100 fps with a 1 s GOP, kills the connection 450 ms into a GOP and
+// returns the time from the kill until the server has a decodable keyframe
+double measureReconnect(size_t gopCacheBytes, double& joinMs) {
+    StandInServer server, joiner;
+    StreamOutputConfig output;
+    output.url = server.url("gop");
+    output.reconnectDelayMs = 20;
+    StreamController controller;
+    controller.setGopCacheBytes(gopCacheBytes);
+    // Already at the top, so nothing after the reconnect changes the decision
+    BitrateControllerConfig bitrate;
+    bitrate.startKbps = bitrate.maxKbps;
+    controller.setBitrateControllerConfig(bitrate);
+    assert(controller.startStreaming(std::vector<StreamOutputConfig>{output}));
+
+    std::atomic<bool> stop{false};
+    std::atomic<int> framesSent{0};
+    std::thread producer([&]() {
+        auto start = std::chrono::steady_clock::now();
+        controller.sendVideo(0, true, makePayload(32, 0), RtmpPublisher::kFlvVideoAvc, true);
+        controller.sendAudio(0, makePayload(4, 0), RtmpPublisher::kFlvAudioAac, true);
+        for (int i = 0; !stop; ++i) {
+            std::this_thread::sleep_until(start + std::chrono::milliseconds(10 * i));
+            bool keyframe = i % 100 == 0;
+            controller.sendVideo(10 * i, keyframe, makePayload(keyframe ? 20000 : 4000, (uint8_t)i));
+            controller.sendAudio(10 * i, makePayload(200, (uint8_t)i));
+            framesSent = i + 1;
+        }
+    });
+
+    // Until the first keyframe of the given session reaches the server
+    auto firstKeyframe = [](StandInServer& target, int session, std::chrono::steady_clock::time_point& at) {
+        std::lock_guard<std::mutex> lock(target.mutex);
+        for (const auto& media : target.media) {
+            if (media.session != session || media.typeId != 9 || media.payload[1] != 1) continue;
+            // The first frame of a new connection must be decodable on its own
+            assert(media.payload[0] >> 4 == 1);
+            at = media.arrival;
+            return true;
+        }
+        return false;
+    };
+
+    assert(waitFor([&]() { return framesSent >= 145; }));
+    auto killed = std::chrono::steady_clock::now();
+    server.disconnect();
+    bool sawRecovering = false;
+    std::chrono::steady_clock::time_point firstFrame;
+    assert(waitFor([&]() {
+        controller.updateNetworkStats();
+        sawRecovering |= controller.getState() == StreamController::State::RECOVERING;
+        return firstKeyframe(server, 2, firstFrame);
+    }));
+    assert(sawRecovering);
+    // A healthy link after the reconnect is back to streaming, even though
+    // the bitrate decision has no reason to change
+    assert(waitFor([&]() {
+        controller.updateNetworkStats();
+        return controller.getState() == StreamController::State::STREAMING;
+    }));
+
+    // A new output joining mid-GOP
+    auto joined = std::chrono::steady_clock::now();
+    StreamOutputConfig late;
+    late.url = joiner.url("late");
+    assert(controller.addOutput(late));
+    std::chrono::steady_clock::time_point joinFrame;
+    assert(waitFor([&]() { return firstKeyframe(joiner, 1, joinFrame); }));
+    joinMs = std::chrono::duration<double, std::milli>(joinFrame - joined).count();
+
+    stop = true;
+    producer.join();
+    controller.stopStreaming();
+    return std::chrono::duration<double, std::milli>(firstFrame - killed).count();
+}
+
+void test_gop_reconnect() {
+    std::cout << "\nTesting time to first frame after a reconnect, with and without the GOP cache..." << std::endl;
+    double joinCachedMs = 0, joinUncachedMs = 0;
+    double cachedMs = measureReconnect(8 * 1024 * 1024, joinCachedMs);
+    double uncachedMs = measureReconnect(0, joinUncachedMs);
+    std::cout << "time to first frame after reconnect: " << cachedMs << " ms from the GOP cache, " << uncachedMs
+              << " ms waiting for a keyframe" << std::endl;
+    std::cout << "time to first frame for a joining output: " << joinCachedMs << " ms from the GOP cache, "
+              << joinUncachedMs << " ms waiting for a keyframe" << std::endl;
+    // Without the cache the next keyframe is about 550 ms after the kill
+    assert(uncachedMs > 400.0 && cachedMs < uncachedMs);
+    assert(joinCachedMs < joinUncachedMs);
+    std::cout << "GOP reconnect test passed!" << std::endl;
+}
+
+void bench_throughput() {
+    std::cout << "\nBenchmarking loopback publishing..." << std::endl;
+    StandInServer server;
+    server.keepPayloads = false;
+    RtmpPublisherConfig config;
+    config.maxQueuedBytes = 16 * 1024 * 1024;
+    RtmpPublisher publisher(config);
+    assert(publisher.start(server.url("bench")));
+
+    const int frames = 600;
+    auto keyframe = makePayload(200 * 1024, 1);
+    auto frame = makePayload(40 * 1024, 2);
+    auto audio = makePayload(400, 3);
+    auto start = std::chrono::steady_clock::now();
+    int sent = 0;
+    for (int i = 0; i < frames; ++i) {
+        // Pace on queue occupancy, as a live producer would, instead of dropping
+        waitFor([&]() { return publisher.getStats().queuedBytes + keyframe->size() < config.maxQueuedBytes; });
+        sent += publisher.sendVideo(i * 33, i % 60 == 0, i % 60 == 0 ? keyframe : frame) ? 1 : 0;
+        sent += publisher.sendAudio(i * 33, audio) ? 1 : 0;
+    }
+    assert(waitFor([&]() { return server.mediaCount() == (size_t)sent; }, 20000));
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    RtmpPublisherStats stats = publisher.getStats();
+    std::cout << "throughput: " << server.mediaBytes / seconds / (1024 * 1024) << " MB/s, "
+              << sent / seconds << " messages/s" << std::endl;
+    std::cout << "send latency: avg " << stats.avgSendLatencyMs << " ms, max " << stats.maxSendLatencyMs
+              << " ms; " << stats.gatherWrites << " gather writes for " << sent << " messages, dropped "
+              << stats.droppedVideo + stats.droppedAudio << std::endl;
+    publisher.stop();
+}
+
+int main() {
+    test_protocol();
+    test_publish();
+    test_refusals();
+    test_backpressure();
+    test_stream_control();
+    test_fanout();
+    test_gop_reconnect();
+    bench_throughput();
+    std::cout << "\nAll RTMP publisher tests passed!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,319 @@
+#include <iostream>
+#include <cassert>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include <time.h>
+#include "streaming/RtpProtocol.h"
+#include "streaming/RtpReceiver.h"
+#include "streaming/RtpSender.h"
+
+namespace {
+
+std::vector<uint8_t> pattern(size_t size, uint32_t seed) {
+    std::vector<uint8_t> data(size);
+    for (size_t i = 0; i < size; ++i) data[i] = (uint8_t)((i * 131 + seed * 7919) >> 3);
+    return data;
+}
+
+// Feeds packets straight into a depacketizer, optionally skipping some
+std::vector<RtpFrame> depacketize(RtpPayloadFormat format, const std::vector<RtpPacketBuffer>& packets,
+                                  size_t count, int skip = -1) {
+    RtpDepacketizer depacketizer(format);
+    std::vector<RtpFrame> frames;
+    for (size_t i = 0; i < count; ++i) {
+        if ((int)i == skip) {
+            depacketizer.markLoss();
+            continue;
+        }
+        RtpHeader header;
+        size_t offset = 0, size = 0;
+        assert(parseRtpHeader(packets[i].data(), packets[i].size(), header, offset, size));
+        depacketizer.push(header, packets[i].data() + offset, size, frames);
+    }
+    return frames;
+}
+
+double cpuSeconds() {
+    timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Sends frames at roughly the given rate and collects what arrives
+struct Transfer {
+    uint64_t sent = 0;
+    uint64_t complete = 0;
+    uint64_t mismatched = 0;
+};
+
+Transfer transfer(RtpSender& sender, RtpReceiver& receiver, int frames, size_t frameBytes, double frameIntervalMs) {
+    Transfer result;
+    std::vector<std::vector<uint8_t>> payloads;
+    for (int i = 0; i < frames; ++i) payloads.push_back(pattern(frameBytes + i % 7, i));
+
+    auto start = std::chrono::steady_clock::now();
+    RtpFrame frame;
+    auto drain = [&](int timeoutMs) {
+        while (receiver.getFrame(frame, timeoutMs)) {
+            uint32_t index = frame.timestamp / 3000;
+            if (!frame.complete) continue;
+            if (index < payloads.size() && frame.data == payloads[index]) {
+                result.complete++;
+            } else {
+                result.mismatched++;
+            }
+        }
+    };
+    for (int i = 0; i < frames; ++i) {
+        auto due = start + std::chrono::microseconds((int64_t)(i * frameIntervalMs * 1000));
+        std::this_thread::sleep_until(due);
+        if (sender.sendVideo(payloads[i].data(), payloads[i].size(), (uint32_t)i * 3000)) result.sent++;
+        drain(0);
+    }
+    drain(300);
+    return result;
+}
+
+} // namespace
+
+void test_packetization() {
+    std::cout << "Testing RTP packetization round trips..." << std::endl;
+
+    // H.264: SPS and PPS as single NAL units, a large IDR through FU-A
+    std::vector<uint8_t> annexB = {0, 0, 0, 1, 0x67, 0x42, 0x00, 0x1f, 0, 0, 0, 1, 0x68, 0xce, 0x3c, 0x80};
+    std::vector<uint8_t> idr = pattern(5000, 1);
+    idr[0] = 0x65;
+    for (uint8_t& byte : idr) {
+        if (byte == 0) byte = 1; // No accidental start codes
+    }
+    annexB.insert(annexB.end(), {0, 0, 0, 1});
+    annexB.insert(annexB.end(), idr.begin(), idr.end());
+
+    RtpPacketizer h264(RtpPayloadFormat::H264, 96, 0x1234, 1200);
+    std::vector<RtpPacketBuffer> packets;
+    size_t count = h264.packetize(annexB.data(), annexB.size(), 9000, packets);
+    assert(count == 2 + (idr.size() - 1 + h264.maxPayload() - 3) / (h264.maxPayload() - 2));
+    for (size_t i = 0; i < count; ++i) assert(packets[i].size() <= 1200);
+    RtpHeader last;
+    size_t offset = 0, size = 0;
+    assert(parseRtpHeader(packets[count - 1].data(), packets[count - 1].size(), last, offset, size));
+    assert(last.marker && last.timestamp == 9000 && last.ssrc == 0x1234 && last.payloadType == 96);
+
+    std::vector<RtpFrame> frames = depacketize(RtpPayloadFormat::H264, packets, count);
+    assert(frames.size() == 1 && frames[0].complete && frames[0].data == annexB);
+    frames = depacketize(RtpPayloadFormat::H264, packets, count, 3);
+    assert(frames.size() == 1 && !frames[0].complete);
+
+    // Opaque frames with offsets, including a lost middle packet
+    std::vector<uint8_t> opaque = pattern(20000, 2);
+    RtpPacketizer fragmented(RtpPayloadFormat::Fragmented, 96, 0x5678, 1200);
+    count = fragmented.packetize(opaque.data(), opaque.size(), 3000, packets);
+    assert(count == (opaque.size() + fragmented.maxPayload() - 5) / (fragmented.maxPayload() - 4));
+    frames = depacketize(RtpPayloadFormat::Fragmented, packets, count);
+    assert(frames.size() == 1 && frames[0].complete && frames[0].data == opaque);
+    frames = depacketize(RtpPayloadFormat::Fragmented, packets, count, 5);
+    assert(frames.size() == 1 && !frames[0].complete);
+
+    // Audio: one frame per packet, nothing over the MTU
+    std::vector<uint8_t> audio = pattern(160, 3);
+    RtpPacketizer opus(RtpPayloadFormat::Audio, 111, 0x9abc, 1200);
+    count = opus.packetize(audio.data(), audio.size(), 960, packets);
+    assert(count == 1);
+    frames = depacketize(RtpPayloadFormat::Audio, packets, count);
+    assert(frames.size() == 1 && frames[0].complete && frames[0].data == audio);
+    std::vector<uint8_t> oversized(2000, 1);
+    assert(opus.packetize(oversized.data(), oversized.size(), 1920, packets) == 0);
+
+    // Sequence numbers continue across frames
+    uint16_t next = opus.nextSequence();
+    count = opus.packetize(audio.data(), audio.size(), 1920, packets);
+    RtpHeader header;
+    assert(parseRtpHeader(packets[0].data(), packets[0].size(), header, offset, size) && header.sequence == next);
+    std::cout << "Packetization test passed!" << std::endl;
+}
+
+void test_nack() {
+    std::cout << "\nTesting RTCP NACK build and parse..." << std::endl;
+    std::vector<uint16_t> lost = {100, 101, 116, 117, 200, 65535, 0};
+    std::vector<uint8_t> packet = buildRtcpNack(1, 0xdeadbeef, lost);
+    assert(packet.size() >= 16 && packet[1] == kRtcpTransportFeedback);
+    uint32_t ssrc = 0;
+    std::vector<uint16_t> parsed;
+    assert(parseRtcpNack(packet.data(), packet.size(), ssrc, parsed));
+    assert(ssrc == 0xdeadbeef);
+    std::sort(parsed.begin(), parsed.end());
+    std::vector<uint16_t> expected = lost;
+    std::sort(expected.begin(), expected.end());
+    assert(parsed == expected);
+    assert(!parseRtcpNack(packet.data(), 8, ssrc, parsed));
+    std::cout << "NACK test passed!" << std::endl;
+}
+
+void test_fec_recovery() {
+    std::cout << "\nTesting XOR parity recovery (4 x 3 matrix)..." << std::endl;
+    RtpFecConfig config;
+    config.columns = 4;
+    config.rows = 3;
+    RtpPacketizer packetizer(RtpPayloadFormat::Fragmented, 96, 0x1111, 1200);
+    RtpFecEncoder encoder(config, 127, 0x2222, 0x1111);
+
+    // Varying lengths so the length recovery is exercised too
+    std::vector<RtpPacketBuffer> media, parity, scratch;
+    for (int frame = 0; frame < 12; ++frame) {
+        std::vector<uint8_t> data = pattern(300 + frame * 37, frame);
+        size_t count = packetizer.packetize(data.data(), data.size(), frame * 3000, scratch);
+        assert(count == 1);
+        media.push_back(scratch[0]);
+    }
+    std::vector<RtpPacketBuffer> out;
+    for (size_t i = 0; i < media.size(); ++i) {
+        RtpHeader header;
+        size_t offset = 0, size = 0;
+        parseRtpHeader(media[i].data(), media[i].size(), header, offset, size);
+        size_t count = encoder.protect(media[i], header.sequence, header.timestamp, out);
+        for (size_t k = 0; k < count; ++k) parity.push_back(out[k]);
+    }
+    assert(parity.size() == 3 + 4); // Three rows, then four columns
+
+    // Rebuilds lost member `target` from the given parity packet
+    auto recover = [&](const RtpPacketBuffer& fec, const std::vector<bool>& lost, size_t target) {
+        RtpHeader header;
+        size_t offset = 0, size = 0;
+        assert(parseRtpHeader(fec.data(), fec.size(), header, offset, size) && header.payloadType == 127);
+        RtpFecHeader fecHeader;
+        assert(parseRtpFecHeader(fec.data() + offset, size, fecHeader) && fecHeader.mediaSsrc == 0x1111);
+        std::vector<std::pair<const uint8_t*, size_t>> others;
+        RtpHeader first;
+        parseRtpHeader(media[0].data(), media[0].size(), first, offset, size);
+        for (int k = 0; k < fecHeader.count; ++k) {
+            size_t index = (uint16_t)(fecHeader.baseSequence - first.sequence) + k * fecHeader.stride;
+            if (!lost[index]) others.emplace_back(media[index].data(), media[index].size());
+        }
+        RtpPacketBuffer rebuilt;
+        assert(others.size() + 1 == fecHeader.count);
+        parseRtpHeader(fec.data(), fec.size(), header, offset, size);
+        assert(recoverRtpFecPacket(fecHeader, fec.data() + offset + kRtpFecHeaderSize, size - kRtpFecHeaderSize,
+                                   others, rebuilt));
+        assert(rebuilt == media[target]);
+    };
+
+    // One loss: its row parity repairs it
+    std::vector<bool> lost(media.size(), false);
+    lost[5] = true;
+    recover(parity[1], lost, 5);
+
+    // Two losses in one row: the row cannot, the columns can
+    lost[5] = false;
+    lost[4] = lost[6] = true;
+    recover(parity[3 + 0], lost, 4);
+    recover(parity[3 + 2], lost, 6);
+    std::cout << "FEC recovery test passed!" << std::endl;
+}
+
+void test_loopback() {
+    std::cout << "\nTesting sender to receiver over loopback..." << std::endl;
+    RtpReceiverConfig receiverConfig;
+    receiverConfig.videoFormat = RtpPayloadFormat::Fragmented;
+    RtpReceiver receiver(receiverConfig);
+    assert(receiver.start() && receiver.port() > 0);
+
+    RtpSenderConfig senderConfig;
+    senderConfig.port = receiver.port();
+    senderConfig.videoFormat = RtpPayloadFormat::Fragmented;
+    RtpSender sender(senderConfig);
+    assert(sender.start() && sender.localPort() > 0);
+
+    Transfer result = transfer(sender, receiver, 100, 30000, 2.0);
+    sender.stop();
+    receiver.stop();
+    RtpSenderStats sent = sender.getStats();
+    RtpReceiverStats received = receiver.getStats();
+    std::cout << result.complete << "/" << result.sent << " frames, " << sent.packetsSent << " packets in "
+              << sent.sendCalls << " sendmmsg calls, GSO " << (sent.gsoActive ? "on" : "off") << std::endl;
+    assert(result.sent == 100 && result.complete == 100 && result.mismatched == 0);
+    assert(received.lostPackets == 0 && received.framesIncomplete == 0);
+    assert(sent.sendCalls < sent.packetsSent);
+
+    std::cout << "Loopback test passed!" << std::endl;
+}
+
+void test_loss_recovery() {
+    std::cout << "\nTesting recovery at 2% injected loss with FEC 5x5 and NACK..." << std::endl;
+    RtpReceiverConfig receiverConfig;
+    receiverConfig.videoFormat = RtpPayloadFormat::Fragmented;
+    receiverConfig.injectedLossRate = 0.02;
+    receiverConfig.seed = 7;
+    RtpReceiver receiver(receiverConfig);
+    assert(receiver.start());
+
+    RtpSenderConfig senderConfig;
+    senderConfig.port = receiver.port();
+    senderConfig.videoFormat = RtpPayloadFormat::Fragmented;
+    senderConfig.fec.columns = 5;
+    senderConfig.fec.rows = 5;
+    senderConfig.pacingKbps = 50000;
+    RtpSender sender(senderConfig);
+    assert(sender.start());
+
+    const int frames = 600;
+    Transfer result = transfer(sender, receiver, frames, 15000, 4.0);
+    sender.stop();
+    receiver.stop();
+    RtpSenderStats sent = sender.getStats();
+    RtpReceiverStats received = receiver.getStats();
+    std::cout << result.complete << "/" << result.sent << " frames complete; " << received.injectedDrops
+              << " packets dropped, " << received.recoveredByFec << " repaired by FEC, " << received.recoveredByNack
+              << " by NACK (" << received.nacksSent << " NACKs, " << sent.retransmitted << " resent), "
+              << received.lostPackets << " lost" << std::endl;
+    // Under load pacing may turn some frames away; what matters is that
+    // the ones sent arrive whole
+    assert(result.sent > 0 && result.mismatched == 0);
+    assert(result.complete * 100 >= result.sent * 99);
+    assert(received.recoveredByFec > 0 && received.recoveredByNack > 0 && sent.fecPackets > 0);
+    std::cout << "Loss recovery test passed!" << std::endl;
+}
+
+void test_throughput() {
+    std::cout << "\nBenchmarking send path..." << std::endl;
+    RtpReceiverConfig receiverConfig;
+    receiverConfig.videoFormat = RtpPayloadFormat::Fragmented;
+    RtpReceiver receiver(receiverConfig);
+    assert(receiver.start());
+
+    RtpSenderConfig senderConfig;
+    senderConfig.port = receiver.port();
+    senderConfig.videoFormat = RtpPayloadFormat::Fragmented;
+    senderConfig.maxQueuedPackets = 8192;
+    RtpSender sender(senderConfig);
+    assert(sender.start());
+
+    double cpuStart = cpuSeconds();
+    auto start = std::chrono::steady_clock::now();
+    Transfer result = transfer(sender, receiver, 400, 60000, 1.0);
+    sender.stop();
+    double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double cpu = cpuSeconds() - cpuStart;
+    receiver.stop();
+    RtpSenderStats sent = sender.getStats();
+    std::cout << sent.packetsSent / wallSeconds << " packets/s, " << sent.packetsSent / cpu
+              << " packets per CPU-second (sender and receiver), " << (double)sent.sendCalls / sent.packetsSent
+              << " sendmmsg calls per packet, " << sent.gsoMessages << " GSO messages, GSO "
+              << (sent.gsoActive ? "on" : "off") << "; " << result.complete << "/" << result.sent << " frames"
+              << std::endl;
+    assert(result.sent > 0 && result.mismatched == 0);
+    std::cout << "Throughput benchmark done!" << std::endl;
+}
+
+int main() {
+    test_packetization();
+    test_nack();
+    test_fec_recovery();
+    test_loopback();
+    test_loss_recovery();
+    test_throughput();
+    std::cout << "\nAll RTP transport tests passed!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,250 @@
+#include <iostream>
+#include <cassert>
+#include <cstring>
+#include <cstdlib>
+#include <chrono>
+#include <memory>
+#include "video/SceneCompositor.h"
+
+// Source that publishes whatever frame the test hands it
+class FakeSource : public VideoSource {
+public:
+    explicit FakeSource(const std::string& name) : name_(name) {}
+    bool start() override { return true; }
+    void stop() override {}
+    std::string getName() const override { return name_; }
+
+    bool getFrame(VideoFrame& frame) override {
+        if (!pending_) return false;
+        frame = frame_;
+        pending_ = false;
+        return true;
+    }
+
+    bool getLatestFrame(VideoFrame& frame) override {
+        if (frame_.empty()) return false;
+        frame = frame_;
+        return true;
+    }
+
+    void publish(const VideoFrame& frame) {
+        frame_ = frame;
+        pending_ = true;
+    }
+
+private:
+    std::string name_;
+    VideoFrame frame_;
+    bool pending_ = false;
+};
+
+VideoFrame solid(int w, int h, uint8_t r, uint8_t g, uint8_t b, uint8_t a = 255) {
+    VideoFrame frame(w, h);
+    for (int y = 0; y < h; ++y) {
+        uint8_t* row = frame.plane(0) + (size_t)y * frame.stride(0);
+        for (int x = 0; x < w; ++x) {
+            row[x * 4] = r;
+            row[x * 4 + 1] = g;
+            row[x * 4 + 2] = b;
+            row[x * 4 + 3] = a;
+        }
+    }
+    return frame;
+}
+
+const uint8_t* pixel(const VideoFrame& frame, int x, int y) {
+    return frame.plane(0) + (size_t)y * frame.stride(0) + (size_t)x * 4;
+}
+
+bool near(const uint8_t* p, int r, int g, int b, int tolerance = 1) {
+    return std::abs(p[0] - r) <= tolerance && std::abs(p[1] - g) <= tolerance && std::abs(p[2] - b) <= tolerance;
+}
+
+SceneDescription pipScene(std::shared_ptr<VideoSource> screen, std::shared_ptr<VideoSource> camera,
+                          int width, int height, const VideoRect& pip) {
+    SceneDescription scene;
+    scene.width = width;
+    scene.height = height;
+    SceneLayer base;
+    base.id = "screen";
+    base.source = screen;
+    base.dest = {0, 0, width, height};
+    SceneLayer cam;
+    cam.id = "camera";
+    cam.source = camera;
+    cam.dest = pip;
+    cam.zOrder = 1;
+    cam.cornerRadius = 12;
+    scene.layers = {cam, base}; // Order in the list does not matter, zOrder does
+    return scene;
+}
+
+void test_picture_in_picture() {
+    std::cout << "Testing picture-in-picture layout..." << std::endl;
+    auto screen = std::make_shared<FakeSource>("screen");
+    auto camera = std::make_shared<FakeSource>("camera");
+    SceneCompositor compositor("pip", 2);
+    compositor.setScene(pipScene(screen, camera, 640, 360, {461, 251, 161, 91}));
+
+    screen->publish(solid(1280, 720, 200, 10, 10));
+    camera->publish(solid(320, 180, 10, 10, 200));
+    VideoFrame out;
+    assert(compositor.renderFrame(out));
+    assert(out.width == 640 && out.height == 360 && !out.unchanged);
+
+    assert(near(pixel(out, 10, 10), 200, 10, 10));     // Screen, downscaled
+    assert(near(pixel(out, 540, 300), 10, 10, 200));   // Camera inside the PiP
+    assert(near(pixel(out, 461, 251), 200, 10, 10));   // Masked-out rounded corner
+    assert(near(pixel(out, 461, 300), 10, 10, 200));   // Straight edge is not masked
+    // Anti-aliased corner edge lies between the two
+    const uint8_t* edge = pixel(out, 461 + 3, 251 + 3);
+    assert(edge[0] < 200 && edge[2] < 200 && edge[3] == 255);
+    std::cout << "PiP test passed!" << std::endl;
+}
+
+void test_static_and_partial_updates() {
+    std::cout << "\nTesting static scene reuse and partial recomposition..." << std::endl;
+    auto screen = std::make_shared<FakeSource>("screen");
+    auto camera = std::make_shared<FakeSource>("camera");
+    SceneCompositor compositor("pip", 2);
+    compositor.setScene(pipScene(screen, camera, 640, 360, {448, 256, 128, 64}));
+
+    VideoFrame screenFrame = solid(640, 360, 0, 120, 0);
+    screen->publish(screenFrame);
+    camera->publish(solid(128, 64, 50, 50, 50));
+    VideoFrame first;
+    compositor.renderFrame(first);
+
+    // Nothing new, and a republished identical buffer: both reuse the canvas
+    VideoFrame second;
+    compositor.renderFrame(second);
+    assert(second.unchanged && second.plane(0) == first.plane(0));
+    screen->publish(screenFrame);
+    camera->publish(solid(128, 64, 50, 50, 50)); // New buffer, same pixels
+    VideoFrame third;
+    compositor.renderFrame(third);
+    assert(third.unchanged);
+    auto stats = compositor.getStats();
+    assert(stats.unchangedFrames == 2 && stats.layerUpdates == 2);
+
+    // The camera changes: only tiles under the PiP are recomposed
+    camera->publish(solid(128, 64, 250, 250, 0));
+    VideoFrame fourth;
+    compositor.renderFrame(fourth);
+    assert(!fourth.unchanged && fourth.plane(0) != first.plane(0));
+    assert(!fourth.dirtyRects.empty());
+    for (const auto& r : fourth.dirtyRects) {
+        assert(r.x >= 448 && r.y >= 256);
+    }
+    assert(near(pixel(fourth, 500, 300), 250, 250, 0));
+    assert(near(pixel(fourth, 100, 100), 0, 120, 0));
+    assert(near(pixel(fourth, 447, 300), 0, 120, 0));
+    std::cout << "Static/partial test passed!" << std::endl;
+}
+
+// Sources are also read by the encoder or the FFI; composing must not take
+// their frames away
+void test_shared_source() {
+    std::cout << "\nTesting a source shared with another consumer..." << std::endl;
+    auto screen = std::make_shared<FakeSource>("screen");
+    auto camera = std::make_shared<FakeSource>("camera");
+    SceneCompositor compositor("pip", 2);
+    compositor.setScene(pipScene(screen, camera, 320, 180, {200, 100, 80, 45}));
+
+    VideoFrame out, taken;
+    for (int i = 0; i < 3; ++i) {
+        screen->publish(solid(320, 180, (uint8_t)(40 * i), 0, 0));
+        camera->publish(solid(80, 45, 0, 0, (uint8_t)(40 * i)));
+        assert(compositor.renderFrame(out));
+        assert(near(pixel(out, 10, 10), 40 * i, 0, 0) && near(pixel(out, 240, 120), 0, 0, 40 * i));
+        // The other consumer still gets each frame, after the compositor
+        assert(screen->getFrame(taken) && near(pixel(taken, 0, 0), 40 * i, 0, 0));
+        assert(camera->getFrame(taken));
+    }
+    // Nothing new since: the canvas is reused
+    assert(compositor.renderFrame(out) && out.unchanged);
+    std::cout << "Shared source test passed!" << std::endl;
+}
+
+void test_opacity_crop_and_order() {
+    std::cout << "\nTesting opacity, crop and z-order..." << std::endl;
+    auto back = std::make_shared<FakeSource>("back");
+    auto front = std::make_shared<FakeSource>("front");
+    SceneCompositor compositor("layers", 1);
+
+    SceneDescription scene;
+    scene.width = 99;
+    scene.height = 37;
+    scene.background[0] = 0;
+    scene.background[1] = 0;
+    scene.background[2] = 0;
+    SceneLayer a;
+    a.id = "back";
+    a.source = back;
+    SceneLayer b;
+    b.id = "front";
+    b.source = front;
+    b.zOrder = 1;
+    b.opacity = 0.5f;
+    b.crop = {100, 0, 100, 100}; // Right half of the source only
+    b.dest = {10, 5, 50, 20};
+    scene.layers = {a, b};
+    compositor.setScene(scene);
+
+    back->publish(solid(99, 37, 200, 0, 0));
+    VideoFrame twoTone = solid(200, 100, 0, 255, 0);
+    for (int y = 0; y < 100; ++y) {
+        for (int x = 100; x < 200; ++x) std::memcpy(twoTone.plane(0) + (size_t)y * twoTone.stride(0) + x * 4, "\x00\x00\xFF\xFF", 4);
+    }
+    front->publish(twoTone);
+
+    VideoFrame out;
+    compositor.renderFrame(out);
+    // Half-transparent blue over red, and no green from the cropped-out half
+    assert(near(pixel(out, 30, 15), 100, 0, 128, 2));
+    assert(near(pixel(out, 5, 5), 200, 0, 0));
+
+    // Put the back layer on top: the overlap is solid red again
+    scene.layers[0].zOrder = 2;
+    compositor.setScene(scene);
+    compositor.renderFrame(out);
+    assert(!out.unchanged && near(pixel(out, 30, 15), 200, 0, 0));
+    std::cout << "Opacity/crop/order test passed!" << std::endl;
+}
+
+void bench_compositor() {
+    std::cout << "\nBenchmarking 1080p screen + 320x180 camera PiP..." << std::endl;
+    auto screen = std::make_shared<FakeSource>("screen");
+    auto camera = std::make_shared<FakeSource>("camera");
+    SceneCompositor compositor("bench");
+    compositor.setScene(pipScene(screen, camera, 1920, 1080, {1560, 860, 320, 180}));
+
+    const int frames = 30;
+    auto run = [&](const char* name, bool newScreen, bool newCamera) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < frames; ++i) {
+            if (newScreen) screen->publish(solid(1920, 1080, i, 100, 100));
+            if (newCamera) camera->publish(solid(640, 360, 100, i, 100));
+            VideoFrame out;
+            compositor.renderFrame(out);
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << name << ": " << ms / frames << " ms/tick (incl. source frame generation)" << std::endl;
+    };
+    run("screen + camera change", true, true);
+    run("camera changes only", false, true);
+    run("static scene", false, false);
+    auto stats = compositor.getStats();
+    std::cout << "avg compose " << stats.avgComposeMs << " ms, avg dirty " << (int)(stats.avgDirtyFraction * 100)
+              << "%, " << stats.unchangedFrames << " unchanged of " << stats.frames << std::endl;
+}
+
+int main() {
+    test_picture_in_picture();
+    test_static_and_partial_updates();
+    test_shared_source();
+    test_opacity_crop_and_order();
+    bench_compositor();
+    std::cout << "\nAll compositor tests passed!" << std::endl;
+    return 0;
+}
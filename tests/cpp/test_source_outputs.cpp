@@ -0,0 +1,215 @@
+#include <iostream>
+#include <cassert>
+#include <cstring>
+#include <cstdlib>
+#include <chrono>
+#include <thread>
+#include "video/SourceOutputs.h"
+#include "video/ScreenSource.h"
+
+VideoFrame gradient(int w, int h) {
+    VideoFrame frame(w, h);
+    for (int y = 0; y < h; ++y) {
+        uint8_t* row = frame.plane(0) + (size_t)y * frame.stride(0);
+        for (int x = 0; x < w; ++x) {
+            row[x * 4] = (uint8_t)x;
+            row[x * 4 + 1] = (uint8_t)y;
+            row[x * 4 + 2] = 0;
+            row[x * 4 + 3] = 255;
+        }
+    }
+    return frame;
+}
+
+void test_geometry_queries() {
+    std::cout << "Testing resolve and capture requirements..." << std::endl;
+    SourceOutputs outputs;
+    SourceOutputConfig thumb;
+    thumb.width = 320;
+    thumb.height = 180;
+    thumb.maxFps = 5;
+    SourceOutputConfig roi;
+    roi.crop = {100, 200, 640, 360};
+    roi.format = VideoFrame::Format::I420;
+    roi.maxFps = 15;
+    int thumbId = outputs.add(thumb);
+    int roiId = outputs.add(roi);
+
+    SourceOutputConfig r = outputs.resolve(roiId, 1920, 1080);
+    assert(r.crop.x == 100 && r.crop.width == 640 && r.width == 640 && r.height == 360);
+    // Crop in 1920x1080 reference coordinates, frame captured at 960x540
+    r = outputs.resolve(roiId, 960, 540, 1920, 1080);
+    assert(r.crop.x == 50 && r.crop.y == 100 && r.crop.width == 320 && r.width == 640);
+
+    VideoRect region = outputs.requiredRegion(1920, 1080);
+    assert(region.x == 0 && region.width == 1920); // The thumbnail spans everything
+    outputs.remove(thumbId);
+    region = outputs.requiredRegion(1920, 1080);
+    assert(region.x == 100 && region.y == 200 && region.width == 640 && region.height == 360);
+
+    // The ROI keeps full detail; the thumbnail alone would need far less
+    ScaleSize needed = outputs.requiredResolution(1920, 1080);
+    assert(needed.width == 1920 && needed.height == 1080);
+    outputs.remove(roiId);
+    outputs.add(thumb);
+    needed = outputs.requiredResolution(1920, 1080);
+    assert(needed.width == 320 && needed.height == 180);
+    assert(outputs.requiredFps() == 5);
+    outputs.add(SourceOutputConfig());
+    assert(outputs.requiredFps() == 0);
+    std::cout << "Geometry test passed!" << std::endl;
+}
+
+void test_publish_and_rates() {
+    std::cout << "\nTesting crop/scale/format and per-output rates..." << std::endl;
+    SourceOutputs outputs;
+    SourceOutputConfig roi;
+    roi.crop = {64, 32, 128, 64};
+    int roiId = outputs.add(roi);
+    SourceOutputConfig half;
+    half.width = 160;
+    half.height = 90;
+    half.format = VideoFrame::Format::NV12;
+    half.maxFps = 10;
+    int halfId = outputs.add(half);
+
+    VideoFrame src = gradient(320, 180);
+    uint64_t ts = 1000000;
+    int roiFrames = 0, halfFrames = 0;
+    for (int i = 0; i < 30; ++i) { // One second at 30 fps
+        src.timestamp = ts + (uint64_t)i * 33333;
+        outputs.publish(src);
+        VideoFrame out;
+        if (outputs.getFrame(roiId, out)) {
+            roiFrames++;
+            assert(out.width == 128 && out.height == 64 && out.format == VideoFrame::Format::RGBA);
+            assert(out.plane(0)[0] == 64 && out.plane(0)[1] == 32); // Crop origin
+            assert(out.plane(0) == src.plane(0) + 32 * src.stride(0) + 64 * 4); // A view, no copy
+        }
+        if (outputs.getFrame(halfId, out)) {
+            halfFrames++;
+            assert(out.width == 160 && out.height == 90 && out.format == VideoFrame::Format::NV12);
+        }
+        assert(!outputs.getFrame(roiId, out)); // Mailboxes are per output
+    }
+    assert(roiFrames == 30);
+    assert(halfFrames == 10);
+    std::cout << "Publish/rate test passed!" << std::endl;
+}
+
+void test_unchanged_reuse_and_colors() {
+    std::cout << "\nTesting unchanged crops and RGBA -> YUV..." << std::endl;
+    SourceOutputs outputs;
+    SourceOutputConfig corner;
+    corner.crop = {0, 0, 64, 64};
+    corner.width = 32;
+    corner.height = 32;
+    corner.format = VideoFrame::Format::I420;
+    int id = outputs.add(corner);
+
+    VideoFrame src(256, 128);
+    for (int y = 0; y < 128; ++y) {
+        uint32_t* row = reinterpret_cast<uint32_t*>(src.plane(0) + (size_t)y * src.stride(0));
+        for (int x = 0; x < 256; ++x) row[x] = 0xFFFFFFFFu; // White
+    }
+    src.timestamp = 1;
+    outputs.publish(src);
+    VideoFrame first;
+    assert(outputs.getFrame(id, first));
+    assert(first.plane(0)[0] == 235 && first.plane(1)[0] == 128 && first.plane(2)[0] == 128);
+
+    // A change outside the crop leaves the output as it was, without work
+    src.timestamp = 2;
+    src.dirtyRects = {{200, 100, 16, 16}};
+    outputs.publish(src);
+    VideoFrame second;
+    assert(outputs.getFrame(id, second));
+    assert(second.unchanged && second.plane(0) == first.plane(0) && second.timestamp == 2);
+
+    // Pure red through the converter
+    VideoFrame red(4, 2);
+    for (int y = 0; y < 2; ++y) {
+        uint32_t* row = reinterpret_cast<uint32_t*>(red.plane(0) + (size_t)y * red.stride(0));
+        for (int x = 0; x < 4; ++x) row[x] = 0xFF0000FFu;
+    }
+    VideoFrame yuv(4, 2, VideoFrame::Format::I420);
+    assert(SourceOutputs::convertFromRgba(red, yuv));
+    assert(std::abs(yuv.plane(0)[0] - 82) <= 1 && std::abs(yuv.plane(1)[0] - 90) <= 1 &&
+           std::abs(yuv.plane(2)[0] - 240) <= 1);
+    std::cout << "Reuse/color test passed!" << std::endl;
+}
+
+void test_screen_source_outputs() {
+    std::cout << "\nTesting two ScreenSource consumers from one capture..." << std::endl;
+    ScreenSource screen(0);
+    SourceOutputConfig thumb;
+    thumb.width = 320;
+    thumb.height = 180;
+    thumb.maxFps = 10;
+    SourceOutputConfig roi;
+    roi.crop = {0, 0, 640, 360};
+    roi.format = VideoFrame::Format::I420;
+    int thumbId = screen.addOutput(thumb);
+    int roiId = screen.addOutput(roi);
+    screen.setFullFrameOutput(false);
+    assert(screen.start());
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+
+    VideoFrame a, b, full;
+    assert(screen.getOutputFrame(thumbId, a) && a.width == 320 && a.height == 180);
+    assert(screen.getOutputFrame(roiId, b) && b.width == 640 && b.format == VideoFrame::Format::I420);
+    assert(!screen.getFrame(full)); // Full-frame output disabled
+    screen.stop();
+    std::cout << "ScreenSource test passed!" << std::endl;
+}
+
+void bench_outputs() {
+    std::cout << "\nBenchmarking 1080p source -> 720p I420 + 180p thumb + 640x360 ROI..." << std::endl;
+    SourceOutputs outputs;
+    SourceOutputConfig hd;
+    hd.width = 1280;
+    hd.height = 720;
+    hd.format = VideoFrame::Format::I420;
+    SourceOutputConfig thumb;
+    thumb.width = 320;
+    thumb.height = 180;
+    thumb.maxFps = 5;
+    SourceOutputConfig roi;
+    roi.crop = {1280, 720, 640, 360};
+    outputs.add(hd);
+    outputs.add(thumb);
+    outputs.add(roi);
+
+    VideoFrame src = gradient(1920, 1080);
+    const int frames = 30;
+    auto run = [&](const char* name, bool changing) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < frames; ++i) {
+            src.timestamp = (uint64_t)(i + 1) * 33333 + (changing ? 0 : 10000000);
+            src.unchanged = !changing && i > 0;
+            outputs.publish(src);
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << name << ": " << ms / frames << " ms/frame" << std::endl;
+    };
+    run("changing content", true);
+    run("static content", false);
+
+    // Baseline: what a consumer paid before, a full-size copy per frame
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < frames; ++i) {
+        VideoFrame copy = src.clone();
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "full 1080p RGBA copy alone: " << ms / frames << " ms/frame" << std::endl;
+}
+
+int main() {
+    test_geometry_queries();
+    test_publish_and_rates();
+    test_unchanged_reuse_and_colors();
+    test_screen_source_outputs();
+    bench_outputs();
+    std::cout << "\nAll source output tests passed!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,253 @@
+#include <iostream>
+#include <cassert>
+#include <cstring>
+#include <cstdlib>
+#include <chrono>
+#include <opencv2/opencv.hpp>
+#include "video/TextOverlay.h"
+
+VideoFrame blank(int w, int h, VideoFrame::Format fmt) {
+    VideoFrame frame(w, h, fmt);
+    for (int i = 0; i < frame.planeCount; ++i) {
+        uint8_t value = fmt == VideoFrame::Format::RGBA ? 0 : (i == 0 ? 16 : 128);
+        for (int y = 0; y < frame.planeHeight(i); ++y) {
+            std::memset(frame.plane(i) + (size_t)y * frame.stride(i), value, frame.planeRowBytes(i));
+        }
+    }
+    if (fmt == VideoFrame::Format::RGBA) {
+        for (int y = 0; y < h; ++y) {
+            for (int x = 0; x < w; ++x) frame.plane(0)[(size_t)y * frame.stride(0) + x * 4 + 3] = 255;
+        }
+    }
+    return frame;
+}
+
+bool samePixels(const VideoFrame& a, const VideoFrame& b) {
+    for (int i = 0; i < a.planeCount; ++i) {
+        for (int y = 0; y < a.planeHeight(i); ++y) {
+            if (std::memcmp(a.plane(i) + (size_t)y * a.stride(i), b.plane(i) + (size_t)y * b.stride(i),
+                            a.planeRowBytes(i)) != 0) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+TextStyle plainStyle() {
+    TextStyle style;
+    style.scale = 1;
+    style.outline[3] = 0;
+    style.padding = 0;
+    return style;
+}
+
+void test_glyph_pixels() {
+    std::cout << "Testing glyph rasterisation and bounding box..." << std::endl;
+    const uint8_t glyphI[5] = {0x00, 0x41, 0x7F, 0x41, 0x00};
+    VideoFrame frame = blank(64, 32, VideoFrame::Format::RGBA);
+    TextOverlay overlay;
+    overlay.addText("I", 3, 4, plainStyle());
+    assert(overlay.apply(frame));
+
+    VideoRect box = TextOverlay::measure("I", plainStyle());
+    assert(box.width == 6 && box.height == 8);
+    for (int y = 0; y < frame.height; ++y) {
+        for (int x = 0; x < frame.width; ++x) {
+            const uint8_t* p = frame.plane(0) + (size_t)y * frame.stride(0) + x * 4;
+            int fx = x - 3, fy = y - 4;
+            bool lit = fx >= 0 && fx < 5 && fy >= 0 && fy < 8 && (glyphI[fx] & (1 << fy));
+            assert(p[0] == (lit ? 255 : 0) && p[3] == 255);
+        }
+    }
+    std::cout << "Glyph test passed!" << std::endl;
+}
+
+void test_incremental_updates() {
+    std::cout << "\nTesting incremental re-rendering..." << std::endl;
+    for (auto fmt : {VideoFrame::Format::RGBA, VideoFrame::Format::I420, VideoFrame::Format::NV12}) {
+        TextOverlay overlay;
+        int id = overlay.addText("12:00:00", 11, 7);
+        VideoFrame first = blank(320, 64, fmt);
+        overlay.apply(first);
+        assert(overlay.getStats().glyphsRendered == 8);
+
+        overlay.setText(id, "12:00:01");
+        VideoFrame second = blank(320, 64, fmt);
+        overlay.apply(second);
+        assert(overlay.getStats().glyphsRendered == 9);
+
+        // Same pixels as rendering the new text from scratch
+        TextOverlay fresh;
+        fresh.addText("12:00:01", 11, 7);
+        VideoFrame reference = blank(320, 64, fmt);
+        fresh.apply(reference);
+        assert(samePixels(second, reference));
+        assert(!samePixels(first, reference));
+    }
+    std::cout << "Incremental test passed!" << std::endl;
+}
+
+void test_yuv_colors() {
+    std::cout << "\nTesting I420 luma/chroma output..." << std::endl;
+    TextStyle style = plainStyle();
+    style.scale = 2;
+    VideoFrame frame = blank(64, 32, VideoFrame::Format::I420);
+    TextOverlay overlay;
+    overlay.addText("I", 5, 3, style); // Snaps to (4, 2)
+    overlay.apply(frame);
+
+    // The stem of "I" is font column 2, rows 0..6
+    assert(frame.plane(0)[(size_t)(2 + 6) * frame.stride(0) + 4 + 4] == 235);
+    assert(frame.plane(0)[(size_t)(2 + 6) * frame.stride(0) + 4 + 2] == 16);
+    assert(frame.plane(0)[(size_t)30 * frame.stride(0) + 60] == 16);
+    for (int i = 1; i < 3; ++i) {
+        for (int y = 0; y < frame.planeHeight(i); ++y) {
+            for (int x = 0; x < frame.planeWidth(i); ++x) {
+                assert(std::abs(frame.plane(i)[(size_t)y * frame.stride(i) + x] - 128) <= 1);
+            }
+        }
+    }
+    std::cout << "I420 test passed!" << std::endl;
+}
+
+void test_fields_and_hints() {
+    std::cout << "\nTesting timestamp field and change hints..." << std::endl;
+    TextOverlay overlay;
+    overlay.addTimestamp(-10, 4);
+    VideoRect box = TextOverlay::measure("2023-11-14 22:13:20.123", TextStyle());
+
+    VideoFrame a = blank(640, 120, VideoFrame::Format::RGBA);
+    a.timestamp = 1700000000123456ULL;
+    a.unchanged = true;
+    overlay.apply(a);
+    assert(!a.unchanged && a.dirtyRects.size() == 1);
+    const VideoRect& r = a.dirtyRects[0];
+    assert(r.x + r.width == 630 && r.y == 4 && r.width == box.width && r.height == box.height);
+
+    TextOverlay literal;
+    literal.addText("2023-11-14 22:13:20.123", 630 - box.width, 4);
+    VideoFrame b = blank(640, 120, VideoFrame::Format::RGBA);
+    literal.apply(b);
+    assert(samePixels(a, b));
+
+    // Same timestamp on an unchanged frame: still unchanged
+    VideoFrame c = blank(640, 120, VideoFrame::Format::RGBA);
+    c.timestamp = a.timestamp;
+    c.unchanged = true;
+    overlay.apply(c);
+    assert(c.unchanged);
+
+    // A newer timestamp dirties only the box; the producer's rects are kept
+    VideoFrame d = blank(640, 120, VideoFrame::Format::RGBA);
+    d.timestamp = a.timestamp + 1000;
+    d.dirtyRects.push_back({0, 100, 16, 16});
+    overlay.apply(d);
+    assert(!d.unchanged && d.dirtyRects.size() == 2);
+    std::cout << "Field/hint test passed!" << std::endl;
+}
+
+// A frame the source still holds is copied, never drawn into
+void test_shared_frames() {
+    std::cout << "\nTesting frames shared with their source..." << std::endl;
+    TextOverlay overlay;
+    overlay.addText("LIVE", 8, 8);
+    VideoFrame source = blank(320, 180, VideoFrame::Format::I420);
+    VideoFrame pristine = source.clone();
+
+    VideoFrame shared = source;
+    assert(overlay.apply(shared));
+    assert(shared.buffer != source.buffer && samePixels(source, pristine) && !samePixels(shared, pristine));
+    assert(overlay.getStats().copiedFrames == 1);
+
+    // Owned frames are drawn in place
+    VideoFrame owned = source.clone();
+    const uint8_t* pixels = owned.plane(0);
+    overlay.apply(owned);
+    assert(owned.plane(0) == pixels && samePixels(owned, shared));
+    assert(overlay.getStats().copiedFrames == 1);
+    std::cout << "Shared frame test passed!" << std::endl;
+}
+
+void bench_overlay() {
+    std::cout << "\nBenchmarking timestamp + name + counter on 1080p..." << std::endl;
+    const int frames = 120;
+    TextStyle style;
+    style.scale = 3;
+    style.background[3] = 128;
+
+    for (auto fmt : {VideoFrame::Format::RGBA, VideoFrame::Format::I420}) {
+        TextOverlay overlay;
+        overlay.addTimestamp(16, 16, style);
+        overlay.addText("Camera 1 (/dev/video0)", -16, 16, style);
+        overlay.addFrameCounter("frame ", 16, -16, style);
+        VideoFrame frame = blank(1920, 1080, fmt);
+        uint64_t ts = 1700000000000000ULL;
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < frames; ++i) {
+            frame.timestamp = ts + (uint64_t)i * 33333;
+            overlay.apply(frame);
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        auto stats = overlay.getStats();
+        std::cout << (fmt == VideoFrame::Format::RGBA ? "RGBA" : "I420") << " glyph atlas: " << ms / frames
+                  << " ms/frame, " << (double)stats.glyphsRendered / frames << " glyphs re-rendered/frame" << std::endl;
+    }
+
+    // Frames still held by their source, as getFrame() hands them out:
+    // a pooled copy, against the clone() it replaced. The last few outputs
+    // stay referenced, as in an encoder's queue.
+    for (auto fmt : {VideoFrame::Format::RGBA, VideoFrame::Format::I420}) {
+        TextOverlay overlay;
+        overlay.addTimestamp(16, 16, style);
+        overlay.addText("Camera 1 (/dev/video0)", -16, 16, style);
+        overlay.addFrameCounter("frame ", 16, -16, style);
+        VideoFrame source = blank(1920, 1080, fmt);
+        uint64_t ts = 1700000000000000ULL;
+
+        VideoFrame queued[4];
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < frames; ++i) {
+            VideoFrame frame = source;
+            frame.timestamp = ts + (uint64_t)i * 33333;
+            overlay.apply(frame);
+            queued[i % 4] = frame;
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < frames; ++i) {
+            queued[i % 4] = source.clone();
+        }
+        double cloneMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        assert(overlay.getStats().copiedFrames == (uint64_t)frames);
+        std::cout << (fmt == VideoFrame::Format::RGBA ? "RGBA" : "I420") << " shared frame: " << ms / frames
+                  << " ms/frame (clone() alone: " << cloneMs / frames << " ms)" << std::endl;
+    }
+
+    // Same three strings through OpenCV on the RGBA frame
+    VideoFrame frame = blank(1920, 1080, VideoFrame::Format::RGBA);
+    cv::Mat mat(1080, 1920, CV_8UC4, frame.plane(0), frame.stride(0));
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < frames; ++i) {
+        cv::putText(mat, "2023-11-14 22:13:20.123", cv::Point(16, 48), cv::FONT_HERSHEY_SIMPLEX, 1.0,
+                    cv::Scalar(255, 255, 255, 255), 2, cv::LINE_AA);
+        cv::putText(mat, "Camera 1 (/dev/video0)", cv::Point(1400, 48), cv::FONT_HERSHEY_SIMPLEX, 1.0,
+                    cv::Scalar(255, 255, 255, 255), 2, cv::LINE_AA);
+        cv::putText(mat, "frame " + std::to_string(i), cv::Point(16, 1060), cv::FONT_HERSHEY_SIMPLEX, 1.0,
+                    cv::Scalar(255, 255, 255, 255), 2, cv::LINE_AA);
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "RGBA cv::putText: " << ms / frames << " ms/frame" << std::endl;
+}
+
+int main() {
+    test_glyph_pixels();
+    test_incremental_updates();
+    test_yuv_colors();
+    test_fields_and_hints();
+    test_shared_frames();
+    bench_overlay();
+    std::cout << "\nAll text overlay tests passed!" << std::endl;
+    return 0;
+}
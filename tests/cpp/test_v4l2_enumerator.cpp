@@ -0,0 +1,136 @@
+#include <iostream>
+#include <cassert>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <cstdlib>
+#include <vector>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "video/V4L2DeviceEnumerator.h"
+
+// Builds a fake /sys/class/video4linux node; no /dev node exists, so the
+// enumerator must rely on sysfs attributes only.
+void addFakeDevice(const std::string& root, int index, const std::string& name, int nodeIndex) {
+    std::string dir = root + "/video" + std::to_string(index);
+    std::string tmp = root + "/.tmp-video" + std::to_string(index);
+    mkdir(tmp.c_str(), 0755);
+    std::ofstream(tmp + "/name") << name << "\n";
+    std::ofstream(tmp + "/index") << nodeIndex << "\n";
+    // Rename into place so the watcher sees a complete node, like udev
+    rename(tmp.c_str(), dir.c_str());
+}
+
+void removeFakeDevice(const std::string& root, int index) {
+    std::string dir = root + "/video" + std::to_string(index);
+    unlink((dir + "/name").c_str());
+    unlink((dir + "/index").c_str());
+    rmdir(dir.c_str());
+}
+
+bool waitForCount(V4L2DeviceEnumerator& enumerator, size_t expected) {
+    for (int i = 0; i < 100; ++i) {
+        if (enumerator.getDevices().size() == expected) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    return false;
+}
+
+int openFdCount() {
+    int count = 0;
+    DIR* dir = opendir("/proc/self/fd");
+    if (!dir) return -1;
+    while (readdir(dir)) count++;
+    closedir(dir);
+    return count;
+}
+
+// Callers such as CameraDeviceManager start the watcher from any thread;
+// racing starts must create one watcher and leak nothing
+void testConcurrentStart(const std::string& sysfs, const std::string& devRoot) {
+    int fdsBefore = openFdCount();
+    for (int round = 0; round < 20; ++round) {
+        V4L2DeviceEnumerator enumerator(sysfs, devRoot);
+        std::vector<std::thread> callers;
+        for (int i = 0; i < 8; ++i) {
+            callers.emplace_back([&enumerator, i]() {
+                bool watching = i % 2 ? enumerator.startWatchingOnce() : enumerator.startWatching();
+                assert(watching);
+            });
+        }
+        for (auto& caller : callers) caller.join();
+        enumerator.stopWatching();
+    }
+    assert(openFdCount() == fdsBefore);
+
+    // Without anything to watch the first attempt fails and is not retried
+    V4L2DeviceEnumerator missing(sysfs + "/absent", devRoot + "/absent");
+    bool first = missing.startWatchingOnce();
+    bool retried = missing.startWatchingOnce();
+    assert(!first && !retried);
+    assert(openFdCount() == fdsBefore);
+    std::cout << "Concurrent startWatching(): OK" << std::endl;
+}
+
+int main() {
+    std::cout << "=== V4L2 Enumerator Test ===" << std::endl;
+
+    char rootTemplate[] = "/tmp/v4l2sysfsXXXXXX";
+    std::string root = mkdtemp(rootTemplate);
+    std::string devRoot = root + "/dev";
+    mkdir(devRoot.c_str(), 0755);
+    std::string sysfs = root + "/video4linux";
+    mkdir(sysfs.c_str(), 0755);
+
+    // UVC-style pair: capture node + metadata node
+    addFakeDevice(sysfs, 0, "Integrated Camera", 0);
+    addFakeDevice(sysfs, 1, "Integrated Camera", 1);
+    addFakeDevice(sysfs, 2, "USB Capture HDMI", 0);
+
+    V4L2DeviceEnumerator enumerator(sysfs, devRoot);
+    auto devices = enumerator.getDevices();
+    assert(devices.size() == 2);
+    assert(devices[0].index == 0 && devices[0].name == "Integrated Camera");
+    assert(devices[1].index == 2 && devices[1].devicePath == devRoot + "/video2");
+
+    // Cached lookups must be cheap
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 1000; ++i) {
+        enumerator.getDevices();
+    }
+    auto perCall = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count() / 1000.0;
+    std::cout << "Cached getDevices(): " << perCall << " us/call" << std::endl;
+    assert(perCall < 1000.0);
+
+    testConcurrentStart(sysfs, devRoot);
+
+    // Hotplug
+    int notifications = 0;
+    bool watching = enumerator.startWatching([&notifications](const std::vector<V4L2DeviceInfo>&) {
+        notifications++;
+    });
+    assert(watching);
+    addFakeDevice(sysfs, 4, "Hotplugged Cam", 0);
+    bool added = waitForCount(enumerator, 3);
+    assert(added);
+    removeFakeDevice(sysfs, 0);
+    bool removed = waitForCount(enumerator, 2);
+    assert(removed);
+    enumerator.stopWatching();
+    assert(notifications >= 2);
+
+    // Full probe cannot open fake nodes but must complete without blocking callers
+    auto probed = enumerator.probeFormatsAsync().get();
+    assert(probed.size() == 2);
+
+    std::string cleanup = "rm -rf " + root;
+    if (std::system(cleanup.c_str()) != 0) {
+        std::cerr << "Failed to remove " << root << std::endl;
+    }
+
+    std::cout << "\nAll tests passed!" << std::endl;
+    return 0;
+}
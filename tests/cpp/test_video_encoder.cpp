@@ -0,0 +1,296 @@
+#include <iostream>
+#include <cassert>
+#include <cstring>
+#include <chrono>
+#include <random>
+#include <atomic>
+#include <thread>
+#include "video/LosslessCodec.h"
+#include "video/VideoEncoder.h"
+#include "video_ffi.h"
+
+// Desktop-like content: flat panels, a gradient and some text-like strokes
+VideoFrame screen(int w, int h, VideoFrame::Format format = VideoFrame::Format::RGBA, int shift = 0) {
+    VideoFrame frame(w, h, format);
+    for (int i = 0; i < frame.planeCount; ++i) {
+        int bytes = frame.planeRowBytes(i);
+        for (int y = 0; y < frame.planeHeight(i); ++y) {
+            uint8_t* row = frame.plane(i) + (size_t)y * frame.stride(i);
+            for (int x = 0; x < bytes; ++x) {
+                int px = x / (format == VideoFrame::Format::RGBA ? 4 : 1) + shift;
+                bool stroke = (y % 24) < 12 && (px % 9) < 2 && px > 40;
+                int v = y < frame.planeHeight(i) / 8 ? 40 : (px < 60 ? 200 : (stroke ? 20 : 235));
+                if (y > frame.planeHeight(i) * 3 / 4) v = (px + y) & 0xFF;
+                row[x] = (uint8_t)(v + (x & 3) * 7 * (format == VideoFrame::Format::RGBA ? 1 : 0));
+            }
+        }
+    }
+    return frame;
+}
+
+VideoFrame noise(int w, int h, unsigned seed) {
+    VideoFrame frame(w, h);
+    std::mt19937 rng(seed);
+    for (int y = 0; y < h; ++y) {
+        uint8_t* row = frame.plane(0) + (size_t)y * frame.stride(0);
+        for (int x = 0; x < w * 4; ++x) row[x] = (uint8_t)rng();
+    }
+    return frame;
+}
+
+bool samePixels(const VideoFrame& a, const VideoFrame& b) {
+    if (a.width != b.width || a.height != b.height || a.format != b.format) return false;
+    for (int i = 0; i < a.planeCount; ++i) {
+        for (int y = 0; y < a.planeHeight(i); ++y) {
+            if (std::memcmp(a.plane(i) + (size_t)y * a.stride(i), b.plane(i) + (size_t)y * b.stride(i),
+                            a.planeRowBytes(i)) != 0) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void test_codec_round_trip() {
+    std::cout << "Testing lossless round trips..." << std::endl;
+    const VideoFrame::Format formats[] = {VideoFrame::Format::RGBA, VideoFrame::Format::I420, VideoFrame::Format::NV12};
+    const int sizes[][2] = {{64, 64}, {33, 17}, {1, 1}, {321, 97}};
+    for (auto format : formats) {
+        for (auto& size : sizes) {
+            for (int sliceRows : {1, 16, 64, 1000}) {
+                VideoFrame frame = screen(size[0], size[1], format);
+                std::vector<uint8_t> coded;
+                assert(LosslessCodec::encode(frame, coded, sliceRows));
+                VideoFrame decoded;
+                assert(LosslessCodec::decode(coded.data(), coded.size(), decoded));
+                assert(samePixels(frame, decoded));
+            }
+        }
+    }
+    // Noise round-trips too, at full residual width
+    VideoFrame random = noise(130, 70, 7);
+    std::vector<uint8_t> coded;
+    assert(LosslessCodec::encode(random, coded));
+    VideoFrame decoded;
+    assert(LosslessCodec::decode(coded.data(), coded.size(), decoded) && samePixels(random, decoded));
+    std::cout << "Round-trip test passed!" << std::endl;
+}
+
+void test_codec_ratio_and_validation() {
+    std::cout << "\nTesting compression and malformed input..." << std::endl;
+    VideoFrame desktop = screen(640, 360);
+    std::vector<uint8_t> coded;
+    assert(LosslessCodec::encode(desktop, coded));
+    double ratio = (double)desktop.packedSize() / coded.size();
+    std::cout << "screen content ratio: " << ratio << std::endl;
+    assert(ratio > 4.0);
+
+    VideoFrame random = noise(640, 360, 3);
+    std::vector<uint8_t> noisy;
+    assert(LosslessCodec::encode(random, noisy));
+    assert(noisy.size() < random.packedSize() * 11 / 10); // Bounded expansion
+
+    VideoFrame decoded;
+    assert(!LosslessCodec::decode(coded.data(), coded.size() - 1, decoded));
+    assert(!LosslessCodec::decode(coded.data(), 10, decoded));
+    std::vector<uint8_t> corrupt = coded;
+    corrupt[0] = 'X';
+    assert(!LosslessCodec::decode(corrupt.data(), corrupt.size(), decoded));
+    std::vector<uint8_t> none;
+    assert(!LosslessCodec::encode(VideoFrame(), none) && none.empty());
+    std::cout << "Ratio/validation test passed!" << std::endl;
+}
+
+void test_pipeline_order() {
+    std::cout << "\nTesting in-order delivery from a worker pool..." << std::endl;
+    VideoEncoderConfig config;
+    config.width = 320;
+    config.height = 180;
+    config.workerCount = 4;
+    VideoEncoder encoder(config);
+    assert(!encoder.submit(screen(320, 180))); // Not started
+    assert(encoder.start());
+    assert(!encoder.submit(screen(64, 64)));   // Wrong size
+
+    const int count = 40;
+    std::vector<VideoFrame> sent;
+    for (int i = 0; i < count; ++i) {
+        // Alternate cheap and expensive frames so workers finish out of order
+        VideoFrame frame = i % 2 ? noise(320, 180, i) : screen(320, 180, VideoFrame::Format::RGBA, i);
+        frame.timestamp = 1000 + i;
+        sent.push_back(frame);
+        assert(encoder.submit(frame, i == 10));
+    }
+    encoder.stop();
+    assert(encoder.getEncodedFrames() == count);
+
+    EncodedPacket packet;
+    for (int i = 0; i < count; ++i) {
+        assert(encoder.getPacket(packet));
+        assert(packet.sequence == (uint64_t)i && packet.timestamp == 1000 + i && packet.keyframe);
+        assert(packet.sceneCut == (i == 10));
+        VideoFrame decoded;
+        assert(LosslessCodec::decode(packet.data.data(), packet.data.size(), decoded));
+        assert(samePixels(sent[i], decoded));
+    }
+    assert(!encoder.getPacket(packet));
+    VideoEncoderStats stats = encoder.getStats();
+    assert(stats.submitted == count && stats.encoded == count && stats.rejected == 2);
+    assert(stats.compressionRatio > 1.0 && stats.avgEncodeMs > 0.0);
+    std::cout << "Order test passed!" << std::endl;
+}
+
+void test_backpressure() {
+    std::cout << "\nTesting backpressure on a slow consumer..." << std::endl;
+    VideoEncoderConfig config;
+    config.width = 160;
+    config.height = 90;
+    config.workerCount = 1;
+    config.maxInFlight = 2;
+    VideoEncoder encoder(config);
+    int delivered = 0;
+    uint64_t expected = 0;
+    bool ordered = true;
+    encoder.setPacketCallback([&](const EncodedPacket& packet) {
+        ordered = ordered && packet.sequence == expected++;
+        delivered++;
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    });
+    assert(encoder.start());
+    VideoFrame frame = screen(160, 90);
+    for (int i = 0; i < 20; ++i) assert(encoder.submit(frame));
+    encoder.stop();
+    VideoEncoderStats stats = encoder.getStats();
+    assert(delivered == 20 && ordered);
+    assert(stats.blockedSubmits > 0);
+    assert(!encoder.submit(frame)); // Stopped
+    std::cout << "Blocked submits: " << stats.blockedSubmits << std::endl;
+    std::cout << "Backpressure test passed!" << std::endl;
+}
+
+void test_ffi() {
+    std::cout << "\nTesting the encoder C API..." << std::endl;
+    assert(!encoder_create(CEncoderConfig{0, 0, 30, 0}));
+    EncoderPipeline* pipeline = encoder_create(CEncoderConfig{64, 48, 30, 2000000});
+    assert(pipeline);
+    std::vector<uint8_t> rgba(64 * 48 * 4, 90), rgb(64 * 48 * 3, 120), i420(64 * 48 * 3 / 2, 60);
+    assert(!encoder_submit_frame(pipeline, rgba.data(), rgba.size(), 0)); // Not started
+    assert(encoder_start(pipeline));
+    assert(encoder_submit_frame(pipeline, rgba.data(), rgba.size(), 0));
+    assert(encoder_submit_frame(pipeline, rgb.data(), rgb.size(), 33333));
+    CFrameHints hints{};
+    hints.force_keyframe = true;
+    assert(encoder_submit_frame_with_hints(pipeline, i420.data(), i420.size(), 66666, &hints));
+    assert(!encoder_submit_frame(pipeline, rgba.data(), 100, 99999)); // Unknown layout
+    assert(encoder_stop(pipeline));
+    assert(encoder_get_encoded_frames(pipeline) == 3);
+    encoder_destroy(pipeline);
+    std::cout << "FFI test passed!" << std::endl;
+}
+
+struct CallbackState {
+    std::atomic<bool> hold{true};
+    std::atomic<int> packets{0};
+    int64_t lastPts = -1;
+    bool ordered = true;
+};
+
+void onPacket(const CEncodedPacket* packet, void* user_data) {
+    auto* state = static_cast<CallbackState*>(user_data);
+    while (state->hold) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    state->ordered = state->ordered && packet->pts > state->lastPts && packet->dts == packet->pts && packet->size > 0;
+    state->lastPts = packet->pts;
+    state->packets++;
+}
+
+void test_ffi_packets() {
+    std::cout << "\nTesting packet output, in-flight limit and flush..." << std::endl;
+    EncoderPipeline* pipeline = encoder_create(CEncoderConfig{64, 48, 30, 0});
+    assert(encoder_set_max_in_flight(pipeline, 2));
+    CallbackState state;
+    assert(encoder_set_packet_callback(pipeline, onPacket, &state));
+    assert(encoder_start(pipeline));
+    assert(!encoder_set_max_in_flight(pipeline, 4)); // Running
+
+    // The callback holds the first packet, so both slots stay taken
+    VideoFrame frame = screen(64, 48);
+    std::vector<uint8_t> rgba(frame.packedSize());
+    frame.copyTo(rgba.data(), rgba.size());
+    assert(encoder_try_submit_frame(pipeline, rgba.data(), rgba.size(), 0, nullptr) == ENCODER_SUBMIT_OK);
+    assert(encoder_try_submit_frame(pipeline, rgba.data(), rgba.size(), 1, nullptr) == ENCODER_SUBMIT_OK);
+    assert(encoder_try_submit_frame(pipeline, rgba.data(), rgba.size(), 2, nullptr) == ENCODER_SUBMIT_WOULD_BLOCK);
+    assert(encoder_try_submit_frame(pipeline, rgba.data(), 7, 2, nullptr) == ENCODER_SUBMIT_WOULD_BLOCK);
+    CEncoderStats stats;
+    assert(encoder_get_stats(pipeline, &stats));
+    assert(stats.in_flight == 2 && stats.max_in_flight == 2 && stats.would_block == 2);
+
+    state.hold = false;
+    assert(encoder_flush(pipeline));
+    assert(state.packets == 2 && state.ordered);
+    assert(encoder_get_stats(pipeline, &stats) && stats.in_flight == 0 && stats.peak_in_flight == 2);
+
+    // Pull mode: borrowed packets decode back to the input
+    assert(encoder_set_packet_callback(pipeline, nullptr, nullptr));
+    CFrameHints cut{};
+    cut.force_keyframe = true;
+    for (int i = 0; i < 2; ++i) {
+        assert(encoder_try_submit_frame(pipeline, rgba.data(), rgba.size(), 10 + i, i ? &cut : nullptr) ==
+               ENCODER_SUBMIT_OK);
+    }
+    assert(encoder_flush(pipeline));
+    assert(encoder_get_stats(pipeline, &stats) && stats.queued_packets == 2);
+    CEncodedPacket packets[2];
+    for (int i = 0; i < 2; ++i) {
+        assert(encoder_receive_packet(pipeline, &packets[i]));
+        assert(packets[i].sequence == (uint64_t)(2 + i) && packets[i].pts == 10 + i && packets[i].keyframe);
+        assert(packets[i].scene_cut == (i == 1));
+    }
+    CEncodedPacket none;
+    assert(!encoder_receive_packet(pipeline, &none));
+    for (auto& packet : packets) {
+        VideoFrame decoded;
+        assert(LosslessCodec::decode(packet.data, packet.size, decoded) && samePixels(frame, decoded));
+        encoder_release_packet(pipeline, &packet);
+        assert(!packet.data && !packet.handle);
+    }
+    assert(encoder_stop(pipeline));
+    assert(encoder_try_submit_frame(pipeline, rgba.data(), rgba.size(), 20, nullptr) == ENCODER_SUBMIT_REJECTED);
+    encoder_destroy(pipeline);
+    std::cout << "Packet output test passed!" << std::endl;
+}
+
+void bench_encoder() {
+    std::cout << "\nBenchmarking 1080p RGBA encoding..." << std::endl;
+    VideoFrame frames[2] = {screen(1920, 1080), screen(1920, 1080, VideoFrame::Format::RGBA, 5)};
+    const int count = 60;
+    for (int workers : {1, 0}) {
+        VideoEncoderConfig config;
+        config.width = 1920;
+        config.height = 1080;
+        config.workerCount = workers;
+        VideoEncoder encoder(config);
+        encoder.setPacketCallback([](const EncodedPacket&) {});
+        assert(encoder.start());
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < count; ++i) encoder.submit(frames[i % 2]);
+        encoder.flush();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        VideoEncoderStats stats = encoder.getStats();
+        std::cout << (workers ? "1 worker: " : "all workers: ") << count / seconds << " fps, "
+                  << stats.avgEncodeMs << " ms/frame, ratio " << stats.compressionRatio << ", latency "
+                  << stats.avgLatencyMs << " ms, peak in flight " << stats.peakInFlight << std::endl;
+        encoder.stop();
+    }
+}
+
+int main() {
+    test_codec_round_trip();
+    test_codec_ratio_and_validation();
+    test_pipeline_order();
+    test_backpressure();
+    test_ffi();
+    test_ffi_packets();
+    bench_encoder();
+    std::cout << "\nAll video encoder tests passed!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,88 @@
+#include <iostream>
+#include <cassert>
+#include <cstring>
+#include <vector>
+#include "video/VideoFrame.h"
+
+void test_aligned_layout() {
+    std::cout << "Testing aligned allocation..." << std::endl;
+
+    VideoFrame rgba(1918, 1080, VideoFrame::Format::RGBA);
+    assert(rgba.planeCount == 1);
+    assert(rgba.isAligned());
+    assert(rgba.stride(0) >= 1918 * 4);
+
+    VideoFrame i420(1281, 721, VideoFrame::Format::I420);
+    assert(i420.planeCount == 3);
+    assert(i420.isAligned());
+    assert(i420.planeWidth(1) == 641 && i420.planeHeight(1) == 361);
+    assert(i420.packedSize() == 1281u * 721 + 2u * 641 * 361);
+
+    VideoFrame nv12(640, 480, VideoFrame::Format::NV12);
+    assert(nv12.planeCount == 2);
+    assert(nv12.planeRowBytes(1) == 640);
+
+    // New frames never expose leftover heap contents, padding included
+    const uint8_t* bytes = i420.buffer->data();
+    for (size_t i = 0; i < i420.buffer->size(); ++i) assert(bytes[i] == 0);
+
+    std::cout << "Aligned allocation test passed!" << std::endl;
+}
+
+void test_wrap_release() {
+    std::cout << "\nTesting external buffer wrapping..." << std::endl;
+
+    std::vector<uint8_t> external(64 * 4 * 16, 7);
+    bool released = false;
+    {
+        VideoFrame frame = VideoFrame::wrap(64, 16, VideoFrame::Format::RGBA,
+                                            external.data(), external.size(), 64 * 4,
+                                            [&released]() { released = true; });
+        assert(frame.plane(0) == external.data());
+        VideoFrame shared = frame;
+        assert(shared.plane(0) == frame.plane(0));
+        frame = VideoFrame();
+        assert(!released);
+    }
+    assert(released);
+
+    std::cout << "External buffer test passed!" << std::endl;
+}
+
+void test_crop_view() {
+    std::cout << "\nTesting crop views..." << std::endl;
+
+    VideoFrame frame(64, 32, VideoFrame::Format::I420);
+    for (int y = 0; y < frame.height; ++y) {
+        std::memset(frame.plane(0) + y * frame.stride(0), y, frame.width);
+    }
+
+    VideoFrame view = frame.crop(9, 5, 16, 8);
+    // Origin is snapped to even coordinates for subsampled formats
+    assert(view.plane(0) == frame.plane(0) + 4 * frame.stride(0) + 8);
+    assert(view.plane(1) == frame.plane(1) + 2 * frame.stride(1) + 4);
+    assert(view.buffer == frame.buffer);
+    assert(view.plane(0)[0] == 4);
+
+    std::vector<uint8_t> packed(view.packedSize());
+    assert(view.copyTo(packed.data(), packed.size()));
+    assert(!view.copyTo(packed.data(), packed.size() - 1));
+    assert(packed[16] == 5);
+
+    VideoFrame writable = view;
+    writable.makeWritable();
+    assert(writable.buffer != frame.buffer);
+    assert(writable.isAligned());
+    assert(writable.plane(0)[writable.stride(0)] == 5);
+
+    std::cout << "Crop view test passed!" << std::endl;
+}
+
+int main() {
+    test_aligned_layout();
+    test_wrap_release();
+    test_crop_view();
+
+    std::cout << "\nAll tests passed!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,171 @@
+#include <iostream>
+#include <cassert>
+#include <cstring>
+#include <cstdlib>
+#include <chrono>
+#include <random>
+#include "video/VideoScaler.h"
+
+void fillPlanes(VideoFrame& frame, uint8_t value) {
+    for (int i = 0; i < frame.planeCount; ++i) {
+        for (int y = 0; y < frame.planeHeight(i); ++y) {
+            std::memset(frame.plane(i) + (size_t)y * frame.stride(i), value, frame.planeRowBytes(i));
+        }
+    }
+}
+
+void fillNoise(VideoFrame& frame, unsigned seed) {
+    std::mt19937 rng(seed);
+    for (int i = 0; i < frame.planeCount; ++i) {
+        for (int y = 0; y < frame.planeHeight(i); ++y) {
+            uint8_t* row = frame.plane(i) + (size_t)y * frame.stride(i);
+            for (int x = 0; x < frame.planeRowBytes(i); ++x) row[x] = (uint8_t)rng();
+        }
+    }
+}
+
+bool allEqual(const VideoFrame& frame, uint8_t value) {
+    for (int i = 0; i < frame.planeCount; ++i) {
+        for (int y = 0; y < frame.planeHeight(i); ++y) {
+            const uint8_t* row = frame.plane(i) + (size_t)y * frame.stride(i);
+            for (int x = 0; x < frame.planeRowBytes(i); ++x) {
+                if (row[x] != value) return false;
+            }
+        }
+    }
+    return true;
+}
+
+int maxDifference(const VideoFrame& a, const VideoFrame& b) {
+    int worst = 0;
+    for (int i = 0; i < a.planeCount; ++i) {
+        for (int y = 0; y < a.planeHeight(i); ++y) {
+            const uint8_t* ra = a.plane(i) + (size_t)y * a.stride(i);
+            const uint8_t* rb = b.plane(i) + (size_t)y * b.stride(i);
+            for (int x = 0; x < a.planeRowBytes(i); ++x) worst = std::max(worst, std::abs(ra[x] - rb[x]));
+        }
+    }
+    return worst;
+}
+
+void test_flat_fields() {
+    std::cout << "Testing flat fields across modes and formats..." << std::endl;
+    VideoScaler scaler(2);
+    for (auto fmt : {VideoFrame::Format::RGBA, VideoFrame::Format::I420, VideoFrame::Format::NV12}) {
+        VideoFrame src(333, 187, fmt);
+        fillPlanes(src, 173);
+        for (auto mode : {ScaleMode::Box, ScaleMode::Bilinear, ScaleMode::Bicubic, ScaleMode::Lanczos}) {
+            for (auto size : {ScaleSize{160, 90}, ScaleSize{37, 21}, ScaleSize{500, 300}}) {
+                VideoFrame dst = scaler.scale(src, size.width, size.height, mode);
+                assert(dst.width == size.width && dst.height == size.height && dst.format == fmt);
+                assert(allEqual(dst, 173));
+            }
+        }
+    }
+    std::cout << "Flat field test passed!" << std::endl;
+}
+
+void test_box_average() {
+    std::cout << "\nTesting 2:1 box average..." << std::endl;
+    VideoScaler scaler(1);
+    VideoFrame src(64, 32, VideoFrame::Format::I420);
+    fillNoise(src, 5);
+    VideoFrame dst = scaler.scale(src, 32, 16, ScaleMode::Box);
+    for (int y = 0; y < 16; ++y) {
+        for (int x = 0; x < 32; ++x) {
+            const uint8_t* s = src.plane(0) + (size_t)(2 * y) * src.stride(0) + 2 * x;
+            int sum = s[0] + s[1] + s[src.stride(0)] + s[src.stride(0) + 1];
+            int got = dst.plane(0)[(size_t)y * dst.stride(0) + x];
+            assert(std::abs(got - sum / 4.0) <= 1.0);
+        }
+    }
+    std::cout << "Box average test passed!" << std::endl;
+}
+
+void test_threads_and_pool() {
+    std::cout << "\nTesting band split and frame pool..." << std::endl;
+    VideoFrame src(1280, 720, VideoFrame::Format::NV12);
+    fillNoise(src, 9);
+
+    // Band boundaries must not show in the output
+    VideoScaler single(1), multi(4);
+    for (auto mode : {ScaleMode::Bilinear, ScaleMode::Lanczos}) {
+        VideoFrame a = single.scale(src, 854, 480, mode);
+        VideoFrame b = multi.scale(src, 854, 480, mode);
+        assert(maxDifference(a, b) == 0);
+    }
+
+    // Released frames are recycled instead of reallocated
+    uint8_t* first;
+    {
+        VideoFrame out = multi.scale(src, 320, 180, ScaleMode::Box);
+        first = out.plane(0);
+    }
+    VideoFrame again = multi.scale(src, 320, 180, ScaleMode::Box);
+    assert(again.plane(0) == first);
+    VideoFrame held = multi.scale(src, 320, 180, ScaleMode::Box);
+    assert(held.plane(0) != again.plane(0));
+    std::cout << "Thread/pool test passed!" << std::endl;
+}
+
+void test_ladder() {
+    std::cout << "\nTesting simulcast ladder..." << std::endl;
+    VideoScaler scaler;
+    VideoFrame src(1920, 1080, VideoFrame::Format::I420);
+    fillNoise(src, 3);
+    src.timestamp = 1234;
+    std::vector<ScaleSize> ladder = {{320, 180}, {1920, 1080}, {1280, 720}, {640, 360}};
+
+    for (auto mode : {ScaleMode::Box, ScaleMode::Lanczos}) {
+        auto levels = scaler.scaleLadder(src, ladder, mode);
+        assert(levels.size() == ladder.size());
+        for (size_t i = 0; i < ladder.size(); ++i) {
+            assert(levels[i].width == ladder[i].width && levels[i].height == ladder[i].height);
+            assert(levels[i].timestamp == 1234);
+        }
+        // The full-size level shares the source pixels
+        assert(levels[1].plane(0) == src.plane(0));
+
+        // Cascaded levels stay close to a direct scale of the source
+        VideoFrame direct = scaler.scale(src, 320, 180, mode);
+        int diff = maxDifference(levels[0], direct);
+        std::cout << "  " << (mode == ScaleMode::Box ? "box" : "lanczos")
+                  << " 180p cascaded vs direct: max diff " << diff << std::endl;
+    }
+    std::cout << "Ladder test passed!" << std::endl;
+}
+
+void bench_ladder() {
+    std::cout << "\nBenchmarking 1080p -> 720p/360p/180p ladder..." << std::endl;
+    const std::vector<ScaleSize> ladder = {{1280, 720}, {640, 360}, {320, 180}};
+    const char* names[] = {"box", "bilinear", "bicubic", "lanczos"};
+    const ScaleMode modes[] = {ScaleMode::Box, ScaleMode::Bilinear, ScaleMode::Bicubic, ScaleMode::Lanczos};
+
+    for (auto fmt : {VideoFrame::Format::I420, VideoFrame::Format::RGBA}) {
+        VideoFrame src(1920, 1080, fmt);
+        fillNoise(src, 1);
+        for (size_t threads : {(size_t)1, (size_t)0}) {
+            VideoScaler scaler(threads);
+            for (int m = 0; m < 4; ++m) {
+                scaler.scaleLadder(src, ladder, modes[m]); // Warm the pool
+                const int iterations = 10;
+                auto start = std::chrono::steady_clock::now();
+                for (int i = 0; i < iterations; ++i) scaler.scaleLadder(src, ladder, modes[m]);
+                double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                std::cout << (fmt == VideoFrame::Format::I420 ? "I420" : "RGBA") << " "
+                          << (threads == 1 ? "1 thread " : "all threads") << " " << names[m] << ": "
+                          << ms / iterations << " ms/ladder" << std::endl;
+            }
+        }
+    }
+}
+
+int main() {
+    test_flat_fields();
+    test_box_average();
+    test_threads_and_pool();
+    test_ladder();
+    bench_ladder();
+    std::cout << "\nAll scaler tests passed!" << std::endl;
+    return 0;
+}